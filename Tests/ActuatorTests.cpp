@@ -0,0 +1,206 @@
+//
+//  ActuatorTests.cpp
+//  VoodooInput host tests
+//
+//  Copyright © 2024 Kishor Prins. All rights reserved.
+//
+
+#include "Test.hpp"
+
+#include "VoodooInputActuatorQueue.hpp"
+#include "VoodooInputSimulator/VoodooInputActuatorCodec.hpp"
+
+// A full 0x53 report, 63 bytes after the id as declared by the actuator descriptor
+static void fillReport(UInt8 (&report)[64], UInt8 command, UInt8 first, UInt8 second) {
+    for (int i = 0; i < 64; i++)
+        report[i] = (UInt8)(0xA0 + i);
+    report[0] = MT2_ACTUATOR_REPORT_ID;
+    report[1] = command;
+    report[2] = first;
+    report[3] = second;
+}
+
+static VoodooInputActuatorCommand dirtyCommand() {
+    VoodooInputActuatorCommand command;
+    memset(&command, 0xEE, sizeof(command));
+    return command;
+}
+
+TEST(DecodesActuate) {
+    UInt8 report[64];
+    fillReport(report, MT2_ACTUATOR_COMMAND_ACTUATE, 0x05, 0x80);
+    VoodooInputActuatorCommand command = dirtyCommand();
+
+    CHECK(MT2DecodeActuatorReport(report, sizeof(report), 1234, command));
+    CHECK_EQ(command.type, kVoodooInputActuatorActuate);
+    CHECK_EQ(command.waveform, 0x05);
+    CHECK_EQ(command.strength, 0x80);
+    CHECK_EQ(command.timestamp, 1234);
+    // Only the leading bytes are kept
+    CHECK_EQ(command.raw_length, VOODOO_INPUT_ACTUATOR_RAW_SIZE);
+    CHECK(memcmp(command.raw, report, VOODOO_INPUT_ACTUATOR_RAW_SIZE) == 0);
+}
+
+TEST(DecodesStrength) {
+    UInt8 report[64];
+    fillReport(report, MT2_ACTUATOR_COMMAND_STRENGTH, 0x40, 0x99);
+    VoodooInputActuatorCommand command = dirtyCommand();
+
+    CHECK(MT2DecodeActuatorReport(report, sizeof(report), 0, command));
+    CHECK_EQ(command.type, kVoodooInputActuatorStrength);
+    CHECK_EQ(command.strength, 0x40);
+    CHECK_EQ(command.waveform, 0);
+
+    // The shortest strength report there can be
+    command = dirtyCommand();
+    CHECK(MT2DecodeActuatorReport(report, 3, 0, command));
+    CHECK_EQ(command.type, kVoodooInputActuatorStrength);
+    CHECK_EQ(command.strength, 0x40);
+    CHECK_EQ(command.raw_length, 3);
+}
+
+TEST(RejectsOtherReportsAndTooShort) {
+    UInt8 report[64];
+    fillReport(report, MT2_ACTUATOR_COMMAND_ACTUATE, 0x05, 0x80);
+    VoodooInputActuatorCommand command = dirtyCommand();
+
+    CHECK(!MT2DecodeActuatorReport(report, 0, 0, command));
+    CHECK(!MT2DecodeActuatorReport(report, 1, 0, command));
+
+    report[0] = 0x3F;
+    CHECK(!MT2DecodeActuatorReport(report, sizeof(report), 0, command));
+}
+
+TEST(TruncatedFieldsAreForwardedRaw) {
+    UInt8 report[64];
+    VoodooInputActuatorCommand command = dirtyCommand();
+
+    // Actuate without its strength byte
+    fillReport(report, MT2_ACTUATOR_COMMAND_ACTUATE, 0x05, 0x80);
+    CHECK(MT2DecodeActuatorReport(report, 3, 0, command));
+    CHECK_EQ(command.type, kVoodooInputActuatorUnknown);
+    CHECK_EQ(command.waveform, 0);
+    CHECK_EQ(command.strength, 0);
+    CHECK_EQ(command.raw_length, 3);
+    CHECK(memcmp(command.raw, report, 3) == 0);
+
+    // Strength without its value
+    fillReport(report, MT2_ACTUATOR_COMMAND_STRENGTH, 0x40, 0);
+    command = dirtyCommand();
+    CHECK(MT2DecodeActuatorReport(report, 2, 0, command));
+    CHECK_EQ(command.type, kVoodooInputActuatorUnknown);
+    CHECK_EQ(command.raw_length, 2);
+}
+
+TEST(UnknownCommandsAreForwardedRaw) {
+    UInt8 report[64];
+    fillReport(report, 0x07, 0x11, 0x22);
+    VoodooInputActuatorCommand command = dirtyCommand();
+
+    CHECK(MT2DecodeActuatorReport(report, sizeof(report), 0, command));
+    CHECK_EQ(command.type, kVoodooInputActuatorUnknown);
+    CHECK_EQ(command.raw[1], 0x07);
+    CHECK_EQ(command.raw[VOODOO_INPUT_ACTUATOR_RAW_SIZE - 1], report[VOODOO_INPUT_ACTUATOR_RAW_SIZE - 1]);
+}
+
+static VoodooInputActuatorCommand actuate(UInt8 waveform) {
+    VoodooInputActuatorCommand command {};
+    command.type = kVoodooInputActuatorActuate;
+    command.waveform = waveform;
+    return command;
+}
+
+static VoodooInputActuatorCommand strength(UInt8 value) {
+    VoodooInputActuatorCommand command {};
+    command.type = kVoodooInputActuatorStrength;
+    command.strength = value;
+    return command;
+}
+
+TEST(QueueKeepsOrder) {
+    VoodooInputActuatorQueue queue;
+    CHECK(queue.init());
+
+    for (UInt8 i = 0; i < 5; i++)
+        CHECK(queue.push(actuate(i)));
+
+    VoodooInputActuatorCommand command;
+    for (UInt8 i = 0; i < 5; i++) {
+        CHECK(queue.pop(command));
+        CHECK_EQ(command.waveform, i);
+    }
+    CHECK(!queue.pop(command));
+    CHECK_EQ(queue.getMaxDepth(), 5);
+    queue.release();
+}
+
+TEST(FullQueueDrops) {
+    VoodooInputActuatorQueue queue;
+    queue.init();
+
+    for (int i = 0; i < ACTUATOR_QUEUE_CAPACITY; i++)
+        CHECK(queue.push(actuate((UInt8)i)));
+    CHECK(!queue.push(actuate(99)));
+    CHECK_EQ(queue.getDropped(), 1);
+
+    // The oldest are still there, wrapping around the ring afterwards works
+    VoodooInputActuatorCommand command;
+    CHECK(queue.pop(command));
+    CHECK_EQ(command.waveform, 0);
+    CHECK(queue.push(actuate(100)));
+    for (int i = 1; i < ACTUATOR_QUEUE_CAPACITY; i++)
+        queue.pop(command);
+    CHECK(queue.pop(command));
+    CHECK_EQ(command.waveform, 100);
+    queue.release();
+}
+
+TEST(StrengthCoalescing) {
+    VoodooInputActuatorQueue queue;
+    queue.init();
+    VoodooInputActuatorCommand command;
+
+    // Same strength again is dropped even after delivery
+    CHECK(queue.push(strength(10)));
+    queue.pop(command);
+    CHECK(queue.push(strength(10)));
+    CHECK(!queue.pop(command));
+    CHECK_EQ(queue.getCoalesced(), 1);
+
+    // A new strength replaces one still waiting at the tail
+    CHECK(queue.push(strength(20)));
+    CHECK(queue.push(strength(30)));
+    CHECK_EQ(queue.getCoalesced(), 2);
+    CHECK(queue.pop(command));
+    CHECK_EQ(command.strength, 30);
+    CHECK(!queue.pop(command));
+
+    // but never one queued before an actuation
+    CHECK(queue.push(strength(40)));
+    CHECK(queue.push(actuate(1)));
+    CHECK(queue.push(strength(50)));
+    CHECK(queue.pop(command));
+    CHECK_EQ(command.strength, 40);
+    CHECK(queue.pop(command));
+    CHECK_EQ(command.type, kVoodooInputActuatorActuate);
+    CHECK(queue.pop(command));
+    CHECK_EQ(command.strength, 50);
+    queue.release();
+}
+
+TEST(DeliveryLatencyStatistics) {
+    VoodooInputActuatorQueue queue;
+    queue.init();
+
+    queue.recordDelivery(8000);
+    CHECK_EQ(queue.getAverageLatency(), 8000);
+    queue.recordDelivery(16000);
+    CHECK_EQ(queue.getAverageLatency(), 9000);
+    queue.recordDelivery(1000);
+    CHECK_EQ(queue.getWorstLatency(), 16000);
+
+    queue.init();
+    CHECK_EQ(queue.getAverageLatency(), 0);
+    CHECK_EQ(queue.getWorstLatency(), 0);
+    queue.release();
+}
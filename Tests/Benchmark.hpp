@@ -0,0 +1,56 @@
+//
+//  Benchmark.hpp
+//  VoodooInput host tests
+//
+//  Copyright © 2024 Kishor Prins. All rights reserved.
+//
+
+#ifndef VOODOO_INPUT_BENCHMARK_HPP
+#define VOODOO_INPUT_BENCHMARK_HPP
+
+#include "HostShim.hpp"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+/*
+ * Benchmarks print one row per configuration. The iteration count is the first
+ * argument, ctest runs them with a small one so they only need to work there.
+ * Each configuration runs BENCHMARK_ROUNDS times and the fastest round is kept,
+ * which takes out warm up and most of the noise of a shared machine.
+ */
+
+#define BENCHMARK_ROUNDS 5
+
+static inline UInt32 BenchmarkIterations(int argc, char** argv, UInt32 fallback) {
+    return argc > 1 ? (UInt32)strtoul(argv[1], nullptr, 10) : fallback;
+}
+
+// Keeps results alive without the compiler seeing through it
+template <typename T>
+static inline void BenchmarkKeep(const T& value) {
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+static inline void BenchmarkHeader(const char* title) {
+    printf("%-40s %12s %14s\n", title, "ns/op", "ops/s");
+}
+
+// Fastest of BENCHMARK_ROUNDS calls of round(), which returns the ns it took
+template <typename Round>
+static inline UInt64 BenchmarkBest(Round round) {
+    UInt64 best = ~0ULL;
+    for (int i = 0; i < BENCHMARK_ROUNDS; i++) {
+        UInt64 elapsed = round();
+        if (elapsed < best)
+            best = elapsed;
+    }
+    return best;
+}
+
+static inline void BenchmarkRow(const char* name, UInt64 elapsed_ns, UInt64 operations) {
+    double per_op = operations ? (double)elapsed_ns / operations : 0;
+    printf("%-40s %12.2f %14.0f\n", name, per_op, per_op > 0 ? 1e9 / per_op : 0);
+}
+
+#endif // VOODOO_INPUT_BENCHMARK_HPP
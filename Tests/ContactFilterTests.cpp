@@ -0,0 +1,119 @@
+//
+//  ContactFilterTests.cpp
+//  VoodooInput host tests
+//
+//  Copyright © 2024 Kishor Prins. All rights reserved.
+//
+
+#include "Test.hpp"
+
+#include "VoodooInputSimulator/VoodooInputContactFilter.hpp"
+
+// 125 Hz
+#define PERIOD_US 8000
+
+static SInt32 distance(SInt32 a, SInt32 b) {
+    return a > b ? a - b : b - a;
+}
+
+static SInt32 filterX(VoodooInputContactFilter& filter, UInt32 time_us, SInt32 x) {
+    SInt32 y = 0;
+    filter.update(0, time_us, x, y);
+    return x;
+}
+
+TEST(FirstSamplePassesThrough) {
+    VoodooInputContactFilter filter;
+    SInt32 x = 1234, y = 567;
+
+    filter.update(3, 1000, x, y);
+    CHECK_EQ(x, 1234);
+    CHECK_EQ(y, 567);
+    CHECK_EQ(filter.getSpeed(3), 0);
+
+    // So does the first one after a reset or a long gap
+    filterX(filter, 0, 100);
+    filter.reset(0);
+    CHECK_EQ(filterX(filter, PERIOD_US, 900), 900);
+    CHECK_EQ(filterX(filter, PERIOD_US + CONTACT_FILTER_MAX_GAP_US + 1, 10), 10);
+}
+
+TEST(RestingJitterIsSmoothed) {
+    VoodooInputContactFilter filter;
+    SInt32 low = 0x7FFFFFFF, high = 0;
+
+    for (UInt32 i = 0; i < 200; i++) {
+        SInt32 x = filterX(filter, i * PERIOD_US, i & 1 ? 1004 : 996);
+        if (i > 100) {
+            low = min(low, x);
+            high = max(high, x);
+        }
+    }
+    CHECK(high - low < 4);
+}
+
+TEST(LagIsBounded) {
+    const UInt32 betas[] = {0, CONTACT_FILTER_DEFAULT_BETA, 100};
+
+    for (UInt32 beta : betas) {
+        VoodooInputContactFilter filter;
+        filter.configure(CONTACT_FILTER_DEFAULT_MIN_CUTOFF, beta);
+
+        // Swipe right at up to 200 MT2 units per frame, then rest
+        SInt32 raw = 0, output = 0, worst = 0;
+        UInt32 time_us = 0;
+        for (SInt32 step = 0; step <= 200; step += 10, time_us += PERIOD_US) {
+            raw += step;
+            output = filterX(filter, time_us, raw);
+            worst = max(worst, distance(output, raw));
+            CHECK(output <= raw);
+        }
+        CHECK(worst <= CONTACT_FILTER_MAX_LAG);
+
+        // Catches up once the finger stops
+        for (int i = 0; i < 250; i++, time_us += PERIOD_US)
+            output = filterX(filter, time_us, raw);
+        CHECK(distance(output, raw) <= 1);
+    }
+}
+
+TEST(SpeedFollowsMotion) {
+    VoodooInputContactFilter filter;
+    UInt32 slow = 0, fast = 0;
+
+    for (UInt32 i = 0; i < 100; i++)
+        filterX(filter, i * PERIOD_US, (SInt32)i);
+    slow = filter.getSpeed(0);
+
+    filter.reset();
+    for (UInt32 i = 0; i < 100; i++)
+        filterX(filter, i * PERIOD_US, (SInt32)i * 40);
+    fast = filter.getSpeed(0);
+
+    // Measured against the lagging output, so at least 125 and 5000 MT2 units per second
+    CHECK(slow >= 125);
+    CHECK(fast >= 5000);
+    CHECK(fast > 8 * slow);
+}
+
+TEST(TinyIntervalsDoNotOverflow) {
+    VoodooInputContactFilter filter;
+
+    // A millisecond apart this is 2^32 + 704 units/s, which used to wrap to 704
+    filterX(filter, 0, 0);
+    SInt32 output = filterX(filter, 1000, 4294968);
+    CHECK(filter.getSpeed(0) > 100000);
+    CHECK(filter.getSpeed(0) <= CONTACT_FILTER_MAX_SPEED);
+    CHECK(distance(output, 4294968) <= CONTACT_FILTER_MAX_LAG);
+
+    // Back and forth a microsecond apart, the speed saturates and the lag stays bounded
+    filter.reset();
+    filterX(filter, 0, 0);
+    UInt32 time_us = 0;
+    for (int i = 0; i < 5000; i++) {
+        SInt32 raw = i & 1 ? -4000000 : 4000000;
+        output = filterX(filter, ++time_us, raw);
+        CHECK(distance(output, raw) <= CONTACT_FILTER_MAX_LAG);
+        CHECK(filter.getSpeed(0) <= CONTACT_FILTER_MAX_SPEED);
+    }
+}
@@ -0,0 +1,168 @@
+//
+//  ContactTrackerTests.cpp
+//  VoodooInput host tests
+//
+//  Copyright © 2024 Kishor Prins. All rights reserved.
+//
+
+#include "Test.hpp"
+
+#include "VoodooInputSimulator/VoodooInputContactTracker.hpp"
+
+#include <initializer_list>
+
+#define MS 1000000ULL
+
+struct Contact {
+    UInt32 id;
+    UInt32 x;
+    UInt32 y;
+    bool active;
+};
+
+static VoodooInputEvent frame(std::initializer_list<Contact> contacts) {
+    VoodooInputEvent event {};
+    for (const Contact& contact : contacts) {
+        VoodooInputTransducer& transducer = event.transducers[event.contact_count++];
+        transducer.type = VoodooInputTransducerType::FINGER;
+        transducer.isValid = true;
+        transducer.secondaryId = contact.id;
+        transducer.isTransducerActive = contact.active;
+        transducer.currentCoordinates.x = contact.x;
+        transducer.currentCoordinates.y = contact.y;
+    }
+    return event;
+}
+
+static const VoodooInputContactVelocity* velocityOf(const VoodooInputContactStats& stats, UInt32 id) {
+    for (UInt8 i = 0; i < stats.contact_count; i++) {
+        if (stats.velocities[i].id == id)
+            return &stats.velocities[i];
+    }
+    return nullptr;
+}
+
+TEST(GeometryOfActiveContacts) {
+    VoodooInputContactTracker tracker;
+    tracker.reset();
+
+    // The lifting contact and the stylus are left out
+    VoodooInputEvent event = frame({{0, 100, 200, true}, {1, 300, 600, true}, {2, 5000, 5000, false}, {3, 4000, 4000, true}});
+    event.transducers[3].type = VoodooInputTransducerType::STYLUS;
+    tracker.update(event, 8 * MS);
+
+    const VoodooInputContactStats& stats = tracker.getStats();
+    CHECK_EQ(stats.timestamp, 8 * MS);
+    CHECK_EQ(stats.contact_count, 2);
+    CHECK_EQ(stats.centroid_x, 200);
+    CHECK_EQ(stats.centroid_y, 400);
+    CHECK_EQ(stats.min_x, 100);
+    CHECK_EQ(stats.min_y, 200);
+    CHECK_EQ(stats.max_x, 300);
+    CHECK_EQ(stats.max_y, 600);
+    // Each contact is 100 + 200 away from the centroid
+    CHECK_EQ(stats.spread, 300);
+}
+
+TEST(NoContactsClearTheGeometry) {
+    VoodooInputContactTracker tracker;
+    tracker.reset();
+    tracker.update(frame({{0, 100, 200, true}}), 8 * MS);
+    tracker.update(frame({{0, 100, 200, false}}), 16 * MS);
+
+    const VoodooInputContactStats& stats = tracker.getStats();
+    CHECK_EQ(stats.contact_count, 0);
+    CHECK_EQ(stats.centroid_x, 0);
+    CHECK_EQ(stats.min_x, 0);
+    CHECK_EQ(stats.max_x, 0);
+    CHECK_EQ(stats.spread, 0);
+}
+
+TEST(VelocityOverTheHistoryWindow) {
+    VoodooInputContactTracker tracker;
+    tracker.reset();
+
+    tracker.update(frame({{7, 1000, 1000, true}}), 8 * MS);
+    CHECK_EQ(tracker.getStats().velocities[0].id, 7);
+    CHECK_EQ(tracker.getStats().velocities[0].vx, 0);
+
+    // 10 units right and 5 up every 8 ms, the oldest sample drops out after CONTACT_TRACKER_HISTORY
+    for (UInt32 i = 1; i < 10; i++)
+        tracker.update(frame({{7, 1000 + i * 10, 1000 - i * 5, true}}), (8 + i * 8) * MS);
+
+    const VoodooInputContactVelocity* velocity = velocityOf(tracker.getStats(), 7);
+    CHECK(velocity != nullptr);
+    if (velocity) {
+        CHECK_EQ(velocity->vx, 1250);
+        CHECK_EQ(velocity->vy, -625);
+    }
+}
+
+TEST(TinyOrDuplicateTimestampsAreFlooredAndSaturate) {
+    VoodooInputContactTracker tracker;
+    tracker.reset();
+
+    // The same timestamp twice is taken as 1 ms apart
+    tracker.update(frame({{0, 1000, 1000, true}}), 8 * MS);
+    tracker.update(frame({{0, 1003, 998, true}}), 8 * MS);
+    CHECK_EQ(tracker.getStats().velocities[0].vx, 3000);
+    CHECK_EQ(tracker.getStats().velocities[0].vy, -2000);
+
+    // A jump across the surface in 1 ns would be far past SInt32
+    tracker.reset();
+    tracker.update(frame({{0, 0, 0xFFFFFFFF, true}}), 8 * MS);
+    tracker.update(frame({{0, 0xFFFFFFFF, 0, true}}), 8 * MS + 1);
+    CHECK_EQ(tracker.getStats().velocities[0].vx, INT32_MAX);
+    CHECK_EQ(tracker.getStats().velocities[0].vy, INT32_MIN);
+
+    // A timestamp going back gives no velocity instead of a bogus one
+    tracker.update(frame({{0, 0, 0, true}}), 4 * MS);
+    CHECK_EQ(tracker.getStats().velocities[0].vx, 0);
+    CHECK_EQ(tracker.getStats().velocities[0].vy, 0);
+}
+
+TEST(ContactMissingAFrameStartsOver) {
+    VoodooInputContactTracker tracker;
+    tracker.reset();
+    tracker.update(frame({{0, 1000, 1000, true}, {1, 2000, 2000, true}}), 8 * MS);
+    tracker.update(frame({{0, 1000, 1000, true}, {1, 2080, 2000, true}}), 16 * MS);
+    CHECK_EQ(velocityOf(tracker.getStats(), 1)->vx, 10000);
+
+    // Id 1 vanishes without lifting, then comes back elsewhere as a new finger
+    tracker.update(frame({{0, 1000, 1000, true}}), 24 * MS);
+    tracker.update(frame({{0, 1000, 1000, true}, {1, 200, 200, true}}), 32 * MS);
+    CHECK_EQ(velocityOf(tracker.getStats(), 1)->vx, 0);
+    CHECK_EQ(velocityOf(tracker.getStats(), 1)->vy, 0);
+
+    tracker.update(frame({{0, 1000, 1000, true}, {1, 208, 200, true}}), 40 * MS);
+    CHECK_EQ(velocityOf(tracker.getStats(), 1)->vx, 1000);
+}
+
+TEST(IdsAreNotFoldedOntoEachOther) {
+    VoodooInputContactTracker tracker;
+    tracker.reset();
+
+    // 2 and 17 share an MT2 touch id, each keeps its own history
+    tracker.update(frame({{2, 1000, 1000, true}, {17, 3000, 3000, true}}), 8 * MS);
+    tracker.update(frame({{2, 1008, 1000, true}, {17, 2992, 3000, true}}), 16 * MS);
+
+    const VoodooInputContactStats& stats = tracker.getStats();
+    CHECK_EQ(stats.contact_count, 2);
+    CHECK_EQ(velocityOf(stats, 2)->vx, 1000);
+    CHECK_EQ(velocityOf(stats, 17)->vx, -1000);
+}
+
+TEST(DuplicateIdsGetNoVelocity) {
+    VoodooInputContactTracker tracker;
+    tracker.reset();
+    tracker.update(frame({{4, 1000, 1000, true}, {4, 3000, 1000, true}}), 8 * MS);
+    tracker.update(frame({{4, 1008, 1000, true}, {4, 3000, 1000, true}}), 16 * MS);
+
+    // Both count towards the geometry, only the first one feeds the history
+    const VoodooInputContactStats& stats = tracker.getStats();
+    CHECK_EQ(stats.contact_count, 2);
+    CHECK_EQ(stats.centroid_x, 2004);
+    CHECK_EQ(stats.velocities[0].vx, 1000);
+    CHECK_EQ(stats.velocities[1].id, 4);
+    CHECK_EQ(stats.velocities[1].vx, 0);
+}
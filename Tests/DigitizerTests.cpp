@@ -0,0 +1,307 @@
+//
+//  DigitizerTests.cpp
+//  VoodooInput host tests
+//
+//  Copyright © 2024 Kishor Prins. All rights reserved.
+//
+
+#include "Test.hpp"
+
+#include "VoodooInputSimulator/VoodooInputDigitizerReport.hpp"
+#include "VoodooInputMultitouch/MultitouchHelpers.h"
+
+#include <IOKit/hid/IOHIDUsageTables.h>
+
+static void setFinger(VoodooInputEvent& event, int index, UInt32 id, UInt32 x, UInt32 y, bool down, MT2FingerType finger = kMT2FingerTypeIndexFinger) {
+    VoodooInputTransducer& transducer = event.transducers[index];
+    transducer = {};
+    transducer.type = FINGER;
+    transducer.isValid = true;
+    transducer.isTransducerActive = down;
+    transducer.fingerType = finger;
+    transducer.secondaryId = id;
+    transducer.currentCoordinates.x = x;
+    transducer.currentCoordinates.y = y;
+}
+
+struct DigitizerHarness {
+    VoodooInputDigitizerEncoder encoder;
+    DIGITIZER_TOUCH_REPORT touch {};
+    DIGITIZER_PEN_REPORT pen {};
+    VoodooInputEvent event {};
+
+    DigitizerHarness() {
+        encoder.reset();
+        encoder.setSurface(1000, 1000, 0);
+    }
+
+    UInt32 send(UInt8 contact_count, UInt64 scan_time_ns = 0) {
+        event.contact_count = contact_count;
+        return encoder.encode(event, scan_time_ns, touch, pen);
+    }
+
+    const DIGITIZER_TOUCH_REPORT_CONTACT* contactWithId(UInt8 contact_id) const {
+        for (int i = 0; i < touch.contact_count; i++) {
+            if (touch.contacts[i].contact_id == contact_id)
+                return &touch.contacts[i];
+        }
+        return nullptr;
+    }
+};
+
+/*
+ * Bits each report id carries per main item type, as the HID parser would count them,
+ * plus whether every collection was closed.
+ */
+struct DescriptorLayout {
+    UInt32 input_bits[256] {};
+    UInt32 feature_bits[256] {};
+    int depth {0};
+    bool balanced {true};
+    UInt32 contact_id_max {0};
+
+    explicit DescriptorLayout(const DigitizerDescriptor& descriptor) {
+        UInt32 report_size = 0, report_count = 0, report_id = 0, usage_page = 0, logical_max = 0, last_usage = 0;
+
+        for (size_t i = 0; i < descriptor.length;) {
+            UInt8 prefix = descriptor.bytes[i];
+            UInt8 size = (prefix & 0x3) == 3 ? 4 : prefix & 0x3;
+            UInt32 value = 0;
+            for (UInt8 j = 0; j < size; j++)
+                value |= (UInt32)descriptor.bytes[i + 1 + j] << (j * 8);
+            i += 1 + size;
+
+            switch (prefix & 0xFC) {
+                case HID_USAGE_PAGE: usage_page = value; break;
+                case HID_USAGE: last_usage = value; break;
+                case HID_REPORT_SIZE: report_size = value; break;
+                case HID_REPORT_COUNT: report_count = value; break;
+                case HID_REPORT_ID: report_id = value; break;
+                case HID_LOGICAL_MAX: logical_max = value; break;
+                case HID_COLLECTION: depth++; break;
+                case HID_END_COLLECTION: balanced &= --depth >= 0; break;
+                case HID_INPUT:
+                    input_bits[report_id] += report_size * report_count;
+                    if (usage_page == kHIDPage_Digitizer && last_usage == 0x51)
+                        contact_id_max = logical_max;
+                    break;
+                case HID_FEATURE: feature_bits[report_id] += report_size * report_count; break;
+            }
+        }
+        balanced &= depth == 0;
+    }
+};
+
+TEST(DescriptorMatchesReportStructs) {
+    DigitizerDescriptor descriptor {};
+    VoodooInputDigitizerWriteDescriptor(descriptor, 29000, 17000);
+    DescriptorLayout layout(descriptor);
+
+    CHECK(layout.balanced);
+    CHECK(descriptor.length < DIGITIZER_DESCRIPTOR_MAX_SIZE);
+    CHECK_EQ(layout.input_bits[DIGITIZER_TOUCH_REPORT_ID], (sizeof(DIGITIZER_TOUCH_REPORT) - 1) * 8);
+    CHECK_EQ(layout.input_bits[DIGITIZER_PEN_REPORT_ID], (sizeof(DIGITIZER_PEN_REPORT) - 1) * 8);
+    CHECK_EQ(layout.feature_bits[DIGITIZER_CONTACT_MAX_REPORT_ID], 8);
+    CHECK_EQ(layout.input_bits[DIGITIZER_CONTACT_MAX_REPORT_ID], 0);
+    // Contact identifiers are slots, not provider ids
+    CHECK_EQ(layout.contact_id_max, VOODOO_INPUT_MAX_TRANSDUCERS - 1);
+}
+
+TEST(ContactIdsAreStableSlots) {
+    DigitizerHarness harness;
+
+    setFinger(harness.event, 0, 1000, 100, 100, true);
+    setFinger(harness.event, 1, 7, 200, 200, true);
+    setFinger(harness.event, 2, 0x1234567, 300, 300, true);
+    CHECK_EQ(harness.send(3), kDigitizerSendTouch);
+    CHECK_EQ(harness.touch.contact_count, 3);
+    CHECK_EQ(harness.touch.contacts[0].contact_id, 0);
+    CHECK_EQ(harness.touch.contacts[1].contact_id, 1);
+    CHECK_EQ(harness.touch.contacts[2].contact_id, 2);
+
+    // Providers may reorder their contacts, the ids follow the secondary id
+    setFinger(harness.event, 0, 0x1234567, 310, 310, true);
+    setFinger(harness.event, 1, 1000, 110, 110, true);
+    setFinger(harness.event, 2, 7, 210, 210, true);
+    CHECK_EQ(harness.send(3), kDigitizerSendTouch);
+    CHECK_EQ(harness.touch.contacts[0].contact_id, 2);
+    CHECK_EQ(harness.touch.contacts[1].contact_id, 0);
+    CHECK_EQ(harness.touch.contacts[2].contact_id, 1);
+    CHECK_EQ(harness.touch.contacts[0].flags, DIGITIZER_TIP_SWITCH | DIGITIZER_IN_RANGE | DIGITIZER_CONFIDENCE);
+}
+
+TEST(LastLiftIsFollowedByEmptyReport) {
+    DigitizerHarness harness;
+
+    setFinger(harness.event, 0, 5, 100, 100, true);
+    setFinger(harness.event, 1, 6, 200, 200, true);
+    harness.send(2);
+
+    setFinger(harness.event, 0, 5, 100, 100, false);
+    setFinger(harness.event, 1, 6, 200, 200, true);
+    CHECK_EQ(harness.send(2), kDigitizerSendTouch);
+    CHECK_EQ(harness.contactWithId(0)->flags, DIGITIZER_CONFIDENCE);
+
+    setFinger(harness.event, 0, 6, 200, 200, false);
+    CHECK_EQ(harness.send(1), kDigitizerSendTouch | kDigitizerSendRelease);
+    CHECK_EQ(harness.touch.contact_count, 1);
+    CHECK_EQ(harness.touch.contacts[0].contact_id, 1);
+    CHECK_EQ(harness.touch.contacts[0].flags & DIGITIZER_TIP_SWITCH, 0);
+
+    VoodooInputDigitizerEncoder::encodeRelease(harness.touch);
+    CHECK_EQ(harness.touch.report_id, DIGITIZER_TOUCH_REPORT_ID);
+    CHECK_EQ(harness.touch.contact_count, 0);
+    CHECK_EQ(harness.touch.contacts[0].flags, 0);
+
+    // Nothing more until the next touch
+    CHECK_EQ(harness.send(0), 0);
+}
+
+TEST(LiftingSlotIsFreeFromTheNextReport) {
+    DigitizerHarness harness;
+
+    setFinger(harness.event, 0, 5, 100, 100, true);
+    harness.send(1);
+
+    // A new contact in the same report as the lift must not take over id 0
+    setFinger(harness.event, 0, 5, 100, 100, false);
+    setFinger(harness.event, 1, 9, 500, 500, true);
+    CHECK_EQ(harness.send(2), kDigitizerSendTouch);
+    CHECK_EQ(harness.touch.contacts[0].contact_id, 0);
+    CHECK_EQ(harness.touch.contacts[1].contact_id, 1);
+
+    setFinger(harness.event, 0, 9, 500, 500, true);
+    setFinger(harness.event, 1, 11, 600, 600, true);
+    harness.send(2);
+    CHECK_EQ(harness.touch.contacts[0].contact_id, 1);
+    CHECK_EQ(harness.touch.contacts[1].contact_id, 0);
+}
+
+TEST(VanishedContactIsLiftedWhereItWas) {
+    DigitizerHarness harness;
+
+    setFinger(harness.event, 0, 5, 100, 100, true);
+    setFinger(harness.event, 1, 6, 500, 250, true, kMT2FingerTypePalm);
+    harness.send(2);
+    UInt16 x = harness.touch.contacts[1].x;
+    UInt16 y = harness.touch.contacts[1].y;
+
+    setFinger(harness.event, 0, 5, 120, 100, true);
+    CHECK_EQ(harness.send(1), kDigitizerSendTouch);
+    CHECK_EQ(harness.touch.contact_count, 2);
+    const DIGITIZER_TOUCH_REPORT_CONTACT* vanished = harness.contactWithId(1);
+    CHECK(vanished != nullptr);
+    if (vanished) {
+        // Still a palm, without confidence
+        CHECK_EQ(vanished->flags, 0);
+        CHECK_EQ(vanished->x, x);
+        CHECK_EQ(vanished->y, y);
+    }
+
+    // Everything gone at once, still lifted and then emptied
+    CHECK_EQ(harness.send(0), kDigitizerSendTouch | kDigitizerSendRelease);
+    CHECK_EQ(harness.touch.contact_count, 1);
+    CHECK_EQ(harness.touch.contacts[0].contact_id, 0);
+    CHECK_EQ(harness.send(0), 0);
+}
+
+TEST(PalmHasNoConfidence) {
+    DigitizerHarness harness;
+
+    setFinger(harness.event, 0, 1, 100, 100, true, kMT2FingerTypePalm);
+    setFinger(harness.event, 1, 2, 200, 200, true, kMT2FingerTypeThumb);
+    harness.send(2);
+    CHECK_EQ(harness.touch.contacts[0].flags, DIGITIZER_TIP_SWITCH | DIGITIZER_IN_RANGE);
+    CHECK_EQ(harness.touch.contacts[1].flags, DIGITIZER_TIP_SWITCH | DIGITIZER_IN_RANGE | DIGITIZER_CONFIDENCE);
+}
+
+TEST(EleventhIdWaitsForAFreeSlot) {
+    DigitizerHarness harness;
+
+    for (int i = 0; i < VOODOO_INPUT_MAX_TRANSDUCERS; i++)
+        setFinger(harness.event, i, 100 + i, 10 * i, 10 * i, true);
+    harness.send(VOODOO_INPUT_MAX_TRANSDUCERS);
+    CHECK_EQ(harness.touch.contact_count, VOODOO_INPUT_MAX_TRANSDUCERS);
+
+    // 100 vanished and 200 appeared in its place, the slot is only free once 100 was lifted
+    setFinger(harness.event, 0, 200, 900, 900, true);
+    harness.send(VOODOO_INPUT_MAX_TRANSDUCERS);
+    CHECK_EQ(harness.touch.contact_count, VOODOO_INPUT_MAX_TRANSDUCERS);
+    CHECK_EQ(harness.contactWithId(0)->flags & DIGITIZER_TIP_SWITCH, 0);
+    CHECK_EQ(harness.contactWithId(0)->x, 0);
+
+    harness.send(VOODOO_INPUT_MAX_TRANSDUCERS);
+    CHECK_EQ(harness.touch.contacts[0].contact_id, 0);
+    CHECK_EQ(harness.touch.contacts[0].flags & DIGITIZER_TIP_SWITCH, DIGITIZER_TIP_SWITCH);
+    CHECK(harness.touch.contacts[0].x > 0x7000);
+}
+
+TEST(DuplicateIdIsReportedOnce) {
+    DigitizerHarness harness;
+
+    setFinger(harness.event, 0, 4, 100, 100, true);
+    setFinger(harness.event, 1, 4, 900, 900, true);
+    harness.send(2);
+    CHECK_EQ(harness.touch.contact_count, 1);
+}
+
+TEST(ScalingAndTransform) {
+    DigitizerHarness harness;
+
+    setFinger(harness.event, 0, 1, 250, 1000, true);
+    harness.send(1, 123456789);
+    CHECK_EQ(harness.touch.contacts[0].x, DIGITIZER_LOGICAL_MAX / 4);
+    CHECK_EQ(harness.touch.contacts[0].y, DIGITIZER_LOGICAL_MAX);
+    CHECK_EQ(harness.touch.scan_time, 1234);
+
+    // Past the surface is clamped
+    setFinger(harness.event, 0, 1, 5000, 0, true);
+    harness.send(1);
+    CHECK_EQ(harness.touch.contacts[0].x, DIGITIZER_LOGICAL_MAX);
+
+    harness.encoder.setSurface(1000, 1000, kIOFBSwapAxes | kIOFBInvertX);
+    setFinger(harness.event, 0, 1, 250, 0, true);
+    harness.send(1);
+    CHECK_EQ(harness.touch.contacts[0].x, DIGITIZER_LOGICAL_MAX);
+    CHECK_EQ(harness.touch.contacts[0].y, DIGITIZER_LOGICAL_MAX / 4);
+}
+
+TEST(StylusEntersAndLeavesRange) {
+    DigitizerHarness harness;
+    VoodooInputTransducer& stylus = harness.event.transducers[0];
+
+    stylus = {};
+    stylus.type = STYLUS;
+    stylus.isValid = true;
+    stylus.supportsPressure = true;
+    stylus.maxPressure = 255;
+    stylus.currentCoordinates = {500, 500, 255, 0};
+    CHECK_EQ(harness.send(1), kDigitizerSendPen);
+    CHECK_EQ(harness.pen.flags, DIGITIZER_PEN_IN_RANGE);
+    CHECK_EQ(harness.pen.tip_pressure, 0);
+
+    stylus.isTransducerActive = true;
+    stylus.isPhysicalButtonDown = true;
+    CHECK_EQ(harness.send(1), kDigitizerSendPen);
+    CHECK_EQ(harness.pen.flags, DIGITIZER_PEN_IN_RANGE | DIGITIZER_TIP_SWITCH | DIGITIZER_BARREL_SWITCH);
+    CHECK_EQ(harness.pen.tip_pressure, DIGITIZER_PRESSURE_MAX);
+
+    // Out of range once, at the last position
+    UInt16 x = harness.pen.x;
+    CHECK_EQ(harness.send(0), kDigitizerSendPen);
+    CHECK_EQ(harness.pen.flags, 0);
+    CHECK_EQ(harness.pen.x, x);
+    CHECK_EQ(harness.send(0), 0);
+}
+
+TEST(StylusDoesNotTakeAContactSlot) {
+    DigitizerHarness harness;
+
+    harness.event.transducers[0] = {};
+    harness.event.transducers[0].type = STYLUS;
+    harness.event.transducers[0].isValid = true;
+    setFinger(harness.event, 1, 3, 100, 100, true);
+    CHECK_EQ(harness.send(2), kDigitizerSendTouch | kDigitizerSendPen);
+    CHECK_EQ(harness.touch.contact_count, 1);
+    CHECK_EQ(harness.touch.contacts[0].contact_id, 0);
+}
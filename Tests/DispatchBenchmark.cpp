@@ -0,0 +1,73 @@
+//
+//  DispatchBenchmark.cpp
+//  VoodooInput host tests
+//
+//  Copyright © 2024 Kishor Prins. All rights reserved.
+//
+
+#include "Benchmark.hpp"
+#include "DispatchModel.hpp"
+
+/*
+ * Per call overhead of IOService::message against the direct call interface, for touch
+ * frames and trackpoint reports, as a provider would issue them. Touch frames go through
+ * VoodooInputFramePath up to the simulator, the same sequence VoodooInput runs.
+ */
+
+template <typename Call>
+static UInt64 measure(const char* name, UInt32 count, Call call) {
+    UInt64 elapsed = BenchmarkBest([&] {
+        UInt64 start = HostMonotonicNs();
+        for (UInt32 i = 0; i < count; i++)
+            call(i);
+        UInt64 end = HostMonotonicNs();
+        return end - start;
+    });
+    BenchmarkRow(name, elapsed, count);
+    return elapsed;
+}
+
+int main(int argc, char** argv) {
+    UInt32 count = BenchmarkIterations(argc, argv, 50000000);
+
+    ModelService provider;
+    ModelService* service = new ModelEngine(&provider);
+    ModelEngine* engine = static_cast<ModelEngine*>(service);
+    ModelSimulator simulator;
+    engine->publish(&simulator);
+
+    const VoodooInputInterface* interface = nullptr;
+    service->message(kIOMessageVoodooInputGetInterfaceMessage, &provider, &interface);
+    if (!VOODOO_INPUT_INTERFACE_HAS(interface, submitTrackpointReport)) {
+        fprintf(stderr, "interface not handed out\n");
+        return 1;
+    }
+
+    VoodooInputEvent event {};
+    event.contact_count = 1;
+    TrackpointReport report {};
+
+    BenchmarkHeader("calls");
+    measure("touch frame, message", count, [&](UInt32 i) {
+        event.timestamp = i;
+        service->message(kIOMessageVoodooInputMessage, &provider, &event);
+    });
+    measure("touch frame, interface", count, [&](UInt32 i) {
+        event.timestamp = i;
+        interface->submitTouchFrame(interface->context, &event);
+    });
+    measure("trackpoint report, message", count, [&](UInt32 i) {
+        report.dx = i;
+        service->message(kIOMessageVoodooTrackpointMessage, &provider, &report);
+    });
+    measure("trackpoint report, interface", count, [&](UInt32 i) {
+        report.dx = i;
+        interface->submitTrackpointReport(interface->context, &report);
+    });
+
+    // Every call has to have arrived, both paths run BENCHMARK_ROUNDS times
+    UInt64 expected = (UInt64)count * BENCHMARK_ROUNDS * 2;
+    bool delivered = simulator.frames == expected && engine->trackpointReports == expected;
+    delete service;
+    return delivered ? 0 : 1;
+}
@@ -0,0 +1,116 @@
+//
+//  DispatchModel.cpp
+//  VoodooInput host tests
+//
+//  Copyright © 2024 Kishor Prins. All rights reserved.
+//
+
+#include "DispatchModel.hpp"
+#include "VoodooInputKdebug.hpp"
+
+IOReturn ModelService::message(UInt32 type, ModelService* provider, void* argument) {
+    return kIOReturnUnsupported;
+}
+
+ModelEngine::ModelEngine(ModelService* parent) : parentProvider(parent) {
+    subdeviceLock = IOLockAlloc();
+    rateAdvisor.reset();
+    interface.version = VOODOO_INPUT_INTERFACE_VERSION;
+    interface.size = sizeof(interface);
+    interface.context = this;
+    interface.submitTouchFrame = &ModelEngine::interfaceSubmitTouchFrame;
+    interface.updateDimensions = &ModelEngine::interfaceUpdateDimensions;
+    interface.submitTrackpointReport = &ModelEngine::interfaceSubmitTrackpointReport;
+}
+
+ModelEngine::~ModelEngine() {
+    unpublish();
+    IOLockFree(subdeviceLock);
+}
+
+void ModelEngine::publish(ModelSimulator* device) {
+    IOLockLock(subdeviceLock);
+    simulator = device;
+    IOLockUnlock(subdeviceLock);
+}
+
+void ModelEngine::unpublish() {
+    IOLockLock(subdeviceLock);
+    simulator = nullptr;
+    subdeviceUsers.drain(subdeviceLock);
+    IOLockUnlock(subdeviceLock);
+}
+
+// Only reached while starting, the model is ready from the beginning
+bool ModelEngine::holdEarlyFrame(const VoodooInputEvent* event) {
+    return false;
+}
+
+void ModelEngine::recordFirstReport() {
+    firstReportSent = 1;
+}
+
+void ModelEngine::requestRateHint() {}
+
+// The devices and the other handlers only count, what they forward to is the same for both paths
+__attribute__((noinline)) void ModelSimulator::constructReport(const VoodooInputEvent& event) {
+    frames += event.contact_count;
+}
+
+__attribute__((noinline)) void ModelDigitizer::constructReport(const VoodooInputEvent& event) {
+    frames += event.contact_count;
+}
+
+__attribute__((noinline)) IOReturn ModelEngine::handleDimensions(const VoodooInputDimensions& dimensions) {
+    return kIOReturnSuccess;
+}
+
+__attribute__((noinline)) IOReturn ModelEngine::handleTrackpointReport(const TrackpointReport& report) {
+    trackpointReports += report.buttons + 1;
+    return kIOReturnSuccess;
+}
+
+IOReturn ModelEngine::interfaceSubmitTouchFrame(void* context, VoodooInputEvent* event) {
+    return event ? VoodooInputFramePath<ModelEngine>::handleTouchFrame(*static_cast<ModelEngine*>(context), *event) : kIOReturnBadArgument;
+}
+
+IOReturn ModelEngine::interfaceUpdateDimensions(void* context, const VoodooInputDimensions* dimensions) {
+    return dimensions ? static_cast<ModelEngine*>(context)->handleDimensions(*dimensions) : kIOReturnBadArgument;
+}
+
+IOReturn ModelEngine::interfaceSubmitTrackpointReport(void* context, const TrackpointReport* report) {
+    return report ? static_cast<ModelEngine*>(context)->handleTrackpointReport(*report) : kIOReturnBadArgument;
+}
+
+IOReturn ModelEngine::message(UInt32 type, ModelService* provider, void* argument) {
+    VoodooInputKdebug(kVoodooInputKdebugMessage, DBG_FUNC_NONE, type);
+
+    switch (type) {
+        case kIOMessageVoodooInputMessage:
+            if (provider == parentProvider && argument) {
+                VoodooInputFramePath<ModelEngine>::handleTouchFrame(*this, *(VoodooInputEvent*)argument);
+            }
+            break;
+
+        case kIOMessageVoodooInputGetInterfaceMessage:
+            if (provider == parentProvider && argument) {
+                *(const VoodooInputInterface**)argument = &interface;
+                return kIOReturnSuccess;
+            }
+            break;
+
+        case kIOMessageVoodooInputUpdateDimensionsMessage:
+            if (provider == parentProvider && argument) {
+                handleDimensions(*(VoodooInputDimensions*)argument);
+            }
+            break;
+
+        case kIOMessageVoodooTrackpointMessage:
+            if (argument) {
+                handleTrackpointReport(*(TrackpointReport*)argument);
+            }
+            break;
+    }
+
+    return ModelService::message(type, provider, argument);
+}
@@ -0,0 +1,93 @@
+//
+//  DispatchModel.hpp
+//  VoodooInput host tests
+//
+//  Copyright © 2024 Kishor Prins. All rights reserved.
+//
+
+#ifndef VOODOO_INPUT_TEST_DISPATCH_MODEL_HPP
+#define VOODOO_INPUT_TEST_DISPATCH_MODEL_HPP
+
+#include <IOKit/IOService.h>
+
+#include "VoodooInputFramePath.hpp"
+#include "VoodooInputMultitouch/VoodooInputMessages.h"
+
+/*
+ * The two ways a provider reaches VoodooInput, without IOKit around them. ModelService
+ * stands in for IOService, whose message() only returns kIOReturnUnsupported, and
+ * ModelEngine::message keeps the shape of VoodooInput::message: type switch, provider
+ * check and the trailing super::message. Both live in DispatchModel.cpp so the
+ * benchmark cannot see through the virtual call.
+ *
+ * Touch frames run the real VoodooInputFramePath: early frame check, subdevice users,
+ * trace, delivery timing and rate advisor. Only the touch devices are stand-ins that
+ * count what reaches them.
+ */
+class ModelService {
+public:
+    virtual ~ModelService() {}
+    virtual IOReturn message(UInt32 type, ModelService* provider, void* argument);
+};
+
+class ModelSimulator {
+public:
+    void constructReport(const VoodooInputEvent& event);
+    bool isDegraded() const { return false; }
+
+    UInt64 frames {0};
+};
+
+class ModelDigitizer {
+public:
+    void constructReport(const VoodooInputEvent& event);
+
+    UInt64 frames {0};
+};
+
+class ModelEngine : public ModelService {
+public:
+    explicit ModelEngine(ModelService* parent);
+    ~ModelEngine() override;
+
+    IOReturn message(UInt32 type, ModelService* provider, void* argument) override;
+
+    // What VoodooInput::startMultitouch and stopMultitouch do with the simulator
+    void publish(ModelSimulator* device);
+    void unpublish();
+
+    UInt64 trackpointReports {0};
+
+private:
+    ModelService* parentProvider;
+    VoodooInputInterface interface {};
+
+    // VoodooInputFramePath reads these like the members of VoodooInput with the same names
+    friend struct VoodooInputFramePath<ModelEngine>;
+    enum StartStage : UInt32 {
+        kStartStagePending,
+        kStartStageReady
+    };
+    volatile UInt32 startStage {kStartStageReady};
+    IOLock* subdeviceLock {nullptr};
+    VoodooInputSubdeviceUsers subdeviceUsers;
+    UInt32 backend {kVoodooInputBackendMagicTrackpad};
+    ModelSimulator* simulator {nullptr};
+    ModelDigitizer* digitizer {nullptr};
+    VoodooInputTrace trace;
+    VoodooInputRateAdvisor rateAdvisor;
+    volatile UInt32 firstReportSent {0};
+
+    bool holdEarlyFrame(const VoodooInputEvent* event);
+    void recordFirstReport();
+    void requestRateHint();
+
+    IOReturn handleDimensions(const VoodooInputDimensions& dimensions);
+    IOReturn handleTrackpointReport(const TrackpointReport& report);
+
+    static IOReturn interfaceSubmitTouchFrame(void* context, VoodooInputEvent* event);
+    static IOReturn interfaceUpdateDimensions(void* context, const VoodooInputDimensions* dimensions);
+    static IOReturn interfaceSubmitTrackpointReport(void* context, const TrackpointReport* report);
+};
+
+#endif // VOODOO_INPUT_TEST_DISPATCH_MODEL_HPP
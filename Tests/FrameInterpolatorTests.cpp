@@ -0,0 +1,203 @@
+//
+//  FrameInterpolatorTests.cpp
+//  VoodooInput host tests
+//
+//  Copyright © 2024 Kishor Prins. All rights reserved.
+//
+
+#include "Test.hpp"
+
+#include "VoodooInputSimulator/VoodooInputFrameInterpolator.hpp"
+
+// Times in us, output at 125 Hz from a provider at about 31 Hz, more than lag plus one period apart
+#define PERIOD 8000
+#define LAG 20000
+#define SAMPLE_PERIOD 32000
+
+static VoodooInputEvent frame(UInt32 x, UInt8 fingers = 1) {
+    VoodooInputEvent event {};
+    event.contact_count = fingers;
+    for (UInt8 i = 0; i < fingers; i++) {
+        VoodooInputTransducer& transducer = event.transducers[i];
+        transducer.type = VoodooInputTransducerType::FINGER;
+        transducer.isValid = true;
+        transducer.isTransducerActive = true;
+        transducer.secondaryId = i;
+        transducer.fingerType = kMT2FingerTypeIndexFinger;
+        transducer.currentCoordinates.x = x + i * 500;
+        transducer.currentCoordinates.y = 1000;
+    }
+    return event;
+}
+
+static VoodooInputFrameInterpolator interpolator() {
+    VoodooInputFrameInterpolator interpolator;
+    interpolator.configure(PERIOD, LAG);
+    return interpolator;
+}
+
+TEST(FirstFrameIsSentAsIs) {
+    VoodooInputFrameInterpolator frames = interpolator();
+    VoodooInputEvent event;
+
+    CHECK(!frames.push(frame(1000), 0));
+    CHECK(!frames.isActive());
+    CHECK(!frames.render(LAG + PERIOD, event));
+
+    // Primed by it, the next frame starts a segment
+    CHECK(frames.push(frame(1100), SAMPLE_PERIOD));
+    CHECK(frames.isActive());
+}
+
+TEST(LagIsBounded) {
+    VoodooInputFrameInterpolator frames = interpolator();
+    VoodooInputEvent event;
+
+    const int samples = 40;
+    UInt32 reached[samples] {};
+    UInt32 output_x = 0;
+    UInt64 output_time = 0;
+    int next = 0;
+
+    for (UInt64 now = 0; now <= samples * SAMPLE_PERIOD + LAG + PERIOD; now += 1000) {
+        if (next < samples && now == (UInt64)next * SAMPLE_PERIOD) {
+            UInt32 x = 1000 + next * 100;
+            if (!frames.push(frame(x), now)) {
+                // Sent by the caller itself
+                output_x = x;
+                output_time = now;
+                reached[next] = (UInt32)now;
+            }
+            next++;
+        }
+
+        // The timer ticks once per output period while there is motion left
+        if (now % PERIOD != 0 || !frames.isActive() || !frames.render(now, event))
+            continue;
+
+        UInt32 x = event.transducers[0].currentCoordinates.x;
+        UInt32 latest = 1000 + (next - 1) * 100;
+
+        // Never ahead of the provider, never past its latest sample and never back
+        CHECK(event.timestamp <= now - LAG);
+        CHECK(event.timestamp > output_time);
+        CHECK(x >= output_x && x <= latest);
+        CHECK_EQ(event.transducers[0].previousCoordinates.x, output_x);
+
+        output_x = x;
+        output_time = event.timestamp;
+        if ((x - 1000) % 100 == 0 && !reached[(x - 1000) / 100])
+            reached[(x - 1000) / 100] = (UInt32)now;
+    }
+
+    for (int i = 0; i < samples; i++) {
+        CHECK(reached[i] != 0 || i == 0);
+        CHECK(reached[i] - (UInt32)i * SAMPLE_PERIOD <= LAG + PERIOD);
+    }
+    CHECK(!frames.isActive());
+}
+
+TEST(SegmentsHandOffWhereOutputIs) {
+    VoodooInputFrameInterpolator frames = interpolator();
+    VoodooInputEvent event;
+
+    frames.push(frame(1000), 0);
+    CHECK(frames.push(frame(2000), 10000));
+
+    // Halfway, 5 of 10 ms rendered
+    CHECK(frames.render(LAG + 5000, event));
+    UInt32 mid = event.transducers[0].currentCoordinates.x;
+    CHECK_EQ(mid, 1500);
+
+    // The provider is faster than the lag here, the next segment starts from what was sent
+    CHECK(frames.push(frame(1000), 15000));
+    CHECK(frames.render(LAG + 10000, event));
+    UInt32 x = event.transducers[0].currentCoordinates.x;
+    CHECK_EQ(event.transducers[0].previousCoordinates.x, mid);
+    // 5 of the 10 ms from 1500 back to 1000
+    CHECK_EQ(x, 1250);
+
+    // And ends on the sample
+    CHECK(frames.render(LAG + 15000, event));
+    CHECK_EQ(event.transducers[0].currentCoordinates.x, 1000);
+    CHECK_EQ(event.timestamp, 15000);
+    CHECK(!frames.isActive());
+    CHECK(!frames.render(LAG + 20000, event));
+}
+
+TEST(TransitionsAreNotInterpolated) {
+    VoodooInputEvent event;
+
+    VoodooInputEvent lift = frame(1100);
+    lift.transducers[0].isTransducerActive = false;
+
+    VoodooInputEvent button = frame(1100);
+    button.transducers[0].isPhysicalButtonDown = true;
+
+    VoodooInputEvent finger = frame(1100);
+    finger.transducers[0].fingerType = kMT2FingerTypeMiddleFinger;
+
+    VoodooInputEvent id = frame(1100);
+    id.transducers[0].secondaryId = 3;
+
+    VoodooInputEvent stylus = frame(1100);
+    stylus.transducers[0].type = VoodooInputTransducerType::STYLUS;
+
+    const VoodooInputEvent transitions[] = {lift, button, finger, id, stylus, frame(1100, 2)};
+    for (const VoodooInputEvent& transition : transitions) {
+        VoodooInputFrameInterpolator frames = interpolator();
+        frames.push(frame(1000), 0);
+        CHECK(frames.push(frame(1050), 10000));
+
+        // Pending motion is dropped, the transition goes out as is
+        CHECK(!frames.push(transition, 20000));
+        CHECK(!frames.isActive());
+        CHECK(!frames.render(LAG + 15000, event));
+    }
+}
+
+TEST(TransitionsStartTheNextSegment) {
+    VoodooInputFrameInterpolator frames = interpolator();
+    VoodooInputEvent event;
+
+    frames.push(frame(1000), 0);
+    CHECK(!frames.push(frame(1000, 2), 10000));
+
+    // Every contact still down, the next frame moves from it
+    CHECK(frames.push(frame(1200, 2), 20000));
+    CHECK(frames.render(LAG + 15000, event));
+    CHECK_EQ(event.contact_count, 2);
+    CHECK_EQ(event.transducers[0].currentCoordinates.x, 1100);
+    CHECK_EQ(event.transducers[1].currentCoordinates.x, 1600);
+
+    // A lift leaves nothing to move from
+    VoodooInputEvent lift = frame(1200, 2);
+    lift.transducers[1].isTransducerActive = false;
+    CHECK(!frames.push(lift, 30000));
+    CHECK(!frames.push(frame(1300), 40000));
+    CHECK(frames.push(frame(1400), 50000));
+}
+
+TEST(PausesAreNotBridged) {
+    VoodooInputFrameInterpolator frames = interpolator();
+
+    frames.push(frame(1000), 0);
+    CHECK(!frames.push(frame(2000), LAG * FRAME_INTERPOLATOR_GAP_LAGS + 1));
+    CHECK(!frames.isActive());
+
+    // Back on cadence from there
+    CHECK(frames.push(frame(2100), LAG * FRAME_INTERPOLATOR_GAP_LAGS + 1 + SAMPLE_PERIOD));
+}
+
+TEST(ResetDropsPendingMotion) {
+    VoodooInputFrameInterpolator frames = interpolator();
+    VoodooInputEvent event;
+
+    frames.push(frame(1000), 0);
+    CHECK(frames.push(frame(1100), 10000));
+    frames.reset();
+
+    CHECK(!frames.isActive());
+    CHECK(!frames.render(LAG + 10000, event));
+    CHECK(!frames.push(frame(1200), 20000));
+}
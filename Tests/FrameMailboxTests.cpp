@@ -0,0 +1,224 @@
+//
+//  FrameMailboxTests.cpp
+//  VoodooInput host tests
+//
+//  Copyright © 2024 Kishor Prins. All rights reserved.
+//
+
+#include "Test.hpp"
+#include "MT2EncoderHarness.hpp"
+
+#include "VoodooInputSimulator/VoodooInputFrameMailbox.hpp"
+
+#include <pthread.h>
+#include <vector>
+
+#define PERIOD_NS 8000000ULL
+
+// One finger at x, stamped with the time it was sampled
+static VoodooInputEvent motion(UInt64 timestamp, UInt32 x) {
+    VoodooInputEvent event {};
+    event.contact_count = 1;
+    event.timestamp = timestamp;
+    VoodooInputTransducer& transducer = event.transducers[0];
+    transducer.type = VoodooInputTransducerType::FINGER;
+    transducer.isValid = true;
+    transducer.fingerType = kMT2FingerTypeIndexFinger;
+    transducer.isTransducerActive = true;
+    transducer.currentCoordinates.x = x;
+    transducer.currentCoordinates.y = 1000;
+    return event;
+}
+
+TEST(NewestFrameSupersedes) {
+    VoodooInputFrameMailbox mailbox;
+    CHECK(mailbox.init());
+
+    VoodooInputEvent frame;
+    CHECK(!mailbox.take(frame));
+
+    // Only the post into an empty slot asks for a take
+    CHECK(mailbox.post(motion(1, 100)));
+    CHECK(!mailbox.post(motion(2, 200)));
+    CHECK(!mailbox.post(motion(3, 300)));
+    CHECK_EQ(mailbox.getSuperseded(), 2);
+
+    CHECK(mailbox.take(frame));
+    CHECK_EQ(frame.timestamp, 3);
+    CHECK_EQ(frame.transducers[0].currentCoordinates.x, 300);
+    CHECK(!mailbox.take(frame));
+
+    CHECK(mailbox.post(motion(4, 400)));
+    mailbox.release();
+}
+
+struct Poster {
+    VoodooInputFrameMailbox* mailbox;
+    UInt64 first;
+    UInt32 count;
+};
+
+static void* postFrames(void* argument) {
+    Poster* poster = (Poster*)argument;
+    for (UInt32 i = 0; i < poster->count; i++) {
+        // x follows the timestamp, a frame copied while being replaced would not match
+        UInt64 timestamp = poster->first + i;
+        VoodooInputEvent frame = motion(timestamp, (UInt32)timestamp);
+        frame.transducers[VOODOO_INPUT_MAX_TRANSDUCERS - 1].currentCoordinates.x = (UInt32)timestamp;
+        poster->mailbox->post(frame);
+    }
+    return nullptr;
+}
+
+TEST(FramesAreNeverTorn) {
+    VoodooInputFrameMailbox mailbox;
+    CHECK(mailbox.init());
+
+    Poster posters[3] {{&mailbox, 1000000, 100000}, {&mailbox, 2000000, 100000}, {&mailbox, 3000000, 100000}};
+    pthread_t threads[3];
+    for (int i = 0; i < 3; i++)
+        pthread_create(&threads[i], nullptr, postFrames, &posters[i]);
+
+    UInt32 taken = 0;
+    bool consistent = true;
+    VoodooInputEvent frame;
+    for (int i = 0; i < 200000; i++) {
+        if (!mailbox.take(frame))
+            continue;
+        taken++;
+        consistent &= frame.transducers[0].currentCoordinates.x == (UInt32)frame.timestamp;
+        consistent &= frame.transducers[VOODOO_INPUT_MAX_TRANSDUCERS - 1].currentCoordinates.x == (UInt32)frame.timestamp;
+    }
+
+    for (pthread_t& thread : threads)
+        pthread_join(thread, nullptr);
+    while (mailbox.take(frame))
+        taken++;
+
+    CHECK(consistent);
+    CHECK(taken > 0);
+    CHECK_EQ(taken + mailbox.getSuperseded(), 300000);
+    mailbox.release();
+}
+
+// The device gate, busy until released; what the interrupt event source would run is left to the test
+struct BusyGate {
+    MT2EncoderHarness& harness;
+    std::vector<SInt16> sent_x;
+    bool busy {false};
+    UInt32 scheduled {0};
+
+    explicit BusyGate(MT2EncoderHarness& harness) : harness(harness) {}
+
+    void runGated(const VoodooInputEvent& event) {
+        harness.encoder.constructReport(event, *this);
+    }
+
+    bool attemptGated(const VoodooInputEvent& event) {
+        if (busy)
+            return false;
+        harness.encoder.constructReport(event, *this);
+        return true;
+    }
+
+    void schedulePending() {
+        scheduled++;
+    }
+
+    // VoodooInputSimulatorDevice::constructPendingGated
+    bool constructPending() {
+        VoodooInputEvent event;
+        if (!harness.encoder.takePending(event))
+            return false;
+        harness.encoder.constructReport(event, *this);
+        return true;
+    }
+
+    void sendReport(const UInt8* report, UInt32 length) {
+        sent_x.push_back(MT2DecodeFinger(report + MT2_HEADER_SIZE).x);
+    }
+
+    void publishSampleProperties() {}
+    void publishWatchdogProperties() {}
+};
+
+// Motion 300 units apart from x on, sampled lateness ns before it arrives
+static void submitMotion(BusyGate& gate, UInt64& now, UInt32 frames, UInt64 lateness, UInt32 x = 1000) {
+    for (UInt32 i = 0; i < frames; i++, now += PERIOD_NS) {
+        HostClockSet(now + lateness);
+        gate.harness.encoder.submit(motion(now, x + i * 300), gate);
+    }
+}
+
+// MT2 x of a finger at x
+static SInt16 encodedX(UInt32 x) {
+    MT2EncoderHarness harness(3000, 2000, 0);
+    BusyGate gate(harness);
+    gate.runGated(motion(PERIOD_NS, x));
+    return gate.sent_x.back();
+}
+
+TEST(LastMotionBehindABusyGateIsSent) {
+    MT2EncoderHarness harness(3000, 2000, 0);
+    BusyGate gate(harness);
+    UInt64 now = PERIOD_NS;
+
+    // Late from the first frame, everything after the touch is coalescable
+    submitMotion(gate, now, 1, 2 * FRAME_WATCHDOG_DEADLINE_NS);
+    CHECK(harness.encoder.getWatchdog().isDegraded());
+    size_t sent = gate.sent_x.size();
+
+    gate.busy = true;
+    submitMotion(gate, now, 5, 2 * FRAME_WATCHDOG_DEADLINE_NS);
+    CHECK_EQ(gate.sent_x.size(), sent);
+    CHECK_EQ(gate.scheduled, 1);
+
+    // The provider goes quiet, the gate frees up and runs what was scheduled
+    gate.busy = false;
+    CHECK(gate.constructPending());
+    CHECK_EQ(gate.sent_x.size(), sent + 1);
+    CHECK(!gate.constructPending());
+
+    // The newest of the five frames
+    CHECK_EQ(gate.sent_x.back(), encodedX(1000 + 4 * 300));
+    CHECK_EQ(harness.encoder.getMailbox().getSuperseded(), 4);
+}
+
+TEST(PendingFrameOlderThanTheLastOneIsDropped) {
+    MT2EncoderHarness harness(3000, 2000, 0);
+    BusyGate gate(harness);
+    UInt64 now = PERIOD_NS;
+
+    submitMotion(gate, now, 1, 2 * FRAME_WATCHDOG_DEADLINE_NS);
+    gate.busy = true;
+    submitMotion(gate, now, 1, 2 * FRAME_WATCHDOG_DEADLINE_NS);
+
+    // A newer frame gets in before the scheduled take runs
+    gate.busy = false;
+    submitMotion(gate, now, 1, 2 * FRAME_WATCHDOG_DEADLINE_NS);
+    size_t sent = gate.sent_x.size();
+
+    CHECK(!gate.constructPending());
+    CHECK_EQ(gate.sent_x.size(), sent);
+}
+
+TEST(TransitionsNeverWaitInTheMailbox) {
+    MT2EncoderHarness harness(3000, 2000, 0);
+    BusyGate gate(harness);
+    UInt64 now = PERIOD_NS;
+
+    submitMotion(gate, now, 1, 2 * FRAME_WATCHDOG_DEADLINE_NS);
+    gate.busy = true;
+
+    // A second finger is a transition, the gate is waited for
+    VoodooInputEvent event = motion(now, 1000);
+    event.contact_count = 2;
+    event.transducers[1] = event.transducers[0];
+    event.transducers[1].secondaryId = 1;
+    HostClockSet(now + 2 * FRAME_WATCHDOG_DEADLINE_NS);
+    size_t sent = gate.sent_x.size();
+    harness.encoder.submit(event, gate);
+
+    CHECK(gate.sent_x.size() > sent);
+    CHECK_EQ(gate.scheduled, 0);
+}
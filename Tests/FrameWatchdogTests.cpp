@@ -0,0 +1,195 @@
+//
+//  FrameWatchdogTests.cpp
+//  VoodooInput host tests
+//
+//  Copyright © 2024 Kishor Prins. All rights reserved.
+//
+
+#include "Test.hpp"
+
+#include "VoodooInputSimulator/VoodooInputFrameWatchdog.hpp"
+
+#define MS 1000000ULL
+
+TEST(DeadlineIsExclusive) {
+    VoodooInputFrameWatchdog watchdog;
+    watchdog.reset();
+
+    CHECK(!watchdog.update(FRAME_WATCHDOG_DEADLINE_NS));
+    CHECK(!watchdog.isDegraded());
+    CHECK_EQ(watchdog.getOverruns(), 0);
+
+    CHECK(watchdog.update(FRAME_WATCHDOG_DEADLINE_NS + 1));
+    CHECK(watchdog.isDegraded());
+    CHECK_EQ(watchdog.getOverruns(), 1);
+    CHECK_EQ(watchdog.getModeSwitches(), 1);
+}
+
+TEST(OverrunsWhileDegradedDoNotSwitchAgain) {
+    VoodooInputFrameWatchdog watchdog;
+    watchdog.reset();
+
+    CHECK(watchdog.update(30 * MS));
+    CHECK(!watchdog.update(40 * MS));
+    CHECK(!watchdog.update(25 * MS));
+    CHECK_EQ(watchdog.getOverruns(), 3);
+    CHECK_EQ(watchdog.getModeSwitches(), 1);
+    CHECK_EQ(watchdog.getWorstStall(), 40 * MS);
+}
+
+TEST(RecoveryNeedsConsecutiveFastFrames) {
+    VoodooInputFrameWatchdog watchdog;
+    watchdog.reset();
+    watchdog.update(30 * MS);
+
+    for (int i = 0; i < FRAME_WATCHDOG_RECOVERY_FRAMES - 1; i++)
+        CHECK(!watchdog.update(2 * MS));
+    // Between half the deadline and the deadline starts the count over without an overrun
+    CHECK(!watchdog.update(15 * MS));
+    CHECK(watchdog.isDegraded());
+    CHECK_EQ(watchdog.getOverruns(), 1);
+
+    for (int i = 0; i < FRAME_WATCHDOG_RECOVERY_FRAMES - 1; i++)
+        CHECK(!watchdog.update(FRAME_WATCHDOG_DEADLINE_NS / 2));
+    CHECK(watchdog.update(FRAME_WATCHDOG_DEADLINE_NS / 2));
+    CHECK(!watchdog.isDegraded());
+    CHECK_EQ(watchdog.getModeSwitches(), 2);
+}
+
+TEST(SlowFramesOutsideDegradedModeChangeNothing) {
+    VoodooInputFrameWatchdog watchdog;
+    watchdog.reset();
+
+    for (int i = 0; i < 100; i++)
+        CHECK(!watchdog.update(15 * MS));
+    CHECK(!watchdog.isDegraded());
+    CHECK_EQ(watchdog.getOverruns(), 0);
+    CHECK_EQ(watchdog.getWorstStall(), 15 * MS);
+}
+
+TEST(ResetClearsStatistics) {
+    VoodooInputFrameWatchdog watchdog;
+    watchdog.reset();
+    watchdog.update(50 * MS);
+    watchdog.reset();
+
+    CHECK(!watchdog.isDegraded());
+    CHECK_EQ(watchdog.getOverruns(), 0);
+    CHECK_EQ(watchdog.getModeSwitches(), 0);
+    CHECK_EQ(watchdog.getWorstStall(), 0);
+}
+
+TEST(DeadlineIsKeptAcrossReset) {
+    VoodooInputFrameWatchdog watchdog;
+    watchdog.setDeadline(40 * MS);
+    watchdog.reset();
+    CHECK_EQ(watchdog.getDeadline(), 40 * MS);
+
+    CHECK(!watchdog.update(40 * MS));
+    CHECK(watchdog.update(40 * MS + 1));
+
+    // Recovery is within half of it
+    for (int i = 0; i < FRAME_WATCHDOG_RECOVERY_FRAMES - 1; i++)
+        CHECK(!watchdog.update(20 * MS));
+    CHECK(watchdog.update(20 * MS));
+    CHECK(!watchdog.isDegraded());
+}
+
+/*
+ * The simulator gate in front of a sink that takes cost ns per report. Frames are stamped
+ * when the provider sampled them and wait for the gate in order (runAction). While degraded,
+ * motion only frames that find the gate busy are dropped instead (attemptAction), the next
+ * frame supersedes them. Lateness is taken once the report is out, like updateWatchdog.
+ */
+struct SlowSinkHarness {
+    VoodooInputFrameWatchdog watchdog;
+    bool coalescing {true};
+    UInt64 gate_free {0};
+    UInt32 delivered {0};
+    UInt32 coalesced {0};
+    UInt64 worst_lateness {0};
+
+    SlowSinkHarness() { watchdog.reset(); }
+
+    bool submit(UInt64 stamp, bool transition, UInt64 cost) {
+        if (coalescing && watchdog.isDegraded() && !transition && stamp < gate_free) {
+            coalesced++;
+            return false;
+        }
+
+        UInt64 start = stamp > gate_free ? stamp : gate_free;
+        gate_free = start + cost;
+        UInt64 lateness = gate_free - stamp;
+        if (lateness > worst_lateness)
+            worst_lateness = lateness;
+
+        watchdog.update(lateness);
+        delivered++;
+        return true;
+    }
+};
+
+// 125 Hz, the sink needs 12 ms per report from 1 s to 2 s and 1 ms otherwise
+static UInt64 stallingCost(UInt64 stamp) {
+    return stamp >= 1000 * MS && stamp < 2000 * MS ? 12 * MS : 1 * MS;
+}
+
+TEST(SlowSinkEntersAndLeavesDegradedMode) {
+    SlowSinkHarness harness;
+    bool degraded_during_stall = false;
+
+    for (UInt64 stamp = 8 * MS; stamp <= 4000 * MS; stamp += 8 * MS) {
+        harness.submit(stamp, false, stallingCost(stamp));
+        if (stamp == 1504 * MS)
+            degraded_during_stall = harness.watchdog.isDegraded();
+    }
+
+    CHECK(degraded_during_stall);
+    CHECK(!harness.watchdog.isDegraded());
+    CHECK_EQ(harness.watchdog.getModeSwitches(), 2);
+    CHECK(harness.coalesced > 0);
+    // Only frames that found the gate idle got in, lateness stays around one report
+    CHECK(harness.worst_lateness < FRAME_WATCHDOG_DEADLINE_NS + 12 * MS);
+    CHECK_EQ(harness.watchdog.getWorstStall(), harness.worst_lateness);
+}
+
+TEST(WithoutCoalescingTheBacklogGrows) {
+    SlowSinkHarness harness;
+    harness.coalescing = false;
+
+    for (UInt64 stamp = 8 * MS; stamp <= 4000 * MS; stamp += 8 * MS)
+        harness.submit(stamp, false, stallingCost(stamp));
+
+    // 4 ms more per frame for a whole second, then it takes a while to drain
+    CHECK(harness.worst_lateness > 400 * MS);
+    CHECK_EQ(harness.coalesced, 0);
+    CHECK(!harness.watchdog.isDegraded());
+    CHECK(harness.watchdog.getOverruns() > 100);
+}
+
+TEST(TransitionsAreNeverCoalesced) {
+    SlowSinkHarness harness;
+    UInt32 transitions = 0;
+    UInt32 transitions_delivered = 0;
+
+    for (UInt64 stamp = 8 * MS; stamp <= 4000 * MS; stamp += 8 * MS) {
+        bool transition = (stamp / (8 * MS)) % 10 == 0;
+        transitions += transition;
+        transitions_delivered += harness.submit(stamp, transition, stallingCost(stamp)) && transition;
+    }
+
+    CHECK(harness.coalesced > 0);
+    CHECK_EQ(transitions_delivered, transitions);
+    CHECK(!harness.watchdog.isDegraded());
+}
+
+TEST(SinkThatNeverRecoversStaysDegraded) {
+    SlowSinkHarness harness;
+
+    for (UInt64 stamp = 8 * MS; stamp <= 3000 * MS; stamp += 8 * MS)
+        harness.submit(stamp, false, stamp >= 1000 * MS ? 12 * MS : 1 * MS);
+
+    // Every report takes longer than half the deadline, recovery can never count up
+    CHECK(harness.watchdog.isDegraded());
+    CHECK_EQ(harness.watchdog.getModeSwitches(), 1);
+}
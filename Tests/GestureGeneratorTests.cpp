@@ -0,0 +1,249 @@
+//
+//  GestureGeneratorTests.cpp
+//  VoodooInput host tests
+//
+//  Copyright © 2024 Kishor Prins. All rights reserved.
+//
+
+#include "Test.hpp"
+#include "MT2EncoderHarness.hpp"
+
+#include "VoodooInputSimulator/VoodooInputGestureGenerator.hpp"
+
+#include <vector>
+
+static VoodooInputGestureParams params(VoodooInputGestureScenario scenario, UInt32 seed = 1234, UInt8 transform = 0) {
+    return {scenario, seed, 125, 500, 3000, 2000, transform, 10};
+}
+
+// Only the fields the generator writes, the rest of the event is left as it was
+static bool sameFrame(const VoodooInputEvent& a, const VoodooInputEvent& b) {
+    if (a.contact_count != b.contact_count || a.timestamp != b.timestamp)
+        return false;
+
+    for (int i = 0; i < a.contact_count; i++) {
+        const VoodooInputTransducer& x = a.transducers[i];
+        const VoodooInputTransducer& y = b.transducers[i];
+        if (x.currentCoordinates.x != y.currentCoordinates.x || x.currentCoordinates.y != y.currentCoordinates.y ||
+            x.currentCoordinates.pressure != y.currentCoordinates.pressure || x.currentCoordinates.width != y.currentCoordinates.width ||
+            x.isTransducerActive != y.isTransducerActive || x.fingerType != y.fingerType || x.secondaryId != y.secondaryId)
+            return false;
+    }
+    return true;
+}
+
+TEST(SameSeedSameStream) {
+    for (int scenario = 0; scenario < kVoodooInputGestureScenarioCount; scenario++) {
+        VoodooInputGestureGenerator first, second;
+        first.init(params((VoodooInputGestureScenario)scenario), 1000000);
+        second.init(params((VoodooInputGestureScenario)scenario), 1000000);
+
+        VoodooInputEvent a {}, b {};
+        bool same = true;
+        for (int i = 0; i < 2000 && same; i++) {
+            same = first.next(a) == second.next(b) && sameFrame(a, b);
+        }
+        CHECK(same);
+        CHECK_EQ(first.getFrameCount(), second.getFrameCount());
+    }
+}
+
+TEST(SeedsDiffer) {
+    VoodooInputGestureGenerator first, second;
+    first.init(params(kVoodooInputGestureStress, 1), 0);
+    second.init(params(kVoodooInputGestureStress, 2), 0);
+
+    VoodooInputEvent a {}, b {};
+    int different = 0;
+    for (int i = 0; i < 100; i++) {
+        first.next(a);
+        second.next(b);
+        different += !sameFrame(a, b);
+    }
+    CHECK(different > 90);
+}
+
+TEST(TimestampsFollowRateWithinJitter) {
+    VoodooInputGestureGenerator generator;
+    generator.init(params(kVoodooInputGestureCursor), 5000000);
+
+    VoodooInputEvent event {};
+    UInt64 previous = 0;
+    bool increasing = true;
+    for (UInt32 i = 0; i < 5000; i++) {
+        UInt64 timestamp = generator.next(event);
+        UInt64 nominal = 5000000 + (UInt64)i * 8000000;
+        CHECK_NEAR(timestamp, nominal, 500000);
+        CHECK_EQ(event.timestamp, timestamp);
+        increasing &= timestamp > previous;
+        previous = timestamp;
+    }
+    CHECK(increasing);
+}
+
+TEST(TightJitterStaysMonotonic) {
+    // Jitter larger than the period can never make time run backwards
+    VoodooInputGestureParams tight = params(kVoodooInputGestureTapStorm);
+    tight.sample_rate = 1000;
+    tight.jitter_us = 3000;
+    VoodooInputGestureGenerator generator;
+    generator.init(tight, 0);
+
+    VoodooInputEvent event {};
+    UInt64 previous = 0;
+    bool increasing = true;
+    for (int i = 0; i < 5000; i++) {
+        UInt64 timestamp = generator.next(event);
+        increasing &= timestamp > previous;
+        previous = timestamp;
+    }
+    CHECK(increasing);
+}
+
+TEST(ScenarioContactCounts) {
+    static const UInt8 expected[kVoodooInputGestureScenarioCount] = {1, 2, 3, 4, 2, 1, 10};
+
+    for (int scenario = 0; scenario < kVoodooInputGestureScenarioCount; scenario++) {
+        VoodooInputGestureGenerator generator;
+        generator.init(params((VoodooInputGestureScenario)scenario), 0);
+
+        VoodooInputEvent event {};
+        for (int i = 0; i < 200; i++) {
+            generator.next(event);
+            CHECK_EQ(event.contact_count, expected[scenario]);
+        }
+    }
+
+    VoodooInputGestureParams three = params(kVoodooInputGestureStress);
+    three.contacts = 3;
+    VoodooInputGestureGenerator generator;
+    generator.init(three, 0);
+    VoodooInputEvent event {};
+    generator.next(event);
+    CHECK_EQ(event.contact_count, 3);
+}
+
+TEST(EveryStrokeEndsWithLiftOff) {
+    // 500 ms strokes at 125 Hz, tap storms lift every third frame
+    struct Case { VoodooInputGestureScenario scenario; UInt32 length; };
+    static const Case cases[] = {{kVoodooInputGestureCursor, 62}, {kVoodooInputGestureScroll, 62}, {kVoodooInputGestureTapStorm, 3}};
+
+    for (const Case& c : cases) {
+        VoodooInputGestureGenerator generator;
+        generator.init(params(c.scenario), 0);
+
+        VoodooInputEvent event {};
+        for (UInt32 i = 0; i < c.length * 5; i++) {
+            generator.next(event);
+            bool lifted = true;
+            for (int j = 0; j < event.contact_count; j++)
+                lifted &= !event.transducers[j].isTransducerActive;
+            CHECK_EQ(lifted, (i + 1) % c.length == 0);
+        }
+    }
+}
+
+TEST(PalmStaysDownUntilTheFingerLifts) {
+    VoodooInputGestureGenerator generator;
+    generator.init(params(kVoodooInputGesturePalm), 0);
+
+    VoodooInputEvent event {};
+    for (int i = 0; i < 62; i++) {
+        generator.next(event);
+        CHECK_EQ(event.transducers[0].fingerType, kMT2FingerTypePalm);
+        CHECK_EQ(event.transducers[0].isTransducerActive, i != 61);
+        CHECK_EQ(event.transducers[1].isTransducerActive, i != 61);
+    }
+}
+
+TEST(CoordinatesStayOnTheSurface) {
+    for (int scenario = 0; scenario < kVoodooInputGestureScenarioCount; scenario++) {
+        VoodooInputGestureGenerator generator;
+        generator.init(params((VoodooInputGestureScenario)scenario), 0);
+
+        VoodooInputEvent event {};
+        bool inside = true;
+        for (int i = 0; i < 3000; i++) {
+            generator.next(event);
+            for (int j = 0; j < event.contact_count; j++)
+                inside &= event.transducers[j].currentCoordinates.x <= 3000 && event.transducers[j].currentCoordinates.y <= 2000;
+        }
+        CHECK(inside);
+    }
+}
+
+struct ReportRecorder {
+    std::vector<std::vector<UInt8>> reports;
+
+    void sendReport(const UInt8* report, UInt32 length) {
+        reports.emplace_back(report, report + length);
+    }
+
+    void publishSampleProperties() {}
+    void publishWatchdogProperties() {}
+};
+
+static ReportRecorder simulate(VoodooInputGestureScenario scenario, UInt8 transform) {
+    VoodooInputGestureGenerator generator;
+    generator.init(params(scenario, 99, transform), 0);
+    MT2EncoderHarness harness(3000, 2000, transform);
+    ReportRecorder recorder;
+
+    VoodooInputEvent event {};
+    for (int i = 0; i < 300; i++) {
+        generator.next(event);
+        HostClockSet(event.timestamp);
+        harness.encoder.constructReport(event, recorder);
+    }
+    return recorder;
+}
+
+TEST(TransformIsUndoneBySimulator) {
+    // The generator pre-rotates so the simulator lands where an untransformed surface would
+    static const UInt8 transforms[] = {kIOFBRotate90, kIOFBRotate180, kIOFBRotate270};
+
+    for (int scenario = 0; scenario < kVoodooInputGestureScenarioCount; scenario++) {
+        ReportRecorder plain = simulate((VoodooInputGestureScenario)scenario, 0);
+
+        for (UInt8 transform : transforms) {
+            ReportRecorder rotated = simulate((VoodooInputGestureScenario)scenario, transform);
+            CHECK_EQ(rotated.reports.size(), plain.reports.size());
+            if (rotated.reports.size() != plain.reports.size())
+                continue;
+
+            int worst = 0;
+            for (size_t i = 0; i < plain.reports.size(); i++) {
+                CHECK_EQ(rotated.reports[i].size(), plain.reports[i].size());
+                for (size_t offset = MT2_HEADER_SIZE; offset + MT2_FINGER_SIZE <= plain.reports[i].size(); offset += MT2_FINGER_SIZE) {
+                    MT2Finger a = MT2DecodeFinger(&plain.reports[i][offset]);
+                    MT2Finger b = MT2DecodeFinger(&rotated.reports[i][offset]);
+                    int dx = a.x > b.x ? a.x - b.x : b.x - a.x;
+                    int dy = a.y > b.y ? a.y - b.y : b.y - a.y;
+                    worst = dx > worst ? dx : worst;
+                    worst = dy > worst ? dy : worst;
+                    CHECK_EQ(a.state, b.state);
+                    CHECK_EQ(a.identifier, b.identifier);
+                }
+            }
+            // Permille positions scaled twice, only rounding may differ
+            CHECK(worst <= 8);
+        }
+    }
+}
+
+TEST(ReportPathAllocatesNothing) {
+    VoodooInputGestureGenerator generator;
+    generator.init(params(kVoodooInputGestureStress), 0);
+    MT2EncoderHarness harness(3000, 2000, 0);
+    ReportRecorder recorder;
+    recorder.reports.reserve(4000);
+
+    VoodooInputEvent event {};
+    UInt64 before = HostAllocationCount();
+    for (int i = 0; i < 1000; i++) {
+        generator.next(event);
+        harness.encoder.constructReport(event, recorder);
+    }
+    CHECK_EQ(HostAllocationCount(), before);
+    CHECK(harness.encoder.getSampleEstimator().getRate() >= 124 && harness.encoder.getSampleEstimator().getRate() <= 126);
+}
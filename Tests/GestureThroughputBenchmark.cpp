@@ -0,0 +1,184 @@
+//
+//  GestureThroughputBenchmark.cpp
+//  VoodooInput host tests
+//
+//  Copyright © 2024 Kishor Prins. All rights reserved.
+//
+
+#include "Benchmark.hpp"
+#include "MT2EncoderHarness.hpp"
+
+#include "Trackpoint/TrackpointPipeline.hpp"
+#include "VoodooInputSimulator/VoodooInputDigitizerReport.hpp"
+#include "VoodooInputSimulator/VoodooInputGestureGenerator.hpp"
+
+/*
+ * Throughput of the simulator MT2 encoder, the digitizer encoder and the trackpoint
+ * pipeline for every generator scenario. Frames are generated up front so only the path is timed.
+ * The allocation column counts IOMalloc calls during the timed loop.
+ */
+
+static const char* const kScenarioNames[kVoodooInputGestureScenarioCount] = {
+    "cursor", "scroll", "swipe", "pinch", "palm", "tap storm", "stress 10",
+};
+
+struct CountingSink {
+    UInt64 bytes {0};
+    UInt32 reports {0};
+
+    inline void handleReport(const UInt8* report, UInt32 length) {
+        bytes += length + report[length - 1];
+        reports++;
+    }
+
+    inline void sendReport(const UInt8* report, UInt32 length) { handleReport(report, length); }
+    inline void publishSampleProperties() {}
+    inline void publishWatchdogProperties() {}
+
+    inline void dispatchPointer(int dx, int dy, UInt32 buttons, AbsoluteTime timestamp) {
+        bytes += dx - dy + buttons;
+        reports++;
+    }
+
+    inline void dispatchScroll(short deltaAxis1, short deltaAxis2, short deltaAxis3, AbsoluteTime timestamp) {
+        bytes += deltaAxis1 - deltaAxis2;
+        reports++;
+    }
+
+    inline void scheduleFlush(AbsoluteTime deadline) {}
+};
+
+static void measureSimulator(const char* name, const VoodooInputEvent* frames, UInt32 count) {
+    UInt64 allocations = 0;
+    UInt32 reports = 0;
+
+    UInt64 elapsed = BenchmarkBest([&] {
+        MT2EncoderHarness harness(3000, 2000, 0);
+        CountingSink sink;
+
+        UInt64 before = HostAllocationCount();
+        UInt64 start = HostMonotonicNs();
+        for (UInt32 i = 0; i < count; i++) {
+            // Every frame on time, the watchdog stays in normal mode
+            HostClockSet(frames[i].timestamp);
+            harness.encoder.constructReport(frames[i], sink);
+        }
+        UInt64 end = HostMonotonicNs();
+        allocations = HostAllocationCount() - before;
+        reports = sink.reports;
+        BenchmarkKeep(sink.bytes);
+        return end - start;
+    });
+
+    char row[64];
+    snprintf(row, sizeof(row), "%s (%u reports, %llu allocs)", name, reports, (unsigned long long)allocations);
+    BenchmarkRow(row, elapsed, count);
+}
+
+// The same frames as digitizer reports, the alternative backend to the MT2 encoder above
+static void measureDigitizer(const char* name, const VoodooInputEvent* frames, UInt32 count) {
+    UInt64 allocations = 0;
+    UInt32 reports = 0;
+
+    UInt64 elapsed = BenchmarkBest([&] {
+        VoodooInputDigitizerEncoder encoder;
+        DIGITIZER_TOUCH_REPORT touch {};
+        DIGITIZER_PEN_REPORT pen {};
+        CountingSink sink;
+        encoder.reset();
+        encoder.setSurface(3000, 2000, 0);
+
+        UInt64 before = HostAllocationCount();
+        UInt64 start = HostMonotonicNs();
+        for (UInt32 i = 0; i < count; i++) {
+            UInt32 send = encoder.encode(frames[i], frames[i].timestamp, touch, pen);
+            if (send & kDigitizerSendTouch)
+                sink.handleReport((const UInt8*)&touch, sizeof(touch));
+            if (send & kDigitizerSendRelease) {
+                VoodooInputDigitizerEncoder::encodeRelease(touch);
+                sink.handleReport((const UInt8*)&touch, sizeof(touch));
+            }
+            if (send & kDigitizerSendPen)
+                sink.handleReport((const UInt8*)&pen, sizeof(pen));
+        }
+        UInt64 end = HostMonotonicNs();
+        allocations = HostAllocationCount() - before;
+        reports = sink.reports;
+        BenchmarkKeep(sink.bytes);
+        return end - start;
+    });
+
+    char row[64];
+    snprintf(row, sizeof(row), "%s (%u reports, %llu allocs)", name, reports, (unsigned long long)allocations);
+    BenchmarkRow(row, elapsed, count);
+}
+
+// Contact 0 motion replayed as trackpoint packets, the left button while it is down
+static void measureTrackpoint(const char* name, const VoodooInputEvent* frames, UInt32 count) {
+    TrackpointPacket* packets = new TrackpointPacket[count];
+    for (UInt32 i = 0; i < count; i++) {
+        const VoodooInputTransducer& contact = frames[i].transducers[0];
+        const VoodooInputTransducer& previous = frames[i ? i - 1 : 0].transducers[0];
+        packets[i] = {frames[i].timestamp, kTrackpointPacketPointer, true,
+                      (int)contact.currentCoordinates.x - (int)previous.currentCoordinates.x,
+                      (int)contact.currentCoordinates.y - (int)previous.currentCoordinates.y,
+                      contact.isTransducerActive ? 1u : 0u, {0, 0, 0}};
+    }
+
+    TrackpointSettings settings;
+    UInt64 allocations = 0;
+
+    UInt64 elapsed = BenchmarkBest([&] {
+        TrackpointPipelineState state;
+        TrackpointPipelineContext context {settings, state};
+        CountingSink sink;
+
+        UInt64 before = HostAllocationCount();
+        UInt64 start = HostMonotonicNs();
+        for (UInt32 i = 0; i < count; i++) {
+            TrackpointPacket packet = packets[i];
+            TrackpointDefaultPipeline::run(packet, context, sink);
+        }
+        UInt64 end = HostMonotonicNs();
+        allocations = HostAllocationCount() - before;
+        BenchmarkKeep(sink.bytes);
+        return end - start;
+    });
+
+    char row[64];
+    snprintf(row, sizeof(row), "%s (%llu allocs)", name, (unsigned long long)allocations);
+    BenchmarkRow(row, elapsed, count);
+    delete[] packets;
+}
+
+int main(int argc, char** argv) {
+    UInt32 count = BenchmarkIterations(argc, argv, 1000000);
+    VoodooInputEvent* frames[kVoodooInputGestureScenarioCount];
+
+    for (int scenario = 0; scenario < kVoodooInputGestureScenarioCount; scenario++) {
+        VoodooInputGestureGenerator generator;
+        generator.init({(VoodooInputGestureScenario)scenario, 42, 125, 500, 3000, 2000, 0, 10}, 0);
+
+        frames[scenario] = new VoodooInputEvent[count]();
+        for (UInt32 i = 0; i < count; i++) {
+            frames[scenario][i] = i ? frames[scenario][i - 1] : VoodooInputEvent {};
+            generator.next(frames[scenario][i]);
+        }
+    }
+
+    BenchmarkHeader("simulator MT2 encoder, frames");
+    for (int scenario = 0; scenario < kVoodooInputGestureScenarioCount; scenario++)
+        measureSimulator(kScenarioNames[scenario], frames[scenario], count);
+
+    BenchmarkHeader("digitizer encoder, frames");
+    for (int scenario = 0; scenario < kVoodooInputGestureScenarioCount; scenario++)
+        measureDigitizer(kScenarioNames[scenario], frames[scenario], count);
+
+    BenchmarkHeader("trackpoint default pipeline, packets");
+    for (int scenario = 0; scenario < kVoodooInputGestureScenarioCount; scenario++)
+        measureTrackpoint(kScenarioNames[scenario], frames[scenario], count);
+
+    for (VoodooInputEvent* scenario_frames : frames)
+        delete[] scenario_frames;
+    return 0;
+}
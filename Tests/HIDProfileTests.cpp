@@ -0,0 +1,205 @@
+//
+//  HIDProfileTests.cpp
+//  VoodooInput host tests
+//
+//  Copyright © 2024 Kishor Prins. All rights reserved.
+//
+
+#include "Test.hpp"
+
+#include "VoodooInputIDs.hpp"
+#include "VoodooInputSimulator/VoodooInputHIDProfile.hpp"
+
+#include <libkern/version.h>
+
+/*
+ * The hand written blobs VoodooInputSimulatorDevice and VoodooInputActuatorDevice sent
+ * before the tables were generated, copied verbatim. The static_asserts next to the
+ * tables check the same bytes, these also cover the profile picked at run time and the
+ * surface size patched in by copyFeatureResponse.
+ */
+static const UInt8 legacy_report_descriptor[] = {0x05, 0x01, 0x09, 0x02, 0xa1, 0x01, 0x09, 0x01, 0xa1, 0x00, 0x05, 0x09, 0x19, 0x01, 0x29, 0x03, 0x15, 0x00, 0x25, 0x01, 0x85, 0x02, 0x95, 0x03, 0x75, 0x01, 0x81, 0x02, 0x95, 0x01, 0x75, 0x05, 0x81, 0x01, 0x05, 0x01, 0x09, 0x30, 0x09, 0x31, 0x15, 0x81, 0x25, 0x7f, 0x75, 0x08, 0x95, 0x02, 0x81, 0x06, 0x95, 0x04, 0x75, 0x08, 0x81, 0x01, 0xc0, 0xc0, 0x05, 0x0d, 0x09, 0x05, 0xa1, 0x01, 0x06, 0x00, 0xff, 0x09, 0x0c, 0x15, 0x00, 0x26, 0xff, 0x00, 0x75, 0x08, 0x95, 0x10, 0x85, 0x3f, 0x81, 0x22, 0xc0, 0x06, 0x00, 0xff, 0x09, 0x0c, 0xa1, 0x01, 0x06, 0x00, 0xff, 0x09, 0x0c, 0x15, 0x00, 0x26, 0xff, 0x00, 0x85, 0x44, 0x75, 0x08, 0x96, 0x6b, 0x05, 0x81, 0x00, 0xc0};
+static const UInt8 legacy_actuator_descriptor[] = {0x06, 0x00, 0xff, 0x09, 0x0d, 0xa1, 0x01, 0x06, 0x00, 0xff, 0x09, 0x0d, 0x15, 0x00, 0x26, 0xff, 0x00, 0x75, 0x08, 0x85, 0x3f, 0x96, 0x0f, 0x00, 0x81, 0x02, 0x09, 0x0d, 0x85, 0x53, 0x96, 0x3f, 0x00, 0x91, 0x02, 0xc0};
+
+// Sensor Surface Width = 0x3cf0 = 15.600 cm, Height = 0x2b20 = 11.040 cm
+#define SURFACE_WIDTH 0x3cf0
+#define SURFACE_HEIGHT 0x2b20
+
+struct LegacyFeature {
+    UInt8 report_id;
+    UInt8 length;
+    UInt8 bytes[80];
+};
+
+static const LegacyFeature legacy_features[] = {
+    {0x00, 2, {0x0, 0x01}},
+    {0x02, 2, {0x02, 0x01}},
+    {0xD1, 2, {0xD1, 0x81}},
+    {0xD3, 13, {0xD3, 0x01, 0x16, 0x1E, 0x03, 0x95, 0x00, 0x14, 0x1E, 0x62, 0x05, 0x00, 0x00}},
+    {0xD0, 16, {0xD0, 0x02, 0x01, 0x00, 0x14, 0x01, 0x00, 0x1E, 0x00, 0x02, 0x14, 0x02, 0x01, 0x0E, 0x02, 0x00}},
+    {0xA1, 7, {0xA1, 0x00, 0x00, 0x05, 0x00, 0xFC, 0x01}},
+    {0xD9, 17, {0xD9, 0xf0, 0x3c, 0x00, 0x00, 0x20, 0x2b, 0x00, 0x00, 0x44, 0xE3, 0x52, 0xFF, 0xBD, 0x1E, 0xE4, 0x26}},
+    {0x7F, 5, {0x7F, 0x00, 0x00, 0x00, 0x00}},
+    {0xC8, 2, {0xC8, 0x08}},
+    {0xDB, 72, {0xDB, 0x01, 0x02, 0x00,
+        0xD1, 0x81,
+        0x0D, 0x00,
+        0xD3, 0x01, 0x16, 0x1E, 0x03, 0x95, 0x00, 0x14, 0x1E, 0x62, 0x05, 0x00, 0x00,
+        0x10, 0x00,
+        0xD0, 0x02, 0x01, 0x00, 0x14, 0x01, 0x00, 0x1E, 0x00, 0x02, 0x14, 0x02, 0x01, 0x0E, 0x02, 0x00,
+        0x07, 0x00,
+        0xA1, 0x00, 0x00, 0x05, 0x00, 0xFC, 0x01,
+        0x11, 0x00,
+        0xD9, 0xf0, 0x3c, 0x00, 0x00, 0x20, 0x2b, 0x00, 0x00, 0x44, 0xE3, 0x52, 0xFF, 0xBD, 0x1E, 0xE4, 0x26,
+        0x7F, 0x00, 0x00, 0x00, 0x00}},
+};
+
+// Lengths setReport acknowledged when the host selected a report through report 0x01
+static const UInt8 legacy_acknowledgements[][2] = {{0xDB, 0x49}, {0xD1, 0x01}, {0xD3, 0x0C}, {0xD0, 0x0F}, {0xA1, 0x06}, {0x7F, 0x04}, {0xC8, 0x01}};
+
+static const int darwin_majors[] = {14, 20, 21, 23, 25};
+
+template <size_t Capacity, size_t N>
+static bool sameBytes(const VoodooInputHIDBytes<Capacity>& generated, const UInt8 (&expected)[N]) {
+    return generated.length == N && memcmp(generated.bytes, expected, N) == 0;
+}
+
+// What copyFeatureResponse hands out for the surface above
+static size_t copyFeature(const VoodooInputHIDTables& tables, UInt8 report_id, UInt8* buffer) {
+    const VoodooInputFeatureReport* feature = tables.findFeature(report_id);
+    if (!feature)
+        return 0;
+
+    memcpy(buffer, feature->response.bytes, feature->response.length);
+    if (feature->has_surface) {
+        UInt8* surface = buffer + feature->surface_offset;
+        surface[MT2_SURFACE_WIDTH_OFFSET] = SURFACE_WIDTH & 0xff;
+        surface[MT2_SURFACE_WIDTH_OFFSET + 1] = (SURFACE_WIDTH >> 8) & 0xff;
+        surface[MT2_SURFACE_HEIGHT_OFFSET] = SURFACE_HEIGHT & 0xff;
+        surface[MT2_SURFACE_HEIGHT_OFFSET + 1] = (SURFACE_HEIGHT >> 8) & 0xff;
+    }
+    return feature->response.length;
+}
+
+TEST(ProfileFollowsDarwinVersion) {
+    int saved = version_major;
+
+    for (int major : darwin_majors) {
+        version_major = major;
+        const VoodooInputHIDTables& tables = VoodooInputGetHIDTables();
+        CHECK_EQ(tables.profile->product_id, major >= kVoodooInputVersionMonterey ? kVoodooInputProductMacbookAir10_1 : kVoodooInputProductMacbook8_1);
+        CHECK_EQ(tables.profile->version, 0x804);
+        CHECK(major >= tables.profile->min_darwin_major);
+    }
+
+    version_major = saved;
+}
+
+TEST(DescriptorsMatchLegacyBlobs) {
+    int saved = version_major;
+
+    for (int major : darwin_majors) {
+        version_major = major;
+        const VoodooInputHIDTables& tables = VoodooInputGetHIDTables();
+        CHECK(sameBytes(tables.report_descriptor, legacy_report_descriptor));
+        CHECK(sameBytes(tables.actuator_descriptor, legacy_actuator_descriptor));
+    }
+
+    version_major = saved;
+}
+
+TEST(FeatureRepliesMatchLegacyBuffers) {
+    int saved = version_major;
+
+    for (int major : darwin_majors) {
+        version_major = major;
+        const VoodooInputHIDTables& tables = VoodooInputGetHIDTables();
+
+        for (const LegacyFeature& legacy : legacy_features) {
+            UInt8 buffer[MT2_FEATURE_MAX_SIZE] {};
+            size_t length = copyFeature(tables, legacy.report_id, buffer);
+            CHECK_EQ(length, legacy.length);
+            CHECK(memcmp(buffer, legacy.bytes, legacy.length) == 0);
+        }
+
+        // Reports the legacy code never answered
+        UInt8 buffer[MT2_FEATURE_MAX_SIZE] {};
+        CHECK_EQ(copyFeature(tables, 0x01, buffer), 0);
+        CHECK_EQ(copyFeature(tables, 0x44, buffer), 0);
+    }
+
+    version_major = saved;
+}
+
+TEST(AcknowledgementsMatchLegacySetReport) {
+    int saved = version_major;
+
+    for (int major : darwin_majors) {
+        version_major = major;
+        const VoodooInputHIDTables& tables = VoodooInputGetHIDTables();
+
+        for (const auto& legacy : legacy_acknowledgements) {
+            const VoodooInputFeatureReport* feature = tables.findFeature(legacy[0]);
+            CHECK(feature != nullptr);
+            if (feature)
+                CHECK_EQ(feature->ack_length, legacy[1]);
+        }
+
+        // Status reports are answered but never acknowledged
+        CHECK_EQ(tables.findFeature(0x00)->ack_length, 0);
+        CHECK_EQ(tables.findFeature(0x02)->ack_length, 0);
+    }
+
+    version_major = saved;
+}
+
+TEST(SurfaceOffsetsPointAtTheSurfaceReport) {
+    const VoodooInputHIDTables& tables = VoodooInputGetHIDTables();
+    const VoodooInputFeatureReport* surface = tables.findFeature(MT2_SURFACE_REPORT_ID);
+    const VoodooInputFeatureReport* description = tables.findFeature(MT2_SENSOR_DESCRIPTION_REPORT_ID);
+
+    CHECK(surface && surface->has_surface && surface->surface_offset == 0);
+    CHECK(description && description->has_surface);
+    if (description)
+        CHECK_EQ(description->response.bytes[description->surface_offset], MT2_SURFACE_REPORT_ID);
+}
+
+// Bits per report id and main item type over the whole descriptor
+template <size_t Capacity>
+static UInt32 reportBits(const VoodooInputHIDBytes<Capacity>& descriptor, UInt8 report_id, UInt8 main_tag) {
+    UInt32 bits = 0, report_size = 0, report_count = 0, current_id = 0;
+
+    for (size_t i = 0; i < descriptor.length;) {
+        UInt8 prefix = descriptor.bytes[i];
+        UInt8 size = (prefix & 0x3) == 3 ? 4 : prefix & 0x3;
+        UInt32 value = 0;
+        for (UInt8 j = 0; j < size; j++)
+            value |= (UInt32)descriptor.bytes[i + 1 + j] << (j * 8);
+        i += 1 + size;
+
+        if ((prefix & 0xFC) == HID_REPORT_ID)
+            current_id = value;
+        else if ((prefix & 0xFC) == HID_REPORT_SIZE)
+            report_size = value;
+        else if ((prefix & 0xFC) == HID_REPORT_COUNT)
+            report_count = value;
+        else if ((prefix & 0xFC) == main_tag && current_id == report_id)
+            bits += report_size * report_count;
+    }
+    return bits;
+}
+
+TEST(CompositeCarriesBothCollections) {
+    const VoodooInputHIDTables& tables = VoodooInputGetHIDTables();
+    const VoodooInputHIDBytes<192>& composite = tables.composite_descriptor;
+
+    CHECK_EQ(composite.length, sizeof(legacy_report_descriptor) + sizeof(legacy_actuator_descriptor));
+    CHECK(memcmp(composite.bytes, legacy_report_descriptor, sizeof(legacy_report_descriptor)) == 0);
+    CHECK(memcmp(composite.bytes + sizeof(legacy_report_descriptor), legacy_actuator_descriptor, sizeof(legacy_actuator_descriptor)) == 0);
+
+    // 0x3F spans the multitouch and actuator collections, every other report is as before
+    CHECK_EQ(reportBits(composite, 0x3F, HID_INPUT), (0x10 + 0x0F) * 8);
+    CHECK_EQ(reportBits(composite, MT2_ACTUATOR_REPORT_ID, HID_OUTPUT), 0x3F * 8);
+    CHECK_EQ(reportBits(composite, 0x02, HID_INPUT), reportBits(tables.report_descriptor, 0x02, HID_INPUT));
+    CHECK_EQ(reportBits(composite, 0x44, HID_INPUT), reportBits(tables.report_descriptor, 0x44, HID_INPUT));
+}
@@ -0,0 +1,34 @@
+//
+//  Jitter.hpp
+//  VoodooInput host tests
+//
+//  Copyright © 2024 Kishor Prins. All rights reserved.
+//
+
+#ifndef VOODOO_INPUT_TEST_JITTER_HPP
+#define VOODOO_INPUT_TEST_JITTER_HPP
+
+#include <IOKit/IOService.h>
+
+// Same seed, same trace on every host
+class TestRandom {
+public:
+    explicit TestRandom(UInt32 seed) : state(seed ? seed : 1) {}
+
+    UInt32 next() {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        return state;
+    }
+
+    // Uniform in [-range, range]
+    SInt64 jitter(SInt64 range) {
+        return range ? (SInt64)(next() % (UInt32)(2 * range + 1)) - range : 0;
+    }
+
+private:
+    UInt32 state;
+};
+
+#endif // VOODOO_INPUT_TEST_JITTER_HPP
@@ -0,0 +1,389 @@
+//
+//  KdebugTests.cpp
+//  VoodooInput host tests
+//
+//  Copyright © 2024 Kishor Prins. All rights reserved.
+//
+
+#include "Test.hpp"
+
+#include "MT2EncoderHarness.hpp"
+#include "DispatchModel.hpp"
+#include "TrackpointRecorder.hpp"
+
+#include <string.h>
+#include <vector>
+
+#define PERIOD_NS 8000000ULL
+
+struct ReportRecorder {
+    std::vector<std::vector<UInt8>> reports;
+
+    void sendReport(const UInt8* report, UInt32 length) {
+        reports.emplace_back(report, report + length);
+    }
+
+    void publishSampleProperties() {}
+    void publishWatchdogProperties() {}
+};
+
+// The simulator gate, attemptGated finds it busy while busy is set
+struct GateRecorder : ReportRecorder {
+    MT2EncoderHarness& harness;
+    bool busy {false};
+    UInt32 attempts {0};
+    UInt32 scheduled {0};
+
+    explicit GateRecorder(MT2EncoderHarness& harness) : harness(harness) {}
+
+    void runGated(const VoodooInputEvent& event) {
+        harness.encoder.constructReport(event, *this);
+    }
+
+    bool attemptGated(const VoodooInputEvent& event) {
+        attempts++;
+        if (busy)
+            return false;
+        harness.encoder.constructReport(event, *this);
+        return true;
+    }
+
+    void schedulePending() {
+        scheduled++;
+    }
+};
+
+// Names Scripts/voodooinput.codes gives each code, in enum order
+static const char* const code_names[] = {
+    "VoodooInput_Message",
+    "VoodooInput_Gate",
+    "VoodooInput_Frame",
+    "VoodooInput_Report",
+    "VoodooInput_LiftOff",
+    "VoodooInput_Trackpoint",
+};
+static_assert(sizeof(code_names) / sizeof(code_names[0]) == kVoodooInputKdebugTrackpoint, "A kdebug code has no name");
+
+static UInt32 code(const HostKdebugEvent& event) {
+    return (event.debugid >> 2) & 0x3fff;
+}
+
+static UInt32 function(const HostKdebugEvent& event) {
+    return event.debugid & 0x3;
+}
+
+// Fingers down for the given number of frames, then a frame lifting them, each sampled lateness ns before it arrives
+template <typename Submit>
+static void tap(UInt64& now, int frames, UInt8 fingers, UInt64 lateness, Submit submit) {
+    VoodooInputEvent event {};
+    event.contact_count = fingers;
+
+    for (int i = 0; i <= frames; i++, now += PERIOD_NS) {
+        HostClockSet(now + lateness);
+        event.timestamp = now;
+        for (UInt8 j = 0; j < fingers; j++) {
+            VoodooInputTransducer& transducer = event.transducers[j];
+            transducer.type = VoodooInputTransducerType::FINGER;
+            transducer.isValid = true;
+            transducer.secondaryId = j;
+            transducer.fingerType = kMT2FingerTypeIndexFinger;
+            transducer.isTransducerActive = i < frames;
+            transducer.currentCoordinates.x = 1000 + i * 10 + j * 300;
+            transducer.currentCoordinates.y = 1000;
+        }
+        submit(event);
+    }
+}
+
+// Straight into the encoder, the way the gate runs it
+static void tap(MT2EncoderHarness& harness, ReportRecorder& recorder, UInt64& now, int frames, UInt8 fingers = 1) {
+    tap(now, frames, fingers, 0, [&](const VoodooInputEvent& event) { harness.encoder.constructReport(event, recorder); });
+}
+
+TEST(DisabledEmitsNothing) {
+    MT2EncoderHarness harness(3000, 2000, 0);
+    ReportRecorder recorder;
+    UInt64 now = 0;
+
+    VoodooInputKdebugEnabled = false;
+    HostKdebugClear();
+    tap(harness, recorder, now, 20);
+    CHECK(!recorder.reports.empty());
+    CHECK_EQ(HostKdebugCount(), 0);
+}
+
+TEST(DebugIdsUseTheThirdPartyClass) {
+    for (UInt32 i = kVoodooInputKdebugMessage; i <= kVoodooInputKdebugTrackpoint; i++) {
+        UInt32 debugid = VOODOO_INPUT_KDEBUG_ID(i);
+        CHECK_EQ(debugid >> 24, DBG_THIRD_PARTY);
+        CHECK_EQ((debugid >> 16) & 0xff, 'V');
+        CHECK_EQ(debugid, 0x25560000 | (i << 2));
+    }
+}
+
+TEST(FramesBracketTheirReports) {
+    MT2EncoderHarness harness(3000, 2000, 0);
+    ReportRecorder recorder;
+    UInt64 now = 0;
+
+    VoodooInputKdebugEnabled = true;
+    HostKdebugClear();
+    tap(harness, recorder, now, 10, 2);
+    tap(harness, recorder, now, 5);
+    VoodooInputKdebugEnabled = false;
+
+    CHECK_EQ(HostKdebugLost(), 0);
+
+    bool in_frame = false;
+    UInt32 frames = 0, lift_offs = 0;
+    size_t reports = 0;
+    for (size_t i = 0; i < HostKdebugCount(); i++) {
+        const HostKdebugEvent& event = HostKdebugAt(i);
+
+        switch (code(event)) {
+            case kVoodooInputKdebugFrame:
+                // Nested or unbalanced brackets would read as overlapping frames in ktrace
+                CHECK_EQ(function(event), in_frame ? DBG_FUNC_END : DBG_FUNC_START);
+                if (function(event) == DBG_FUNC_START)
+                    frames++;
+                in_frame = function(event) == DBG_FUNC_START;
+                break;
+            case kVoodooInputKdebugReport:
+                CHECK(in_frame);
+                CHECK(reports < recorder.reports.size());
+                if (reports < recorder.reports.size()) {
+                    const std::vector<UInt8>& report = recorder.reports[reports];
+                    CHECK_EQ(event.args[0], report.size());
+                    CHECK_EQ(event.args[1], report[7]);
+                }
+                reports++;
+                break;
+            case kVoodooInputKdebugLiftOff:
+                CHECK(in_frame);
+                CHECK_EQ(event.args[0], lift_offs ? 1 : 2);
+                lift_offs++;
+                break;
+            default:
+                CHECK(false);
+        }
+    }
+
+    CHECK(!in_frame);
+    CHECK_EQ(frames, 11 + 6);
+    CHECK_EQ(lift_offs, 2);
+    CHECK_EQ(reports, recorder.reports.size());
+}
+
+/*
+ * Every submitted frame is bracketed by the gate, with the frame inside unless a busy gate
+ * refused it. Only motion while degraded is attempted.
+ */
+static void checkGateSequence(UInt32& entered, UInt32& attempted, UInt32& refused) {
+    bool in_gate = false, in_frame = false;
+    uintptr_t attempt = 0;
+    UInt32 frames_in_gate = 0;
+    entered = attempted = refused = 0;
+
+    for (size_t i = 0; i < HostKdebugCount(); i++) {
+        const HostKdebugEvent& event = HostKdebugAt(i);
+
+        switch (code(event)) {
+            case kVoodooInputKdebugGate:
+                CHECK(!in_frame);
+                CHECK_EQ(function(event), in_gate ? DBG_FUNC_END : DBG_FUNC_START);
+                if (function(event) == DBG_FUNC_START) {
+                    attempt = event.args[1];
+                    frames_in_gate = 0;
+                    entered++;
+                    attempted += attempt != 0;
+                } else {
+                    CHECK_EQ(event.args[1], attempt);
+                    // Waiting for the gate always gets the frame in
+                    CHECK_EQ(frames_in_gate, attempt ? frames_in_gate : 1);
+                    refused += frames_in_gate == 0;
+                }
+                in_gate = function(event) == DBG_FUNC_START;
+                break;
+            case kVoodooInputKdebugFrame:
+                CHECK(in_gate);
+                CHECK_EQ(function(event), in_frame ? DBG_FUNC_END : DBG_FUNC_START);
+                frames_in_gate += function(event) == DBG_FUNC_START;
+                in_frame = function(event) == DBG_FUNC_START;
+                break;
+            case kVoodooInputKdebugReport:
+            case kVoodooInputKdebugLiftOff:
+                CHECK(in_frame);
+                break;
+            default:
+                CHECK(false);
+        }
+    }
+
+    CHECK(!in_gate);
+    CHECK(!in_frame);
+}
+
+TEST(GateBracketsEachSubmittedFrame) {
+    MT2EncoderHarness harness(3000, 2000, 0);
+    GateRecorder gate(harness);
+    UInt64 now = 0;
+
+    VoodooInputKdebugEnabled = true;
+    HostKdebugClear();
+    tap(now, 10, 2, 0, [&](const VoodooInputEvent& event) { harness.encoder.submit(event, gate); });
+    VoodooInputKdebugEnabled = false;
+
+    UInt32 entered, attempted, refused;
+    checkGateSequence(entered, attempted, refused);
+    CHECK_EQ(entered, 11);
+    CHECK_EQ(attempted, 0);
+    CHECK_EQ(refused, 0);
+    CHECK_EQ(gate.attempts, 0);
+}
+
+TEST(DegradedMotionIsAttemptedAndMayBeRefused) {
+    MT2EncoderHarness harness(3000, 2000, 0);
+    GateRecorder gate(harness);
+    gate.busy = true;
+    // The watchdog skips frames without a timestamp
+    UInt64 now = PERIOD_NS;
+
+    // Every frame arrives well past the deadline, the first one puts the encoder behind
+    VoodooInputKdebugEnabled = true;
+    HostKdebugClear();
+    tap(now, 10, 1, 2 * FRAME_WATCHDOG_DEADLINE_NS, [&](const VoodooInputEvent& event) { harness.encoder.submit(event, gate); });
+    VoodooInputKdebugEnabled = false;
+
+    CHECK(harness.encoder.getWatchdog().isDegraded());
+
+    UInt32 entered, attempted, refused;
+    checkGateSequence(entered, attempted, refused);
+    CHECK_EQ(entered, 11);
+    // The touch and the lift off wait, the motion between them gives way
+    CHECK_EQ(attempted, 9);
+    CHECK_EQ(refused, 9);
+    CHECK_EQ(gate.attempts, 9);
+    CHECK_EQ(gate.scheduled, 1);
+}
+
+TEST(MessagesAreMarkedWithTheirType) {
+    ModelService parent;
+    ModelEngine engine(&parent);
+    VoodooInputEvent event {};
+    VoodooInputDimensions dimensions {};
+    TrackpointReport report {};
+    const VoodooInputInterface* interface = nullptr;
+
+    const UInt32 types[] = {
+        kIOMessageVoodooInputGetInterfaceMessage,
+        kIOMessageVoodooInputMessage,
+        kIOMessageVoodooInputUpdateDimensionsMessage,
+        kIOMessageVoodooTrackpointMessage,
+        0x1234,
+    };
+    void* const arguments[] = {&interface, &event, &dimensions, &report, nullptr};
+
+    VoodooInputKdebugEnabled = true;
+    HostKdebugClear();
+    for (size_t i = 0; i < sizeof(types) / sizeof(types[0]); i++)
+        engine.message(types[i], &parent, arguments[i]);
+
+    // Providers on the interface do not go through message()
+    CHECK(interface != nullptr);
+    if (interface) {
+        interface->submitTouchFrame(interface->context, &event);
+        interface->submitTrackpointReport(interface->context, &report);
+    }
+    VoodooInputKdebugEnabled = false;
+
+    CHECK_EQ(HostKdebugCount(), sizeof(types) / sizeof(types[0]));
+    for (size_t i = 0; i < HostKdebugCount() && i < sizeof(types) / sizeof(types[0]); i++) {
+        const HostKdebugEvent& point = HostKdebugAt(i);
+        CHECK_EQ(code(point), kVoodooInputKdebugMessage);
+        CHECK_EQ(function(point), DBG_FUNC_NONE);
+        CHECK_EQ(point.args[0], types[i]);
+    }
+}
+
+TEST(TrackpointReportsAreMarkedBeforeThePipeline) {
+    TrackpointSettings settings;
+    TrackpointPipelineState state;
+    TrackpointPipelineContext context {settings, state};
+    TrackpointRecorder recorder;
+
+    const TrackpointReport reports[] = {
+        {1000, 5, -3, 0},
+        {2000, -40, 12, 1},
+        {3000, 0, 0, 2},
+        {4000, 2, 7, 0},
+    };
+
+    VoodooInputKdebugEnabled = true;
+    HostKdebugClear();
+    for (const TrackpointReport& report : reports) {
+        TrackpointPacket packet = TrackpointReportPacket(report);
+        TrackpointDefaultPipeline::run(packet, context, recorder);
+    }
+
+    // What the provider already processed comes in through updateRelativePointer, unmarked
+    TrackpointPacket relative {5000, kTrackpointPacketPointer, false, 4, 4, 0, {0, 0, 0}};
+    TrackpointDefaultPipeline::run(relative, context, recorder);
+    VoodooInputKdebugEnabled = false;
+
+    CHECK_EQ(recorder.events.size(), 5);
+    CHECK_EQ(HostKdebugCount(), sizeof(reports) / sizeof(reports[0]));
+    for (size_t i = 0; i < HostKdebugCount() && i < sizeof(reports) / sizeof(reports[0]); i++) {
+        const HostKdebugEvent& point = HostKdebugAt(i);
+        CHECK_EQ(code(point), kVoodooInputKdebugTrackpoint);
+        CHECK_EQ(function(point), DBG_FUNC_NONE);
+        CHECK_EQ(point.args[0], (uintptr_t)reports[i].dx);
+        CHECK_EQ(point.args[1], (uintptr_t)reports[i].dy);
+        CHECK_EQ(point.args[2], reports[i].buttons);
+    }
+}
+
+TEST(RecordingAllocatesNothing) {
+    MT2EncoderHarness harness(3000, 2000, 0);
+    ReportRecorder recorder;
+    recorder.reports.reserve(512);
+    UInt64 now = 0;
+
+    VoodooInputKdebugEnabled = true;
+    HostKdebugClear();
+    UInt64 before = HostAllocationCount();
+    tap(harness, recorder, now, 100);
+    CHECK_EQ(HostAllocationCount(), before);
+    VoodooInputKdebugEnabled = false;
+}
+
+TEST(CodesFileMatchesTheEnum) {
+    FILE* file = fopen(VOODOO_INPUT_KDEBUG_CODES, "r");
+    CHECK(file != nullptr);
+    if (!file)
+        return;
+
+    UInt32 expected = kVoodooInputKdebugMessage;
+    char line[128];
+    while (fgets(line, sizeof(line), file)) {
+        unsigned debugid = 0;
+        char name[64] {};
+        if (line[0] == '\n')
+            continue;
+
+        CHECK_EQ(sscanf(line, "%x\t%63s", &debugid, name), 2);
+        CHECK(expected <= kVoodooInputKdebugTrackpoint);
+        if (expected > kVoodooInputKdebugTrackpoint)
+            break;
+
+        CHECK_EQ(debugid, VOODOO_INPUT_KDEBUG_ID(expected));
+        if (strcmp(name, code_names[expected - 1]) != 0) {
+            fprintf(stderr, "code %u is named %s, expected %s\n", expected, name, code_names[expected - 1]);
+            CHECK(false);
+        }
+        expected++;
+    }
+    fclose(file);
+
+    // Every code has a name
+    CHECK_EQ(expected, kVoodooInputKdebugTrackpoint + 1);
+}
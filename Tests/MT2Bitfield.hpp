@@ -0,0 +1,51 @@
+//
+//  MT2Bitfield.hpp
+//  VoodooInput host tests
+//
+//  Copyright © 2024 Kishor Prins. All rights reserved.
+//
+
+#ifndef VOODOO_INPUT_TEST_MT2_BITFIELD_HPP
+#define VOODOO_INPUT_TEST_MT2_BITFIELD_HPP
+
+#include "VoodooInputSimulator/VoodooInputMT2Codec.hpp"
+
+/*
+ * The finger record as the simulator declared it before the codec, kept verbatim.
+ * The codec has to produce the same bytes the compiler packs this into.
+ */
+struct __attribute__((__packed__)) MAGIC_TRACKPAD_INPUT_REPORT_FINGER {
+    SInt16 X: 13;
+    SInt16 Y: 13;
+    UInt8 Finger: 3;
+    UInt8 State: 3;
+    UInt8 Touch_Major;
+    UInt8 Touch_Minor;
+    UInt8 Size;
+    UInt8 Pressure;
+    UInt8 Identifier: 4;
+    UInt8 : 1;
+    UInt8 Angle: 3;
+};
+
+static_assert(sizeof(MAGIC_TRACKPAD_INPUT_REPORT_FINGER) == MT2_FINGER_SIZE, "Unexpected MAGIC_TRACKPAD_INPUT_REPORT_FINGER size");
+
+// Field by field, like encodeReport used to fill it
+static inline void MT2BitfieldEncodeFinger(const MT2Finger& finger, MAGIC_TRACKPAD_INPUT_REPORT_FINGER& out) {
+    out.State = finger.state;
+    out.Finger = finger.finger;
+    out.Pressure = finger.pressure;
+    out.Size = finger.size;
+    out.Touch_Major = finger.touchMajor;
+    out.Touch_Minor = finger.touchMinor;
+    out.X = finger.x;
+    out.Y = finger.y;
+    out.Angle = finger.angle;
+    out.Identifier = finger.identifier;
+}
+
+static inline MT2Finger MT2BitfieldDecodeFinger(const MAGIC_TRACKPAD_INPUT_REPORT_FINGER& in) {
+    return MT2Finger {(SInt16)in.X, (SInt16)in.Y, in.Finger, in.State, in.Touch_Major, in.Touch_Minor, in.Size, in.Pressure, in.Identifier, in.Angle};
+}
+
+#endif // VOODOO_INPUT_TEST_MT2_BITFIELD_HPP
@@ -0,0 +1,87 @@
+//
+//  MT2CodecBenchmark.cpp
+//  VoodooInput host tests
+//
+//  Copyright © 2024 Kishor Prins. All rights reserved.
+//
+
+#include "Benchmark.hpp"
+#include "Jitter.hpp"
+#include "MT2Bitfield.hpp"
+
+/*
+ * Shift/mask codec against the bitfield struct it replaced, encoding and decoding
+ * one full 10 finger report per iteration.
+ */
+
+#define FINGERS 10
+#define FRAMES 1024
+
+static MT2Finger frames[FRAMES][FINGERS];
+static UInt8 report[FINGERS * MT2_FINGER_SIZE];
+
+// Precomputed so only the codec is in the loop
+static void makeFrames() {
+    TestRandom random(5);
+    for (int f = 0; f < FRAMES; f++) {
+        for (int i = 0; i < FINGERS; i++) {
+            MT2Finger& finger = frames[f][i];
+            finger = {(SInt16)(i * 700 - 3500 + random.jitter(200)), (SInt16)(i * 400 - 2000 + random.jitter(200)), 2,
+                      kTouchStateActive, 20, 20, 10, (UInt8)random.next(), (UInt8)(i + 1), 4};
+        }
+    }
+}
+
+template <typename Round>
+static void measure(const char* name, UInt32 count, Round round) {
+    UInt64 elapsed = BenchmarkBest([&] {
+        UInt64 sum = 0;
+        UInt64 start = HostMonotonicNs();
+        for (UInt32 i = 0; i < count; i++)
+            sum += round(frames[i % FRAMES]);
+        UInt64 end = HostMonotonicNs();
+        BenchmarkKeep(sum);
+        return end - start;
+    });
+    BenchmarkRow(name, elapsed, count);
+}
+
+int main(int argc, char** argv) {
+    UInt32 count = BenchmarkIterations(argc, argv, 2000000);
+    makeFrames();
+
+    BenchmarkHeader("10 finger reports");
+    measure("encode bitfield", count, [](const MT2Finger* fingers) {
+        MAGIC_TRACKPAD_INPUT_REPORT_FINGER* out = (MAGIC_TRACKPAD_INPUT_REPORT_FINGER*)report;
+        for (int i = 0; i < FINGERS; i++)
+            MT2BitfieldEncodeFinger(fingers[i], out[i]);
+        BenchmarkKeep(report);
+        return report[0];
+    });
+    measure("encode codec", count, [](const MT2Finger* fingers) {
+        for (int i = 0; i < FINGERS; i++)
+            MT2EncodeFinger(fingers[i], report + i * MT2_FINGER_SIZE);
+        BenchmarkKeep(report);
+        return report[0];
+    });
+    measure("encode + decode bitfield", count, [](const MT2Finger* fingers) {
+        MAGIC_TRACKPAD_INPUT_REPORT_FINGER* out = (MAGIC_TRACKPAD_INPUT_REPORT_FINGER*)report;
+        int sum = 0;
+        for (int i = 0; i < FINGERS; i++)
+            MT2BitfieldEncodeFinger(fingers[i], out[i]);
+        BenchmarkKeep(report);
+        for (int i = 0; i < FINGERS; i++)
+            sum += MT2BitfieldDecodeFinger(out[i]).x;
+        return sum;
+    });
+    measure("encode + decode codec", count, [](const MT2Finger* fingers) {
+        int sum = 0;
+        for (int i = 0; i < FINGERS; i++)
+            MT2EncodeFinger(fingers[i], report + i * MT2_FINGER_SIZE);
+        BenchmarkKeep(report);
+        for (int i = 0; i < FINGERS; i++)
+            sum += MT2DecodeFinger(report + i * MT2_FINGER_SIZE).x;
+        return sum;
+    });
+    return 0;
+}
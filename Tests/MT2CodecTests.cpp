@@ -0,0 +1,184 @@
+//
+//  MT2CodecTests.cpp
+//  VoodooInput host tests
+//
+//  Copyright © 2024 Kishor Prins. All rights reserved.
+//
+
+#include "Test.hpp"
+#include "Jitter.hpp"
+#include "MT2Bitfield.hpp"
+
+static MT2Finger randomFinger(TestRandom& random) {
+    UInt32 bits = random.next();
+    return MT2Finger {
+        (SInt16)((SInt32)(random.next() % 8192) - 4096), (SInt16)((SInt32)(random.next() % 8192) - 4096),
+        (UInt8)(bits & 0x7), (UInt8)((bits >> 3) & 0x7), (UInt8)(bits >> 8), (UInt8)(bits >> 16), (UInt8)(bits >> 24),
+        (UInt8)random.next(), (UInt8)((bits >> 6) & 0xF), (UInt8)((bits >> 10) & 0x7)
+    };
+}
+
+static bool sameFinger(const MT2Finger& a, const MT2Finger& b) {
+    return a.x == b.x && a.y == b.y && a.finger == b.finger && a.state == b.state && a.touchMajor == b.touchMajor &&
+        a.touchMinor == b.touchMinor && a.size == b.size && a.pressure == b.pressure && a.identifier == b.identifier &&
+        a.angle == b.angle;
+}
+
+TEST(EveryCoordinateRoundTrips) {
+    MT2Finger finger {0, 0, 2, kTouchStateActive, 20, 20, 10, 5, 1, 4};
+    UInt8 bytes[MT2_FINGER_SIZE];
+    int failures = 0;
+
+    for (SInt32 value = -4096; value < 4096; value++) {
+        finger.x = (SInt16)value;
+        finger.y = (SInt16)(-1 - value);
+        MT2EncodeFinger(finger, bytes);
+        failures += !sameFinger(MT2DecodeFinger(bytes), finger);
+    }
+    CHECK_EQ(failures, 0);
+}
+
+TEST(RandomFingersRoundTrip) {
+    TestRandom random(33);
+    UInt8 bytes[MT2_FINGER_SIZE];
+    int failures = 0;
+
+    for (int i = 0; i < 100000; i++) {
+        MT2Finger finger = randomFinger(random);
+        MT2EncodeFinger(finger, bytes);
+        failures += !sameFinger(MT2DecodeFinger(bytes), finger);
+    }
+    CHECK_EQ(failures, 0);
+}
+
+TEST(OutOfRangeFieldsAreMasked) {
+    // Wider values must not spill into their neighbours
+    MT2Finger finger {0, 0, 0xFF, 0xFF, 0, 0, 0, 0, 0xFF, 0xFF};
+    UInt8 bytes[MT2_FINGER_SIZE];
+    MT2EncodeFinger(finger, bytes);
+
+    MT2Finger decoded = MT2DecodeFinger(bytes);
+    CHECK_EQ(decoded.x, 0);
+    CHECK_EQ(decoded.y, 0);
+    CHECK_EQ(decoded.finger, 0x7);
+    CHECK_EQ(decoded.state, 0x7);
+    CHECK_EQ(decoded.identifier, 0xF);
+    CHECK_EQ(decoded.angle, 0x7);
+    // The reserved bit stays clear
+    CHECK_EQ(bytes[8] & 0x10, 0);
+}
+
+TEST(MatchesBitfieldLayout) {
+    TestRandom random(7);
+    int mismatches = 0;
+
+    for (int i = 0; i < 100000; i++) {
+        MT2Finger finger = randomFinger(random);
+        UInt8 bytes[MT2_FINGER_SIZE];
+        MAGIC_TRACKPAD_INPUT_REPORT_FINGER bitfield;
+        memset(&bitfield, 0, sizeof(bitfield));
+
+        MT2EncodeFinger(finger, bytes);
+        MT2BitfieldEncodeFinger(finger, bitfield);
+        mismatches += memcmp(bytes, &bitfield, MT2_FINGER_SIZE) != 0;
+        mismatches += !sameFinger(MT2BitfieldDecodeFinger(*(const MAGIC_TRACKPAD_INPUT_REPORT_FINGER*)bytes), finger);
+    }
+    CHECK_EQ(mismatches, 0);
+}
+
+TEST(TimestampRoundTripsAndWraps) {
+    UInt8 bytes[MT2_HEADER_SIZE];
+    static const UInt32 samples[] = {0, 1, 31, 32, 8191, 8192, 123456, MT2_TIMESTAMP_MASK};
+
+    for (UInt32 ms : samples) {
+        MT2EncodeHeader(MT2Header {0x02, 0, 0x3, 0x31, ms}, bytes);
+        CHECK_EQ(MT2DecodeTimestamp(bytes + 9), ms);
+        CHECK_EQ(bytes[9] & 0x7, 0x4);
+
+        // As the simulator wrote it before the codec
+        CHECK_EQ(bytes[9], (UInt8)((ms << 0x3) | 0x4));
+        CHECK_EQ(bytes[10], (ms >> 0x5) & 0xFF);
+        CHECK_EQ(bytes[11], (ms >> 0xd) & 0xFF);
+    }
+
+    MT2EncodeTimestamp(MT2_TIMESTAMP_MASK + 1 + 77, bytes);
+    CHECK_EQ(MT2DecodeTimestamp(bytes), 77);
+}
+
+TEST(HeaderFields) {
+    UInt8 bytes[MT2_HEADER_SIZE];
+    memset(bytes, 0xAA, sizeof(bytes));
+    MT2EncodeHeader(MT2Header {0x02, 1, 0x2, 0x31, 500}, bytes);
+
+    CHECK_EQ(bytes[0], 0x02);
+    CHECK_EQ(bytes[1], 1);
+    for (int i = 2; i < 7; i++)
+        CHECK_EQ(bytes[i], 0);
+    CHECK_EQ(bytes[7], 0x2);
+    CHECK_EQ(bytes[8], 0x31);
+
+    MT2Header header = MT2DecodeHeader(bytes);
+    CHECK_EQ(header.timestamp, 500);
+    CHECK_EQ(header.touchActive, 0x2);
+}
+
+/*
+ * magicmouse_emit_touch() for the Magic Trackpad 2 in linux/drivers/hid/hid-magicmouse.c,
+ * on the 9 byte finger record.
+ */
+struct LinuxTouch {
+    int id, x, y, size, orientation, touch_major, touch_minor, pressure;
+    bool down;
+};
+
+static LinuxTouch linuxDecode(const UInt8* tdata) {
+    LinuxTouch touch;
+    touch.id = tdata[8] & 0xf;
+    touch.x = (int)((UInt32)tdata[1] << 27 | (UInt32)tdata[0] << 19) >> 19;
+    touch.y = -((int)((UInt32)tdata[3] << 30 | (UInt32)tdata[2] << 22 | (UInt32)tdata[1] << 14) >> 19);
+    touch.size = tdata[6];
+    touch.orientation = (tdata[8] >> 5) - 4;
+    touch.touch_major = tdata[4];
+    touch.touch_minor = tdata[5];
+    touch.pressure = tdata[7];
+    touch.down = (tdata[3] & 0xC0) != 0;
+    return touch;
+}
+
+TEST(DecoderAgreesWithHidMagicmouse) {
+    TestRandom random(99);
+    int mismatches = 0;
+
+    for (int i = 0; i < 100000; i++) {
+        MT2Finger finger = randomFinger(random);
+        UInt8 bytes[MT2_FINGER_SIZE];
+        MT2EncodeFinger(finger, bytes);
+
+        LinuxTouch touch = linuxDecode(bytes);
+        MT2Finger decoded = MT2DecodeFinger(bytes);
+
+        mismatches += touch.id != decoded.identifier;
+        mismatches += touch.x != decoded.x;
+        // Linux flips y, the simulator already writes it flipped
+        mismatches += touch.y != -decoded.y;
+        mismatches += touch.size != decoded.size || touch.pressure != decoded.pressure;
+        mismatches += touch.touch_major != decoded.touchMajor || touch.touch_minor != decoded.touchMinor;
+        mismatches += touch.orientation != MT2FingerOrientation(bytes);
+        mismatches += touch.down != MT2FingerIsDown(bytes);
+    }
+    CHECK_EQ(mismatches, 0);
+}
+
+TEST(StatesSeenByHidMagicmouse) {
+    MT2Finger finger {0, 0, 2, 0, 20, 20, 10, 5, 1, 4};
+    UInt8 bytes[MT2_FINGER_SIZE];
+    struct Case { UInt8 state; bool down; };
+    static const Case cases[] = {{kTouchStateInactive, false}, {kTouchStateStart, true}, {kTouchStateActive, true}, {kTouchStateStop, true}};
+
+    for (const Case& c : cases) {
+        finger.state = c.state;
+        MT2EncodeFinger(finger, bytes);
+        CHECK_EQ(MT2FingerIsDown(bytes), c.down);
+        CHECK_EQ(MT2FingerOrientation(bytes), 0);
+    }
+}
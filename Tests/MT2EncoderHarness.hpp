@@ -0,0 +1,38 @@
+//
+//  MT2EncoderHarness.hpp
+//  VoodooInput host tests
+//
+//  Copyright © 2024 Kishor Prins. All rights reserved.
+//
+
+#ifndef VOODOO_INPUT_TEST_MT2_ENCODER_HARNESS_HPP
+#define VOODOO_INPUT_TEST_MT2_ENCODER_HARNESS_HPP
+
+#include "HostShim.hpp"
+
+#include "VoodooInputSimulator/VoodooInputMT2Report.hpp"
+
+/*
+ * The encoder VoodooInputSimulatorDevice runs inside its gate, with the report buffer
+ * the device keeps in the engine arena, a disabled trace and the host clock. Settings
+ * start as the engine defaults for the given surface.
+ */
+struct MT2EncoderHarness {
+    UInt8 report[MT2_REPORT_MAX_SIZE] {};
+    VoodooInputTrace trace;
+    VoodooInputMT2Settings settings;
+    VoodooInputMT2Encoder encoder;
+
+    MT2EncoderHarness(UInt32 logical_max_x, UInt32 logical_max_y, UInt8 transform,
+                      VoodooInputTimestamp::Clock clock = HostClockNow) {
+        settings.logical_max_x = logical_max_x;
+        settings.logical_max_y = logical_max_y;
+        settings.transform = transform;
+        encoder.init(report, &trace, 1, 1, clock);
+        encoder.configure(settings);
+    }
+
+    ~MT2EncoderHarness() { encoder.release(); }
+};
+
+#endif // VOODOO_INPUT_TEST_MT2_ENCODER_HARNESS_HPP
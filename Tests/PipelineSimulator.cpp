@@ -0,0 +1,433 @@
+//
+//  PipelineSimulator.cpp
+//  VoodooInput host tests
+//
+//  Copyright © 2024 Kishor Prins. All rights reserved.
+//
+
+#include "Benchmark.hpp"
+#include "MT2EncoderHarness.hpp"
+
+#include "VoodooInputSimulator/VoodooInputGestureGenerator.hpp"
+
+#include <algorithm>
+#include <deque>
+#include <functional>
+#include <queue>
+#include <random>
+#include <string>
+#include <vector>
+
+/*
+ * Discrete-event model of the provider -> VoodooInput -> HID pipeline on a virtual
+ * clock, to compare watchdog, rate and lift-off settings before trying them on a
+ * machine. Unlike a pure model every frame goes through the real pieces: the gesture
+ * generator as provider and, inside the gate, the encoder of VoodooInputSimulatorDevice
+ * with its MT2 codec, timestamps, lift-off reports and the frame watchdog that decides
+ * about coalescing.
+ *
+ * Modelled around them:
+ * - a provider that buffers up to provider-queue samples while it waits for the gate
+ * - the simulator command gate, FIFO, shared with other clients (trackpoint, actuator)
+ *   that take it at random with a fixed hold time
+ * - handleReport, which runs inside the gate for every report the path sends
+ * - attemptAction for frames that may be coalesced while degraded, chosen by the encoder,
+ *   and the interrupt event source that takes the gate in turn for the newest of them
+ *
+ * The construct cost is the host time the encoder took, scaled by construct-scale, or a
+ * fixed construct-us for reproducible runs. The encoder reads a virtual clock that moves
+ * with that cost and hid-service-us per report sent, so the watchdog measures lateness
+ * where the device would. deadline-ms and lift-off-ms set the watchdog deadline and the
+ * spacing of the reports synthesized after a lift off.
+ *
+ * The first argument is the number of provider frames per configuration, the others
+ * are name=value, a comma separated list of values is swept:
+ *
+ *   PipelineSimulator 12500 rate=80,125 hid-service-us=50,400
+ *   PipelineSimulator 12500 contention-rate=200 contention-hold-us=2000 construct-us=60
+ *   PipelineSimulator 12500 hid-service-us=400 deadline-ms=10,20,40 lift-off-ms=5,10
+ */
+
+struct Option {
+    const char* name;
+    std::vector<double> values;
+};
+
+enum OptionIndex {
+    kRate,
+    kJitter,
+    kScenario,
+    kContacts,
+    kProviderQueue,
+    kConstructUs,
+    kConstructScale,
+    kHidServiceUs,
+    kContentionRate,
+    kContentionHoldUs,
+    kDeadlineMs,
+    kLiftOffMs,
+    kSeed,
+    kOptionCount
+};
+
+static Option options[kOptionCount] = {
+    {"rate", {125}},
+    {"jitter-us", {500}},
+    {"scenario", {kVoodooInputGestureTapStorm}},
+    {"contacts", {VOODOO_INPUT_MAX_TRANSDUCERS}},
+    {"provider-queue", {8}},
+    {"construct-us", {0}},
+    {"construct-scale", {1}},
+    {"hid-service-us", {100}},
+    {"contention-rate", {0}},
+    {"contention-hold-us", {1000}},
+    {"deadline-ms", {FRAME_WATCHDOG_DEADLINE_NS / 1e6}},
+    {"lift-off-ms", {MT2_LIFT_OFF_SPACING_MS}},
+    {"seed", {1}},
+};
+
+class Pipeline;
+
+// The time the encoder sees, there is one pipeline running at a time
+static Pipeline* running;
+static AbsoluteTime pipelineClock();
+
+struct ReportSink {
+    UInt32 reports {0};
+    UInt32 regressions {0};
+    bool has_timestamp {false};
+    UInt32 last_timestamp {0};
+
+    void sendReport(const UInt8* report, UInt32 length) {
+        reports++;
+
+        // The HID stack reads the 21 bit field, going back by more than half of it is a wrap
+        UInt32 timestamp = MT2DecodeHeader(report).timestamp;
+        if (has_timestamp && ((timestamp - last_timestamp) & MT2_TIMESTAMP_MASK) > MT2_TIMESTAMP_MASK / 2)
+            regressions++;
+        has_timestamp = true;
+        last_timestamp = timestamp;
+    }
+
+    void publishSampleProperties() {}
+    void publishWatchdogProperties() {}
+};
+
+class Pipeline {
+public:
+    Pipeline(const double* config, UInt32 frames) : config(config), frames(frames), random((UInt32)config[kSeed]) {
+        VoodooInputGestureParams params {};
+        params.scenario = (VoodooInputGestureScenario)config[kScenario];
+        params.seed = (UInt32)config[kSeed];
+        params.sample_rate = (UInt32)config[kRate];
+        params.jitter_us = (UInt32)config[kJitter];
+        params.logical_max_x = 3000;
+        params.logical_max_y = 2000;
+        params.contacts = (UInt8)config[kContacts];
+        generator.init(params, 0);
+
+        harness.settings.lift_off_spacing_ms = (UInt32)config[kLiftOffMs];
+        harness.encoder.configure(harness.settings);
+        harness.encoder.getWatchdog().setDeadline((UInt64)(config[kDeadlineMs] * 1e6));
+    }
+
+    // Start of the frame in the gate, plus what it has cost so far
+    AbsoluteTime now() const {
+        UInt64 cost = config[kConstructUs] > 0 ? (UInt64)(config[kConstructUs] * 1000) : (UInt64)((HostMonotonicNs() - host_start) * config[kConstructScale]);
+        return frame_start + cost + (UInt64)((sink.reports - frame_reports) * config[kHidServiceUs] * 1000);
+    }
+
+    void run() {
+        scheduleSample();
+        if (config[kContentionRate] > 0)
+            schedule(nextContention(0), [this](UInt64 now) { contend(now); });
+
+        while (!events.empty()) {
+            Event event = events.top();
+            events.pop();
+            event.action(event.time);
+        }
+    }
+
+    void print(int varied, const int* columns) const {
+        std::vector<UInt64> sorted = latencies;
+        std::sort(sorted.begin(), sorted.end());
+
+        for (int i = 0; i < varied; i++)
+            printf("%18g", config[columns[i]]);
+        printf("  %8.3f  %8.3f  %8.3f  %8.3f  %6.2f / %-4u %9u %9u %9u %9u %9u %9u\n",
+               percentile(sorted, 0.5) / 1e6, percentile(sorted, 0.9) / 1e6, percentile(sorted, 0.99) / 1e6,
+               sorted.empty() ? 0 : sorted.back() / 1e6, depth_samples ? (double)depth_total / depth_samples : 0, max_depth,
+               coalesced, pending, overflowed, harness.encoder.getWatchdog().getModeSwitches(), sink.reports, sink.regressions);
+    }
+
+private:
+    friend class VoodooInputMT2Encoder;
+
+    struct Event {
+        UInt64 time;
+        UInt64 sequence;
+        std::function<void(UInt64)> action;
+
+        bool operator<(const Event& other) const {
+            return time != other.time ? time > other.time : sequence > other.sequence;
+        }
+    };
+
+    const double* config;
+    UInt32 frames;
+    UInt32 sampled {0};
+    UInt64 last_sample {0};
+
+    VoodooInputGestureGenerator generator;
+    MT2EncoderHarness harness {3000, 2000, 0, pipelineClock};
+    ReportSink sink;
+    std::mt19937 random;
+
+    std::priority_queue<Event> events;
+    UInt64 sequence {0};
+
+    bool gate_busy {false};
+    std::deque<std::function<void(UInt64)>> gate_waiters;
+    bool provider_busy {false};
+    std::deque<VoodooInputEvent> provider_queue;
+
+    // Frame handed to the encoder, and whether it got into the gate
+    UInt64 submit_time {0};
+    bool entered {false};
+
+    // Frame in the gate
+    UInt64 frame_start {0};
+    UInt64 host_start {0};
+    UInt32 frame_reports {0};
+
+    std::vector<UInt64> latencies;
+    UInt32 max_depth {0};
+    UInt64 depth_total {0};
+    UInt64 depth_samples {0};
+    UInt32 coalesced {0};
+    // Coalesced frames sent from the mailbox after all
+    UInt32 pending {0};
+    UInt32 overflowed {0};
+
+    static double percentile(const std::vector<UInt64>& sorted, double fraction) {
+        if (sorted.empty())
+            return 0;
+        return (double)sorted[std::min(sorted.size() - 1, (size_t)(fraction * sorted.size()))];
+    }
+
+    void schedule(UInt64 time, std::function<void(UInt64)> action) {
+        events.push({time, sequence++, std::move(action)});
+    }
+
+    // Gate, FIFO like a work loop gate with waiters
+
+    void acquire(UInt64 now, std::function<void(UInt64)> holder) {
+        if (gate_busy) {
+            gate_waiters.push_back(std::move(holder));
+            return;
+        }
+        gate_busy = true;
+        holder(now);
+    }
+
+    void release(UInt64 now) {
+        if (gate_waiters.empty()) {
+            gate_busy = false;
+            return;
+        }
+        std::function<void(UInt64)> next = std::move(gate_waiters.front());
+        gate_waiters.pop_front();
+        next(now);
+    }
+
+    // Provider
+
+    void scheduleSample() {
+        if (sampled == frames)
+            return;
+
+        VoodooInputEvent event;
+        memset(&event, 0, sizeof(event));
+        last_sample = generator.next(event);
+        sampled++;
+        schedule(last_sample, [this, event](UInt64 now) { sample(now, event); });
+    }
+
+    void sample(UInt64 now, const VoodooInputEvent& event) {
+        if (provider_queue.size() >= (size_t)config[kProviderQueue])
+            overflowed++;
+        else
+            provider_queue.push_back(event);
+
+        UInt32 depth = (UInt32)provider_queue.size() + (provider_busy ? 1 : 0);
+        max_depth = std::max(max_depth, depth);
+        depth_total += depth;
+        depth_samples++;
+
+        if (!provider_busy)
+            submit(now);
+        scheduleSample();
+    }
+
+    void submit(UInt64 now) {
+        while (!provider_queue.empty()) {
+            VoodooInputEvent event = provider_queue.front();
+            provider_queue.pop_front();
+            provider_busy = true;
+
+            // The encoder picks runAction or attemptAction like in the device
+            submit_time = now;
+            entered = true;
+            harness.encoder.submit(event, *this);
+            if (entered)
+                return;
+            coalesced++;
+        }
+
+        provider_busy = false;
+    }
+
+    void runGated(const VoodooInputEvent& event) {
+        acquire(submit_time, [this, event](UInt64 time) { construct(time, event, true); });
+    }
+
+    // attemptAction gives way to a busy gate
+    bool attemptGated(const VoodooInputEvent& event) {
+        if (gate_busy) {
+            entered = false;
+            return false;
+        }
+        gate_busy = true;
+        construct(submit_time, event, true);
+        return true;
+    }
+
+    // The device's interrupt event source, queued for the gate behind whoever holds it
+    void schedulePending() {
+        acquire(submit_time, [this](UInt64 time) {
+            VoodooInputEvent event;
+            if (!harness.encoder.takePending(event)) {
+                release(time);
+                return;
+            }
+            pending++;
+            construct(time, event, false);
+        });
+    }
+
+    void construct(UInt64 now, const VoodooInputEvent& event, bool provider) {
+        frame_start = now;
+        frame_reports = sink.reports;
+        host_start = HostMonotonicNs();
+        harness.encoder.constructReport(event, sink);
+
+        AbsoluteTime end = this->now();
+        schedule(end, [this, event, provider](UInt64 time) { constructed(time, event, provider); });
+    }
+
+    void constructed(UInt64 now, const VoodooInputEvent& event, bool provider) {
+        latencies.push_back(now > event.timestamp ? now - event.timestamp : 0);
+
+        release(now);
+        if (provider)
+            submit(now);
+    }
+
+    // Other gate clients, until the provider stops
+
+    UInt64 nextContention(UInt64 now) {
+        std::exponential_distribution<double> interval(config[kContentionRate]);
+        return now + (UInt64)(interval(random) * 1e9);
+    }
+
+    void contend(UInt64 now) {
+        UInt64 hold = (UInt64)(config[kContentionHoldUs] * 1000);
+        acquire(now, [this, hold](UInt64 time) {
+            schedule(time + hold, [this](UInt64 end) { release(end); });
+        });
+
+        UInt64 next = nextContention(now);
+        if (sampled < frames || next <= last_sample)
+            schedule(next, [this](UInt64 time) { contend(time); });
+    }
+};
+
+static AbsoluteTime pipelineClock() {
+    // The timestamp epoch is taken while the pipeline is constructed, at time 0
+    return running ? running->now() : 0;
+}
+
+static bool parseOption(const char* argument) {
+    std::string text(argument);
+    size_t equals = text.find('=');
+    if (equals == std::string::npos)
+        return false;
+
+    for (Option& option : options) {
+        if (text.compare(0, equals, option.name) != 0 || strlen(option.name) != equals)
+            continue;
+
+        option.values.clear();
+        size_t start = equals + 1;
+        while (start <= text.size()) {
+            size_t comma = text.find(',', start);
+            std::string value = text.substr(start, comma == std::string::npos ? std::string::npos : comma - start);
+            char* end = nullptr;
+            option.values.push_back(strtod(value.c_str(), &end));
+            if (value.empty() || *end)
+                return false;
+            if (comma == std::string::npos)
+                break;
+            start = comma + 1;
+        }
+        return true;
+    }
+    return false;
+}
+
+int main(int argc, char** argv) {
+    UInt32 frames = BenchmarkIterations(argc, argv, 12500);
+
+    for (int i = 2; i < argc; i++) {
+        if (!parseOption(argv[i])) {
+            fprintf(stderr, "unknown or malformed option %s\n", argv[i]);
+            return 1;
+        }
+    }
+
+    int columns[kOptionCount];
+    int varied = 0;
+    for (int i = 0; i < kOptionCount; i++) {
+        if (options[i].values.size() > 1)
+            columns[varied++] = i;
+    }
+    if (!varied)
+        columns[varied++] = kRate;
+
+    for (int i = 0; i < varied; i++)
+        printf("%18s", options[columns[i]].name);
+    printf("    p50 ms    p90 ms    p99 ms    max ms  depth avg/max coalesced   mailbox  overflow  switches   reports  ts back\n");
+
+    // Every combination of the swept values, the first option varies slowest
+    size_t indices[kOptionCount] {};
+    while (true) {
+        double config[kOptionCount];
+        for (int i = 0; i < kOptionCount; i++)
+            config[i] = options[i].values[indices[i]];
+
+        Pipeline pipeline(config, frames);
+        running = &pipeline;
+        pipeline.run();
+        running = nullptr;
+        pipeline.print(varied, columns);
+
+        int i = kOptionCount - 1;
+        while (i >= 0 && ++indices[i] == options[i].values.size())
+            indices[i--] = 0;
+        if (i < 0)
+            break;
+    }
+
+    return 0;
+}
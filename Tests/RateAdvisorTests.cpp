@@ -0,0 +1,177 @@
+//
+//  RateAdvisorTests.cpp
+//  VoodooInput host tests
+//
+//  Copyright © 2024 Kishor Prins. All rights reserved.
+//
+
+#include "Test.hpp"
+
+#include "VoodooInputRateAdvisor.hpp"
+
+#define MS 1000000ULL
+// 125 Hz provider
+#define PERIOD (8 * MS)
+
+// Feeds frames every PERIOD from now, returns how many changed the hint
+static int feed(VoodooInputRateAdvisor& advisor, UInt64& now, int frames, UInt8 contacts, UInt64 delivery, UInt64 period = PERIOD) {
+    int changes = 0;
+    for (int i = 0; i < frames; i++) {
+        now += period;
+        changes += advisor.update(now, contacts, delivery);
+    }
+    return changes;
+}
+
+static void checkHint(const VoodooInputRateAdvisor& advisor, UInt32 rate, UInt32 reason) {
+    CHECK_EQ(advisor.getHint().sample_rate, rate);
+    CHECK_EQ(advisor.getHint().reason, reason);
+}
+
+TEST(StaysAtNativeRateWhileTouching) {
+    VoodooInputRateAdvisor advisor;
+    advisor.reset();
+    UInt64 now = 1000 * MS;
+
+    CHECK_EQ(feed(advisor, now, 1000, 2, 100000), 0);
+    checkHint(advisor, 0, kVoodooInputRateHintFull);
+}
+
+TEST(IdleAfterTimeoutWithoutContacts) {
+    VoodooInputRateAdvisor advisor;
+    advisor.reset();
+    UInt64 now = 1000 * MS;
+
+    feed(advisor, now, 10, 1, 100000);
+    UInt64 lifted = now;
+
+    // Frames without contacts keep coming, the hint only changes once the timeout passed
+    int changes = 0;
+    while (now + PERIOD - lifted < RATE_ADVISOR_IDLE_TIMEOUT_NS) {
+        now += PERIOD;
+        changes += advisor.update(now, 0, 100000);
+    }
+    CHECK_EQ(changes, 0);
+    checkHint(advisor, 0, kVoodooInputRateHintFull);
+
+    now += PERIOD;
+    CHECK(advisor.update(now, 0, 100000));
+    checkHint(advisor, RATE_ADVISOR_DEFAULT_IDLE_RATE, kVoodooInputRateHintIdle);
+
+    // Reported once, not on every idle frame
+    CHECK_EQ(feed(advisor, now, 20, 0, 100000, 50 * MS), 0);
+}
+
+TEST(FirstContactRestoresNativeRate) {
+    VoodooInputRateAdvisor advisor;
+    advisor.reset();
+    UInt64 now = 1000 * MS;
+
+    feed(advisor, now, 10, 1, 100000);
+    feed(advisor, now, 300, 0, 100000);
+    checkHint(advisor, RATE_ADVISOR_DEFAULT_IDLE_RATE, kVoodooInputRateHintIdle);
+
+    now += 50 * MS;
+    CHECK(advisor.update(now, 1, 100000));
+    checkHint(advisor, 0, kVoodooInputRateHintFull);
+}
+
+TEST(IdleRateZeroNeverIdles) {
+    VoodooInputRateAdvisor advisor;
+    advisor.reset();
+    advisor.setIdleRate(0);
+    UInt64 now = 1000 * MS;
+
+    feed(advisor, now, 10, 1, 100000);
+    CHECK_EQ(feed(advisor, now, 1000, 0, 100000), 0);
+    checkHint(advisor, 0, kVoodooInputRateHintFull);
+}
+
+TEST(ThrottlesToHalfRateWhenDeliveryBacksUp) {
+    VoodooInputRateAdvisor advisor;
+    advisor.reset();
+    UInt64 now = 1000 * MS;
+
+    feed(advisor, now, 50, 1, 100000);
+    checkHint(advisor, 0, kVoodooInputRateHintFull);
+
+    // 7 ms per frame is above 3/4 of 8 ms once the average catches up
+    CHECK_EQ(feed(advisor, now, 50, 1, 7 * MS), 1);
+    checkHint(advisor, 62, kVoodooInputRateHintThrottle);
+}
+
+TEST(ThrottleHasHysteresis) {
+    VoodooInputRateAdvisor advisor;
+    advisor.reset();
+    UInt64 now = 1000 * MS;
+
+    feed(advisor, now, 50, 1, 100000);
+    feed(advisor, now, 50, 1, 7 * MS);
+    checkHint(advisor, 62, kVoodooInputRateHintThrottle);
+
+    // Between 1/2 and 3/4 of the period keeps the throttle, the provider is still at half rate
+    CHECK_EQ(feed(advisor, now, 100, 1, 5 * MS, 2 * PERIOD), 0);
+    checkHint(advisor, 62, kVoodooInputRateHintThrottle);
+
+    // Under half a period lets it go
+    CHECK_EQ(feed(advisor, now, 100, 1, 2 * MS, 2 * PERIOD), 1);
+    checkHint(advisor, 0, kVoodooInputRateHintFull);
+}
+
+TEST(ThrottledRateDoesNotTeachThePeriod) {
+    VoodooInputRateAdvisor advisor;
+    advisor.reset();
+    UInt64 now = 1000 * MS;
+
+    feed(advisor, now, 50, 1, 100000);
+    feed(advisor, now, 50, 1, 7 * MS);
+    checkHint(advisor, 62, kVoodooInputRateHintThrottle);
+
+    // The provider followed the hint, a learnt 16 ms period would suggest 31 Hz next
+    feed(advisor, now, 200, 1, 7 * MS, 2 * PERIOD);
+    checkHint(advisor, 62, kVoodooInputRateHintThrottle);
+}
+
+TEST(LiftOffReleasesThrottle) {
+    VoodooInputRateAdvisor advisor;
+    advisor.reset();
+    UInt64 now = 1000 * MS;
+
+    feed(advisor, now, 50, 1, 100000);
+    feed(advisor, now, 50, 1, 7 * MS);
+    checkHint(advisor, 62, kVoodooInputRateHintThrottle);
+
+    now += PERIOD;
+    CHECK(advisor.update(now, 0, 7 * MS));
+    checkHint(advisor, 0, kVoodooInputRateHintFull);
+}
+
+TEST(PausesAreNotAPeriod) {
+    VoodooInputRateAdvisor advisor;
+    advisor.reset();
+    UInt64 now = 1000 * MS;
+
+    feed(advisor, now, 50, 1, 100000);
+    // Touches separated by pauses, each longer than a sample period could ever be
+    for (int i = 0; i < 20; i++)
+        feed(advisor, now, 1, 1, 100000, 500 * MS);
+
+    feed(advisor, now, 50, 1, 7 * MS);
+    checkHint(advisor, 62, kVoodooInputRateHintThrottle);
+}
+
+TEST(ResetForgetsEverything) {
+    VoodooInputRateAdvisor advisor;
+    advisor.reset();
+    UInt64 now = 1000 * MS;
+
+    feed(advisor, now, 50, 1, 100000);
+    feed(advisor, now, 50, 1, 7 * MS);
+    advisor.reset();
+    checkHint(advisor, 0, kVoodooInputRateHintFull);
+
+    // Without a period nothing can be throttled yet
+    now += PERIOD;
+    CHECK(!advisor.update(now, 1, 7 * MS));
+    checkHint(advisor, 0, kVoodooInputRateHintFull);
+}
@@ -0,0 +1,104 @@
+//
+//  ReportBufferBenchmark.cpp
+//  VoodooInput host tests
+//
+//  Copyright © 2024 Kishor Prins. All rights reserved.
+//
+
+#include "Benchmark.hpp"
+#include "Jitter.hpp"
+
+#include "VoodooInputSimulator/VoodooInputMT2Codec.hpp"
+
+#define CONTACTS 10
+#define REPORT_SIZE (MT2_HEADER_SIZE + CONTACTS * MT2_FINGER_SIZE)
+
+/*
+ * handleReport copies the report into the HID event queue before it returns, so the
+ * simulator can only ever have one report in flight. This compares clearing the
+ * buffer before every frame, encoding over the previous frame and rotating through
+ * two buffers, each handed to a sink that copies it and then takes a while.
+ */
+
+struct SlowSink {
+    UInt8 queue[REPORT_SIZE];
+    UInt32 spin;
+    UInt64 sum {0};
+
+    void handleReport(const UInt8* report, UInt32 length) {
+        memcpy(queue, report, length);
+        for (UInt32 i = 0; i < spin; i++)
+            sum += queue[i % length];
+        BenchmarkKeep(sum);
+    }
+};
+
+static void encode(UInt8* report, const MT2Finger* fingers, UInt32 frame) {
+    MT2Header header {0x31, 0, 1, 0x02, frame * 8};
+    MT2EncodeHeader(header, report);
+    for (int i = 0; i < CONTACTS; i++)
+        MT2EncodeFinger(fingers[i], report + MT2_HEADER_SIZE + i * MT2_FINGER_SIZE);
+}
+
+static void moveFingers(MT2Finger* fingers, TestRandom& random) {
+    for (int i = 0; i < CONTACTS; i++) {
+        fingers[i].x += (SInt16)random.jitter(8);
+        fingers[i].y += (SInt16)random.jitter(8);
+        fingers[i].pressure = (UInt8)(random.next() & 0xFF);
+    }
+}
+
+template <typename Frame>
+static void measure(const char* name, UInt32 spin, UInt32 count, Frame frame) {
+    UInt64 elapsed = BenchmarkBest([&] {
+        static UInt8 buffers[2][REPORT_SIZE];
+        MT2Finger fingers[CONTACTS];
+        for (int i = 0; i < CONTACTS; i++)
+            fingers[i] = {(SInt16)(i * 300 - 1500), (SInt16)(i * 100), (UInt8)(i % 5 + 1), MT2_TOUCH_STATE_BIT_CONTACT, 200, 180, 40, 0, (UInt8)i, 4};
+        TestRandom random(7);
+        SlowSink sink;
+        sink.spin = spin;
+
+        UInt64 start = HostMonotonicNs();
+        for (UInt32 i = 0; i < count; i++) {
+            moveFingers(fingers, random);
+            frame(buffers, fingers, i, sink);
+        }
+        UInt64 end = HostMonotonicNs();
+        BenchmarkKeep(sink.sum);
+        return end - start;
+    });
+    BenchmarkRow(name, elapsed, count);
+}
+
+static void clearOne(UInt8 (*buffers)[REPORT_SIZE], const MT2Finger* fingers, UInt32 frame, SlowSink& sink) {
+    memset(buffers[0], 0, REPORT_SIZE);
+    encode(buffers[0], fingers, frame);
+    sink.handleReport(buffers[0], REPORT_SIZE);
+}
+
+static void reuseOne(UInt8 (*buffers)[REPORT_SIZE], const MT2Finger* fingers, UInt32 frame, SlowSink& sink) {
+    encode(buffers[0], fingers, frame);
+    sink.handleReport(buffers[0], REPORT_SIZE);
+}
+
+static void rotateTwo(UInt8 (*buffers)[REPORT_SIZE], const MT2Finger* fingers, UInt32 frame, SlowSink& sink) {
+    UInt8* report = buffers[frame & 1];
+    encode(report, fingers, frame);
+    sink.handleReport(report, REPORT_SIZE);
+}
+
+int main(int argc, char** argv) {
+    UInt32 count = BenchmarkIterations(argc, argv, 1000000);
+
+    static const UInt32 spins[] = {0, 2000};
+    for (UInt32 spin : spins) {
+        char title[64];
+        snprintf(title, sizeof(title), "%d contacts, sink spin %u", CONTACTS, spin);
+        BenchmarkHeader(title);
+        measure("clear + encode, 1 buffer", spin, count, clearOne);
+        measure("encode in place, 1 buffer", spin, count, reuseOne);
+        measure("encode in place, 2 buffers", spin, count, rotateTwo);
+    }
+    return 0;
+}
@@ -0,0 +1,143 @@
+//
+//  SampleEstimatorTests.cpp
+//  VoodooInput host tests
+//
+//  Copyright © 2024 Kishor Prins. All rights reserved.
+//
+
+#include "Test.hpp"
+#include "Jitter.hpp"
+
+#include "VoodooInputSimulator/VoodooInputSampleEstimator.hpp"
+
+#include <kern/clock.h>
+
+#define PERIOD_NS (NSEC_PER_SEC / 125)
+
+struct TimelineStats {
+    UInt64 raw_error;
+    UInt64 smoothed_error;
+    bool monotonic;
+};
+
+// Mean absolute distance of successive intervals from the nominal period, raw and smoothed
+static TimelineStats run(VoodooInputSampleEstimator& estimator, UInt64 start, UInt32 frames, SInt64 jitter_ns, UInt32 seed) {
+    TestRandom random(seed);
+    TimelineStats stats {0, 0, true};
+    UInt64 previous_raw = 0, previous_smoothed = 0;
+    UInt32 measured = 0;
+
+    for (UInt32 i = 0; i < frames; i++) {
+        UInt64 raw = start + i * PERIOD_NS + random.jitter(jitter_ns);
+        UInt64 smoothed = estimator.update(raw);
+
+        // The loop needs a few dozen samples to settle
+        if (i > 64) {
+            SInt64 raw_interval = raw - previous_raw - PERIOD_NS;
+            SInt64 smoothed_interval = smoothed - previous_smoothed - PERIOD_NS;
+            stats.raw_error += raw_interval < 0 ? -raw_interval : raw_interval;
+            stats.smoothed_error += smoothed_interval < 0 ? -smoothed_interval : smoothed_interval;
+            measured++;
+        }
+        if (i > 0 && smoothed <= previous_smoothed)
+            stats.monotonic = false;
+
+        previous_raw = raw;
+        previous_smoothed = smoothed;
+    }
+
+    stats.raw_error /= measured;
+    stats.smoothed_error /= measured;
+    return stats;
+}
+
+TEST(LocksOntoCleanRate) {
+    VoodooInputSampleEstimator estimator;
+    estimator.init();
+    TimelineStats stats = run(estimator, NSEC_PER_SEC, 500, 0, 1);
+
+    CHECK_EQ(estimator.getRate(), 125);
+    CHECK_EQ(estimator.getJitter(), 0);
+    CHECK_EQ(stats.smoothed_error, 0);
+    CHECK(stats.monotonic);
+}
+
+TEST(JitteredTraceConvergesAndSmooths) {
+    static const SInt64 jitters[] = {250000, 1000000, 2000000};
+
+    for (SInt64 jitter : jitters) {
+        VoodooInputSampleEstimator estimator;
+        estimator.init();
+        TimelineStats stats = run(estimator, NSEC_PER_SEC, 2000, jitter, 7);
+
+        CHECK_NEAR(estimator.getRate(), 125, 1);
+        // Uniform jitter of +-j has a mean absolute deviation of j/2, the estimate follows it loosely
+        CHECK(estimator.getJitter() > jitter / 1000 / 4);
+        CHECK(estimator.getJitter() < jitter / 1000 * 2);
+        // The smoothed timeline takes at least half of the interval noise out
+        CHECK(stats.smoothed_error * 2 < stats.raw_error);
+        CHECK(stats.monotonic);
+    }
+}
+
+TEST(TracksRateChange) {
+    VoodooInputSampleEstimator estimator;
+    estimator.init();
+    run(estimator, NSEC_PER_SEC, 300, 500000, 3);
+    CHECK_NEAR(estimator.getRate(), 125, 1);
+
+    // Same session, provider drops to 80Hz
+    UInt64 start = NSEC_PER_SEC + 300 * PERIOD_NS;
+    for (UInt32 i = 0; i < 200; i++)
+        estimator.update(start + i * (NSEC_PER_SEC / 80));
+    CHECK_NEAR(estimator.getRate(), 80, 1);
+}
+
+TEST(GapResynchronisesAndKeepsPeriod) {
+    VoodooInputSampleEstimator estimator;
+    estimator.init();
+    run(estimator, NSEC_PER_SEC, 300, 500000, 5);
+    UInt32 samples = estimator.getSampleCount();
+    CHECK(samples == 300);
+
+    // Next touch session, far off the old phase
+    UInt64 resumed = 10 * NSEC_PER_SEC + 1234567;
+    CHECK_EQ(estimator.update(resumed), resumed);
+    CHECK_EQ(estimator.getSampleCount(), 1);
+    CHECK_NEAR(estimator.getRate(), 125, 1);
+
+    // Timestamps that go backwards resynchronise too
+    CHECK_EQ(estimator.update(resumed - 1000), resumed - 1000);
+    CHECK_EQ(estimator.getSampleCount(), 1);
+}
+
+TEST(SkippedSamplesSnapInsteadOfDragging) {
+    VoodooInputSampleEstimator estimator;
+    estimator.init();
+    run(estimator, NSEC_PER_SEC, 300, 0, 9);
+
+    // Six periods missing is within the session gap but far outside the lock range
+    UInt64 late = NSEC_PER_SEC + 305 * PERIOD_NS;
+    UInt32 jitter = estimator.getJitter();
+    CHECK_EQ(estimator.update(late), late);
+    CHECK_EQ(estimator.getJitter(), jitter);
+
+    // The period still learns from it, that is what lets it follow a provider that really slowed down
+    UInt64 next = late + PERIOD_NS;
+    CHECK_NEAR(estimator.update(next), next, 2 * NSEC_PER_MSEC);
+    for (UInt32 i = 2; i < 100; i++)
+        estimator.update(late + i * PERIOD_NS);
+    CHECK_EQ(estimator.getRate(), 125);
+}
+
+TEST(FollowsDropToIdleRate) {
+    VoodooInputSampleEstimator estimator;
+    estimator.init();
+    run(estimator, NSEC_PER_SEC, 300, 0, 11);
+
+    // Every sample is out of lock at first, 20Hz is what the rate advisor suggests when idle
+    UInt64 start = NSEC_PER_SEC + 300 * PERIOD_NS;
+    for (UInt32 i = 0; i < 100; i++)
+        estimator.update(start + i * (NSEC_PER_SEC / 20));
+    CHECK_EQ(estimator.getRate(), 20);
+}
@@ -0,0 +1,199 @@
+//
+//  HostShim.cpp
+//  VoodooInput host tests
+//
+//  Copyright © 2024 Kishor Prins. All rights reserved.
+//
+
+#include "HostShim.hpp"
+#include "VoodooInputKdebug.hpp"
+
+#include <IOKit/IOLocks.h>
+#include <libkern/version.h>
+
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+int version_major = 21;
+
+static volatile UInt64 host_clock_ns = 0;
+static volatile UInt64 allocations = 0;
+
+void HostClockSet(UInt64 now_ns) {
+    host_clock_ns = now_ns;
+}
+
+void HostClockAdvance(UInt64 delta_ns) {
+    host_clock_ns += delta_ns;
+}
+
+UInt64 HostClockNow() {
+    return host_clock_ns;
+}
+
+UInt64 HostMonotonicNs() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (UInt64)now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+
+UInt64 HostAllocationCount() {
+    return allocations;
+}
+
+// A fixed buffer, recording must not show up in HostAllocationCount
+static HostKdebugEvent kdebug_events[HOST_KDEBUG_CAPACITY];
+static size_t kdebug_count = 0;
+static size_t kdebug_lost = 0;
+
+volatile bool VoodooInputKdebugEnabled = false;
+
+void VoodooInputKdebugEmit(UInt32 debugid, uintptr_t arg1, uintptr_t arg2, uintptr_t arg3, uintptr_t arg4) {
+    if (kdebug_count == HOST_KDEBUG_CAPACITY) {
+        kdebug_lost++;
+        return;
+    }
+    kdebug_events[kdebug_count++] = {debugid, {arg1, arg2, arg3, arg4}};
+}
+
+void HostKdebugClear() {
+    kdebug_count = 0;
+    kdebug_lost = 0;
+}
+
+size_t HostKdebugCount() {
+    return kdebug_count;
+}
+
+const HostKdebugEvent& HostKdebugAt(size_t index) {
+    return kdebug_events[index];
+}
+
+size_t HostKdebugLost() {
+    return kdebug_lost;
+}
+
+extern "C" {
+
+void IOLog(const char* format, ...) {
+    va_list arguments;
+    va_start(arguments, format);
+    vfprintf(stderr, format, arguments);
+    va_end(arguments);
+}
+
+void* IOMalloc(size_t size) {
+    __sync_fetch_and_add(&allocations, 1);
+    return malloc(size);
+}
+
+void IOFree(void* address, size_t size) {
+    free(address);
+}
+
+void IODelay(unsigned microseconds) {
+    usleep(microseconds);
+}
+
+void clock_get_uptime(UInt64* result) {
+    *result = host_clock_ns;
+}
+
+void absolutetime_to_nanoseconds(UInt64 abstime, UInt64* result) {
+    *result = abstime;
+}
+
+void nanoseconds_to_absolutetime(UInt64 nanoseconds, UInt64* result) {
+    *result = nanoseconds;
+}
+
+struct IOSimpleLock {
+    pthread_mutex_t mutex;
+};
+
+IOSimpleLock* IOSimpleLockAlloc() {
+    IOSimpleLock* lock = new IOSimpleLock;
+    pthread_mutex_init(&lock->mutex, nullptr);
+    return lock;
+}
+
+void IOSimpleLockFree(IOSimpleLock* lock) {
+    pthread_mutex_destroy(&lock->mutex);
+    delete lock;
+}
+
+void IOSimpleLockLock(IOSimpleLock* lock) {
+    pthread_mutex_lock(&lock->mutex);
+}
+
+void IOSimpleLockUnlock(IOSimpleLock* lock) {
+    pthread_mutex_unlock(&lock->mutex);
+}
+
+// One condition for every event, sleepers recheck what they wait for
+struct IOLock {
+    pthread_mutex_t mutex;
+    pthread_cond_t wakeup;
+};
+
+IOLock* IOLockAlloc() {
+    IOLock* lock = new IOLock;
+    pthread_mutex_init(&lock->mutex, nullptr);
+    pthread_cond_init(&lock->wakeup, nullptr);
+    return lock;
+}
+
+void IOLockFree(IOLock* lock) {
+    pthread_cond_destroy(&lock->wakeup);
+    pthread_mutex_destroy(&lock->mutex);
+    delete lock;
+}
+
+void IOLockLock(IOLock* lock) {
+    pthread_mutex_lock(&lock->mutex);
+}
+
+void IOLockUnlock(IOLock* lock) {
+    pthread_mutex_unlock(&lock->mutex);
+}
+
+int IOLockSleep(IOLock* lock, void* event, UInt32 interruptible) {
+    pthread_cond_wait(&lock->wakeup, &lock->mutex);
+    return 0;
+}
+
+void IOLockWakeup(IOLock* lock, void* event, bool oneThread) {
+    pthread_cond_broadcast(&lock->wakeup);
+}
+
+}
+
+OSData* OSData::withCapacity(unsigned capacity) {
+    OSData* data = new OSData;
+    data->bytes = (UInt8*)malloc(capacity ? capacity : 1);
+    data->capacity = capacity;
+    return data;
+}
+
+bool OSData::appendBytes(const void* newBytes, unsigned newLength) {
+    if (length + newLength > capacity) {
+        unsigned grown = (length + newLength) * 2;
+        UInt8* resized = (UInt8*)realloc(bytes, grown);
+        if (!resized)
+            return false;
+        bytes = resized;
+        capacity = grown;
+    }
+
+    memcpy(bytes + length, newBytes, newLength);
+    length += newLength;
+    return true;
+}
+
+OSData::~OSData() {
+    free(bytes);
+}
@@ -0,0 +1,39 @@
+//
+//  HostShim.hpp
+//  VoodooInput host tests
+//
+//  Copyright © 2024 Kishor Prins. All rights reserved.
+//
+
+#ifndef VOODOO_INPUT_HOST_SHIM_HPP
+#define VOODOO_INPUT_HOST_SHIM_HPP
+
+#include <IOKit/IOService.h>
+
+// The uptime clock, in ns, it starts at 0 and never moves by itself
+void HostClockSet(UInt64 now_ns);
+void HostClockAdvance(UInt64 delta_ns);
+UInt64 HostClockNow();
+
+// Wall clock for benchmarks
+UInt64 HostMonotonicNs();
+
+// IOMalloc calls since the process started
+UInt64 HostAllocationCount();
+
+// VoodooInputKdebugEmit records here instead of calling kernel_debug, nothing is
+// recorded until VoodooInputKdebugEnabled is set
+struct HostKdebugEvent {
+    UInt32 debugid;
+    uintptr_t args[4];
+};
+
+#define HOST_KDEBUG_CAPACITY 4096
+
+void HostKdebugClear();
+size_t HostKdebugCount();
+const HostKdebugEvent& HostKdebugAt(size_t index);
+// Events past HOST_KDEBUG_CAPACITY
+size_t HostKdebugLost();
+
+#endif // VOODOO_INPUT_HOST_SHIM_HPP
@@ -0,0 +1,13 @@
+//
+//  IOLib.h
+//  VoodooInput host tests
+//
+//  Copyright © 2024 Kishor Prins. All rights reserved.
+//
+
+#ifndef VOODOO_INPUT_HOST_IOKIT_IOLIB_H
+#define VOODOO_INPUT_HOST_IOKIT_IOLIB_H
+
+#include <IOKit/IOService.h>
+
+#endif // VOODOO_INPUT_HOST_IOKIT_IOLIB_H
@@ -0,0 +1,26 @@
+//
+//  IOLocks.h
+//  VoodooInput host tests
+//
+//  Copyright © 2024 Kishor Prins. All rights reserved.
+//
+
+#ifndef VOODOO_INPUT_HOST_IOKIT_IOLOCKS_H
+#define VOODOO_INPUT_HOST_IOKIT_IOLOCKS_H
+
+#include <IOKit/IOService.h>
+
+#define THREAD_UNINT 0
+
+// Sleeping on an event waits for a wakeup on the same address, spurious wakeups included
+extern "C" {
+struct IOLock;
+IOLock* IOLockAlloc();
+void IOLockFree(IOLock* lock);
+void IOLockLock(IOLock* lock);
+void IOLockUnlock(IOLock* lock);
+int IOLockSleep(IOLock* lock, void* event, UInt32 interruptible);
+void IOLockWakeup(IOLock* lock, void* event, bool oneThread);
+}
+
+#endif // VOODOO_INPUT_HOST_IOKIT_IOLOCKS_H
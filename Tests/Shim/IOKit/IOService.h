@@ -0,0 +1,98 @@
+//
+//  IOService.h
+//  VoodooInput host tests
+//
+//  Copyright © 2024 Kishor Prins. All rights reserved.
+//
+
+/*
+ * Just enough of the kernel headers to build the parts of VoodooInput that do not
+ * talk to IOKit on the host. Absolute time is in ns and only moves when a test
+ * moves it, see HostShim.hpp.
+ */
+
+#ifndef VOODOO_INPUT_HOST_IOSERVICE_H
+#define VOODOO_INPUT_HOST_IOSERVICE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+typedef uint8_t UInt8;
+typedef int8_t SInt8;
+typedef uint16_t UInt16;
+typedef int16_t SInt16;
+typedef uint32_t UInt32;
+typedef int32_t SInt32;
+typedef uint64_t UInt64;
+typedef int64_t SInt64;
+typedef UInt64 AbsoluteTime;
+typedef int IOReturn;
+typedef UInt32 IOOptionBits;
+typedef UInt64 IOByteCount;
+typedef SInt32 IOFixed;
+
+// For MultitouchHelpers.h
+#define kIOPMPowerOn 0x00000002
+struct IOPMPowerState {
+    unsigned long version, capabilityFlags, outputPowerCharacter, inputPowerRequirement;
+    unsigned long staticPower, unbudgetedPower, powerToAttain, timeToAttain;
+    unsigned long settleUpTime, timeToLower, settleDownTime, powerDomainBudget;
+};
+
+#define kIOReturnSuccess 0
+#define kIOReturnError 0xe00002bc
+#define kIOReturnNoMemory 0xe00002bd
+#define kIOReturnNoResources 0xe00002be
+#define kIOReturnBadArgument 0xe00002c2
+#define kIOReturnUnsupported 0xe00002c7
+#define kIOReturnNotReady 0xe00002d8
+
+#define iokit_vendor_specific_msg(message) (0xe0004000 | (message))
+
+// Like libkern, unsigned int only
+static inline unsigned int min(unsigned int a, unsigned int b) { return a < b ? a : b; }
+static inline unsigned int max(unsigned int a, unsigned int b) { return a > b ? a : b; }
+
+extern "C" {
+void IOLog(const char* format, ...) __attribute__((format(printf, 1, 2)));
+void* IOMalloc(size_t size);
+void IOFree(void* address, size_t size);
+void IODelay(unsigned microseconds);
+
+void clock_get_uptime(UInt64* result);
+void absolutetime_to_nanoseconds(UInt64 abstime, UInt64* result);
+void nanoseconds_to_absolutetime(UInt64 nanoseconds, UInt64* result);
+
+struct IOSimpleLock;
+IOSimpleLock* IOSimpleLockAlloc();
+void IOSimpleLockFree(IOSimpleLock* lock);
+void IOSimpleLockLock(IOSimpleLock* lock);
+void IOSimpleLockUnlock(IOSimpleLock* lock);
+}
+
+class OSObject {
+public:
+    virtual ~OSObject() {}
+    void retain() const { references++; }
+    void release() const { if (--references == 0) delete this; }
+
+private:
+    mutable int references {1};
+};
+
+class OSData : public OSObject {
+public:
+    static OSData* withCapacity(unsigned capacity);
+    bool appendBytes(const void* bytes, unsigned length);
+    const void* getBytesNoCopy() const { return bytes; }
+    unsigned getLength() const { return length; }
+    ~OSData() override;
+
+private:
+    UInt8* bytes {nullptr};
+    unsigned length {0};
+    unsigned capacity {0};
+};
+
+#endif // VOODOO_INPUT_HOST_IOSERVICE_H
@@ -0,0 +1,23 @@
+//
+//  IOHIDUsageTables.h
+//  VoodooInput host tests
+//
+//  Copyright © 2024 Kishor Prins. All rights reserved.
+//
+
+#ifndef VOODOO_INPUT_HOST_IOKIT_HID_IOHIDUSAGETABLES_H
+#define VOODOO_INPUT_HOST_IOKIT_HID_IOHIDUSAGETABLES_H
+
+// The pages and usages VoodooInput refers to by name
+enum {
+    kHIDPage_GenericDesktop = 0x01,
+    kHIDPage_Digitizer = 0x0D,
+};
+
+enum {
+    kHIDUsage_GD_Mouse = 0x02,
+    kHIDUsage_Dig_TouchScreen = 0x04,
+    kHIDUsage_Dig_TouchPad = 0x05,
+};
+
+#endif // VOODOO_INPUT_HOST_IOKIT_HID_IOHIDUSAGETABLES_H
@@ -0,0 +1,18 @@
+//
+//  clock.h
+//  VoodooInput host tests
+//
+//  Copyright © 2024 Kishor Prins. All rights reserved.
+//
+
+#ifndef VOODOO_INPUT_HOST_KERN_CLOCK_H
+#define VOODOO_INPUT_HOST_KERN_CLOCK_H
+
+#include <IOKit/IOService.h>
+
+#define NSEC_PER_SEC 1000000000ULL
+#define NSEC_PER_MSEC 1000000ULL
+#define NSEC_PER_USEC 1000ULL
+#define USEC_PER_SEC 1000000ULL
+
+#endif // VOODOO_INPUT_HOST_KERN_CLOCK_H
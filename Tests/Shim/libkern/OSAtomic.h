@@ -0,0 +1,22 @@
+//
+//  OSAtomic.h
+//  VoodooInput host tests
+//
+//  Copyright © 2024 Kishor Prins. All rights reserved.
+//
+
+#ifndef VOODOO_INPUT_HOST_OSATOMIC_H
+#define VOODOO_INPUT_HOST_OSATOMIC_H
+
+#include <IOKit/IOService.h>
+
+// Return the old value like the kernel versions
+static inline SInt32 OSIncrementAtomic(volatile SInt32* address) { return __sync_fetch_and_add(address, 1); }
+static inline SInt32 OSDecrementAtomic(volatile SInt32* address) { return __sync_fetch_and_sub(address, 1); }
+static inline SInt32 OSAddAtomic(SInt32 amount, volatile SInt32* address) { return __sync_fetch_and_add(address, amount); }
+static inline bool OSCompareAndSwap(UInt32 oldValue, UInt32 newValue, volatile UInt32* address) {
+    return __sync_bool_compare_and_swap(address, oldValue, newValue);
+}
+static inline void OSMemoryBarrier() { __sync_synchronize(); }
+
+#endif // VOODOO_INPUT_HOST_OSATOMIC_H
@@ -0,0 +1,14 @@
+//
+//  version.h
+//  VoodooInput host tests
+//
+//  Copyright © 2024 Kishor Prins. All rights reserved.
+//
+
+#ifndef VOODOO_INPUT_HOST_VERSION_H
+#define VOODOO_INPUT_HOST_VERSION_H
+
+// Darwin major the profiles are picked for, tests may change it
+extern "C" int version_major;
+
+#endif // VOODOO_INPUT_HOST_VERSION_H
@@ -0,0 +1,21 @@
+//
+//  kdebug.h
+//  VoodooInput host tests
+//
+//  Copyright © 2024 Kishor Prins. All rights reserved.
+//
+
+#ifndef VOODOO_INPUT_HOST_KDEBUG_H
+#define VOODOO_INPUT_HOST_KDEBUG_H
+
+#include <IOKit/IOService.h>
+
+#define DBG_THIRD_PARTY 37
+
+#define DBG_FUNC_START 1
+#define DBG_FUNC_END 2
+#define DBG_FUNC_NONE 0
+
+#define KDBG_CODE(Class, SubClass, code) (((Class & 0xff) << 24) | ((SubClass & 0xff) << 16) | ((code & 0x3fff) << 2))
+
+#endif // VOODOO_INPUT_HOST_KDEBUG_H
@@ -0,0 +1,154 @@
+//
+//  SoakSourceTests.cpp
+//  VoodooInput host tests
+//
+//  Copyright © 2024 Kishor Prins. All rights reserved.
+//
+
+#include "Test.hpp"
+
+#include "HostShim.hpp"
+#include "VoodooInputSimulator/VoodooInputSoakSource.hpp"
+
+#define MS 1000000ULL
+// 125 Hz
+#define PERIOD (8 * MS)
+#define START (5000 * MS)
+
+static VoodooInputSoakParams params(UInt32 rate = SOAK_DEFAULT_RATE, bool trackpoint = false) {
+    VoodooInputSoakParams params {};
+    params.scenario = kVoodooInputGestureStress;
+    params.rate = rate;
+    params.contacts = 3;
+    params.trackpoint = trackpoint;
+    params.logical_max_x = 3000;
+    params.logical_max_y = 2000;
+    return params;
+}
+
+// What soakTimerFired does: take a frame if one is due, then sleep until the next deadline
+static bool fire(VoodooInputSoakSource& source, UInt64 wait_ns = 0, bool accepted = true) {
+    VoodooInputEvent event;
+    if (!source.nextFrame(HostClockNow(), event))
+        return false;
+    source.recordDelivery(wait_ns, accepted);
+    return true;
+}
+
+TEST(FramesOnTheGrid) {
+    VoodooInputSoakSource source;
+    HostClockSet(START);
+    source.start(params(), HostClockNow());
+
+    // The first frame is due right away
+    CHECK_EQ(source.getNextDeadline(), START);
+    for (int i = 0; i < 125; i++) {
+        CHECK(fire(source));
+        CHECK_EQ(source.getNextDeadline(), START + (i + 1) * PERIOD);
+
+        // An early wakeup takes nothing
+        HostClockSet(source.getNextDeadline() - 1);
+        CHECK(!fire(source));
+        HostClockAdvance(1);
+    }
+
+    VoodooInputSoakStats stats = source.getStats(HostClockNow());
+    CHECK_EQ(stats.frames, 125);
+    CHECK_EQ(stats.dropped, 0);
+    CHECK_EQ(stats.achieved_rate, 125);
+}
+
+TEST(LateWakeupsDropMissedDeadlines) {
+    VoodooInputSoakSource source;
+    HostClockSet(START);
+    source.start(params(), HostClockNow());
+    CHECK(fire(source));
+
+    // Woken two and a half periods late, one frame for the latest deadline, none in a burst
+    HostClockSet(START + PERIOD + 2 * PERIOD + PERIOD / 2);
+    CHECK(fire(source));
+    CHECK(!fire(source));
+    CHECK_EQ(source.getNextDeadline(), START + 4 * PERIOD);
+
+    // Back on the grid afterwards
+    HostClockSet(START + 4 * PERIOD);
+    CHECK(fire(source));
+
+    VoodooInputSoakStats stats = source.getStats(HostClockNow());
+    CHECK_EQ(stats.frames, 3);
+    CHECK_EQ(stats.dropped, 2);
+}
+
+TEST(RefusedFramesCountAsDropped) {
+    VoodooInputSoakSource source;
+    HostClockSet(START);
+    source.start(params(), HostClockNow());
+
+    for (int i = 0; i < 10; i++) {
+        CHECK(fire(source, (i + 1) * 1000, i % 5 != 0));
+        HostClockSet(source.getNextDeadline());
+    }
+
+    VoodooInputSoakStats stats = source.getStats(HostClockNow());
+    CHECK_EQ(stats.frames, 8);
+    CHECK_EQ(stats.dropped, 2);
+    // Waits of 1 to 10 us
+    CHECK_EQ(stats.average_wait_ns, 5500);
+    CHECK_EQ(stats.worst_wait_ns, 10000);
+}
+
+TEST(RateIsClamped) {
+    VoodooInputSoakSource source;
+    HostClockSet(START);
+
+    source.start(params(0), HostClockNow());
+    fire(source);
+    CHECK_EQ(source.getNextDeadline(), START + 1000000000ULL / SOAK_DEFAULT_RATE);
+
+    source.start(params(SOAK_MAX_RATE * 10), HostClockNow());
+    fire(source);
+    CHECK_EQ(source.getNextDeadline(), START + 1000000000ULL / SOAK_MAX_RATE);
+}
+
+TEST(RestartClearsStatistics) {
+    VoodooInputSoakSource source;
+    HostClockSet(START);
+    source.start(params(), HostClockNow());
+    fire(source, 50000, false);
+    HostClockAdvance(10 * PERIOD);
+    fire(source);
+
+    source.start(params(), HostClockNow());
+    VoodooInputSoakStats stats = source.getStats(HostClockNow());
+    CHECK_EQ(stats.frames, 0);
+    CHECK_EQ(stats.dropped, 0);
+    CHECK_EQ(stats.achieved_rate, 0);
+    CHECK_EQ(stats.worst_wait_ns, 0);
+    CHECK_EQ(source.getNextDeadline(), HostClockNow());
+}
+
+TEST(TrackpointWalksASquare) {
+    VoodooInputSoakSource source;
+    TrackpointReport report;
+    HostClockSet(START);
+
+    source.start(params(), HostClockNow());
+    fire(source);
+    CHECK(!source.nextTrackpoint(report));
+
+    source.start(params(SOAK_DEFAULT_RATE, true), HostClockNow());
+    CHECK(!source.nextTrackpoint(report));
+
+    int x = 0, y = 0;
+    for (int i = 0; i < 4 * 32; i++) {
+        CHECK(fire(source));
+        CHECK(source.nextTrackpoint(report));
+        x += report.dx;
+        y += report.dy;
+        if (i == 31)
+            CHECK(x > 0 && y == 0);
+        HostClockSet(source.getNextDeadline());
+    }
+    CHECK_EQ(x, 0);
+    CHECK_EQ(y, 0);
+}
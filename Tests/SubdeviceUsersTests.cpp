@@ -0,0 +1,92 @@
+//
+//  SubdeviceUsersTests.cpp
+//  VoodooInput host tests
+//
+//  Copyright © 2024 Kishor Prins. All rights reserved.
+//
+
+#include "Test.hpp"
+#include "HostShim.hpp"
+
+#include "VoodooInputSubdeviceUsers.hpp"
+
+#include <pthread.h>
+
+// Stands in for a subdevice, stopped once the stopper drained
+struct Device {
+    volatile bool stopped;
+};
+
+struct Engine {
+    IOLock* lock;
+    VoodooInputSubdeviceUsers users;
+    Device* volatile published;
+    volatile bool stop;
+    volatile SInt32 calls;
+    volatile SInt32 stopped_calls;
+};
+
+// The frame path, calls into whatever it loaded until told to stop
+static void* deliverFrames(void* argument) {
+    Engine* engine = (Engine*)argument;
+    while (!engine->stop) {
+        engine->users.enter();
+        Device* device = engine->published;
+        if (device) {
+            OSIncrementAtomic(&engine->calls);
+            if (device->stopped)
+                OSIncrementAtomic(&engine->stopped_calls);
+        }
+        engine->users.leave(engine->lock);
+    }
+    return nullptr;
+}
+
+TEST(DrainWaitsForEveryUserThatLoadedTheDevice) {
+    Engine engine {IOLockAlloc(), {}, nullptr, false, 0, 0};
+    Device devices[200] {};
+    pthread_t threads[4];
+
+    for (pthread_t& thread : threads)
+        pthread_create(&thread, nullptr, deliverFrames, &engine);
+
+    for (Device& device : devices) {
+        IOLockLock(engine.lock);
+        engine.published = &device;
+        IOLockUnlock(engine.lock);
+
+        IODelay(50);
+
+        IOLockLock(engine.lock);
+        engine.published = nullptr;
+        engine.users.drain(engine.lock);
+        IOLockUnlock(engine.lock);
+        device.stopped = true;
+    }
+
+    engine.stop = true;
+    for (pthread_t& thread : threads)
+        pthread_join(thread, nullptr);
+
+    CHECK(engine.calls > 0);
+    CHECK_EQ(engine.stopped_calls, 0);
+    CHECK_EQ(engine.users.getUsers(), 0);
+    IOLockFree(engine.lock);
+}
+
+TEST(LeavingDoesNotLockWithoutAStopper) {
+    IOLock* lock = IOLockAlloc();
+    VoodooInputSubdeviceUsers users;
+
+    // The lock is not recursive, leave() taking it here would never return
+    IOLockLock(lock);
+    users.enter();
+    CHECK_EQ(users.getUsers(), 1);
+    users.leave(lock);
+    CHECK_EQ(users.getUsers(), 0);
+
+    // Nobody in, nothing to wait for
+    users.drain(lock);
+    IOLockUnlock(lock);
+    IOLockFree(lock);
+}
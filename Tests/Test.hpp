@@ -0,0 +1,73 @@
+//
+//  Test.hpp
+//  VoodooInput host tests
+//
+//  Copyright © 2024 Kishor Prins. All rights reserved.
+//
+
+#ifndef VOODOO_INPUT_TEST_HPP
+#define VOODOO_INPUT_TEST_HPP
+
+#include <stdio.h>
+
+/*
+ * Each test file is its own executable: TEST blocks register themselves, main runs
+ * them in order and fails when any CHECK did.
+ */
+
+struct TestCase {
+    const char* name;
+    void (*function)();
+    TestCase* next;
+};
+
+extern TestCase* TestFirst;
+extern int TestFailures;
+
+struct TestRegistration {
+    TestRegistration(TestCase* test) {
+        TestCase** tail = &TestFirst;
+        while (*tail)
+            tail = &(*tail)->next;
+        *tail = test;
+    }
+};
+
+#define TEST(name) \
+    static void test_##name(); \
+    static TestCase test_case_##name {#name, &test_##name, nullptr}; \
+    static TestRegistration test_registration_##name(&test_case_##name); \
+    static void test_##name()
+
+#define CHECK(condition) \
+    do { \
+        if (!(condition)) { \
+            fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition); \
+            TestFailures++; \
+        } \
+    } while (0)
+
+#define CHECK_EQ(actual, expected) \
+    do { \
+        long long actual_value = (long long)(actual); \
+        long long expected_value = (long long)(expected); \
+        if (actual_value != expected_value) { \
+            fprintf(stderr, "%s:%d: CHECK_EQ(%s, %s) failed: %lld != %lld\n", __FILE__, __LINE__, #actual, #expected, \
+                    actual_value, expected_value); \
+            TestFailures++; \
+        } \
+    } while (0)
+
+#define CHECK_NEAR(actual, expected, tolerance) \
+    do { \
+        long long actual_value = (long long)(actual); \
+        long long expected_value = (long long)(expected); \
+        long long difference = actual_value > expected_value ? actual_value - expected_value : expected_value - actual_value; \
+        if (difference > (long long)(tolerance)) { \
+            fprintf(stderr, "%s:%d: CHECK_NEAR(%s, %s, %s) failed: %lld vs %lld\n", __FILE__, __LINE__, #actual, \
+                    #expected, #tolerance, actual_value, expected_value); \
+            TestFailures++; \
+        } \
+    } while (0)
+
+#endif // VOODOO_INPUT_TEST_HPP
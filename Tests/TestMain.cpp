@@ -0,0 +1,24 @@
+//
+//  TestMain.cpp
+//  VoodooInput host tests
+//
+//  Copyright © 2024 Kishor Prins. All rights reserved.
+//
+
+#include "Test.hpp"
+
+#include "HostShim.hpp"
+
+TestCase* TestFirst = nullptr;
+int TestFailures = 0;
+
+int main() {
+    for (TestCase* test = TestFirst; test; test = test->next) {
+        int failures = TestFailures;
+        HostClockSet(0);
+        test->function();
+        printf("%s %s\n", TestFailures == failures ? "PASS" : "FAIL", test->name);
+    }
+
+    return TestFailures ? 1 : 0;
+}
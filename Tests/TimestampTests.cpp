@@ -0,0 +1,131 @@
+//
+//  TimestampTests.cpp
+//  VoodooInput host tests
+//
+//  Copyright © 2024 Kishor Prins. All rights reserved.
+//
+
+#include "Test.hpp"
+
+#include "HostShim.hpp"
+#include "VoodooInputSimulator/VoodooInputTimestamp.hpp"
+
+#define MS 1000000ULL
+#define MINUTE (60 * 1000 * MS)
+// 125 Hz
+#define PERIOD (8 * MS)
+
+static void initAt(VoodooInputTimestamp& timestamps, UInt64 now) {
+    HostClockSet(now);
+    timestamps.init(1, 1, HostClockNow);
+}
+
+/*
+ * One gesture of frames every PERIOD from start followed by the lift-off reports of
+ * the simulator. Returns whether the header time never went backwards, as the 21 bit
+ * field the HID stack sees, and leaves the first header time in first_ms.
+ */
+static bool gesture(VoodooInputTimestamp& timestamps, UInt64 start, UInt64 duration, UInt32& first_ms) {
+    UInt32 previous = 0;
+    bool increasing = true;
+
+    for (UInt64 stamp = start; stamp < start + duration; stamp += PERIOD) {
+        UInt32 ms = timestamps.mt2Milliseconds(stamp) & MT2_TIMESTAMP_MASK;
+        if (stamp == start)
+            first_ms = ms;
+        else
+            increasing &= ms >= previous;
+        previous = ms;
+    }
+
+    increasing &= (timestamps.mt2Advance(10) & MT2_TIMESTAMP_MASK) >= previous;
+    timestamps.mt2Idle();
+    return increasing;
+}
+
+TEST(TimebaseFactors) {
+    VoodooInputTimestamp timestamps;
+
+    // Apple silicon, 24 MHz ticks
+    timestamps.init(125, 3, HostClockNow);
+    CHECK_EQ(timestamps.toNanoseconds(24000000), 1000000000);
+    CHECK_EQ(timestamps.toMilliseconds(24000000), 1000);
+    CHECK_EQ(timestamps.toMilliseconds(24000), 1);
+
+    timestamps.init(1, 1, HostClockNow);
+    CHECK_EQ(timestamps.toNanoseconds(123456789), 123456789);
+    CHECK_EQ(timestamps.toMilliseconds(999999), 0);
+    CHECK_EQ(timestamps.toMilliseconds(1000000), 1);
+}
+
+TEST(CounterNeverRunsBackwards) {
+    VoodooInputTimestamp timestamps;
+    initAt(timestamps, 1000 * MS);
+
+    CHECK_EQ(timestamps.mt2Milliseconds(1100 * MS), 100);
+    // Late and early frames keep the counter where it is
+    CHECK_EQ(timestamps.mt2Milliseconds(1050 * MS), 100);
+    CHECK_EQ(timestamps.mt2Milliseconds(500 * MS), 100);
+    CHECK_EQ(timestamps.mt2Advance(10), 110);
+    // A frame before the synthesized time does not pull it back either
+    CHECK_EQ(timestamps.mt2Milliseconds(1105 * MS), 110);
+    CHECK_EQ(timestamps.mt2Milliseconds(1200 * MS), 200);
+}
+
+TEST(IdleFarFromTheWrapKeepsTheEpoch) {
+    VoodooInputTimestamp timestamps;
+    initAt(timestamps, 0);
+    UInt32 first_ms = 0;
+
+    CHECK(gesture(timestamps, 10 * MS, 2 * MINUTE, first_ms));
+    CHECK(gesture(timestamps, 10 * MINUTE, MINUTE, first_ms));
+    CHECK_EQ(first_ms, 10 * 60 * 1000);
+}
+
+TEST(GestureStartingNearTheWrapRestartsTheCounter) {
+    VoodooInputTimestamp timestamps;
+    initAt(timestamps, 0);
+    UInt32 first_ms = 0;
+
+    // Lifted well before the margin, the idle period takes the counter into it
+    UInt64 margin_start = (UInt64)(MT2_TIMESTAMP_MASK - MT2_TIMESTAMP_REBASE_MARGIN_MS) * MS;
+    CHECK(gesture(timestamps, margin_start - 2 * MINUTE, MINUTE, first_ms));
+
+    // Four minutes would wrap mid gesture without a restart at its first frame
+    CHECK(gesture(timestamps, margin_start + MINUTE, 4 * MINUTE, first_ms));
+    CHECK_EQ(first_ms, 0);
+}
+
+TEST(IdleAcrossTheWrap) {
+    VoodooInputTimestamp timestamps;
+    initAt(timestamps, 0);
+    UInt32 first_ms = 0;
+
+    // Lifted inside the margin, the counter wraps while nothing is touching
+    UInt64 lifted = (UInt64)(MT2_TIMESTAMP_MASK - MT2_TIMESTAMP_REBASE_MARGIN_MS / 2) * MS;
+    CHECK(gesture(timestamps, lifted - 10 * 1000 * MS, 10 * 1000 * MS, first_ms));
+
+    // Past the wrap and far from the next one, nothing to restart
+    UInt64 start = lifted + 10 * MINUTE;
+    CHECK(gesture(timestamps, start, 4 * MINUTE, first_ms));
+    CHECK_EQ(first_ms, (UInt32)(start / MS) & MT2_TIMESTAMP_MASK);
+    CHECK(first_ms < MT2_TIMESTAMP_MASK - MT2_TIMESTAMP_REBASE_MARGIN_MS);
+
+    // Many wraps later every gesture still reads monotonic
+    bool increasing = true;
+    for (UInt64 stamp = start + 5 * MINUTE; stamp < start + 600 * MINUTE; stamp += 7 * MINUTE)
+        increasing &= gesture(timestamps, stamp, 4 * MINUTE + 30 * 1000 * MS, first_ms);
+    CHECK(increasing);
+}
+
+TEST(OnlyTheFirstFrameAfterIdleDecides) {
+    VoodooInputTimestamp timestamps;
+    initAt(timestamps, 0);
+
+    // A gesture running into the margin is not restarted under the finger
+    UInt64 margin_start = (UInt64)(MT2_TIMESTAMP_MASK - MT2_TIMESTAMP_REBASE_MARGIN_MS) * MS;
+    UInt32 before = timestamps.mt2Milliseconds(margin_start - MS);
+    UInt32 inside = timestamps.mt2Milliseconds(margin_start + MINUTE);
+    CHECK(inside > before);
+    CHECK_EQ(inside, MT2_TIMESTAMP_MASK - MT2_TIMESTAMP_REBASE_MARGIN_MS + 60 * 1000);
+}
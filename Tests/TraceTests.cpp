@@ -0,0 +1,136 @@
+//
+//  TraceTests.cpp
+//  VoodooInput host tests
+//
+//  Copyright © 2024 Kishor Prins. All rights reserved.
+//
+
+#include "Test.hpp"
+#include "HostShim.hpp"
+
+#include "VoodooInputTrace.hpp"
+
+#include <pthread.h>
+
+static const VoodooInputTraceHeader& header(const OSData* data) {
+    return *(const VoodooInputTraceHeader*)data->getBytesNoCopy();
+}
+
+static const VoodooInputTraceRecord& entry(const OSData* data, UInt32 index) {
+    return ((const VoodooInputTraceRecord*)((const UInt8*)data->getBytesNoCopy() + sizeof(VoodooInputTraceHeader)))[index];
+}
+
+TEST(DisabledRecordsNothing) {
+    VoodooInputTrace trace;
+    trace.record(kVoodooInputTraceFrameIn, 1);
+    CHECK(trace.dump() == nullptr);
+
+    CHECK(trace.enable());
+    trace.disable();
+    OSData* data = trace.dump();
+    CHECK(data != nullptr);
+    CHECK_EQ(header(data).count, 0);
+    data->release();
+    trace.release();
+}
+
+TEST(EnableTwiceKeepsRecords) {
+    VoodooInputTrace trace;
+    CHECK(trace.enable());
+    trace.record(kVoodooInputTraceFrameIn, 2);
+    trace.record(kVoodooInputTraceReportSent, 3);
+    CHECK(trace.enable());
+    trace.record(kVoodooInputTraceLiftOff, 4);
+    trace.disable();
+
+    OSData* data = trace.dump();
+    CHECK_EQ(header(data).count, 3);
+    CHECK_EQ(entry(data, 0).type, kVoodooInputTraceFrameIn);
+    CHECK_EQ(entry(data, 2).type, kVoodooInputTraceLiftOff);
+    data->release();
+    trace.release();
+}
+
+TEST(NoDumpWhileEnabled) {
+    VoodooInputTrace trace;
+    CHECK(trace.enable());
+    trace.record(kVoodooInputTraceFrameIn);
+    CHECK(trace.dump() == nullptr);
+    trace.release();
+}
+
+TEST(DumpIsOldestFirstAfterWrap) {
+    VoodooInputTrace trace;
+    CHECK(trace.enable());
+    for (UInt32 i = 0; i < VOODOO_INPUT_TRACE_RECORDS + 10; i++) {
+        HostClockSet(i * 1000);
+        trace.record(kVoodooInputTraceFrameIn, 0, 0, i);
+    }
+    trace.disable();
+
+    OSData* data = trace.dump();
+    CHECK_EQ(header(data).magic, VOODOO_INPUT_TRACE_MAGIC);
+    CHECK_EQ(header(data).count, VOODOO_INPUT_TRACE_RECORDS);
+    CHECK_EQ(header(data).total, VOODOO_INPUT_TRACE_RECORDS + 10);
+    CHECK_EQ(data->getLength(), sizeof(VoodooInputTraceHeader) + VOODOO_INPUT_TRACE_RECORDS * sizeof(VoodooInputTraceRecord));
+    CHECK_EQ(entry(data, 0).arg2, 10);
+    CHECK_EQ(entry(data, 0).timestamp, 10000);
+    CHECK_EQ(entry(data, VOODOO_INPUT_TRACE_RECORDS - 1).arg2, VOODOO_INPUT_TRACE_RECORDS + 9);
+    data->release();
+    trace.release();
+}
+
+// Writers racing with disable() must have finished their record once it returns
+struct Writer {
+    VoodooInputTrace* trace;
+    volatile bool stop;
+};
+
+static void* writeRecords(void* argument) {
+    Writer* writer = (Writer*)argument;
+    while (!writer->stop)
+        writer->trace->record(kVoodooInputTraceReportSent, 0x5A, 0xA5A5, 0x5A5A5A5A);
+    return nullptr;
+}
+
+TEST(DisableQuiescesWriters) {
+    VoodooInputTrace trace;
+    Writer writer {&trace, false};
+    pthread_t threads[4];
+
+    for (int round = 0; round < 50; round++) {
+        CHECK(trace.enable());
+        writer.stop = false;
+        for (pthread_t& thread : threads)
+            pthread_create(&thread, nullptr, writeRecords, &writer);
+
+        IODelay(200);
+        trace.disable();
+
+        OSData* first = trace.dump();
+        IODelay(50);
+        OSData* second = trace.dump();
+
+        // Writers still spin in record(), nothing may land in the ring anymore
+        CHECK_EQ(header(first).total, header(second).total);
+        CHECK(first->getLength() == second->getLength() &&
+              memcmp(first->getBytesNoCopy(), second->getBytesNoCopy(), first->getLength()) == 0);
+
+        for (UInt32 i = 0; i < header(first).count; i++) {
+            const VoodooInputTraceRecord& record = entry(first, i);
+            if (record.type != kVoodooInputTraceReportSent || record.arg1 != 0xA5A5 || record.arg2 != 0x5A5A5A5A) {
+                CHECK(false);
+                break;
+            }
+        }
+
+        first->release();
+        second->release();
+
+        writer.stop = true;
+        for (pthread_t& thread : threads)
+            pthread_join(thread, nullptr);
+    }
+
+    trace.release();
+}
@@ -0,0 +1,103 @@
+//
+//  TrackpointPipelineBenchmark.cpp
+//  VoodooInput host tests
+//
+//  Copyright © 2024 Kishor Prins. All rights reserved.
+//
+
+#include "Benchmark.hpp"
+#include "Jitter.hpp"
+#include "TrackpointRecorder.hpp"
+
+// Only sums what it gets, the HID dispatch is not what is measured
+struct CountingSink {
+    long long sum {0};
+    UInt32 events {0};
+
+    inline void dispatchPointer(int dx, int dy, UInt32 buttons, AbsoluteTime timestamp) {
+        sum += dx - dy + buttons;
+        events++;
+    }
+
+    inline void dispatchScroll(short deltaAxis1, short deltaAxis2, short deltaAxis3, AbsoluteTime timestamp) {
+        sum += deltaAxis1 - deltaAxis2;
+        events++;
+    }
+
+    inline void scheduleFlush(AbsoluteTime deadline) {
+        sum ^= deadline;
+    }
+};
+
+struct Input {
+    int dx, dy;
+    UInt32 buttons;
+};
+
+static Input* makeInput(UInt32 count) {
+    Input* input = new Input[count];
+    TestRandom random(42);
+    UInt32 buttons = 0;
+    for (UInt32 i = 0; i < count; i++) {
+        if (random.next() % 64 == 0)
+            buttons ^= 1u << (random.next() % 3);
+        input[i] = {(int)random.jitter(20), (int)random.jitter(20), buttons};
+    }
+    return input;
+}
+
+template <typename Pipeline>
+static void measure(const char* name, const TrackpointSettings& settings, const Input* input, UInt32 count) {
+    UInt64 elapsed = BenchmarkBest([&] {
+        TrackpointPipelineState state;
+        CountingSink sink;
+        TrackpointPipelineContext context {settings, state};
+
+        UInt64 start = HostMonotonicNs();
+        for (UInt32 i = 0; i < count; i++) {
+            TrackpointPacket packet {250000ULL * i, kTrackpointPacketPointer, true, input[i].dx, input[i].dy, input[i].buttons, {0, 0, 0}};
+            Pipeline::run(packet, context, sink);
+        }
+        UInt64 end = HostMonotonicNs();
+        BenchmarkKeep(sink.sum);
+        return end - start;
+    });
+    BenchmarkRow(name, elapsed, count);
+}
+
+static void measureLegacy(const TrackpointSettings& settings, const Input* input, UInt32 count) {
+    UInt64 elapsed = BenchmarkBest([&] {
+        TrackpointLegacy legacy;
+        CountingSink sink;
+
+        UInt64 start = HostMonotonicNs();
+        for (UInt32 i = 0; i < count; i++)
+            legacy.reportPacket(settings, input[i].dx, input[i].dy, input[i].buttons, 250000ULL * i, sink);
+        UInt64 end = HostMonotonicNs();
+        BenchmarkKeep(sink.sum);
+        return end - start;
+    });
+    BenchmarkRow("legacy reportPacket", elapsed, count);
+}
+
+int main(int argc, char** argv) {
+    UInt32 count = BenchmarkIterations(argc, argv, 10000000);
+    Input* input = makeInput(count);
+
+    TrackpointSettings settings;
+    TrackpointSettings accelerated;
+    accelerated.accelDivisor = 16;
+    accelerated.smoothing = true;
+    TrackpointSettings coalesced = accelerated;
+    coalesced.coalesceIntervalUS = 2000;
+
+    BenchmarkHeader("trackpoint packets");
+    measureLegacy(settings, input, count);
+    measure<TrackpointDefaultPipeline>("default pipeline", settings, input, count);
+    measure<TrackpointTunedPipeline>("tuned pipeline, stages off", settings, input, count);
+    measure<TrackpointTunedPipeline>("tuned pipeline, accel + smoothing", accelerated, input, count);
+    measure<TrackpointTunedPipeline>("tuned pipeline, + coalesce 2ms @ 4kHz", coalesced, input, count);
+
+    delete[] input;
+    return 0;
+}
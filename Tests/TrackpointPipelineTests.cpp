@@ -0,0 +1,158 @@
+//
+//  TrackpointPipelineTests.cpp
+//  VoodooInput host tests
+//
+//  Copyright © 2024 Kishor Prins. All rights reserved.
+//
+
+#include "Test.hpp"
+#include "Jitter.hpp"
+#include "TrackpointRecorder.hpp"
+
+static TrackpointPacket rawPacket(int dx, int dy, UInt32 buttons, AbsoluteTime timestamp) {
+    return {timestamp, kTrackpointPacketPointer, true, dx, dy, buttons, {0, 0, 0}};
+}
+
+template <typename Pipeline>
+static void run(TrackpointPacket packet, const TrackpointSettings& settings, TrackpointPipelineState& state, TrackpointRecorder& sink) {
+    TrackpointPipelineContext context {settings, state};
+    Pipeline::run(packet, context, sink);
+}
+
+static TrackpointSettings settingsVariant(int variant) {
+    TrackpointSettings settings;
+    switch (variant) {
+        case 1:
+            settings.deadzone = 0;
+            break;
+        case 2:
+            settings.deadzone = 3;
+            settings.multX = 3;
+            settings.divX = 2;
+            settings.multY = 5;
+            settings.divY = 4;
+            break;
+        case 3:
+            settings.scrollMultX = -2;
+            settings.scrollMultY = 3;
+            settings.scrollDivY = 2;
+            break;
+    }
+    return settings;
+}
+
+// Random motion with the left and middle buttons going up and down, which exercises every middle button state
+TEST(DefaultPipelineMatchesLegacy) {
+    for (int variant = 0; variant < 4; variant++) {
+        TrackpointSettings settings = settingsVariant(variant);
+        TestRandom random(variant + 1);
+        TrackpointLegacy legacy;
+        TrackpointPipelineState defaultState, tunedState;
+        TrackpointRecorder expected, actual, tuned;
+
+        UInt32 buttons = 0;
+        for (UInt32 i = 0; i < 20000; i++) {
+            if (random.next() % 16 == 0)
+                buttons ^= 1u << (random.next() % 3);
+            int dx = (int)random.jitter(random.next() % 4 ? 6 : 120);
+            int dy = (int)random.jitter(random.next() % 4 ? 6 : 120);
+            AbsoluteTime timestamp = 1000000ULL * i;
+
+            legacy.reportPacket(settings, dx, dy, buttons, timestamp, expected);
+            run<TrackpointDefaultPipeline>(rawPacket(dx, dy, buttons, timestamp), settings, defaultState, actual);
+            // With nothing optional configured the tuned pipeline is the same thing
+            run<TrackpointTunedPipeline>(rawPacket(dx, dy, buttons, timestamp), settings, tunedState, tuned);
+        }
+
+        CHECK(!settings.isTuned());
+        CHECK_EQ(actual.events.size(), expected.events.size());
+        CHECK(actual.events == expected.events);
+        CHECK(tuned.events == expected.events);
+    }
+}
+
+TEST(ProcessedEventsPassThrough) {
+    TrackpointSettings settings = settingsVariant(2);
+    TrackpointPipelineState state;
+    TrackpointRecorder sink;
+
+    run<TrackpointDefaultPipeline>({5, kTrackpointPacketPointer, false, 2, -1, MIDDLE_MOUSE_MASK, {0, 0, 0}}, settings, state, sink);
+    run<TrackpointDefaultPipeline>({6, kTrackpointPacketScroll, false, 0, 0, 0, {7, -8, 9}}, settings, state, sink);
+    run<TrackpointTunedPipeline>({7, kTrackpointPacketPointer, false, 2, -1, 1, {0, 0, 0}}, settings, state, sink);
+
+    CHECK_EQ(sink.events.size(), 3);
+    CHECK((sink.events[0] == TrackpointEvent {false, 2, -1, 0, MIDDLE_MOUSE_MASK, 5}));
+    CHECK((sink.events[1] == TrackpointEvent {true, 7, -8, 9, 0, 6}));
+    CHECK((sink.events[2] == TrackpointEvent {false, 2, -1, 0, 1, 7}));
+    CHECK_EQ(state.middleBtnState, NOT_PRESSED);
+}
+
+TEST(AccelerationAndSmoothing) {
+    TrackpointSettings settings;
+    settings.deadzone = 0;
+    settings.accelDivisor = 10;
+    CHECK(settings.isTuned());
+
+    TrackpointPipelineState state;
+    TrackpointRecorder sink;
+    run<TrackpointTunedPipeline>(rawPacket(10, -5, 0, 1), settings, state, sink);
+    CHECK_EQ(sink.events[0].a, 20);
+    CHECK_EQ(sink.events[0].b, -7);
+
+    settings.accelDivisor = 0;
+    settings.smoothing = true;
+    run<TrackpointTunedPipeline>(rawPacket(10, 4, 0, 2), settings, state, sink);
+    run<TrackpointTunedPipeline>(rawPacket(20, 4, 0, 3), settings, state, sink);
+    CHECK_EQ(sink.events[1].a, 5);
+    CHECK_EQ(sink.events[1].b, 2);
+    CHECK_EQ(sink.events[2].a, 15);
+    CHECK_EQ(sink.events[2].b, 4);
+
+    // Provider scroll events are left alone by both
+    settings.accelDivisor = 10;
+    run<TrackpointTunedPipeline>({4, kTrackpointPacketScroll, false, 0, 0, 0, {3, 3, 0}}, settings, state, sink);
+    CHECK((sink.events[3] == TrackpointEvent {true, 3, 3, 0, 0, 4}));
+}
+
+TEST(CoalesceHoldsAndFlushes) {
+    TrackpointSettings settings;
+    settings.deadzone = 0;
+    settings.coalesceIntervalUS = 8000;
+
+    TrackpointPipelineState state;
+    TrackpointRecorder sink;
+    TrackpointPipelineContext context {settings, state};
+
+    // 1kHz packets after a pause, the first goes out, the next seven are merged
+    const AbsoluteTime start = 100000000ULL;
+    int sent = 0;
+    for (UInt32 i = 0; i < 8; i++) {
+        run<TrackpointTunedPipeline>(rawPacket(1, 2, 0, start + i * 1000000ULL), settings, state, sink);
+        sent++;
+    }
+    CHECK_EQ(sink.events.size(), 1);
+    CHECK_EQ(sink.flushDeadline, start + 8000000ULL);
+
+    // Nothing else comes, the timer sends what was held
+    TrackpointCoalesceStage::flush(context, sink.flushDeadline, sink);
+    CHECK_EQ(sink.events.size(), 2);
+    CHECK_EQ(sink.events[1].a, 7);
+    CHECK_EQ(sink.events[1].b, 14);
+    CHECK_EQ(sink.events[1].timestamp, start + 8000000ULL);
+
+    // A second flush has nothing left
+    TrackpointCoalesceStage::flush(context, start + 9000000ULL, sink);
+    CHECK_EQ(sink.events.size(), 2);
+
+    // Button changes are never held back and carry the motion merged so far
+    run<TrackpointTunedPipeline>(rawPacket(3, 0, 0, start + 10000000ULL), settings, state, sink);
+    run<TrackpointTunedPipeline>(rawPacket(1, 1, 1, start + 11000000ULL), settings, state, sink);
+    CHECK_EQ(sink.events.size(), 3);
+    CHECK((sink.events[2] == TrackpointEvent {false, 4, 1, 0, 1, start + 11000000ULL}));
+
+    // Total motion is preserved
+    int total = 0;
+    for (const TrackpointEvent& event : sink.events)
+        total += event.a;
+    CHECK_EQ(total, sent + 3 + 1);
+}
@@ -0,0 +1,100 @@
+//
+//  TrackpointRecorder.hpp
+//  VoodooInput host tests
+//
+//  Copyright © 2024 Kishor Prins. All rights reserved.
+//
+
+#ifndef VOODOO_INPUT_TEST_TRACKPOINT_RECORDER_HPP
+#define VOODOO_INPUT_TEST_TRACKPOINT_RECORDER_HPP
+
+#include "Trackpoint/TrackpointPipeline.hpp"
+
+#include <vector>
+
+struct TrackpointEvent {
+    bool scroll;
+    int a, b, c;
+    UInt32 buttons;
+    AbsoluteTime timestamp;
+
+    bool operator==(const TrackpointEvent& other) const {
+        return scroll == other.scroll && a == other.a && b == other.b && c == other.c &&
+               buttons == other.buttons && timestamp == other.timestamp;
+    }
+};
+
+// Pipeline sink keeping everything dispatched
+struct TrackpointRecorder {
+    std::vector<TrackpointEvent> events;
+    AbsoluteTime flushDeadline {0};
+
+    void dispatchPointer(int dx, int dy, UInt32 buttons, AbsoluteTime timestamp) {
+        events.push_back({false, dx, dy, 0, buttons, timestamp});
+    }
+
+    void dispatchScroll(short deltaAxis1, short deltaAxis2, short deltaAxis3, AbsoluteTime timestamp) {
+        events.push_back({true, deltaAxis1, deltaAxis2, deltaAxis3, 0, timestamp});
+    }
+
+    void scheduleFlush(AbsoluteTime deadline) {
+        flushDeadline = deadline;
+    }
+};
+
+/*
+ * TrackpointDevice::reportPacket as it was before the pipeline, kept verbatim apart
+ * from dispatching to a recorder, the default pipeline has to match it exactly.
+ */
+struct TrackpointLegacy {
+    MiddlePressedState middleBtnState {NOT_PRESSED};
+
+    template <typename Sink>
+    void reportPacket(const TrackpointSettings& settings, int dx, int dy, UInt32 buttons, AbsoluteTime timestamp, Sink& sink) {
+        dx -= TrackpointSignum(dx) * min(TrackpointAbs(dx), settings.deadzone);
+        dy -= TrackpointSignum(dy) * min(TrackpointAbs(dy), settings.deadzone);
+
+        bool middleBtnNotPressed = (buttons & MIDDLE_MOUSE_MASK) == 0;
+
+        switch (middleBtnState) {
+            case NOT_PRESSED:
+                if (middleBtnNotPressed) {
+                    break;
+                }
+
+                middleBtnState = PRESSED;
+                /* fallthrough */
+            case PRESSED:
+                if (dx || dy) {
+                    middleBtnState = SCROLLED;
+                }
+
+                if (middleBtnNotPressed) {
+                    sink.dispatchPointer(dx, dy, MIDDLE_MOUSE_MASK, timestamp);
+                    middleBtnState = NOT_PRESSED;
+                }
+                break;
+            case SCROLLED:
+                if (middleBtnNotPressed) {
+                    middleBtnState = NOT_PRESSED;
+                }
+                break;
+        }
+
+        buttons &= ~MIDDLE_MOUSE_MASK;
+
+        if (middleBtnState == SCROLLED) {
+            short scrollY = dy * settings.scrollMultX / settings.scrollDivX;
+            short scrollX = dx * settings.scrollMultY / settings.scrollDivY;
+
+            sink.dispatchScroll(scrollY, scrollX, 0, timestamp);
+        } else {
+            int mulDx = dx * settings.multX / settings.divX;
+            int mulDy = dy * settings.multY / settings.divY;
+
+            sink.dispatchPointer(mulDx, mulDy, buttons, timestamp);
+        }
+    }
+};
+
+#endif // VOODOO_INPUT_TEST_TRACKPOINT_RECORDER_HPP
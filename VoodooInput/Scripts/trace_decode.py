@@ -0,0 +1,108 @@
+#!/usr/bin/env python3
+
+#
+#  trace_decode.py
+#  VoodooInput
+#
+#  Copyright © 2024 Kishor Prins. All rights reserved.
+#
+
+#
+#  Decodes a VoodooInput trace ring dump into a readable timeline.
+#
+#  Tracing is started by setting "VoodooInput Trace" to true on the
+#  VoodooInput instance (or its provider) and stopped by setting it to false,
+#  which publishes the captured ring as "VoodooInput Trace Dump".
+#
+#  Example usage:
+#  ioreg -rw0 -c VoodooInput -k "VoodooInput Trace Dump" > trace.txt
+#  ./trace_decode.py trace.txt
+#
+#  Both raw binary dumps and ioreg text output are accepted.
+#
+
+import re
+import struct
+import sys
+
+MAGIC = 0x52544956
+HEADER = struct.Struct('<IHHII')
+RECORD = struct.Struct('<QBBHI')
+
+# Keep in sync with VoodooInputTraceType in VoodooInputTrace.hpp
+TYPES = {
+    1: 'frame-in',
+    2: 'gate-acquired',
+    3: 'report-sent',
+    4: 'lift-off',
+    5: 'dropped',
+    6: 'trackpoint',
+}
+
+DROP_REASONS = {
+    1: 'not-ready',
+    2: 'error-input',
+}
+
+
+def s16(value):
+    return value - 0x10000 if value & 0x8000 else value
+
+
+def describe(kind, arg0, arg1, arg2):
+    if kind in (1, 2, 4):
+        return 'contacts=%d' % arg0
+    if kind == 3:
+        return 'touch_active=0x%x len=%d' % (arg0, arg1)
+    if kind == 5:
+        return 'reason=%s' % DROP_REASONS.get(arg0, arg0)
+    if kind == 6:
+        return 'buttons=0x%x dx=%d dy=%d' % (arg0, s16(arg2 >> 16), s16(arg2 & 0xFFFF))
+    return 'arg0=%d arg1=%d arg2=%d' % (arg0, arg1, arg2)
+
+
+def load(path):
+    with open(path, 'rb') as f:
+        data = f.read()
+
+    if len(data) >= 4 and struct.unpack_from('<I', data)[0] == MAGIC:
+        return data
+
+    match = re.search(rb'"VoodooInput Trace Dump"\s*=\s*<([0-9a-fA-F]*)>', data)
+    if match is None:
+        match = re.search(rb'<([0-9a-fA-F]+)>', data)
+    if match is None:
+        sys.exit('No trace dump found in %s' % path)
+
+    return bytes.fromhex(match.group(1).decode())
+
+
+def main():
+    if len(sys.argv) != 2:
+        sys.exit('Usage: %s <dump>' % sys.argv[0])
+
+    data = load(sys.argv[1])
+    magic, version, record_size, count, total = HEADER.unpack_from(data)
+
+    if magic != MAGIC or record_size != RECORD.size:
+        sys.exit('Unsupported trace dump (magic 0x%08x, record size %d)' % (magic, record_size))
+
+    print('version %d, %d records (%d written, %d overwritten)' % (version, count, total, total - count))
+
+    start = None
+    previous = None
+    offset = HEADER.size
+    for _ in range(count):
+        timestamp, kind, arg0, arg1, arg2 = RECORD.unpack_from(data, offset)
+        offset += RECORD.size
+
+        if start is None:
+            start = previous = timestamp
+
+        print('%12.3f ms  +%9.3f us  %-14s %s' % ((timestamp - start) / 1e6, (timestamp - previous) / 1e3,
+                                                TYPES.get(kind, 'type-%d' % kind), describe(kind, arg0, arg1, arg2)))
+        previous = timestamp
+
+
+if __name__ == '__main__':
+    main()
@@ -8,10 +8,11 @@
 
 #include "TrackpointDevice.hpp"
 
-OSDefineMetaClassAndStructors(TrackpointDevice, IOHIPointing);
+#include <IOKit/IOWorkLoop.h>
+#include <IOKit/IOCommandGate.h>
+#include <IOKit/IOTimerEventSource.h>
 
-#define abs(x) ((x < 0) ? -(x) : (x))
-#define MIDDLE_MOUSE_MASK 0x4
+OSDefineMetaClassAndStructors(TrackpointDevice, IOHIPointing);
 
 UInt32 TrackpointDevice::deviceType() {
     return NX_EVS_DEVICE_TYPE_MOUSE;
@@ -34,6 +35,28 @@ bool TrackpointDevice::start(IOService* provider) {
         return false;
     }
     
+    workLoop = getWorkLoop();
+    if (!workLoop) {
+        IOLog("%s Could not get a IOWorkLoop instance\n", getName());
+        return false;
+    }
+    
+    workLoop->retain();
+    
+    commandGate = IOCommandGate::commandGate(this);
+    if (!commandGate || (workLoop->addEventSource(commandGate) != kIOReturnSuccess)) {
+        IOLog("%s Could not open command gate\n", getName());
+        releaseResources();
+        return false;
+    }
+    
+    flushTimer = IOTimerEventSource::timerEventSource(this, OSMemberFunctionCast(IOTimerEventSource::Action, this, &TrackpointDevice::flushCoalesced));
+    if (!flushTimer || (workLoop->addEventSource(flushTimer) != kIOReturnSuccess)) {
+        IOLog("%s Could not add coalesce timer\n", getName());
+        releaseResources();
+        return false;
+    }
+    
     updateTrackpointProperties();
 
     setProperty(kIOHIDScrollAccelerationTypeKey, kIOHIDTrackpadScrollAccelerationKey);
@@ -62,95 +85,86 @@ void TrackpointDevice::updateTrackpointProperties() {
     if (dict == nullptr) return;
     
     getOSIntValue(dict, &btnCount, VOODOO_TRACKPOINT_BTN_CNT);
-    getOSIntValue(dict, &trackpointDeadzone, VOODOO_TRACKPOINT_DEADZONE);
-    getOSIntValue(dict, &trackpointMultX, VOODOO_TRACKPOINT_MOUSE_MULT_X);
-    getOSIntValue(dict, &trackpointMultY, VOODOO_TRACKPOINT_MOUSE_MULT_Y);
-    getOSIntValue(dict, &trackpointDivX, VOODOO_TRACKPOINT_MOUSE_DIV_X);
-    getOSIntValue(dict, &trackpointDivY, VOODOO_TRACKPOINT_MOUSE_DIV_Y);
+    getOSIntValue(dict, &settings.deadzone, VOODOO_TRACKPOINT_DEADZONE);
+    getOSIntValue(dict, &settings.multX, VOODOO_TRACKPOINT_MOUSE_MULT_X);
+    getOSIntValue(dict, &settings.multY, VOODOO_TRACKPOINT_MOUSE_MULT_Y);
+    getOSIntValue(dict, &settings.divX, VOODOO_TRACKPOINT_MOUSE_DIV_X);
+    getOSIntValue(dict, &settings.divY, VOODOO_TRACKPOINT_MOUSE_DIV_Y);
+    
+    getOSShortValue(dict, &settings.scrollMultX, VOODOO_TRACKPOINT_SCROLL_MULT_X);
+    getOSShortValue(dict, &settings.scrollMultY, VOODOO_TRACKPOINT_SCROLL_MULT_Y);
+    getOSShortValue(dict, &settings.scrollDivX, VOODOO_TRACKPOINT_SCROLL_DIV_X);
+    getOSShortValue(dict, &settings.scrollDivY, VOODOO_TRACKPOINT_SCROLL_DIV_Y);
     
-    getOSShortValue(dict, &trackpointScrollMultX, VOODOO_TRACKPOINT_SCROLL_MULT_X);
-    getOSShortValue(dict, &trackpointScrollMultY, VOODOO_TRACKPOINT_SCROLL_MULT_Y);
-    getOSShortValue(dict, &trackpointScrollDivX, VOODOO_TRACKPOINT_SCROLL_DIV_X);
-    getOSShortValue(dict, &trackpointScrollDivY, VOODOO_TRACKPOINT_SCROLL_DIV_Y);
+    getOSIntValue(dict, &settings.accelDivisor, VOODOO_TRACKPOINT_ACCEL_DIV);
+    getOSIntValue(dict, &settings.coalesceIntervalUS, VOODOO_TRACKPOINT_COALESCE_INTERVAL);
+    OSBoolean *smoothing = OSDynamicCast(OSBoolean, dict->getObject(VOODOO_TRACKPOINT_SMOOTHING));
+    if (smoothing != nullptr) settings.smoothing = smoothing->isTrue();
     
-    if (trackpointDivX == 0) trackpointDivX = 1;
-    if (trackpointDivY == 0) trackpointDivY = 1;
-    if (trackpointScrollDivX == 0) trackpointScrollDivX = 1;
-    if (trackpointScrollDivY == 0) trackpointScrollDivY = 1;
+    if (settings.divX == 0) settings.divX = 1;
+    if (settings.divY == 0) settings.divY = 1;
+    if (settings.scrollDivX == 0) settings.scrollDivX = 1;
+    if (settings.scrollDivY == 0) settings.scrollDivY = 1;
 }
 
 void TrackpointDevice::stop(IOService* provider) {
+    releaseResources();
     super::stop(provider);
 }
 
-int TrackpointDevice::signum(int value)
-{
-    if (value > 0) return 1;
-    if (value < 0) return -1;
-    return 0;
+void TrackpointDevice::releaseResources() {
+    if (flushTimer) {
+        flushTimer->cancelTimeout();
+        workLoop->removeEventSource(flushTimer);
+        OSSafeReleaseNULL(flushTimer);
+    }
+    if (commandGate) {
+        workLoop->removeEventSource(commandGate);
+        OSSafeReleaseNULL(commandGate);
+    }
+    OSSafeReleaseNULL(workLoop);
 }
 
-void TrackpointDevice::reportPacket(TrackpointReport &report) {
-    SInt32 dx = report.dx;
-    SInt32 dy = report.dy;
-    UInt32 buttons = report.buttons;
-    AbsoluteTime timestamp = report.timestamp;
+// Inlined into every entry point, which is what folds the raw checks of the stages away
+inline void TrackpointDevice::processPacket(TrackpointPacket& packet) {
+    if (__builtin_expect(settings.isTuned(), false)) {
+        commandGate->runAction(OSMemberFunctionCast(IOCommandGate::Action, this, &TrackpointDevice::processTunedGated), &packet);
+        return;
+    }
+    
+    TrackpointPipelineContext context {settings, pipelineState};
+    TrackpointDefaultPipeline::run(packet, context, *this);
+}
 
-    dx -= signum(dx) * min(abs(dx), trackpointDeadzone);
-    dy -= signum(dy) * min(abs(dy), trackpointDeadzone);
+void TrackpointDevice::processTunedGated(TrackpointPacket* packet) {
+    TrackpointPipelineContext context {settings, pipelineState};
+    TrackpointTunedPipeline::run(*packet, context, *this);
+}
 
-    bool middleBtnNotPressed = (buttons & MIDDLE_MOUSE_MASK) == 0;
-    
-    // Do not tell macOS about the middle button until it's been released
-    // Scrolling with the button down can result in the button being spammed
-    switch (middleBtnState) {
-        case NOT_PRESSED:
-            if (middleBtnNotPressed) {
-                break;
-            }
-            
-            middleBtnState = PRESSED;
-            /* fallthrough */
-        case PRESSED:
-            if (dx || dy) {
-                middleBtnState = SCROLLED;
-            }
-            
-            if (middleBtnNotPressed) {
-                // Two reports are needed to send the middle button - this is the first
-                // The second one below is sent with the button released
-                dispatchRelativePointerEvent(dx, dy, MIDDLE_MOUSE_MASK, timestamp);
-                middleBtnState = NOT_PRESSED;
-            }
-            break;
-        case SCROLLED:
-            if (middleBtnNotPressed) {
-                middleBtnState = NOT_PRESSED;
-            }
-            break;
-    }
+void TrackpointDevice::scheduleFlush(AbsoluteTime deadline) {
+    flushTimer->wakeAtTime(deadline);
+}
 
-    buttons &= ~MIDDLE_MOUSE_MASK;
-    
-    if (middleBtnState == SCROLLED) {
-        short scrollY = dy * trackpointScrollMultX / trackpointScrollDivX;
-        short scrollX = dx * trackpointScrollMultY / trackpointScrollDivY;
-        
-        dispatchScrollWheelEvent(scrollY, scrollX, 0, timestamp);
-    } else {
-        int mulDx = dx * trackpointMultX / trackpointDivX;
-        int mulDy = dy * trackpointMultY / trackpointDivY;
-        
-        dispatchRelativePointerEvent(mulDx, mulDy, buttons, timestamp);
-    }
+void TrackpointDevice::flushCoalesced(IOTimerEventSource* sender) {
+    AbsoluteTime now;
+    clock_get_uptime(&now);
+    TrackpointPipelineContext context {settings, pipelineState};
+    TrackpointCoalesceStage::flush(context, now, *this);
+}
+
+void TrackpointDevice::reportPacket(const TrackpointReport &report) {
+    TrackpointPacket packet = TrackpointReportPacket(report);
+    processPacket(packet);
 }
 
-void TrackpointDevice::updateRelativePointer(int dx, int dy, int buttons, uint64_t timestamp) {
-    dispatchRelativePointerEvent(dx, dy, buttons, timestamp);
+void TrackpointDevice::updateRelativePointer(int dx, int dy, int buttons, AbsoluteTime timestamp) {
+    TrackpointPacket packet {timestamp, kTrackpointPacketPointer, false, dx, dy, (UInt32)buttons, {0, 0, 0}};
+    processPacket(packet);
 };
 
-void TrackpointDevice::updateScrollwheel(short deltaAxis1, short deltaAxis2, short deltaAxis3, uint64_t timestamp) {
-    dispatchScrollWheelEvent(deltaAxis1, deltaAxis2, deltaAxis3, timestamp);
+void TrackpointDevice::updateScrollwheel(short deltaAxis1, short deltaAxis2, short deltaAxis3, AbsoluteTime timestamp) {
+    TrackpointPacket packet {timestamp, kTrackpointPacketScroll, false, 0, 0, 0, {deltaAxis1, deltaAxis2, deltaAxis3}};
+    processPacket(packet);
 }
 
 bool TrackpointDevice::willTerminate(IOService* provider, IOOptionBits options) {
@@ -13,32 +13,32 @@
 #include <IOKit/hidsystem/IOHIDParameter.h>
 #include "VoodooInputMessages.h"
 #include "VoodooInputEvent.h"
+#include "TrackpointPipeline.hpp"
 
-enum MiddlePressedState {
-    NOT_PRESSED,
-    PRESSED,
-    SCROLLED
-};
+class IOWorkLoop;
+class IOCommandGate;
+class IOTimerEventSource;
 
 class TrackpointDevice : public IOHIPointing {
     typedef IOHIPointing super;
     OSDeclareDefaultStructors(TrackpointDevice);
 private:
-    int trackpointMultX {1};
-    int trackpointMultY {1};
-    int trackpointDivX {1};
-    int trackpointDivY {1};
-    short trackpointScrollMultX {1};
-    short trackpointScrollMultY {1};
-    short trackpointScrollDivX {1};
-    short trackpointScrollDivY {1};
-    int trackpointDeadzone {1};
+    TrackpointSettings settings;
+    TrackpointPipelineState pipelineState;
     int btnCount {3};
     
-    MiddlePressedState middleBtnState {NOT_PRESSED};
-    int signum(int value);
+    // The tuned pipeline runs on the gate, its coalesce stage shares state with flushTimer
+    IOWorkLoop* workLoop {nullptr};
+    IOCommandGate* commandGate {nullptr};
+    IOTimerEventSource* flushTimer {nullptr};
+    
     void getOSIntValue(OSDictionary *dict, int *val, const char *key);
     void getOSShortValue(OSDictionary *dict, short *val, const char *key);
+    
+    void releaseResources();
+    void processPacket(TrackpointPacket& packet);
+    void processTunedGated(TrackpointPacket* packet);
+    void flushCoalesced(IOTimerEventSource* sender);
 protected:
     virtual IOItemCount buttonCount() override;
     virtual IOFixed resolution() override;
@@ -51,10 +51,21 @@ public:
     virtual UInt32 deviceType() override;
     virtual UInt32 interfaceID() override;
     
-    void updateRelativePointer(int dx, int dy, int buttons, uint64_t timestamp);
-    void updateScrollwheel(short deltaAxis1, short deltaAxis2, short deltaAxis3, uint64_t timestamp);
+    void updateRelativePointer(int dx, int dy, int buttons, AbsoluteTime timestamp);
+    void updateScrollwheel(short deltaAxis1, short deltaAxis2, short deltaAxis3, AbsoluteTime timestamp);
     void updateTrackpointProperties();
-    void reportPacket(TrackpointReport &report);
+    void reportPacket(const TrackpointReport &report);
+
+    // Pipeline sink
+    inline void dispatchPointer(int dx, int dy, UInt32 buttons, AbsoluteTime timestamp) {
+        dispatchRelativePointerEvent(dx, dy, buttons, timestamp);
+    }
+
+    inline void dispatchScroll(short deltaAxis1, short deltaAxis2, short deltaAxis3, AbsoluteTime timestamp) {
+        dispatchScrollWheelEvent(deltaAxis1, deltaAxis2, deltaAxis3, timestamp);
+    }
+
+    void scheduleFlush(AbsoluteTime deadline);
 };
 
 #endif /* TrackpointDevice_hpp */
@@ -0,0 +1,306 @@
+//
+//  TrackpointPipeline.hpp
+//  VoodooInput
+//
+//  Copyright © 2024 Kishor Prins. All rights reserved.
+//  Deadzone, middle button and scaling moved from TrackpointDevice.cpp, Copyright (c) 2019 Leonard Kleinhans <leo-labs>
+//
+
+#ifndef TrackpointPipeline_hpp
+#define TrackpointPipeline_hpp
+
+#include <IOKit/IOService.h>
+#include <kern/clock.h>
+
+#include "../VoodooInputKdebug.hpp"
+#include "../VoodooInputMultitouch/VoodooInputEvent.h"
+
+#define MIDDLE_MOUSE_MASK 0x4
+
+enum MiddlePressedState {
+    NOT_PRESSED,
+    PRESSED,
+    SCROLLED
+};
+
+enum TrackpointPacketKind {
+    kTrackpointPacketPointer,
+    kTrackpointPacketScroll
+};
+
+struct TrackpointPacket {
+    AbsoluteTime timestamp;
+    TrackpointPacketKind kind;
+    // Straight from the trackpoint, the provider already processed anything else
+    bool raw;
+    int dx;
+    int dy;
+    UInt32 buttons;
+    short scroll[3];
+};
+
+// A report from the provider as TrackpointDevice::reportPacket feeds it in, the kdebug point of every raw packet
+static inline TrackpointPacket TrackpointReportPacket(const TrackpointReport& report) {
+    VoodooInputKdebug(kVoodooInputKdebugTrackpoint, DBG_FUNC_NONE, report.dx, report.dy, report.buttons);
+    return {report.timestamp, kTrackpointPacketPointer, true, report.dx, report.dy, report.buttons, {0, 0, 0}};
+}
+
+struct TrackpointSettings {
+    int multX {1};
+    int multY {1};
+    int divX {1};
+    int divY {1};
+    short scrollMultX {1};
+    short scrollMultY {1};
+    short scrollDivX {1};
+    short scrollDivY {1};
+    int deadzone {1};
+    // Optional stages, any of them set selects TrackpointTunedPipeline
+    int accelDivisor {0};
+    bool smoothing {false};
+    int coalesceIntervalUS {0};
+
+    inline bool isTuned() const {
+        return accelDivisor > 0 || smoothing || coalesceIntervalUS > 0;
+    }
+};
+
+struct TrackpointPipelineState {
+    MiddlePressedState middleBtnState {NOT_PRESSED};
+    int previousDx {0};
+    int previousDy {0};
+    int pendingDx {0};
+    int pendingDy {0};
+    UInt32 pendingButtons {0};
+    AbsoluteTime lastDispatch {0};
+};
+
+struct TrackpointPipelineContext {
+    const TrackpointSettings& settings;
+    TrackpointPipelineState& state;
+};
+
+static inline int TrackpointSignum(int value) {
+    if (value > 0) return 1;
+    if (value < 0) return -1;
+    return 0;
+}
+
+static inline int TrackpointAbs(int value) {
+    return value < 0 ? -value : value;
+}
+
+/*
+ * A stage is a type with a static process() taking the packet, the context and the sink.
+ * Returning false drops the packet, true hands it to the next stage. The sink receives
+ * whatever reaches the end of the pipeline and any extra events a stage decides to emit:
+ *
+ *   dispatchPointer(dx, dy, buttons, timestamp)
+ *   dispatchScroll(deltaAxis1, deltaAxis2, deltaAxis3, timestamp)
+ *   scheduleFlush(deadline)    TrackpointCoalesceStage::flush() is due at deadline
+ *
+ * Every entry point feeds the same pipeline. Stages that reproduce the trackpoint
+ * processing only touch raw packets, the check folds away once run() is inlined
+ * into an entry point since raw is a constant there.
+ */
+template <typename... Stages>
+struct TrackpointPipeline;
+
+template <>
+struct TrackpointPipeline<> {
+    template <typename Sink>
+    static inline void run(TrackpointPacket& packet, TrackpointPipelineContext& context, Sink& sink) {
+        if (packet.kind == kTrackpointPacketScroll) {
+            sink.dispatchScroll(packet.scroll[0], packet.scroll[1], packet.scroll[2], packet.timestamp);
+        } else {
+            sink.dispatchPointer(packet.dx, packet.dy, packet.buttons, packet.timestamp);
+        }
+    }
+};
+
+template <typename Stage, typename... Rest>
+struct TrackpointPipeline<Stage, Rest...> {
+    template <typename Sink>
+    static inline void run(TrackpointPacket& packet, TrackpointPipelineContext& context, Sink& sink) {
+        if (Stage::process(packet, context, sink)) {
+            TrackpointPipeline<Rest...>::run(packet, context, sink);
+        }
+    }
+};
+
+struct TrackpointDeadzoneStage {
+    template <typename Sink>
+    static inline bool process(TrackpointPacket& packet, TrackpointPipelineContext& context, Sink&) {
+        if (!packet.raw) {
+            return true;
+        }
+
+        int deadzone = context.settings.deadzone;
+        packet.dx -= TrackpointSignum(packet.dx) * min(TrackpointAbs(packet.dx), deadzone);
+        packet.dy -= TrackpointSignum(packet.dy) * min(TrackpointAbs(packet.dy), deadzone);
+        return true;
+    }
+};
+
+// Quadratic gain, d * (1 + |d| / accelDivisor)
+struct TrackpointAccelerationStage {
+    template <typename Sink>
+    static inline bool process(TrackpointPacket& packet, TrackpointPipelineContext& context, Sink&) {
+        int divisor = context.settings.accelDivisor;
+        if (divisor > 0 && packet.kind == kTrackpointPacketPointer) {
+            packet.dx += packet.dx * TrackpointAbs(packet.dx) / divisor;
+            packet.dy += packet.dy * TrackpointAbs(packet.dy) / divisor;
+        }
+        return true;
+    }
+};
+
+// Two tap moving average, trades half a packet of lag for less wobble at low speed
+struct TrackpointSmoothingStage {
+    template <typename Sink>
+    static inline bool process(TrackpointPacket& packet, TrackpointPipelineContext& context, Sink&) {
+        if (!context.settings.smoothing || packet.kind != kTrackpointPacketPointer) {
+            return true;
+        }
+
+        TrackpointPipelineState& state = context.state;
+        int dx = packet.dx;
+        int dy = packet.dy;
+        packet.dx = (dx + state.previousDx) / 2;
+        packet.dy = (dy + state.previousDy) / 2;
+        state.previousDx = dx;
+        state.previousDy = dy;
+        return true;
+    }
+};
+
+// Do not tell macOS about the middle button until it's been released
+// Scrolling with the button down can result in the button being spammed
+struct TrackpointMiddleButtonStage {
+    template <typename Sink>
+    static inline bool process(TrackpointPacket& packet, TrackpointPipelineContext& context, Sink& sink) {
+        if (!packet.raw) {
+            return true;
+        }
+
+        MiddlePressedState& middleBtnState = context.state.middleBtnState;
+        bool middleBtnNotPressed = (packet.buttons & MIDDLE_MOUSE_MASK) == 0;
+
+        switch (middleBtnState) {
+            case NOT_PRESSED:
+                if (middleBtnNotPressed) {
+                    break;
+                }
+
+                middleBtnState = PRESSED;
+                /* fallthrough */
+            case PRESSED:
+                if (packet.dx || packet.dy) {
+                    middleBtnState = SCROLLED;
+                }
+
+                if (middleBtnNotPressed) {
+                    // Two reports are needed to send the middle button - this is the first
+                    // The second one is sent further down the pipeline with the button released
+                    sink.dispatchPointer(packet.dx, packet.dy, MIDDLE_MOUSE_MASK, packet.timestamp);
+                    middleBtnState = NOT_PRESSED;
+                }
+                break;
+            case SCROLLED:
+                if (middleBtnNotPressed) {
+                    middleBtnState = NOT_PRESSED;
+                }
+                break;
+        }
+
+        packet.buttons &= ~MIDDLE_MOUSE_MASK;
+
+        if (middleBtnState == SCROLLED) {
+            packet.kind = kTrackpointPacketScroll;
+        }
+        return true;
+    }
+};
+
+// Applies the multipliers and divisors, turning scroll packets into wheel deltas
+struct TrackpointScaleStage {
+    template <typename Sink>
+    static inline bool process(TrackpointPacket& packet, TrackpointPipelineContext& context, Sink&) {
+        if (!packet.raw) {
+            return true;
+        }
+
+        const TrackpointSettings& settings = context.settings;
+
+        if (packet.kind == kTrackpointPacketScroll) {
+            packet.scroll[0] = packet.dy * settings.scrollMultX / settings.scrollDivX;
+            packet.scroll[1] = packet.dx * settings.scrollMultY / settings.scrollDivY;
+            packet.scroll[2] = 0;
+        } else {
+            packet.dx = packet.dx * settings.multX / settings.divX;
+            packet.dy = packet.dy * settings.multY / settings.divY;
+        }
+        return true;
+    }
+};
+
+// Merges pointer packets arriving faster than coalesceIntervalUS, button changes always go through.
+// Motion held back is due one interval after the last dispatch, the sink calls flush() then.
+struct TrackpointCoalesceStage {
+    template <typename Sink>
+    static inline bool process(TrackpointPacket& packet, TrackpointPipelineContext& context, Sink& sink) {
+        TrackpointPipelineState& state = context.state;
+        int interval = context.settings.coalesceIntervalUS;
+
+        if (packet.kind != kTrackpointPacketPointer || interval <= 0) {
+            return true;
+        }
+
+        packet.dx += state.pendingDx;
+        packet.dy += state.pendingDy;
+        state.pendingDx = state.pendingDy = 0;
+
+        UInt64 elapsed;
+        absolutetime_to_nanoseconds(packet.timestamp - state.lastDispatch, &elapsed);
+
+        if (packet.buttons == state.pendingButtons && elapsed < interval * NSEC_PER_USEC) {
+            state.pendingDx = packet.dx;
+            state.pendingDy = packet.dy;
+
+            if (packet.dx || packet.dy) {
+                AbsoluteTime delay;
+                nanoseconds_to_absolutetime(interval * NSEC_PER_USEC, &delay);
+                sink.scheduleFlush(state.lastDispatch + delay);
+            }
+            return false;
+        }
+
+        state.pendingButtons = packet.buttons;
+        state.lastDispatch = packet.timestamp;
+        return true;
+    }
+
+    template <typename Sink>
+    static inline void flush(TrackpointPipelineContext& context, AbsoluteTime now, Sink& sink) {
+        TrackpointPipelineState& state = context.state;
+
+        if (!state.pendingDx && !state.pendingDy) {
+            return;
+        }
+
+        int dx = state.pendingDx;
+        int dy = state.pendingDy;
+        state.pendingDx = state.pendingDy = 0;
+        state.lastDispatch = now;
+        sink.dispatchPointer(dx, dy, state.pendingButtons, now);
+    }
+};
+
+// What every entry point runs with the optional stages off, reproduces the original reportPacket
+typedef TrackpointPipeline<TrackpointDeadzoneStage, TrackpointMiddleButtonStage, TrackpointScaleStage> TrackpointDefaultPipeline;
+
+// Selected when any optional stage is configured, see TrackpointSettings::isTuned
+typedef TrackpointPipeline<TrackpointDeadzoneStage, TrackpointAccelerationStage, TrackpointSmoothingStage,
+                           TrackpointMiddleButtonStage, TrackpointScaleStage, TrackpointCoalesceStage> TrackpointTunedPipeline;
+
+#endif /* TrackpointPipeline_hpp */
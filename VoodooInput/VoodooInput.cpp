@@ -11,14 +11,23 @@
 #include "VoodooInputMultitouch/VoodooInputMessages.h"
 #include "VoodooInputSimulator/VoodooInputActuatorDevice.hpp"
 #include "VoodooInputSimulator/VoodooInputSimulatorDevice.hpp"
+#include "VoodooInputSimulator/VoodooInputDigitizerDevice.hpp"
+#include "VoodooInputSimulator/VoodooInputHIDProfile.hpp"
+#include "VoodooInputSimulator/VoodooInputActuatorCodec.hpp"
 #include "Trackpoint/TrackpointDevice.hpp"
+#include "VoodooInputKdebug.hpp"
 
-#include "libkern/version.h"
+#include <IOKit/IOWorkLoop.h>
+#include <IOKit/IOInterruptEventSource.h>
+#include <IOKit/IOTimerEventSource.h>
+#include <IOKit/IOUserClient.h>
 
 #define super IOService
 OSDefineMetaClassAndStructors(VoodooInput, IOService);
 
 bool VoodooInput::start(IOService *provider) {
+    clock_get_uptime(&startTime);
+    
     if (!super::start(provider)) {
         IOLog("Kishor VoodooInput could not super::start!\n");
         return false;
@@ -26,97 +35,463 @@ bool VoodooInput::start(IOService *provider) {
     
     parentProvider = provider;
 
+    subdeviceLock = IOLockAlloc();
+    earlyFrameLock = IOSimpleLockAlloc();
+    if (!subdeviceLock || !earlyFrameLock) {
+        IOLog("VoodooInput could not alloc subdevice locks!\n");
+        releaseStartResources();
+        return false;
+    }
+
     if (!updateProperties()) {
         IOLog("VoodooInput could not get provider properties!\n");
+        releaseStartResources();
         return false;
     }
 
-    // Allocate the simulator and actuator devices
-    simulator = OSTypeAlloc(VoodooInputSimulatorDevice);
-    actuator = OSTypeAlloc(VoodooInputActuatorDevice);
-    trackpoint = OSTypeAlloc(TrackpointDevice);
+    if (!arena.init()) {
+        IOLog("VoodooInput could not alloc buffer arena!\n");
+        releaseStartResources();
+        return false;
+    }
+    setProperty(VOODOO_INPUT_ARENA_FOOTPRINT_KEY, arena.getFootprint(), 32);
+
+    // Without it actuation reports are only dropped, not worth failing the touchpad for
+    if (!startActuatorChannel()) {
+        IOLog("VoodooInput could not start actuator channel!\n");
+    }
+
+    // Same for rate hints, providers keep their native rate
+    if (!startRateHintChannel()) {
+        IOLog("VoodooInput could not start rate hint channel!\n");
+    }
+
+    interface.version = VOODOO_INPUT_INTERFACE_VERSION;
+    interface.size = sizeof(interface);
+    interface.context = this;
+    interface.submitTouchFrame = &VoodooInput::interfaceSubmitTouchFrame;
+    interface.updateDimensions = &VoodooInput::interfaceUpdateDimensions;
+    interface.submitTrackpointReport = &VoodooInput::interfaceSubmitTrackpointReport;
+    interface.submitRelativePointer = &VoodooInput::interfaceSubmitRelativePointer;
+    interface.submitScrollWheel = &VoodooInput::interfaceSubmitScrollWheel;
     
-    if (!simulator || !actuator || !trackpoint) {
-        IOLog("VoodooInput could not alloc simulator, actuator or trackpoint!\n");
-        OSSafeReleaseNULL(simulator);
-        OSSafeReleaseNULL(actuator);
-        OSSafeReleaseNULL(trackpoint);
+    setProperty(VOODOO_INPUT_IDENTIFIER, kOSBooleanTrue);
+    
+    if (!parentProvider->open(this)) {
+        IOLog("VoodooInput could not open!\n");
+        releaseStartResources();
+        return false;
+    };
+    
+    // Subdevices the provider declared come up in the background, anything else on first use
+    if (!startStaged()) {
+        IOLog("VoodooInput could not start subdevice thread!\n");
+        parentProvider->close(this);
+        releaseStartResources();
         return false;
     }
     
-    // Initialize simulator device
-    if (!simulator->init(NULL) || !simulator->attach(this)) {
-        IOLog("VoodooInput could not attach simulator!\n");
-        goto exit;
+    return true;
+}
+
+void VoodooInput::releaseStartResources() {
+    stopStaged();
+    
+    if (subdeviceLock) {
+        IOLockFree(subdeviceLock);
+        subdeviceLock = nullptr;
     }
-    else if (!simulator->start(this)) {
-        IOLog("VoodooInput could not start simulator!\n");
-        simulator->detach(this);
-        goto exit;
+    
+    if (earlyFrameLock) {
+        IOSimpleLockFree(earlyFrameLock);
+        earlyFrameLock = nullptr;
     }
     
-    // Initialize actuator device
-    if (!actuator->init(NULL) || !actuator->attach(this)) {
-        IOLog("VoodooInput could not init or attach actuator!\n");
-        goto exit;
+    stopRateHintChannel();
+    stopActuatorChannel();
+    arena.release();
+    trace.release();
+}
+
+bool VoodooInput::startStaged() {
+    startWorkLoop = IOWorkLoop::workLoop();
+    if (!startWorkLoop) {
+        return false;
     }
-    else if (!actuator->start(this)) {
-        IOLog("VoodooInput could not start actuator!\n");
-        actuator->detach(this);
-        goto exit;
+    
+    startSource = IOInterruptEventSource::interruptEventSource(this, OSMemberFunctionCast(IOInterruptEventSource::Action, this, &VoodooInput::startSubdevicesStaged));
+    if (!startSource || startWorkLoop->addEventSource(startSource) != kIOReturnSuccess) {
+        OSSafeReleaseNULL(startSource);
+        OSSafeReleaseNULL(startWorkLoop);
+        return false;
     }
     
-    // Initialize trackpoint device
-    if (!trackpoint->init(NULL) || !trackpoint->attach(this)) {
-        IOLog("VoodooInput could not init or attach trackpoint!\n");
-        goto exit;
+    startSource->interruptOccurred(nullptr, this, 0);
+    return true;
+}
+
+void VoodooInput::stopStaged() {
+    if (startSource) {
+        startSource->disable();
+        // Waits for a bring up still in progress
+        startWorkLoop->removeEventSource(startSource);
+        OSSafeReleaseNULL(startSource);
     }
-    else if (!trackpoint->start(this)) {
-        IOLog("VoodooInput could not start trackpoint!\n");
-        trackpoint->detach(this);
-        goto exit;
+    OSSafeReleaseNULL(startWorkLoop);
+}
+
+// Every subdevice start and stop runs here, or in stop() once this is gone
+void VoodooInput::startSubdevicesStaged(IOInterruptEventSource* sender, int count) {
+    // Property updates and first trackpoint packets, a bring-up in progress is run again for them
+    if (startStage == kStartStageReady) {
+        updateSubdevices();
+        return;
     }
     
-    setProperty(VOODOO_INPUT_IDENTIFIER, kOSBooleanTrue);
+    // Whatever failed is left down, the rest still comes up
+    if (!updateSubdevices()) {
+        IOLog("VoodooInput could not bring up every declared subdevice!\n");
+    }
     
-    if (!parentProvider->open(this)) {
-        IOLog("VoodooInput could not open!\n");
+    AbsoluteTime now;
+    UInt64 readyTime;
+    clock_get_uptime(&now);
+    absolutetime_to_nanoseconds(now - startTime, &readyTime);
+    setProperty(VOODOO_INPUT_READY_TIME_KEY, readyTime / 1000, 32);
+    
+    // Buffered frames go out before ready is visible, so they never overtake a live one
+    VoodooInputEvent event;
+    for (;;) {
+        IOSimpleLockLock(earlyFrameLock);
+        bool pending = earlyFramePending;
+        if (pending) {
+            event = earlyFrame;
+            earlyFramePending = false;
+        } else {
+            startStage = kStartStageReady;
+        }
+        IOSimpleLockUnlock(earlyFrameLock);
+        
+        if (!pending) {
+            break;
+        }
+        
+        // Restamped, it would otherwise count as a stall and push the simulator into degraded mode
+        clock_get_uptime(&now);
+        event.timestamp = now;
+        for (int i = 0; i < event.contact_count && i < VOODOO_INPUT_MAX_TRANSDUCERS; i++) {
+            event.transducers[i].timestamp = now;
+        }
+        FramePath::deliverTouchFrame(*this, event);
+    }
+    
+    setProperty(VOODOO_INPUT_EARLY_FRAMES_DROPPED_KEY, earlyFramesDropped, 32);
+    setProperty(VOODOO_INPUT_READY_KEY, kOSBooleanTrue);
+    
+    parentProvider->message(kIOMessageVoodooInputReadyMessage, this);
+    
+    OSBoolean* soakBoolean = OSDynamicCast(OSBoolean, getProperty(VOODOO_INPUT_SOAK_KEY, gIOServicePlane));
+    if (soakBoolean != nullptr && soakBoolean->isTrue()) {
+        setSoakEnabled(true);
+    }
+}
+
+bool VoodooInput::holdEarlyFrame(const VoodooInputEvent* event) {
+    IOSimpleLockLock(earlyFrameLock);
+    
+    bool held = startStage != kStartStageReady;
+    if (held) {
+        if (event && earlyFramePolicy == kVoodooInputEarlyFramesBuffer) {
+            if (earlyFramePending) {
+                earlyFramesDropped++;
+            }
+            earlyFrame = *event;
+            earlyFramePending = true;
+        } else {
+            earlyFramesDropped++;
+        }
+    }
+    
+    IOSimpleLockUnlock(earlyFrameLock);
+    return held;
+}
+
+void VoodooInput::recordFirstReport() {
+    // Touch and trackpoint may both be first
+    if (!OSCompareAndSwap(0, 1, &firstReportSent)) {
+        return;
+    }
+    
+    AbsoluteTime now;
+    UInt64 uptime;
+    clock_get_uptime(&now);
+    absolutetime_to_nanoseconds(now, &uptime);
+    setProperty(VOODOO_INPUT_FIRST_REPORT_TIME_KEY, uptime / 1000000, 32);
+}
+
+bool VoodooInput::startSubdevice(IOService* device) {
+    if (!device->init(NULL) || !device->attach(this)) {
+        IOLog("VoodooInput could not init or attach %s!\n", device->getMetaClass()->getClassName());
         return false;
-    };
+    }
+    
+    if (!device->start(this)) {
+        IOLog("VoodooInput could not start %s!\n", device->getMetaClass()->getClassName());
+        device->detach(this);
+        return false;
+    }
     
     return true;
+}
 
-exit:
-    return false;
+void VoodooInput::stopSubdevice(IOService* device) {
+    device->stop(this);
+    device->detach(this);
 }
 
-bool VoodooInput::willTerminate(IOService* provider, IOOptionBits options) {
-    if (parentProvider->isOpen(this)) {
-        parentProvider->close(this);
+// Class sizes of the objects in the service plane from the device down, as far as matched yet, and its descriptor length
+static UInt64 subdeviceObjectsSize(IOService* device) {
+    if (!device)
+        return 0;
+
+    const VoodooInputHIDTables& tables = VoodooInputGetHIDTables();
+    VoodooInputSimulatorDevice* simulator = OSDynamicCast(VoodooInputSimulatorDevice, device);
+    UInt64 bytes = device->getMetaClass()->getClassSize();
+    if (simulator)
+        bytes += simulator->isComposite() ? tables.composite_descriptor.length : tables.report_descriptor.length;
+    else
+        bytes += tables.actuator_descriptor.length;
+
+    IORegistryIterator* iterator = IORegistryIterator::iterateOver(device, gIOServicePlane, kIORegistryIterateRecursively);
+    if (iterator) {
+        while (IORegistryEntry* entry = iterator->getNextObject())
+            bytes += entry->getMetaClass()->getClassSize();
+        iterator->release();
     }
 
-    return super::willTerminate(provider, options);
+    return bytes;
 }
 
-void VoodooInput::stop(IOService *provider) {
+// Kept per mode, so switching modes once is enough to compare them
+void VoodooInput::recordAttach(const char* key, bool composite, UInt64 value) {
+    OSDictionary* previous = OSDynamicCast(OSDictionary, getProperty(key));
+    OSDictionary* record = previous ? OSDictionary::withDictionary(previous) : OSDictionary::withCapacity(2);
+    OSNumber* number = OSNumber::withNumber(value, 32);
+
+    if (record && number) {
+        record->setObject(composite ? "Composite" : "Separate", number);
+        setProperty(key, record);
+    }
+
+    OSSafeReleaseNULL(number);
+    OSSafeReleaseNULL(record);
+}
+
+// Counted in subdeviceUsers when not null, a trackpoint nobody declared comes up with the first packet on the start work loop
+TrackpointDevice* VoodooInput::enterTrackpoint() {
+    subdeviceUsers.enter();
+    TrackpointDevice* device = trackpoint;
+    if (device) {
+        return device;
+    }
+    subdeviceUsers.leave(subdeviceLock);
+    
+    IOLockLock(subdeviceLock);
+    bool request = !trackpoint && !capabilitiesDeclared && !trackpointRequested;
+    if (request) {
+        trackpointRequested = true;
+    }
+    IOLockUnlock(subdeviceLock);
+    
+    if (request && startSource) {
+        startSource->interruptOccurred(nullptr, this, 0);
+    }
+    
+    return nullptr;
+}
+
+bool VoodooInput::startMultitouch(bool composite) {
     if (simulator) {
-        simulator->stop(this);
-        simulator->detach(this);
-        OSSafeReleaseNULL(simulator);
+        return true;
+    }
+    
+    AbsoluteTime attachStart;
+    clock_get_uptime(&attachStart);
+    
+    // Allocate the simulator and actuator devices, a composite simulator handles both
+    VoodooInputSimulatorDevice* newSimulator = OSTypeAlloc(VoodooInputSimulatorDevice);
+    VoodooInputActuatorDevice* newActuator = composite ? nullptr : OSTypeAlloc(VoodooInputActuatorDevice);
+    bool success = newSimulator && (composite || newActuator) && startSubdevice(newSimulator);
+    
+    if (success && newActuator && !startSubdevice(newActuator)) {
+        stopSubdevice(newSimulator);
+        success = false;
+    }
+    
+    if (!success) {
+        IOLog("VoodooInput could not bring up simulator and actuator!\n");
+        OSSafeReleaseNULL(newSimulator);
+        OSSafeReleaseNULL(newActuator);
+        return false;
+    }
+    
+    AbsoluteTime attachEnd;
+    UInt64 attachTime;
+    clock_get_uptime(&attachEnd);
+    absolutetime_to_nanoseconds(attachEnd - attachStart, &attachTime);
+    recordAttach(VOODOO_INPUT_MULTITOUCH_ATTACH_TIME_KEY, composite, attachTime / 1000);
+    recordAttach(VOODOO_INPUT_MULTITOUCH_ATTACH_OBJECTS_SIZE_KEY, composite, subdeviceObjectsSize(newSimulator) + subdeviceObjectsSize(newActuator));
+    
+    IOLockLock(subdeviceLock);
+    actuator = newActuator;
+    simulator = newSimulator;
+    IOLockUnlock(subdeviceLock);
+    return true;
+}
+
+void VoodooInput::stopMultitouch() {
+    IOLockLock(subdeviceLock);
+    VoodooInputSimulatorDevice* oldSimulator = simulator;
+    VoodooInputActuatorDevice* oldActuator = actuator;
+    simulator = nullptr;
+    actuator = nullptr;
+    subdeviceUsers.drain(subdeviceLock);
+    IOLockUnlock(subdeviceLock);
+    
+    if (oldSimulator) {
+        stopSubdevice(oldSimulator);
+        OSSafeReleaseNULL(oldSimulator);
+    }
+    
+    if (oldActuator) {
+        stopSubdevice(oldActuator);
+        OSSafeReleaseNULL(oldActuator);
+    }
+}
+
+bool VoodooInput::startDigitizer() {
+    if (digitizer) {
+        return true;
     }
     
-    if (actuator) {
-        actuator->stop(this);
-        actuator->detach(this);
-        OSSafeReleaseNULL(actuator);
+    VoodooInputDigitizerDevice* newDigitizer = OSTypeAlloc(VoodooInputDigitizerDevice);
+    if (!newDigitizer || !startSubdevice(newDigitizer)) {
+        IOLog("VoodooInput could not bring up digitizer!\n");
+        OSSafeReleaseNULL(newDigitizer);
+        return false;
     }
     
+    IOLockLock(subdeviceLock);
+    digitizer = newDigitizer;
+    IOLockUnlock(subdeviceLock);
+    return true;
+}
+
+void VoodooInput::stopDigitizer() {
+    IOLockLock(subdeviceLock);
+    VoodooInputDigitizerDevice* oldDigitizer = digitizer;
+    digitizer = nullptr;
+    subdeviceUsers.drain(subdeviceLock);
+    IOLockUnlock(subdeviceLock);
+    
+    if (oldDigitizer) {
+        stopSubdevice(oldDigitizer);
+        OSSafeReleaseNULL(oldDigitizer);
+    }
+}
+
+bool VoodooInput::startTrackpoint() {
     if (trackpoint) {
-        trackpoint->stop(this);
-        trackpoint->detach(this);
-        OSSafeReleaseNULL(trackpoint);
+        return true;
     }
     
+    TrackpointDevice* newTrackpoint = OSTypeAlloc(TrackpointDevice);
+    if (!newTrackpoint || !startSubdevice(newTrackpoint)) {
+        IOLog("VoodooInput could not bring up trackpoint!\n");
+        OSSafeReleaseNULL(newTrackpoint);
+        return false;
+    }
+    
+    IOLockLock(subdeviceLock);
+    trackpoint = newTrackpoint;
+    IOLockUnlock(subdeviceLock);
+    return true;
+}
+
+void VoodooInput::stopTrackpoint() {
+    IOLockLock(subdeviceLock);
+    TrackpointDevice* oldTrackpoint = trackpoint;
+    trackpoint = nullptr;
+    subdeviceUsers.drain(subdeviceLock);
+    IOLockUnlock(subdeviceLock);
+    
+    if (oldTrackpoint) {
+        stopSubdevice(oldTrackpoint);
+        OSSafeReleaseNULL(oldTrackpoint);
+    }
+}
+
+// Each subdevice fails on its own, what is down stays down until the next property update
+bool VoodooInput::updateSubdevices() {
+    IOLockLock(subdeviceLock);
+    bool declared = capabilitiesDeclared;
+    UInt32 declaredCapabilities = capabilities;
+    bool digitizerBackend = backend == kVoodooInputBackendDigitizer;
+    bool composite = compositeActuator;
+    bool wantTrackpoint = declared ? declaredCapabilities & kVoodooInputCapabilityTrackpoint : trackpointRequested;
+    IOLockUnlock(subdeviceLock);
+    
+    // Without a declaration the touch device still comes up right away, only the trackpoint waits for use
+    bool wantMultitouch = !declared || declaredCapabilities & kVoodooInputCapabilityMultitouch;
+    
+    // Drop the touch device of a backend that is no longer selected
+    if (!wantMultitouch || digitizerBackend) {
+        stopMultitouch();
+    }
+    if (!wantMultitouch || !digitizerBackend) {
+        stopDigitizer();
+    }
+    
+    // A registered report descriptor cannot change, bring the simulator up again in the new mode
+    if (simulator && simulator->isComposite() != composite) {
+        stopMultitouch();
+    }
+    
+    bool success = true;
+    
+    if (wantMultitouch) {
+        success &= digitizerBackend ? startDigitizer() : startMultitouch(composite);
+    }
+    
+    if (wantTrackpoint) {
+        success &= startTrackpoint();
+    } else {
+        stopTrackpoint();
+    }
+    
+    return success;
+}
+
+bool VoodooInput::willTerminate(IOService* provider, IOOptionBits options) {
+    if (parentProvider->isOpen(this)) {
+        parentProvider->close(this);
+    }
+
+    return super::willTerminate(provider, options);
+}
+
+void VoodooInput::stop(IOService *provider) {
+    stopStaged();
+    
+    if (subdeviceLock) {
+        setSoakEnabled(false);
+        stopMultitouch();
+        stopDigitizer();
+        stopTrackpoint();
+    }
+
+    releaseStartResources();
+    
     super::stop(provider);
 }
 
@@ -138,9 +513,229 @@ bool VoodooInput::updateProperties() {
     physicalMaxX = physicalMaxXNumber->unsigned32BitValue();
     physicalMaxY = physicalMaxYNumber->unsigned32BitValue();
 
+    OSBoolean* smoothingBoolean = OSDynamicCast(OSBoolean, getProperty(VOODOO_INPUT_TIMESTAMP_SMOOTHING_KEY, gIOServicePlane));
+    timestampSmoothing = smoothingBoolean != nullptr && smoothingBoolean->isTrue();
+
+    OSBoolean* contactSmoothingBoolean = OSDynamicCast(OSBoolean, getProperty(VOODOO_INPUT_CONTACT_SMOOTHING_KEY, gIOServicePlane));
+    contactSmoothing = contactSmoothingBoolean != nullptr && contactSmoothingBoolean->isTrue();
+    OSNumber* minCutoffNumber = OSDynamicCast(OSNumber, getProperty(VOODOO_INPUT_SMOOTHING_MIN_CUTOFF_KEY, gIOServicePlane));
+    smoothingMinCutoff = minCutoffNumber != nullptr ? minCutoffNumber->unsigned32BitValue() : CONTACT_FILTER_DEFAULT_MIN_CUTOFF;
+    OSNumber* betaNumber = OSDynamicCast(OSNumber, getProperty(VOODOO_INPUT_SMOOTHING_BETA_KEY, gIOServicePlane));
+    smoothingBeta = betaNumber != nullptr ? betaNumber->unsigned32BitValue() : CONTACT_FILTER_DEFAULT_BETA;
+
+    OSBoolean* interpolationBoolean = OSDynamicCast(OSBoolean, getProperty(VOODOO_INPUT_FRAME_INTERPOLATION_KEY, gIOServicePlane));
+    frameInterpolation = interpolationBoolean != nullptr && interpolationBoolean->isTrue();
+    OSNumber* interpolationRateNumber = OSDynamicCast(OSNumber, getProperty(VOODOO_INPUT_INTERPOLATION_RATE_KEY, gIOServicePlane));
+    // The simulator reads the rate from its own work loop, it never sees one out of range
+    UInt32 rate = interpolationRateNumber != nullptr ? interpolationRateNumber->unsigned32BitValue() : FRAME_INTERPOLATOR_DEFAULT_RATE;
+    if (rate == 0 || rate > FRAME_INTERPOLATOR_MAX_RATE) {
+        rate = FRAME_INTERPOLATOR_DEFAULT_RATE;
+    }
+    interpolationRate = rate;
+    OSNumber* interpolationLagNumber = OSDynamicCast(OSNumber, getProperty(VOODOO_INPUT_INTERPOLATION_LAG_KEY, gIOServicePlane));
+    interpolationLag = interpolationLagNumber != nullptr ? interpolationLagNumber->unsigned32BitValue() : FRAME_INTERPOLATOR_DEFAULT_LAG;
+
+    // The frame path and the start work loop read these
+    OSNumber* capabilitiesNumber = OSDynamicCast(OSNumber, getProperty(VOODOO_INPUT_CAPABILITIES_KEY, gIOServicePlane));
+    OSNumber* backendNumber = OSDynamicCast(OSNumber, getProperty(VOODOO_INPUT_BACKEND_KEY, gIOServicePlane));
+    OSBoolean* compositeBoolean = OSDynamicCast(OSBoolean, getProperty(VOODOO_INPUT_COMPOSITE_ACTUATOR_KEY, gIOServicePlane));
+    IOLockLock(subdeviceLock);
+    capabilitiesDeclared = capabilitiesNumber != nullptr;
+    if (capabilitiesDeclared) {
+        capabilities = capabilitiesNumber->unsigned32BitValue();
+    }
+    backend = backendNumber != nullptr ? backendNumber->unsigned32BitValue() : kVoodooInputBackendMagicTrackpad;
+    compositeActuator = compositeBoolean != nullptr && compositeBoolean->isTrue();
+    IOLockUnlock(subdeviceLock);
+
+    OSNumber* idleRateNumber = OSDynamicCast(OSNumber, getProperty(VOODOO_INPUT_IDLE_SAMPLE_RATE_KEY, gIOServicePlane));
+    rateAdvisor.setIdleRate(idleRateNumber != nullptr ? idleRateNumber->unsigned32BitValue() : RATE_ADVISOR_DEFAULT_IDLE_RATE);
+
+    OSBoolean* kdebugBoolean = OSDynamicCast(OSBoolean, getProperty(VOODOO_INPUT_KDEBUG_KEY, gIOServicePlane));
+    if (kdebugBoolean != nullptr) {
+        VoodooInputKdebugEnabled = kdebugBoolean->isTrue();
+    }
+
+    OSBoolean* traceBoolean = OSDynamicCast(OSBoolean, getProperty(VOODOO_INPUT_TRACE_KEY, gIOServicePlane));
+    if (traceBoolean != nullptr) {
+        setTraceEnabled(traceBoolean->isTrue());
+    }
+
+    OSNumber* earlyFramesNumber = OSDynamicCast(OSNumber, getProperty(VOODOO_INPUT_EARLY_FRAMES_KEY, gIOServicePlane));
+    earlyFramePolicy = earlyFramesNumber != nullptr ? earlyFramesNumber->unsigned32BitValue() : kVoodooInputEarlyFramesDrop;
+
+    // Until ready the soak source is left to the subdevice thread
+    OSBoolean* soakBoolean = OSDynamicCast(OSBoolean, getProperty(VOODOO_INPUT_SOAK_KEY, gIOServicePlane));
+    if (soakBoolean != nullptr && startStage == kStartStageReady) {
+        setSoakEnabled(soakBoolean->isTrue());
+    }
+
     return true;
 }
 
+void VoodooInput::setTraceEnabled(bool enable) {
+    if (enable) {
+        if (!trace.enable()) {
+            IOLog("VoodooInput could not allocate trace buffer!\n");
+        }
+        return;
+    }
+
+    trace.disable();
+
+    // Publish what was captured so it can be pulled with ioreg and fed to Scripts/trace_decode.py
+    OSData* data = trace.dump();
+    if (data) {
+        setProperty(VOODOO_INPUT_TRACE_DUMP_KEY, data);
+        data->release();
+    }
+}
+
+IOReturn VoodooInput::setProperties(OSObject* properties) {
+    OSDictionary* dict = OSDynamicCast(OSDictionary, properties);
+    if (dict == nullptr) {
+        return kIOReturnBadArgument;
+    }
+
+    OSBoolean* traceBoolean = OSDynamicCast(OSBoolean, dict->getObject(VOODOO_INPUT_TRACE_KEY));
+    if (traceBoolean == nullptr) {
+        return kIOReturnUnsupported;
+    }
+
+    // Costs every report while on, not something any process gets to toggle
+    if (IOUserClient::clientHasPrivilege(current_task(), kIOClientPrivilegeAdministrator) != kIOReturnSuccess) {
+        return kIOReturnNotPrivileged;
+    }
+
+    setTraceEnabled(traceBoolean->isTrue());
+    return kIOReturnSuccess;
+}
+
+void VoodooInput::setSoakEnabled(bool enable) {
+    IOLockLock(subdeviceLock);
+    soakRequested = enable;
+    
+    // Whoever is already switching picks the request up when done
+    if (soakSwitching) {
+        IOLockUnlock(subdeviceLock);
+        return;
+    }
+    soakSwitching = true;
+    
+    // Switched without the lock, stopping waits for a soak frame that may need it
+    while (soakRequested != (soakTimer != nullptr)) {
+        bool start = soakRequested;
+        IOLockUnlock(subdeviceLock);
+        
+        bool started = start && startSoak();
+        if (!started) {
+            if (start) {
+                IOLog("VoodooInput could not start soak source!\n");
+            }
+            stopSoak();
+        }
+        
+        IOLockLock(subdeviceLock);
+        if (start && !started) {
+            break;
+        }
+    }
+    
+    soakSwitching = false;
+    IOLockUnlock(subdeviceLock);
+}
+
+bool VoodooInput::startSoak() {
+    VoodooInputSoakParams params {};
+    OSNumber* scenarioNumber = OSDynamicCast(OSNumber, getProperty(VOODOO_INPUT_SOAK_SCENARIO_KEY, gIOServicePlane));
+    params.scenario = scenarioNumber != nullptr ? (VoodooInputGestureScenario)scenarioNumber->unsigned32BitValue() : kVoodooInputGestureStress;
+    OSNumber* rateNumber = OSDynamicCast(OSNumber, getProperty(VOODOO_INPUT_SOAK_RATE_KEY, gIOServicePlane));
+    params.rate = rateNumber != nullptr ? rateNumber->unsigned32BitValue() : SOAK_DEFAULT_RATE;
+    OSNumber* contactsNumber = OSDynamicCast(OSNumber, getProperty(VOODOO_INPUT_SOAK_CONTACTS_KEY, gIOServicePlane));
+    params.contacts = contactsNumber != nullptr ? contactsNumber->unsigned8BitValue() : VOODOO_INPUT_MAX_TRANSDUCERS;
+    OSBoolean* trackpointBoolean = OSDynamicCast(OSBoolean, getProperty(VOODOO_INPUT_SOAK_TRACKPOINT_KEY, gIOServicePlane));
+    params.trackpoint = trackpointBoolean != nullptr && trackpointBoolean->isTrue();
+    params.logical_max_x = logicalMaxX;
+    params.logical_max_y = logicalMaxY;
+    params.transform = transformKey;
+    
+    soakWorkLoop = IOWorkLoop::workLoop();
+    if (!soakWorkLoop) {
+        return false;
+    }
+    
+    soakTimer = IOTimerEventSource::timerEventSource(this, OSMemberFunctionCast(IOTimerEventSource::Action, this, &VoodooInput::soakTimerFired));
+    if (!soakTimer || soakWorkLoop->addEventSource(soakTimer) != kIOReturnSuccess) {
+        OSSafeReleaseNULL(soakTimer);
+        return false;
+    }
+    
+    AbsoluteTime now;
+    UInt64 nowNs;
+    clock_get_uptime(&now);
+    absolutetime_to_nanoseconds(now, &nowNs);
+    soakSource.start(params, nowNs);
+    
+    soakTimer->enable();
+    soakTimer->wakeAtTime(now);
+    return true;
+}
+
+void VoodooInput::stopSoak() {
+    if (soakTimer) {
+        soakTimer->cancelTimeout();
+        // Waits for a frame still being delivered
+        soakWorkLoop->removeEventSource(soakTimer);
+        OSSafeReleaseNULL(soakTimer);
+        
+        AbsoluteTime now;
+        UInt64 nowNs;
+        clock_get_uptime(&now);
+        absolutetime_to_nanoseconds(now, &nowNs);
+        
+        VoodooInputSoakStats stats = soakSource.getStats(nowNs);
+        setProperty(VOODOO_INPUT_SOAK_FRAMES_KEY, stats.frames, 32);
+        setProperty(VOODOO_INPUT_SOAK_ACHIEVED_RATE_KEY, stats.achieved_rate, 32);
+        setProperty(VOODOO_INPUT_SOAK_DROPPED_KEY, stats.dropped, 32);
+        setProperty(VOODOO_INPUT_SOAK_GATE_WAIT_KEY, stats.average_wait_ns / 1000, 32);
+        setProperty(VOODOO_INPUT_SOAK_WORST_GATE_WAIT_KEY, stats.worst_wait_ns / 1000, 32);
+    }
+    OSSafeReleaseNULL(soakWorkLoop);
+}
+
+void VoodooInput::soakTimerFired(IOTimerEventSource* sender) {
+    AbsoluteTime now;
+    UInt64 nowNs;
+    clock_get_uptime(&now);
+    absolutetime_to_nanoseconds(now, &nowNs);
+    
+    VoodooInputEvent event;
+    if (soakSource.nextFrame(nowNs, event)) {
+        // Same entry points the message path and the direct call interface use
+        event.timestamp = now;
+        for (int i = 0; i < event.contact_count; i++) {
+            event.transducers[i].timestamp = now;
+        }
+        
+        AbsoluteTime end;
+        UInt64 wait;
+        IOReturn result = FramePath::handleTouchFrame(*this, event);
+        clock_get_uptime(&end);
+        absolutetime_to_nanoseconds(end - now, &wait);
+        soakSource.recordDelivery(wait, result == kIOReturnSuccess);
+        
+        TrackpointReport report;
+        if (soakSource.nextTrackpoint(report)) {
+            report.timestamp = end;
+            handleTrackpointReport(report);
+        }
+    }
+    
+    AbsoluteTime deadline;
+    nanoseconds_to_absolutetime(soakSource.getNextDeadline(), &deadline);
+    sender->wakeAtTime(deadline);
+}
+
 UInt8 VoodooInput::getTransformKey() {
     return transformKey;
 }
@@ -161,58 +756,329 @@ UInt32 VoodooInput::getLogicalMaxY() {
     return logicalMaxY;
 }
 
+bool VoodooInput::getTimestampSmoothing() {
+    return timestampSmoothing;
+}
+
+bool VoodooInput::getContactSmoothing() {
+    return contactSmoothing;
+}
+
+UInt32 VoodooInput::getSmoothingMinCutoff() {
+    return smoothingMinCutoff;
+}
+
+UInt32 VoodooInput::getSmoothingBeta() {
+    return smoothingBeta;
+}
+
+bool VoodooInput::getFrameInterpolation() {
+    return frameInterpolation;
+}
+
+UInt32 VoodooInput::getInterpolationRate() {
+    return interpolationRate;
+}
+
+UInt32 VoodooInput::getInterpolationLag() {
+    return interpolationLag;
+}
+
+bool VoodooInput::getCompositeActuator() {
+    return compositeActuator;
+}
+
+bool VoodooInput::startActuatorChannel() {
+    if (!actuatorQueue.init()) {
+        return false;
+    }
+    
+    actuatorWorkLoop = getWorkLoop();
+    if (!actuatorWorkLoop) {
+        return false;
+    }
+    actuatorWorkLoop->retain();
+    
+    actuatorSource = IOInterruptEventSource::interruptEventSource(this, OSMemberFunctionCast(IOInterruptEventSource::Action, this, &VoodooInput::deliverActuatorCommands));
+    if (!actuatorSource || actuatorWorkLoop->addEventSource(actuatorSource) != kIOReturnSuccess) {
+        OSSafeReleaseNULL(actuatorSource);
+        OSSafeReleaseNULL(actuatorWorkLoop);
+        return false;
+    }
+    
+    return true;
+}
+
+void VoodooInput::stopActuatorChannel() {
+    if (actuatorSource) {
+        actuatorSource->disable();
+        actuatorWorkLoop->removeEventSource(actuatorSource);
+        OSSafeReleaseNULL(actuatorSource);
+    }
+    OSSafeReleaseNULL(actuatorWorkLoop);
+    actuatorQueue.release();
+}
+
+bool VoodooInput::startRateHintChannel() {
+    rateHintWorkLoop = getWorkLoop();
+    if (!rateHintWorkLoop) {
+        return false;
+    }
+    rateHintWorkLoop->retain();
+    
+    rateHintSource = IOInterruptEventSource::interruptEventSource(this, OSMemberFunctionCast(IOInterruptEventSource::Action, this, &VoodooInput::deliverRateHint));
+    if (!rateHintSource || rateHintWorkLoop->addEventSource(rateHintSource) != kIOReturnSuccess) {
+        OSSafeReleaseNULL(rateHintSource);
+        OSSafeReleaseNULL(rateHintWorkLoop);
+        return false;
+    }
+    
+    return true;
+}
+
+void VoodooInput::stopRateHintChannel() {
+    if (rateHintSource) {
+        rateHintSource->disable();
+        rateHintWorkLoop->removeEventSource(rateHintSource);
+        OSSafeReleaseNULL(rateHintSource);
+    }
+    OSSafeReleaseNULL(rateHintWorkLoop);
+}
+
+void VoodooInput::deliverRateHint(IOInterruptEventSource* sender, int count) {
+    // Changes that piled up since the last delivery collapse into the latest one
+    UInt64 pending = rateHintPending;
+    if (pending == rateHintSent) {
+        return;
+    }
+    rateHintSent = pending;
+    
+    VoodooInputRateHint hint {(UInt32)pending, (UInt32)(pending >> 32)};
+    setProperty(VOODOO_INPUT_SUGGESTED_SAMPLE_RATE_KEY, hint.sample_rate, 32);
+    parentProvider->message(kIOMessageVoodooInputRateHintMessage, this, &hint);
+}
+
+IOReturn VoodooInput::handleActuatorReport(IOMemoryDescriptor* report) {
+    if (!actuatorSource) {
+        return kIOReturnNotReady;
+    }
+    
+    UInt8 bytes[VOODOO_INPUT_ACTUATOR_RAW_SIZE];
+    IOByteCount length = min((UInt32)report->getLength(), (UInt32)sizeof(bytes));
+    AbsoluteTime timestamp;
+    clock_get_uptime(&timestamp);
+    
+    report->prepare();
+    length = report->readBytes(0, bytes, length);
+    report->complete();
+    
+    VoodooInputActuatorCommand command;
+    if (!MT2DecodeActuatorReport(bytes, length, timestamp, command)) {
+        return kIOReturnBadArgument;
+    }
+    
+    // A full queue drops the command, the HID family is never held up by the provider
+    if (actuatorQueue.push(command)) {
+        actuatorSource->interruptOccurred(nullptr, this, 0);
+    }
+    
+    return kIOReturnSuccess;
+}
+
+void VoodooInput::deliverActuatorCommands(IOInterruptEventSource* sender, int count) {
+    VoodooInputActuatorCommand command;
+    bool delivered = false;
+    
+    while (actuatorQueue.pop(command)) {
+        parentProvider->message(kIOMessageVoodooInputActuatorCommandMessage, this, &command);
+        
+        AbsoluteTime now;
+        UInt64 latency;
+        clock_get_uptime(&now);
+        absolutetime_to_nanoseconds(now - command.timestamp, &latency);
+        actuatorQueue.recordDelivery(latency);
+        delivered = true;
+    }
+    
+    if (!delivered) {
+        return;
+    }
+    
+    setProperty(VOODOO_INPUT_ACTUATOR_QUEUE_DEPTH_KEY, actuatorQueue.getMaxDepth(), 32);
+    setProperty(VOODOO_INPUT_ACTUATOR_COALESCED_KEY, actuatorQueue.getCoalesced(), 32);
+    setProperty(VOODOO_INPUT_ACTUATOR_DROPPED_KEY, actuatorQueue.getDropped(), 32);
+    setProperty(VOODOO_INPUT_ACTUATOR_LATENCY_KEY, actuatorQueue.getAverageLatency() / 1000, 32);
+    setProperty(VOODOO_INPUT_ACTUATOR_WORST_LATENCY_KEY, actuatorQueue.getWorstLatency() / 1000, 32);
+}
+
+void VoodooInput::requestRateHint() {
+    if (!rateHintSource) {
+        return;
+    }
+    
+    // Only on changes, and never from within the provider's submit call, it may hold its own locks here
+    const VoodooInputRateHint& hint = rateAdvisor.getHint();
+    rateHintPending = (UInt64)hint.reason << 32 | hint.sample_rate;
+    rateHintSource->interruptOccurred(nullptr, this, 0);
+}
+
+IOReturn VoodooInput::handleDimensions(const VoodooInputDimensions& dimensions) {
+    logicalMaxX = dimensions.max_x - dimensions.min_x;
+    logicalMaxY = dimensions.max_y - dimensions.min_y;
+    return kIOReturnSuccess;
+}
+
+IOReturn VoodooInput::handleTrackpointReport(const TrackpointReport& report) {
+    if (__builtin_expect(startStage != kStartStageReady, false) && holdEarlyFrame(nullptr)) {
+        return kIOReturnNotReady;
+    }
+    
+    TrackpointDevice* device = enterTrackpoint();
+    if (!device) {
+        return kIOReturnNotReady;
+    }
+    
+    if (__builtin_expect(!firstReportSent, false)) {
+        recordFirstReport();
+    }
+    
+    trace.record(kVoodooInputTraceTrackpointPacket, report.buttons, 0, ((UInt32)(UInt16)report.dx << 16) | (UInt16)report.dy);
+    device->reportPacket(report);
+    subdeviceUsers.leave(subdeviceLock);
+    return kIOReturnSuccess;
+}
+
+IOReturn VoodooInput::handleRelativePointer(const RelativePointerEvent& event) {
+    if (__builtin_expect(startStage != kStartStageReady, false) && holdEarlyFrame(nullptr)) {
+        return kIOReturnNotReady;
+    }
+    
+    TrackpointDevice* device = enterTrackpoint();
+    if (!device) {
+        return kIOReturnNotReady;
+    }
+    
+    if (__builtin_expect(!firstReportSent, false)) {
+        recordFirstReport();
+    }
+    
+    device->updateRelativePointer(event.dx, event.dy, event.buttons, event.timestamp);
+    subdeviceUsers.leave(subdeviceLock);
+    return kIOReturnSuccess;
+}
+
+IOReturn VoodooInput::handleScrollWheel(const ScrollWheelEvent& event) {
+    if (__builtin_expect(startStage != kStartStageReady, false) && holdEarlyFrame(nullptr)) {
+        return kIOReturnNotReady;
+    }
+    
+    TrackpointDevice* device = enterTrackpoint();
+    if (!device) {
+        return kIOReturnNotReady;
+    }
+    
+    if (__builtin_expect(!firstReportSent, false)) {
+        recordFirstReport();
+    }
+    
+    device->updateScrollwheel(event.deltaAxis1, event.deltaAxis2, event.deltaAxis3, event.timestamp);
+    subdeviceUsers.leave(subdeviceLock);
+    return kIOReturnSuccess;
+}
+
+IOReturn VoodooInput::interfaceSubmitTouchFrame(void* context, VoodooInputEvent* event) {
+    return event ? FramePath::handleTouchFrame(*static_cast<VoodooInput*>(context), *event) : kIOReturnBadArgument;
+}
+
+IOReturn VoodooInput::interfaceUpdateDimensions(void* context, const VoodooInputDimensions* dimensions) {
+    return dimensions ? static_cast<VoodooInput*>(context)->handleDimensions(*dimensions) : kIOReturnBadArgument;
+}
+
+IOReturn VoodooInput::interfaceSubmitTrackpointReport(void* context, const TrackpointReport* report) {
+    return report ? static_cast<VoodooInput*>(context)->handleTrackpointReport(*report) : kIOReturnBadArgument;
+}
+
+IOReturn VoodooInput::interfaceSubmitRelativePointer(void* context, const RelativePointerEvent* event) {
+    return event ? static_cast<VoodooInput*>(context)->handleRelativePointer(*event) : kIOReturnBadArgument;
+}
+
+IOReturn VoodooInput::interfaceSubmitScrollWheel(void* context, const ScrollWheelEvent* event) {
+    return event ? static_cast<VoodooInput*>(context)->handleScrollWheel(*event) : kIOReturnBadArgument;
+}
+
 IOReturn VoodooInput::message(UInt32 type, IOService *provider, void *argument) {
+    VoodooInputKdebug(kVoodooInputKdebugMessage, DBG_FUNC_NONE, type);
+    
     switch (type) {
         case kIOMessageVoodooInputMessage:
-            if (provider == parentProvider && argument && simulator)
-                simulator->constructReport(*(VoodooInputEvent*)argument);
+            if (provider == parentProvider && argument) {
+                FramePath::handleTouchFrame(*this, *(VoodooInputEvent*)argument);
+            }
+            break;
+            
+        case kIOMessageVoodooInputGetInterfaceMessage:
+            if (provider == parentProvider && argument) {
+                *(const VoodooInputInterface**)argument = &interface;
+                return kIOReturnSuccess;
+            }
+            break;
+            
+        case kIOMessageVoodooInputContactStatsMessage:
+            if (provider == parentProvider && argument) {
+                VoodooInputContactStats& stats = *(VoodooInputContactStats*)argument;
+                subdeviceUsers.enter();
+                VoodooInputSimulatorDevice* statsSimulator = simulator;
+                if (statsSimulator) {
+                    statsSimulator->copyContactStats(stats);
+                } else {
+                    memset(&stats, 0, sizeof(stats));
+                }
+                subdeviceUsers.leave(subdeviceLock);
+            }
             break;
             
         case kIOMessageVoodooInputUpdateDimensionsMessage:
             if (provider == parentProvider && argument) {
-                const VoodooInputDimensions& dimensions = *(VoodooInputDimensions*)argument;
-                logicalMaxX = dimensions.max_x - dimensions.min_x;
-                logicalMaxY = dimensions.max_y - dimensions.min_y;
+                handleDimensions(*(VoodooInputDimensions*)argument);
             }
             break;
             
         case kIOMessageVoodooInputUpdatePropertiesNotification:
-            updateProperties();
+            // Subdevices follow on the start work loop, after a bring-up still in progress
+            if (updateProperties() && startSource) {
+                startSource->interruptOccurred(nullptr, this, 0);
+            }
             break;
             
-        case kIOMessageVoodooTrackpointRelativePointer: {
-            if (trackpoint) {
-                const RelativePointerEvent& event = *(RelativePointerEvent*)argument;
-                trackpoint->updateRelativePointer(event.dx, event.dy, event.buttons, event.timestamp);
+        case kIOMessageVoodooTrackpointRelativePointer:
+            if (argument) {
+                handleRelativePointer(*(RelativePointerEvent*)argument);
             }
             break;
-        }
-        case kIOMessageVoodooTrackpointScrollWheel: {
-            if (trackpoint) {
-                const ScrollWheelEvent& event = *(ScrollWheelEvent*)argument;
-                trackpoint->updateScrollwheel(event.deltaAxis1, event.deltaAxis2, event.deltaAxis3, event.timestamp);
+        case kIOMessageVoodooTrackpointScrollWheel:
+            if (argument) {
+                handleScrollWheel(*(ScrollWheelEvent*)argument);
             }
             break;
-        }
         case kIOMessageVoodooTrackpointMessage:
-            if (trackpoint) {
-                trackpoint->reportPacket(*(TrackpointReport *)argument);
+            if (argument) {
+                handleTrackpointReport(*(TrackpointReport*)argument);
             }
             break;
-        case kIOMessageVoodooTrackpointUpdatePropertiesNotification:
-            if (trackpoint) {
-                trackpoint->updateTrackpointProperties();
+        case kIOMessageVoodooTrackpointUpdatePropertiesNotification: {
+            subdeviceUsers.enter();
+            TrackpointDevice* propertiesTrackpoint = trackpoint;
+            if (propertiesTrackpoint) {
+                propertiesTrackpoint->updateTrackpointProperties();
             }
+            subdeviceUsers.leave(subdeviceLock);
             break;
+        }
     }
 
     return super::message(type, provider, argument);
 }
 
 int VoodooInputGetProductId() {
-    if (version_major >= kVoodooInputVersionMonterey) {
-        return kVoodooInputProductMacbookAir10_1;
-    }
-    
-    return kVoodooInputProductMacbook8_1;
+    return VoodooInputGetHIDTables().profile->product_id;
 }
@@ -9,10 +9,25 @@
 #define VOODOO_INPUT_HPP
 
 #include <IOKit/IOService.h>
+#include <IOKit/IOLocks.h>
+
+#include "VoodooInputTrace.hpp"
+#include "VoodooInputRateAdvisor.hpp"
+#include "VoodooInputArena.hpp"
+#include "VoodooInputActuatorQueue.hpp"
+#include "VoodooInputFramePath.hpp"
+#include "VoodooInputSimulator/VoodooInputContactFilter.hpp"
+#include "VoodooInputSimulator/VoodooInputSoakSource.hpp"
+#include "VoodooInputSimulator/VoodooInputFrameInterpolator.hpp"
+#include "VoodooInputMultitouch/VoodooInputMessages.h"
 
 class VoodooInputSimulatorDevice;
 class VoodooInputActuatorDevice;
+class VoodooInputDigitizerDevice;
 class TrackpointDevice;
+class IOWorkLoop;
+class IOInterruptEventSource;
+class IOTimerEventSource;
 
 #ifndef EXPORT
 #define EXPORT __attribute__((visibility("default")))
@@ -25,7 +40,19 @@ class EXPORT VoodooInput : public IOService {
     
     VoodooInputSimulatorDevice* simulator;
     VoodooInputActuatorDevice* actuator;
+    VoodooInputDigitizerDevice* digitizer {nullptr};
     TrackpointDevice* trackpoint;
+    IOLock* subdeviceLock {nullptr};
+    
+    // Published under subdeviceLock and read without it, stopping a subdevice drains the users that loaded it
+    VoodooInputSubdeviceUsers subdeviceUsers;
+    bool trackpointRequested {false};
+    
+    // Written under subdeviceLock
+    UInt32 capabilities {0};
+    bool capabilitiesDeclared {false};
+    UInt32 backend {kVoodooInputBackendMagicTrackpad};
+    bool compositeActuator {false};
     
     UInt8 transformKey;
     
@@ -33,6 +60,111 @@ class EXPORT VoodooInput : public IOService {
     UInt32 logicalMaxY = 0;
     UInt32 physicalMaxX = 0;
     UInt32 physicalMaxY = 0;
+
+    bool timestampSmoothing = false;
+
+    bool contactSmoothing = false;
+    UInt32 smoothingMinCutoff = CONTACT_FILTER_DEFAULT_MIN_CUTOFF;
+    UInt32 smoothingBeta = CONTACT_FILTER_DEFAULT_BETA;
+
+    bool frameInterpolation = false;
+    UInt32 interpolationRate = FRAME_INTERPOLATOR_DEFAULT_RATE;
+    UInt32 interpolationLag = FRAME_INTERPOLATOR_DEFAULT_LAG;
+
+    VoodooInputTrace trace;
+
+    VoodooInputInterface interface {};
+
+    VoodooInputRateAdvisor rateAdvisor;
+
+    // Hints reach the provider from the work loop, the frame path only leaves the latest one here
+    IOWorkLoop* rateHintWorkLoop {nullptr};
+    IOInterruptEventSource* rateHintSource {nullptr};
+    volatile UInt64 rateHintPending {0};
+    UInt64 rateHintSent {0};
+
+    bool startRateHintChannel();
+    void stopRateHintChannel();
+    void deliverRateHint(IOInterruptEventSource* sender, int count);
+
+    VoodooInputArena arena;
+
+    // Actuation reports are delivered to the provider from here, never on the HID family thread
+    VoodooInputActuatorQueue actuatorQueue;
+    IOWorkLoop* actuatorWorkLoop {nullptr};
+    IOInterruptEventSource* actuatorSource {nullptr};
+
+    bool startActuatorChannel();
+    void stopActuatorChannel();
+    void deliverActuatorCommands(IOInterruptEventSource* sender, int count);
+
+    // Declared subdevices are brought up on their own thread, start() only waits for the provider
+    enum StartStage : UInt32 {
+        kStartStagePending,
+        kStartStageReady
+    };
+    volatile UInt32 startStage {kStartStagePending};
+    AbsoluteTime startTime {0};
+    IOWorkLoop* startWorkLoop {nullptr};
+    IOInterruptEventSource* startSource {nullptr};
+    
+    // Frames arriving before ready, by earlyFramePolicy
+    IOSimpleLock* earlyFrameLock {nullptr};
+    UInt32 earlyFramePolicy {kVoodooInputEarlyFramesDrop};
+    bool earlyFramePending {false};
+    VoodooInputEvent earlyFrame {};
+    UInt32 earlyFramesDropped {0};
+    volatile UInt32 firstReportSent {0};
+
+    bool startStaged();
+    void stopStaged();
+    void releaseStartResources();
+    void startSubdevicesStaged(IOInterruptEventSource* sender, int count);
+    bool holdEarlyFrame(const VoodooInputEvent* event);
+    void recordFirstReport();
+
+    // Soak frames come from their own thread so they wait for the gates like a provider would
+    VoodooInputSoakSource soakSource;
+    IOWorkLoop* soakWorkLoop {nullptr};
+    IOTimerEventSource* soakTimer {nullptr};
+    // Under subdeviceLock, the timer itself only changes while switching
+    bool soakRequested {false};
+    bool soakSwitching {false};
+
+    bool startSoak();
+    void stopSoak();
+    void setSoakEnabled(bool enable);
+    void soakTimerFired(IOTimerEventSource* sender);
+
+    void requestRateHint();
+
+    void setTraceEnabled(bool enable);
+
+    // Shared by the message path and the direct call interface, see VoodooInputFramePath
+    friend struct VoodooInputFramePath<VoodooInput>;
+    typedef VoodooInputFramePath<VoodooInput> FramePath;
+    IOReturn handleDimensions(const VoodooInputDimensions& dimensions);
+    IOReturn handleTrackpointReport(const TrackpointReport& report);
+    IOReturn handleRelativePointer(const RelativePointerEvent& event);
+    IOReturn handleScrollWheel(const ScrollWheelEvent& event);
+
+    static IOReturn interfaceSubmitTouchFrame(void* context, VoodooInputEvent* event);
+    static IOReturn interfaceUpdateDimensions(void* context, const VoodooInputDimensions* dimensions);
+    static IOReturn interfaceSubmitTrackpointReport(void* context, const TrackpointReport* report);
+    static IOReturn interfaceSubmitRelativePointer(void* context, const RelativePointerEvent* event);
+    static IOReturn interfaceSubmitScrollWheel(void* context, const ScrollWheelEvent* event);
+
+    TrackpointDevice* enterTrackpoint();
+    bool startSubdevice(IOService* device);
+    void stopSubdevice(IOService* device);
+    void recordAttach(const char* key, bool composite, UInt64 value);
+    bool startMultitouch(bool composite);
+    void stopMultitouch();
+    bool startDigitizer();
+    void stopDigitizer();
+    bool startTrackpoint();
+    void stopTrackpoint();
+    bool updateSubdevices();
 public:
     bool start(IOService* provider) override;
     void stop(IOService* provider) override;
@@ -46,8 +178,29 @@ public:
     UInt32 getLogicalMaxX();
     UInt32 getLogicalMaxY();
 
+    bool getTimestampSmoothing();
+
+    bool getContactSmoothing();
+    UInt32 getSmoothingMinCutoff();
+    UInt32 getSmoothingBeta();
+
+    bool getFrameInterpolation();
+    UInt32 getInterpolationRate();
+    UInt32 getInterpolationLag();
+
+    bool getCompositeActuator();
+
+    // Actuation reports from either the actuator or the composite simulator
+    IOReturn handleActuatorReport(IOMemoryDescriptor* report);
+
+    inline VoodooInputTrace& getTrace() { return trace; }
+
+    inline const VoodooInputArena& getArena() const { return arena; }
+
     bool updateProperties();
 
+    IOReturn setProperties(OSObject* properties) override;
+
     IOReturn message(UInt32 type, IOService *provider, void *argument) override;
 };
 
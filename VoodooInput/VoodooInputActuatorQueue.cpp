@@ -0,0 +1,90 @@
+//
+//  VoodooInputActuatorQueue.cpp
+//  VoodooInput
+//
+//  Copyright © 2024 Kishor Prins. All rights reserved.
+//
+
+#include "VoodooInputActuatorQueue.hpp"
+
+bool VoodooInputActuatorQueue::init() {
+    if (!lock)
+        lock = IOSimpleLockAlloc();
+    if (!lock)
+        return false;
+
+    head = 0;
+    count = 0;
+    has_strength = false;
+    max_depth = 0;
+    coalesced = 0;
+    dropped = 0;
+    average_latency_ns = 0;
+    worst_latency_ns = 0;
+    return true;
+}
+
+void VoodooInputActuatorQueue::release() {
+    if (lock) {
+        IOSimpleLockFree(lock);
+        lock = nullptr;
+    }
+}
+
+bool VoodooInputActuatorQueue::push(const VoodooInputActuatorCommand& command) {
+    bool queued = true;
+
+    IOSimpleLockLock(lock);
+
+    bool strength = command.type == kVoodooInputActuatorStrength;
+    VoodooInputActuatorCommand* tail = count ? &commands[(head + count - 1) % ACTUATOR_QUEUE_CAPACITY] : nullptr;
+
+    if (strength && has_strength && command.strength == last_strength) {
+        coalesced++;
+    } else if (strength && tail && tail->type == kVoodooInputActuatorStrength) {
+        // Nothing was queued after it, so no actuation sees the order change
+        *tail = command;
+        last_strength = command.strength;
+        coalesced++;
+    } else if (count == ACTUATOR_QUEUE_CAPACITY) {
+        dropped++;
+        queued = false;
+    } else {
+        commands[(head + count) % ACTUATOR_QUEUE_CAPACITY] = command;
+        count++;
+        if (count > max_depth)
+            max_depth = count;
+        if (strength) {
+            has_strength = true;
+            last_strength = command.strength;
+        }
+    }
+
+    IOSimpleLockUnlock(lock);
+    return queued;
+}
+
+bool VoodooInputActuatorQueue::pop(VoodooInputActuatorCommand& command) {
+    IOSimpleLockLock(lock);
+
+    bool available = count != 0;
+    if (available) {
+        command = commands[head];
+        head = (head + 1) % ACTUATOR_QUEUE_CAPACITY;
+        count--;
+    }
+
+    IOSimpleLockUnlock(lock);
+    return available;
+}
+
+void VoodooInputActuatorQueue::recordDelivery(UInt64 latency_ns) {
+    // EMA with a weight of 1/8, seeded by the first delivery
+    if (!average_latency_ns)
+        average_latency_ns = latency_ns;
+    else
+        average_latency_ns = average_latency_ns - (average_latency_ns >> 3) + (latency_ns >> 3);
+
+    if (latency_ns > worst_latency_ns)
+        worst_latency_ns = latency_ns;
+}
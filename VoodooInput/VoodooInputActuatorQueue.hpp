@@ -0,0 +1,59 @@
+//
+//  VoodooInputActuatorQueue.hpp
+//  VoodooInput
+//
+//  Copyright © 2024 Kishor Prins. All rights reserved.
+//
+
+#ifndef VOODOO_INPUT_ACTUATOR_QUEUE_HPP
+#define VOODOO_INPUT_ACTUATOR_QUEUE_HPP
+
+#include <IOKit/IOService.h>
+#include <IOKit/IOLocks.h>
+
+#include "VoodooInputMultitouch/VoodooInputEvent.h"
+
+#define ACTUATOR_QUEUE_CAPACITY 16
+
+/*
+ * Bounded queue between the HID family thread sending actuation reports and the
+ * event source delivering them to the provider. push never waits for delivery, a
+ * full queue drops the command instead. Strength updates that change nothing, or
+ * that replace one still waiting at the tail, are coalesced.
+ */
+class VoodooInputActuatorQueue {
+public:
+    bool init();
+    void release();
+
+    // False when the command was dropped
+    bool push(const VoodooInputActuatorCommand& command);
+    bool pop(VoodooInputActuatorCommand& command);
+
+    // Delivery side only
+    void recordDelivery(UInt64 latency_ns);
+
+    UInt32 getMaxDepth() const { return max_depth; }
+    UInt32 getCoalesced() const { return coalesced; }
+    UInt32 getDropped() const { return dropped; }
+    UInt64 getAverageLatency() const { return average_latency_ns; }
+    UInt64 getWorstLatency() const { return worst_latency_ns; }
+
+private:
+    IOSimpleLock* lock {nullptr};
+    VoodooInputActuatorCommand commands[ACTUATOR_QUEUE_CAPACITY] {};
+    UInt32 head {0};
+    UInt32 count {0};
+
+    // Latest strength asked for, queued or delivered
+    bool has_strength {false};
+    UInt8 last_strength {0};
+
+    UInt32 max_depth {0};
+    UInt32 coalesced {0};
+    UInt32 dropped {0};
+    UInt64 average_latency_ns {0};
+    UInt64 worst_latency_ns {0};
+};
+
+#endif // VOODOO_INPUT_ACTUATOR_QUEUE_HPP
@@ -0,0 +1,80 @@
+//
+//  VoodooInputArena.cpp
+//  VoodooInput
+//
+//  Copyright © 2024 Kishor Prins. All rights reserved.
+//
+
+#include "VoodooInputArena.hpp"
+#include "VoodooInputSimulator/VoodooInputSimulatorDevice.hpp"
+#include "VoodooInputSimulator/VoodooInputDigitizerDevice.hpp"
+#include "VoodooInputSimulator/VoodooInputHIDProfile.hpp"
+
+// Regions start on a cache line so two subdevices never share one
+#define ARENA_REGION_ALIGNMENT 64
+
+static constexpr IOByteCount region_lengths[kVoodooInputArenaRegionCount] = {
+    MT2_REPORT_MAX_SIZE,
+    sizeof(decltype(VoodooInputHIDTables::composite_descriptor)::bytes),
+    MT2_FEATURE_MAX_SIZE,
+    sizeof(decltype(VoodooInputHIDTables::actuator_descriptor)::bytes),
+    sizeof(DIGITIZER_TOUCH_REPORT) + sizeof(DIGITIZER_PEN_REPORT),
+    DIGITIZER_DESCRIPTOR_MAX_SIZE,
+};
+
+static constexpr IOByteCount regionOffset(UInt32 region) {
+    IOByteCount offset = 0;
+    for (UInt32 i = 0; i < region; i++)
+        offset += (region_lengths[i] + ARENA_REGION_ALIGNMENT - 1) & ~(IOByteCount)(ARENA_REGION_ALIGNMENT - 1);
+    return offset;
+}
+
+static constexpr IOByteCount arena_size = regionOffset(kVoodooInputArenaRegionCount);
+
+static_assert(arena_size <= 4096, "Arena no longer fits a single page");
+
+bool VoodooInputArena::init() {
+    if (memory)
+        return true;
+
+    memory = IOBufferMemoryDescriptor::inTaskWithOptions(kernel_task, kIODirectionInOut, arena_size, ARENA_REGION_ALIGNMENT);
+    if (!memory)
+        return false;
+
+    bytes = (UInt8*)memory->getBytesNoCopy();
+    // Reserved bits in reports are never written, start from a clean buffer
+    memset(bytes, 0, arena_size);
+    return true;
+}
+
+// Descriptors still held by the HID family keep the memory alive through their parent reference
+void VoodooInputArena::release() {
+    bytes = nullptr;
+    OSSafeReleaseNULL(memory);
+}
+
+UInt8* VoodooInputArena::getBytes(VoodooInputArenaRegion region) const {
+    if (!bytes || region >= kVoodooInputArenaRegionCount)
+        return nullptr;
+    return bytes + regionOffset(region);
+}
+
+IOByteCount VoodooInputArena::getLength(VoodooInputArenaRegion region) const {
+    return region < kVoodooInputArenaRegionCount ? region_lengths[region] : 0;
+}
+
+IOSubMemoryDescriptor* VoodooInputArena::newSubRange(VoodooInputArenaRegion region, IOByteCount offset, IOByteCount length) const {
+    if (!memory || offset + length > getLength(region))
+        return nullptr;
+    return IOSubMemoryDescriptor::withSubRange(memory, regionOffset(region) + offset, length, kIODirectionOut);
+}
+
+bool VoodooInputArena::retarget(IOSubMemoryDescriptor* descriptor, VoodooInputArenaRegion region, IOByteCount offset, IOByteCount length) const {
+    if (!memory || !descriptor || offset + length > getLength(region))
+        return false;
+    return descriptor->initSubRange(memory, regionOffset(region) + offset, length, kIODirectionOut);
+}
+
+IOByteCount VoodooInputArena::getFootprint() const {
+    return memory ? memory->getCapacity() : 0;
+}
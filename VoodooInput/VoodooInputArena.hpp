@@ -0,0 +1,55 @@
+//
+//  VoodooInputArena.hpp
+//  VoodooInput
+//
+//  Copyright © 2024 Kishor Prins. All rights reserved.
+//
+
+#ifndef VOODOO_INPUT_ARENA_HPP
+#define VOODOO_INPUT_ARENA_HPP
+
+#include <IOKit/IOService.h>
+#include <IOKit/IOBufferMemoryDescriptor.h>
+#include <IOKit/IOSubMemoryDescriptor.h>
+
+/* Fixed regions, each one owned by a single subdevice */
+enum VoodooInputArenaRegion : UInt32 {
+    kVoodooInputArenaSimulatorReports = 0,
+    kVoodooInputArenaSimulatorDescriptor,
+    kVoodooInputArenaSimulatorFeature,
+    kVoodooInputArenaActuatorDescriptor,
+    kVoodooInputArenaDigitizerReports,
+    kVoodooInputArenaDigitizerDescriptor,
+    kVoodooInputArenaRegionCount
+};
+
+/*
+ * One wired allocation per VoodooInput instance that the report, descriptor and
+ * feature reply buffers of all subdevices are carved from, instead of every small
+ * buffer pinning its own pages. The HID family is handed sub-range descriptors.
+ *
+ * Regions are laid out at compile time, so a subdevice that is stopped and started
+ * again gets the same bytes back. Subdevices must be stopped before release().
+ */
+class VoodooInputArena {
+public:
+    bool init();
+    void release();
+
+    UInt8* getBytes(VoodooInputArenaRegion region) const;
+    IOByteCount getLength(VoodooInputArenaRegion region) const;
+
+    // Descriptor over length bytes at offset within region, released by the caller
+    IOSubMemoryDescriptor* newSubRange(VoodooInputArenaRegion region, IOByteCount offset, IOByteCount length) const;
+    // Points an existing sub-range descriptor somewhere else without allocating
+    bool retarget(IOSubMemoryDescriptor* descriptor, VoodooInputArenaRegion region, IOByteCount offset, IOByteCount length) const;
+
+    // Bytes wired for the arena
+    IOByteCount getFootprint() const;
+
+private:
+    IOBufferMemoryDescriptor* memory {nullptr};
+    UInt8* bytes {nullptr};
+};
+
+#endif // VOODOO_INPUT_ARENA_HPP
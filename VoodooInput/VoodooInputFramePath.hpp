@@ -0,0 +1,89 @@
+//
+//  VoodooInputFramePath.hpp
+//  VoodooInput
+//
+//  Copyright © 2024 Kishor Prins. All rights reserved.
+//
+
+#ifndef VOODOO_INPUT_FRAME_PATH_HPP
+#define VOODOO_INPUT_FRAME_PATH_HPP
+
+#include <IOKit/IOService.h>
+#include <kern/clock.h>
+
+#include "VoodooInputTrace.hpp"
+#include "VoodooInputRateAdvisor.hpp"
+#include "VoodooInputSubdeviceUsers.hpp"
+#include "VoodooInputMultitouch/VoodooInputMessages.h"
+
+/*
+ * VoodooInput::handleTouchFrame and deliverTouchFrame, kept apart from the IOService so
+ * the host benchmarks run the same sequence. A frame takes no lock and no reference, the
+ * touch device it reaches is kept from stopping by subdeviceUsers.
+ *
+ * An engine provides
+ *   startStage, kStartStageReady, holdEarlyFrame(event)   frames before ready
+ *   subdeviceLock, subdeviceUsers
+ *   backend, simulator, digitizer                         published by the start and stop functions
+ *   trace, rateAdvisor, firstReportSent, recordFirstReport()
+ *   requestRateHint()                                     the advisor changed its hint
+ * and its simulator and digitizer constructReport(event), the simulator also isDegraded().
+ */
+template <typename Engine>
+struct VoodooInputFramePath {
+    static inline IOReturn handleTouchFrame(Engine& engine, VoodooInputEvent& event) {
+        if (__builtin_expect(engine.startStage != Engine::kStartStageReady, false) && engine.holdEarlyFrame(&event))
+            return kIOReturnNotReady;
+
+        return deliverTouchFrame(engine, event);
+    }
+
+    static inline IOReturn deliverTouchFrame(Engine& engine, VoodooInputEvent& event) {
+        engine.subdeviceUsers.enter();
+        bool digitizerBackend = engine.backend == kVoodooInputBackendDigitizer;
+        auto touchSimulator = digitizerBackend ? nullptr : engine.simulator;
+        auto touchDigitizer = digitizerBackend ? engine.digitizer : nullptr;
+
+        // Not declared, failed or being brought up again, the start work loop owns all of those
+        if (!touchSimulator && !touchDigitizer) {
+            engine.subdeviceUsers.leave(engine.subdeviceLock);
+            return kIOReturnNotReady;
+        }
+
+        if (digitizerBackend || !touchSimulator->isDegraded())
+            engine.trace.record(kVoodooInputTraceFrameIn, event.contact_count);
+
+        AbsoluteTime start, end;
+        clock_get_uptime(&start);
+        if (digitizerBackend)
+            touchDigitizer->constructReport(event);
+        else
+            touchSimulator->constructReport(event);
+        clock_get_uptime(&end);
+
+        engine.subdeviceUsers.leave(engine.subdeviceLock);
+
+        if (__builtin_expect(!engine.firstReportSent, false))
+            engine.recordFirstReport();
+
+        updateRateHint(engine, event, start, end);
+        return kIOReturnSuccess;
+    }
+
+    static inline void updateRateHint(Engine& engine, const VoodooInputEvent& event, AbsoluteTime start, AbsoluteTime end) {
+        UInt8 activeContacts = 0;
+        for (int i = 0; i < event.contact_count && i < VOODOO_INPUT_MAX_TRANSDUCERS; i++) {
+            if (event.transducers[i].isValid && event.transducers[i].isTransducerActive)
+                activeContacts++;
+        }
+
+        UInt64 now, delivery;
+        absolutetime_to_nanoseconds(start, &now);
+        absolutetime_to_nanoseconds(end - start, &delivery);
+
+        if (engine.rateAdvisor.update(now, activeContacts, delivery))
+            engine.requestRateHint();
+    }
+};
+
+#endif // VOODOO_INPUT_FRAME_PATH_HPP
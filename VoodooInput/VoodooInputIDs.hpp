@@ -14,6 +14,10 @@ constexpr int kVoodooInputProductMacbook8_1 = 0x272;
 constexpr int kVoodooInputProductMacbookAir10_1 = 0x281;
 constexpr int kVoodooInputVendorApple = 0x5ac;
 
+// pid.codes test ids, the digitizer must not match anything that loads for Apple trackpads
+constexpr int kVoodooInputVendorDigitizer = 0x1209;
+constexpr int kVoodooInputProductDigitizer = 0x0001;
+
 constexpr int kVoodooInputVersionMonterey = 21;
 
 int VoodooInputGetProductId();
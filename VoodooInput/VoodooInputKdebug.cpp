@@ -0,0 +1,14 @@
+//
+//  VoodooInputKdebug.cpp
+//  VoodooInput
+//
+//  Copyright © 2024 Kishor Prins. All rights reserved.
+//
+
+#include "VoodooInputKdebug.hpp"
+
+volatile bool VoodooInputKdebugEnabled = false;
+
+void VoodooInputKdebugEmit(UInt32 debugid, uintptr_t arg1, uintptr_t arg2, uintptr_t arg3, uintptr_t arg4) {
+    kernel_debug(debugid, arg1, arg2, arg3, arg4, 0);
+}
@@ -0,0 +1,58 @@
+//
+//  VoodooInputKdebug.hpp
+//  VoodooInput
+//
+//  Copyright © 2024 Kishor Prins. All rights reserved.
+//
+
+#ifndef VOODOO_INPUT_KDEBUG_HPP
+#define VOODOO_INPUT_KDEBUG_HPP
+
+#include <IOKit/IOService.h>
+#include <sys/kdebug.h>
+
+#ifndef DBG_THIRD_PARTY
+#define DBG_THIRD_PARTY 37
+#endif
+
+// Subclass 'V' of the third party class
+#define VOODOO_INPUT_KDEBUG_SUBCLASS 0x56
+
+/*
+ * kdebug codes, stable across releases so system wide traces (ktrace, Instruments)
+ * can be lined up with scheduler and WindowServer activity. Names for ktrace are in
+ * Scripts/voodooinput.codes, keep both in sync.
+ *
+ *   code  debugid     point                                      args
+ *   1     0x25560004  VoodooInput::message entry                 message type
+ *   2     0x25560008  command gate in MT2 encoder submit, START  contact count, attempt only
+ *                     before asking for it, END once it returned
+ *   3     0x2556000C  MT2 encoder constructReport START / END    contact count
+ *   4     0x25560010  MT2 encoder sendReport                     report length, touch active
+ *   5     0x25560014  lift off synthesis                         contact count
+ *   6     0x25560018  TrackpointReportPacket, raw reports        dx, dy, buttons
+ */
+enum VoodooInputKdebugCode : UInt32 {
+    kVoodooInputKdebugMessage = 1,
+    kVoodooInputKdebugGate,
+    kVoodooInputKdebugFrame,
+    kVoodooInputKdebugReport,
+    kVoodooInputKdebugLiftOff,
+    kVoodooInputKdebugTrackpoint,
+};
+
+#define VOODOO_INPUT_KDEBUG_ID(code) KDBG_CODE(DBG_THIRD_PARTY, VOODOO_INPUT_KDEBUG_SUBCLASS, code)
+
+// Set through "VoodooInput Kdebug"
+extern volatile bool VoodooInputKdebugEnabled;
+
+// The only place that talks to kdebug, a host build can link a recording emitter instead
+void VoodooInputKdebugEmit(UInt32 debugid, uintptr_t arg1, uintptr_t arg2, uintptr_t arg3, uintptr_t arg4);
+
+// A load and a not taken branch while disabled
+static inline void VoodooInputKdebug(UInt32 code, UInt32 function = DBG_FUNC_NONE, uintptr_t arg1 = 0, uintptr_t arg2 = 0, uintptr_t arg3 = 0, uintptr_t arg4 = 0) {
+    if (__builtin_expect(VoodooInputKdebugEnabled, false))
+        VoodooInputKdebugEmit(VOODOO_INPUT_KDEBUG_ID(code) | function, arg1, arg2, arg3, arg4);
+}
+
+#endif // VOODOO_INPUT_KDEBUG_HPP
@@ -25,14 +25,14 @@ struct VoodooInputDimensions {
 };
 
 struct RelativePointerEvent {
-    uint64_t timestamp;
+    AbsoluteTime timestamp;
     int dx;
     int dy;
     int buttons;
 };
 
 struct ScrollWheelEvent {
-    uint64_t timestamp;
+    AbsoluteTime timestamp;
     short deltaAxis1;
     short deltaAxis2;
     short deltaAxis3;
@@ -45,4 +45,60 @@ struct TrackpointReport {
     UInt32 buttons;
 };
 
+struct VoodooInputContactVelocity {
+    // secondaryId of the transducer, as the provider sent it
+    UInt32 id;
+    // Logical units per second
+    SInt32 vx;
+    SInt32 vy;
+};
+
+struct VoodooInputContactStats {
+    AbsoluteTime timestamp;
+    UInt8 contact_count;
+    UInt32 centroid_x;
+    UInt32 centroid_y;
+    UInt32 min_x;
+    UInt32 min_y;
+    UInt32 max_x;
+    UInt32 max_y;
+    // Mean Manhattan distance of the contacts to the centroid
+    UInt32 spread;
+    VoodooInputContactVelocity velocities[VOODOO_INPUT_MAX_TRANSDUCERS];
+};
+
+enum VoodooInputRateHintReason {
+    kVoodooInputRateHintFull = 0,
+    kVoodooInputRateHintIdle,
+    kVoodooInputRateHintThrottle,
+};
+
+struct VoodooInputRateHint {
+    // Suggested sample rate in Hz, 0 means the native (maximum) rate of the provider
+    UInt32 sample_rate;
+    UInt32 reason;
+};
+
+enum VoodooInputActuatorCommandType {
+    // One shot click waveform
+    kVoodooInputActuatorActuate = 1,
+    // Persistent actuation strength, only the latest one matters
+    kVoodooInputActuatorStrength,
+    // Anything else, see raw
+    kVoodooInputActuatorUnknown,
+};
+
+#define VOODOO_INPUT_ACTUATOR_RAW_SIZE 16
+
+struct VoodooInputActuatorCommand {
+    // When macOS sent the report
+    AbsoluteTime timestamp;
+    UInt32 type;
+    UInt8 waveform;
+    UInt8 strength;
+    // Leading bytes of the 0x53 report including its id, for commands this does not decode
+    UInt8 raw_length;
+    UInt8 raw[VOODOO_INPUT_ACTUATOR_RAW_SIZE];
+};
+
 #endif /* VoodooInputEvent_h */
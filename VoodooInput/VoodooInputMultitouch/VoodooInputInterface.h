@@ -0,0 +1,47 @@
+//
+//  VoodooInputInterface.h
+//  VooodooInput
+//
+//  Copyright © 2024 Kishor Prins. All rights reserved.
+//
+
+#ifndef VOODOO_INPUT_INTERFACE_H
+#define VOODOO_INPUT_INTERFACE_H
+
+#include "VoodooInputEvent.h"
+
+/*
+ * Direct call interface, an alternative to IOService::message for the hot paths.
+ *
+ * Once VOODOO_INPUT_IDENTIFIER has matched, a provider may ask for the table once:
+ *
+ *     const VoodooInputInterface* interface = nullptr;
+ *     voodooInputInstance->message(kIOMessageVoodooInputGetInterfaceMessage, this, &interface);
+ *
+ * Older VoodooInput versions leave the pointer untouched, so a null pointer (or a version or
+ * size smaller than what the provider needs) means the message path must be used instead.
+ * The table stays valid for as long as the VoodooInput instance is attached to the provider
+ * and must be dropped together with the instance pointer.
+ *
+ * Fields are only ever appended. version is bumped when entries are added, and size tells how
+ * much of the structure the running VoodooInput actually provides.
+ */
+#define VOODOO_INPUT_INTERFACE_VERSION 1
+
+struct VoodooInputInterface {
+    UInt32 version;
+    UInt32 size;
+    void* context;
+
+    // Version 1
+    IOReturn (*submitTouchFrame)(void* context, VoodooInputEvent* event);
+    IOReturn (*updateDimensions)(void* context, const VoodooInputDimensions* dimensions);
+    IOReturn (*submitTrackpointReport)(void* context, const TrackpointReport* report);
+    IOReturn (*submitRelativePointer)(void* context, const RelativePointerEvent* event);
+    IOReturn (*submitScrollWheel)(void* context, const ScrollWheelEvent* event);
+};
+
+#define VOODOO_INPUT_INTERFACE_HAS(interface, field) \
+    ((interface) != nullptr && (interface)->size >= offsetof(VoodooInputInterface, field) + sizeof((interface)->field))
+
+#endif /* VoodooInputInterface_h */
@@ -16,10 +16,101 @@
 #define VOODOO_INPUT_PHYSICAL_MAX_X_KEY "Physical Max X"
 #define VOODOO_INPUT_PHYSICAL_MAX_Y_KEY "Physical Max Y"
 
+// Optional, when declared nothing else is created. Without it the touch device comes up at start, the trackpoint with its first packet.
+#define VOODOO_INPUT_CAPABILITIES_KEY "VoodooInput Capabilities"
+#define kVoodooInputCapabilityMultitouch (1 << 0)
+#define kVoodooInputCapabilityTrackpoint (1 << 1)
+
+// Optional, device touch frames are emulated as, styluses are only reported by the digitizer
+#define VOODOO_INPUT_BACKEND_KEY "VoodooInput Backend"
+#define kVoodooInputBackendMagicTrackpad 0
+#define kVoodooInputBackendDigitizer 1
+
+// Optional, the simulator also carries the actuator collection instead of a second HID device
+#define VOODOO_INPUT_COMPOSITE_ACTUATOR_KEY "VoodooInput Composite Actuator"
+// Time in us the last simulator (and actuator) bring up took, under "Composite" or "Separate"
+#define VOODOO_INPUT_MULTITOUCH_ATTACH_TIME_KEY "Multitouch Attach Time"
+// Class sizes of the objects in the service plane from the simulator (and actuator) down plus their report
+// descriptor lengths at the end of the bring up, keyed like the time. A size to compare the modes by, not the
+// memory allocated or wired. HID elements and drivers matched later are not included.
+#define VOODOO_INPUT_MULTITOUCH_ATTACH_OBJECTS_SIZE_KEY "Multitouch Attach Objects Size"
+
+// Optional, what happens to frames sent before the declared subdevices are up
+#define VOODOO_INPUT_EARLY_FRAMES_KEY "VoodooInput Early Frames"
+#define kVoodooInputEarlyFramesDrop 0
+// Only the latest touch frame is kept, trackpoint packets are always dropped
+#define kVoodooInputEarlyFramesBuffer 1
+// Published once bring up is done, a subdevice that could not be brought up stays down until the next property update
+#define VOODOO_INPUT_READY_KEY "VoodooInput Ready"
+// Time in us from start until ready, and in ms from boot until the first frame reached a subdevice
+#define VOODOO_INPUT_READY_TIME_KEY "Ready Time"
+#define VOODOO_INPUT_FIRST_REPORT_TIME_KEY "First Report Time"
+#define VOODOO_INPUT_EARLY_FRAMES_DROPPED_KEY "Early Frames Dropped"
+
+// Actuator command queue statistics, latencies in us
+#define VOODOO_INPUT_ACTUATOR_QUEUE_DEPTH_KEY "Actuator Queue Depth"
+#define VOODOO_INPUT_ACTUATOR_COALESCED_KEY "Actuator Commands Coalesced"
+#define VOODOO_INPUT_ACTUATOR_DROPPED_KEY "Actuator Commands Dropped"
+#define VOODOO_INPUT_ACTUATOR_LATENCY_KEY "Actuator Delivery Latency"
+#define VOODOO_INPUT_ACTUATOR_WORST_LATENCY_KEY "Actuator Worst Delivery Latency"
+
+#define VOODOO_INPUT_TIMESTAMP_SMOOTHING_KEY "Timestamp Smoothing"
+#define VOODOO_INPUT_SAMPLE_RATE_KEY "Sample Rate"
+#define VOODOO_INPUT_SAMPLE_JITTER_KEY "Sample Jitter"
+
+// Optional per contact One Euro filter, cutoff in mHz and beta in mHz per MT2 unit/s
+#define VOODOO_INPUT_CONTACT_SMOOTHING_KEY "Contact Smoothing"
+#define VOODOO_INPUT_SMOOTHING_MIN_CUTOFF_KEY "Smoothing Min Cutoff"
+#define VOODOO_INPUT_SMOOTHING_BETA_KEY "Smoothing Beta"
+
+// Optional upsampling of simulator touch frames for low rate providers, rate in Hz and lag in ms
+#define VOODOO_INPUT_FRAME_INTERPOLATION_KEY "Frame Interpolation"
+#define VOODOO_INPUT_INTERPOLATION_RATE_KEY "Interpolation Rate"
+#define VOODOO_INPUT_INTERPOLATION_LAG_KEY "Interpolation Lag"
+
+#define VOODOO_INPUT_FRAME_OVERRUNS_KEY "Frame Overruns"
+#define VOODOO_INPUT_WORST_FRAME_STALL_KEY "Worst Frame Stall"
+#define VOODOO_INPUT_DEGRADED_MODE_SWITCHES_KEY "Degraded Mode Switches"
+#define VOODOO_INPUT_ARENA_FOOTPRINT_KEY "Arena Footprint"
+
+// Rate hints, providers may set the idle rate (0 disables idle hints) and read the suggestion back
+#define VOODOO_INPUT_IDLE_SAMPLE_RATE_KEY "Idle Sample Rate"
+#define VOODOO_INPUT_SUGGESTED_SAMPLE_RATE_KEY "Suggested Sample Rate"
+
+#define VOODOO_INPUT_TRACE_KEY "VoodooInput Trace"
+#define VOODOO_INPUT_TRACE_DUMP_KEY "VoodooInput Trace Dump"
+// Emits the kdebug tracepoints listed in VoodooInputKdebug.hpp, shared by all instances
+#define VOODOO_INPUT_KDEBUG_KEY "VoodooInput Kdebug"
+
+// Optional built-in input source for soak tests, set on the provider like the other keys. The scenario is a VoodooInputGestureScenario
+#define VOODOO_INPUT_SOAK_KEY "VoodooInput Soak"
+#define VOODOO_INPUT_SOAK_SCENARIO_KEY "Soak Scenario"
+#define VOODOO_INPUT_SOAK_RATE_KEY "Soak Rate"
+#define VOODOO_INPUT_SOAK_CONTACTS_KEY "Soak Contacts"
+#define VOODOO_INPUT_SOAK_TRACKPOINT_KEY "Soak Trackpoint"
+// Published when the soak source stops, waits in us
+#define VOODOO_INPUT_SOAK_FRAMES_KEY "Soak Frames"
+#define VOODOO_INPUT_SOAK_ACHIEVED_RATE_KEY "Soak Achieved Rate"
+#define VOODOO_INPUT_SOAK_DROPPED_KEY "Soak Dropped Frames"
+#define VOODOO_INPUT_SOAK_GATE_WAIT_KEY "Soak Gate Wait"
+#define VOODOO_INPUT_SOAK_WORST_GATE_WAIT_KEY "Soak Worst Gate Wait"
+
 #define VOODOO_INPUT_MAX_TRANSDUCERS 10
 #define kIOMessageVoodooInputMessage 12345
 #define kIOMessageVoodooInputUpdateDimensionsMessage 12346
 #define kIOMessageVoodooInputUpdatePropertiesNotification 12347
+// Fills the VoodooInputContactStats passed as argument with the statistics of the last frame
+#define kIOMessageVoodooInputContactStatsMessage 12348
+// Stores a const VoodooInputInterface* to the direct call table in the argument, see VoodooInputInterface.h
+#define kIOMessageVoodooInputGetInterfaceMessage 12349
+// Sent by VoodooInput to its provider with a VoodooInputRateHint whenever the suggested rate changes.
+// It arrives from the provider's work loop shortly after the frame that caused it, never from within
+// the submit call, and only the latest hint is sent when several changes happen in between.
+#define kIOMessageVoodooInputRateHintMessage 12350
+// Sent by VoodooInput to its provider with a VoodooInputActuatorCommand for every actuation report macOS sends
+#define kIOMessageVoodooInputActuatorCommandMessage 12351
+// Sent by VoodooInput to its provider without argument once bring up is done
+#define kIOMessageVoodooInputReadyMessage 12352
 #define kIOMessageVoodooTrackpointRelativePointer iokit_vendor_specific_msg(430)
 #define kIOMessageVoodooTrackpointScrollWheel iokit_vendor_specific_msg(431)
 #define kIOMessageVoodooTrackpointMessage iokit_vendor_specific_msg(432)
@@ -42,7 +133,13 @@
 #define VOODOO_TRACKPOINT_SCROLL_DIV_X "Scroll Divisor X"
 #define VOODOO_TRACKPOINT_SCROLL_DIV_Y "Scroll Divisor Y"
 
+// Optional, apply to every pointer event of the trackpoint device, off when missing
+#define VOODOO_TRACKPOINT_ACCEL_DIV "Acceleration Divisor"
+#define VOODOO_TRACKPOINT_SMOOTHING "Smoothing"
+#define VOODOO_TRACKPOINT_COALESCE_INTERVAL "Coalesce Interval"
+
 #include "VoodooInputTransducer.h"
 #include "VoodooInputEvent.h"
+#include "VoodooInputInterface.h"
 
 #endif /* VoodooInputMessages_h */
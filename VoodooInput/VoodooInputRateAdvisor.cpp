@@ -0,0 +1,61 @@
+//
+//  VoodooInputRateAdvisor.cpp
+//  VoodooInput
+//
+//  Copyright © 2024 Kishor Prins. All rights reserved.
+//
+
+#include "VoodooInputRateAdvisor.hpp"
+
+// Frame gaps above this are pauses in the stream, not a slower rate
+#define RATE_ADVISOR_MAX_PERIOD_NS (100ULL * 1000000ULL)
+
+void VoodooInputRateAdvisor::reset() {
+    last_frame_ns = last_contact_ns = 0;
+    period_ns = delivery_avg_ns = 0;
+    hint = {0, kVoodooInputRateHintFull};
+}
+
+bool VoodooInputRateAdvisor::setHint(UInt32 sample_rate, UInt32 reason) {
+    if (hint.sample_rate == sample_rate && hint.reason == reason)
+        return false;
+
+    hint.sample_rate = sample_rate;
+    hint.reason = reason;
+    return true;
+}
+
+bool VoodooInputRateAdvisor::update(UInt64 now_ns, UInt8 active_contacts, UInt64 delivery_ns) {
+    UInt64 gap = last_frame_ns && now_ns > last_frame_ns ? now_ns - last_frame_ns : 0;
+    last_frame_ns = now_ns;
+
+    // Only learn the period at the native rate, a throttled or idle provider would skew it
+    if (hint.reason == kVoodooInputRateHintFull && gap && gap < RATE_ADVISOR_MAX_PERIOD_NS)
+        period_ns = period_ns ? period_ns - period_ns / 8 + gap / 8 : gap;
+
+    delivery_avg_ns = delivery_avg_ns - delivery_avg_ns / 8 + delivery_ns / 8;
+
+    if (active_contacts || !last_contact_ns)
+        last_contact_ns = now_ns;
+
+    if (!active_contacts) {
+        if (idle_rate && now_ns - last_contact_ns >= RATE_ADVISOR_IDLE_TIMEOUT_NS)
+            return setHint(idle_rate, kVoodooInputRateHintIdle);
+
+        // Backlog is only worth acting on while someone is touching
+        return hint.reason == kVoodooInputRateHintThrottle ? setHint(0, kVoodooInputRateHintFull) : false;
+    }
+
+    if (!period_ns)
+        return setHint(0, kVoodooInputRateHintFull);
+
+    if (delivery_avg_ns > period_ns * 3 / 4) {
+        UInt32 rate = (UInt32)(1000000000ULL / period_ns / 2);
+        return setHint(rate ? rate : 1, kVoodooInputRateHintThrottle);
+    }
+
+    if (hint.reason == kVoodooInputRateHintThrottle && delivery_avg_ns > period_ns / 2)
+        return false;
+
+    return setHint(0, kVoodooInputRateHintFull);
+}
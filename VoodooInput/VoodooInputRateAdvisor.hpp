@@ -0,0 +1,51 @@
+//
+//  VoodooInputRateAdvisor.hpp
+//  VoodooInput
+//
+//  Copyright © 2024 Kishor Prins. All rights reserved.
+//
+
+#ifndef VOODOO_INPUT_RATE_ADVISOR_HPP
+#define VOODOO_INPUT_RATE_ADVISOR_HPP
+
+#include <IOKit/IOService.h>
+
+#include "VoodooInputMultitouch/VoodooInputEvent.h"
+
+#define RATE_ADVISOR_DEFAULT_IDLE_RATE 20
+#define RATE_ADVISOR_IDLE_TIMEOUT_NS (2000ULL * 1000000ULL)
+
+/*
+ * Decides which sample rate to suggest to the provider from the frames it sends
+ * and the time each frame takes to be delivered to the HID stack:
+ *
+ *  - idle rate once no contact has been seen for RATE_ADVISOR_IDLE_TIMEOUT_NS,
+ *  - native rate again on the first contact,
+ *  - half the measured rate while delivery takes more than 3/4 of a frame period,
+ *    until it falls under 1/2 of it.
+ *
+ * Time is passed in by the caller, so the policy can be replayed against any clock.
+ */
+class VoodooInputRateAdvisor {
+public:
+    void reset();
+    void setIdleRate(UInt32 rate) { idle_rate = rate; }
+
+    // Returns true when the suggested rate changed
+    bool update(UInt64 now_ns, UInt8 active_contacts, UInt64 delivery_ns);
+
+    const VoodooInputRateHint& getHint() const { return hint; }
+
+private:
+    UInt32 idle_rate {RATE_ADVISOR_DEFAULT_IDLE_RATE};
+    UInt64 last_frame_ns {0};
+    UInt64 last_contact_ns {0};
+    // Frame period at the native rate and average delivery time, both in ns
+    UInt64 period_ns {0};
+    UInt64 delivery_avg_ns {0};
+    VoodooInputRateHint hint {0, kVoodooInputRateHintFull};
+
+    bool setHint(UInt32 sample_rate, UInt32 reason);
+};
+
+#endif // VOODOO_INPUT_RATE_ADVISOR_HPP
@@ -0,0 +1,61 @@
+//
+//  VoodooInputActuatorCodec.hpp
+//  VoodooInput
+//
+//  Copyright © 2024 Kishor Prins. All rights reserved.
+//
+
+#ifndef VOODOO_INPUT_ACTUATOR_CODEC_HPP
+#define VOODOO_INPUT_ACTUATOR_CODEC_HPP
+
+#include <IOKit/IOService.h>
+
+#include "../VoodooInputMultitouch/VoodooInputEvent.h"
+#include "VoodooInputHIDProfile.hpp"
+
+#define MT2_ACTUATOR_COMMAND_ACTUATE 0x01
+#define MT2_ACTUATOR_COMMAND_STRENGTH 0x02
+
+/*
+ * Decodes the 0x53 actuation output report.
+ *
+ * Source: Apple does not document this report. Only its id and its 63 payload bytes are
+ * known for certain, from the descriptor of the trackpad this emulation reproduces (see
+ * buildActuatorDescriptor). The byte meanings below are this project's working
+ * assumption and have not been checked against captures from real hardware:
+ *
+ *   [0] report id, MT2_ACTUATOR_REPORT_ID
+ *   [1] command, MT2_ACTUATOR_COMMAND_*
+ *   [2] waveform id (actuate) or strength (strength)
+ *   [3] strength (actuate)
+ *
+ * That is why the leading bytes always go along in raw, and why unrecognised commands
+ * or ones too short for their fields are still forwarded as kVoodooInputActuatorUnknown.
+ * Providers that know their hardware better can interpret raw themselves. Has no kernel
+ * dependencies beyond the types, so it can be exercised outside of a kext.
+ */
+inline bool MT2DecodeActuatorReport(const UInt8* report, size_t length, AbsoluteTime timestamp, VoodooInputActuatorCommand& command) {
+    if (length < 2 || report[0] != MT2_ACTUATOR_REPORT_ID)
+        return false;
+
+    command = {};
+    command.timestamp = timestamp;
+    command.raw_length = (UInt8)(length < VOODOO_INPUT_ACTUATOR_RAW_SIZE ? length : VOODOO_INPUT_ACTUATOR_RAW_SIZE);
+    for (size_t i = 0; i < command.raw_length; i++)
+        command.raw[i] = report[i];
+
+    if (report[1] == MT2_ACTUATOR_COMMAND_ACTUATE && length >= 4) {
+        command.type = kVoodooInputActuatorActuate;
+        command.waveform = report[2];
+        command.strength = report[3];
+    } else if (report[1] == MT2_ACTUATOR_COMMAND_STRENGTH && length >= 3) {
+        command.type = kVoodooInputActuatorStrength;
+        command.strength = report[2];
+    } else {
+        command.type = kVoodooInputActuatorUnknown;
+    }
+
+    return true;
+}
+
+#endif // VOODOO_INPUT_ACTUATOR_CODEC_HPP
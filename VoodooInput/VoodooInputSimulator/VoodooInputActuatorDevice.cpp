@@ -7,26 +7,42 @@
 
 #include "VoodooInputActuatorDevice.hpp"
 #include "VoodooInputIDs.hpp"
+#include "VoodooInputHIDProfile.hpp"
+#include "../VoodooInput.hpp"
 
 #define super IOHIDDevice
 OSDefineMetaClassAndStructors(VoodooInputActuatorDevice, IOHIDDevice);
 
-const unsigned char actuator_report_descriptor[] = {0x06, 0x00, 0xff, 0x09, 0x0d, 0xa1, 0x01, 0x06, 0x00, 0xff, 0x09, 0x0d, 0x15, 0x00, 0x26, 0xff, 0x00, 0x75, 0x08, 0x85, 0x3f, 0x96, 0x0f, 0x00, 0x81, 0x02, 0x09, 0x0d, 0x85, 0x53, 0x96, 0x3f, 0x00, 0x91, 0x02, 0xc0};
-
 IOReturn VoodooInputActuatorDevice::setReport(IOMemoryDescriptor* report, IOHIDReportType reportType, IOOptionBits options) {
-    return kIOReturnSuccess;
+    VoodooInput* engine = OSDynamicCast(VoodooInput, getProvider());
+    
+    if (!engine || reportType != kIOHIDReportTypeOutput || (options & 0xFF) != MT2_ACTUATOR_REPORT_ID) {
+        return kIOReturnSuccess;
+    }
+    
+    return engine->handleActuatorReport(report);
 }
 
 IOReturn VoodooInputActuatorDevice::newReportDescriptor(IOMemoryDescriptor** descriptor) const {
-    IOBufferMemoryDescriptor* report_descriptor_buffer = IOBufferMemoryDescriptor::inTaskWithOptions(kernel_task, 0, sizeof(actuator_report_descriptor));
+    const VoodooInputHIDBytes<64>& actuator_report_descriptor = VoodooInputGetHIDTables().actuator_descriptor;
+    VoodooInput* engine = OSDynamicCast(VoodooInput, getProvider());
+    
+    if (!engine) {
+        return kIOReturnNotReady;
+    }
+    
+    const VoodooInputArena& arena = engine->getArena();
+    UInt8* report_descriptor_bytes = arena.getBytes(kVoodooInputArenaActuatorDescriptor);
+    IOSubMemoryDescriptor* report_descriptor_range = arena.newSubRange(kVoodooInputArenaActuatorDescriptor, 0, actuator_report_descriptor.length);
     
-    if (!report_descriptor_buffer) {
+    if (!report_descriptor_bytes || !report_descriptor_range) {
         IOLog("%s Could not allocate buffer for report descriptor\n", getName());
+        OSSafeReleaseNULL(report_descriptor_range);
         return kIOReturnNoResources;
     }
     
-    report_descriptor_buffer->writeBytes(0, actuator_report_descriptor, sizeof(actuator_report_descriptor));
-    *descriptor = report_descriptor_buffer;
+    memcpy(report_descriptor_bytes, actuator_report_descriptor.bytes, actuator_report_descriptor.length);
+    *descriptor = report_descriptor_range;
     
     return kIOReturnSuccess;
 }
@@ -68,5 +84,5 @@ OSNumber* VoodooInputActuatorDevice::newLocationIDNumber() const {
 }
 
 OSNumber* VoodooInputActuatorDevice::newVersionNumber() const {
-    return OSNumber::withNumber(0x804, 32);
+    return OSNumber::withNumber(VoodooInputGetHIDTables().profile->version, 32);
 }
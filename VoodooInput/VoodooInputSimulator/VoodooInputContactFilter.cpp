@@ -0,0 +1,105 @@
+//
+//  VoodooInputContactFilter.cpp
+//  VoodooInput
+//
+//  Copyright © 2024 Kishor Prins. All rights reserved.
+//
+
+#include "VoodooInputContactFilter.hpp"
+
+// 2 pi in Q16
+#define TWO_PI_Q16 411775ULL
+#define POSITION_SHIFT 8
+
+// Smoothing factor dt / (dt + 1 / (2 pi fc)) in Q16
+static UInt32 alpha(UInt32 cutoff_mhz, UInt32 dt_us) {
+    UInt64 w = TWO_PI_Q16 * cutoff_mhz * dt_us / 1000000000ULL;
+    return (UInt32)((w << 16) / (w + (1 << 16)));
+}
+
+static SInt32 lowPass(SInt32 previous, SInt32 value, UInt32 alpha_q16) {
+    return previous + (SInt32)((((SInt64)value - previous) * alpha_q16) >> 16);
+}
+
+// MT2 units per second between two positions, a tiny dt must not blow past SInt32
+static SInt32 speed(SInt32 from, SInt32 to, UInt32 dt_us) {
+    if (dt_us < CONTACT_FILTER_MIN_DT_US)
+        dt_us = CONTACT_FILTER_MIN_DT_US;
+
+    SInt64 value = (((SInt64)to - from) * 1000000 / dt_us) >> POSITION_SHIFT;
+    if (value > CONTACT_FILTER_MAX_SPEED)
+        return CONTACT_FILTER_MAX_SPEED;
+    if (value < -CONTACT_FILTER_MAX_SPEED)
+        return -CONTACT_FILTER_MAX_SPEED;
+    return (SInt32)value;
+}
+
+static SInt32 clampLag(SInt32 filtered, SInt32 raw) {
+    const SInt32 max_lag = CONTACT_FILTER_MAX_LAG << POSITION_SHIFT;
+    if (filtered > raw + max_lag)
+        return raw + max_lag;
+    if (filtered < raw - max_lag)
+        return raw - max_lag;
+    return filtered;
+}
+
+static UInt32 magnitude(SInt32 value) {
+    return value < 0 ? (UInt32)-value : (UInt32)value;
+}
+
+void VoodooInputContactFilter::configure(UInt32 min_cutoff_mhz, UInt32 new_beta) {
+    min_cutoff = min_cutoff_mhz ? min_cutoff_mhz : 1;
+    beta = new_beta;
+}
+
+void VoodooInputContactFilter::reset() {
+    for (UInt8 i = 0; i < CONTACT_FILTER_SLOTS; i++)
+        reset(i);
+}
+
+void VoodooInputContactFilter::reset(UInt8 slot) {
+    if (slot < CONTACT_FILTER_SLOTS)
+        slots[slot].primed = false;
+}
+
+void VoodooInputContactFilter::update(UInt8 slot, UInt32 time_us, SInt32& x, SInt32& y) {
+    if (slot >= CONTACT_FILTER_SLOTS)
+        return;
+
+    Slot& state = slots[slot];
+    SInt32 raw_x = x << POSITION_SHIFT;
+    SInt32 raw_y = y << POSITION_SHIFT;
+    UInt32 dt_us = time_us - state.time_us;
+
+    if (!state.primed || dt_us == 0 || dt_us > CONTACT_FILTER_MAX_GAP_US) {
+        // A repeated timestamp carries no speed information, keep the last output
+        if (state.primed && dt_us == 0) {
+            x = state.x >> POSITION_SHIFT;
+            y = state.y >> POSITION_SHIFT;
+            return;
+        }
+        state = {raw_x, raw_y, 0, 0, time_us, true};
+        return;
+    }
+
+    // Speed in MT2 units per second, smoothed with a fixed cutoff
+    UInt32 derivative_alpha = alpha(CONTACT_FILTER_DERIVATIVE_CUTOFF, dt_us);
+    state.dx = lowPass(state.dx, speed(state.x, raw_x, dt_us), derivative_alpha);
+    state.dy = lowPass(state.dy, speed(state.y, raw_y, dt_us), derivative_alpha);
+
+    UInt64 cutoff = min_cutoff + (UInt64)beta * getSpeed(slot);
+    UInt32 position_alpha = alpha(cutoff < CONTACT_FILTER_MAX_CUTOFF ? (UInt32)cutoff : CONTACT_FILTER_MAX_CUTOFF, dt_us);
+
+    state.x = clampLag(lowPass(state.x, raw_x, position_alpha), raw_x);
+    state.y = clampLag(lowPass(state.y, raw_y, position_alpha), raw_y);
+    state.time_us = time_us;
+
+    x = state.x >> POSITION_SHIFT;
+    y = state.y >> POSITION_SHIFT;
+}
+
+UInt32 VoodooInputContactFilter::getSpeed(UInt8 slot) const {
+    if (slot >= CONTACT_FILTER_SLOTS || !slots[slot].primed)
+        return 0;
+    return magnitude(slots[slot].dx) + magnitude(slots[slot].dy);
+}
@@ -0,0 +1,60 @@
+//
+//  VoodooInputContactFilter.hpp
+//  VoodooInput
+//
+//  Copyright © 2024 Kishor Prins. All rights reserved.
+//
+
+#ifndef VOODOO_INPUT_CONTACT_FILTER_HPP
+#define VOODOO_INPUT_CONTACT_FILTER_HPP
+
+#include <IOKit/IOService.h>
+
+// One slot per MT2 touch id
+#define CONTACT_FILTER_SLOTS 15
+// Cutoffs in mHz, beta in mHz per MT2 unit/s of speed
+#define CONTACT_FILTER_DEFAULT_MIN_CUTOFF 1000
+#define CONTACT_FILTER_DEFAULT_BETA 7
+#define CONTACT_FILTER_DERIVATIVE_CUTOFF 1000
+#define CONTACT_FILTER_MAX_CUTOFF 1000000
+// A slot that was not updated for this long starts over from the raw position
+#define CONTACT_FILTER_MAX_GAP_US 100000
+// The filtered position never trails the raw one by more than this, in MT2 units
+#define CONTACT_FILTER_MAX_LAG 48
+// Speeds are estimated over at least this long and saturate at this many MT2 units/s
+#define CONTACT_FILTER_MIN_DT_US 1000
+#define CONTACT_FILTER_MAX_SPEED 0x1000000
+
+/*
+ * One Euro filter (Casiez et al.) in fixed point: a low pass whose cutoff rises
+ * with the filtered speed, so resting fingers are steadied while fast swipes keep
+ * up. Positions are kept in 1/256 MT2 units, speeds in MT2 units per second.
+ */
+class VoodooInputContactFilter {
+public:
+    void configure(UInt32 min_cutoff_mhz, UInt32 beta);
+    void reset();
+    void reset(UInt8 slot);
+
+    // Filters x and y in place, the first sample of a slot is passed through
+    void update(UInt8 slot, UInt32 time_us, SInt32& x, SInt32& y);
+
+    // Filtered speed of a slot in MT2 units/s, what the cutoff follows
+    UInt32 getSpeed(UInt8 slot) const;
+
+private:
+    struct Slot {
+        SInt32 x;
+        SInt32 y;
+        SInt32 dx;
+        SInt32 dy;
+        UInt32 time_us;
+        bool primed;
+    };
+
+    Slot slots[CONTACT_FILTER_SLOTS] {};
+    UInt32 min_cutoff {CONTACT_FILTER_DEFAULT_MIN_CUTOFF};
+    UInt32 beta {CONTACT_FILTER_DEFAULT_BETA};
+};
+
+#endif // VOODOO_INPUT_CONTACT_FILTER_HPP
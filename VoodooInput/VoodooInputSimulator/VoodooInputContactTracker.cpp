@@ -0,0 +1,133 @@
+//
+//  VoodooInputContactTracker.cpp
+//  VoodooInput
+//
+//  Copyright © 2024 Kishor Prins. All rights reserved.
+//
+
+#include "VoodooInputContactTracker.hpp"
+
+#include <kern/clock.h>
+
+static inline UInt32 distance(UInt32 a, UInt32 b) {
+    return a > b ? a - b : b - a;
+}
+
+// Logical units per second, a jump over a short interval must not wrap
+static inline SInt32 unitsPerSecond(UInt32 from, UInt32 to, UInt64 elapsed_ns) {
+    SInt64 value = ((SInt64)to - from) * (SInt64)NSEC_PER_SEC / (SInt64)elapsed_ns;
+    if (value > INT32_MAX)
+        return INT32_MAX;
+    if (value < INT32_MIN)
+        return INT32_MIN;
+    return (SInt32)value;
+}
+
+void VoodooInputContactTracker::reset() {
+    memset(history, 0, sizeof(history));
+    memset(&stats, 0, sizeof(stats));
+}
+
+VoodooInputContactTracker::History* VoodooInputContactTracker::findHistory(UInt32 id) {
+    History* free = nullptr;
+    for (History& entry : history) {
+        if (entry.count && entry.id == id)
+            return entry.seen ? nullptr : &entry;
+        if (!entry.count && !entry.seen && !free)
+            free = &entry;
+    }
+
+    if (free)
+        free->id = id;
+    return free;
+}
+
+void VoodooInputContactTracker::update(const VoodooInputEvent& event, AbsoluteTime timestamp) {
+    UInt64 now_ns;
+    absolutetime_to_nanoseconds(timestamp, &now_ns);
+
+    UInt32 xs[VOODOO_INPUT_MAX_TRANSDUCERS];
+    UInt32 ys[VOODOO_INPUT_MAX_TRANSDUCERS];
+    UInt8 count = 0;
+    UInt64 sum_x = 0;
+    UInt64 sum_y = 0;
+
+    stats.min_x = stats.min_y = UINT32_MAX;
+    stats.max_x = stats.max_y = 0;
+
+    for (int i = 0; i < event.contact_count && i < VOODOO_INPUT_MAX_TRANSDUCERS; i++) {
+        const VoodooInputTransducer& transducer = event.transducers[i];
+
+        if (!transducer.isValid || transducer.type == VoodooInputTransducerType::STYLUS)
+            continue;
+
+        History* entry = findHistory(transducer.secondaryId);
+
+        if (!transducer.isTransducerActive) {
+            if (entry)
+                entry->count = 0;
+            continue;
+        }
+
+        UInt32 x = transducer.currentCoordinates.x;
+        UInt32 y = transducer.currentCoordinates.y;
+
+        VoodooInputContactVelocity& velocity = stats.velocities[count];
+        velocity.id = transducer.secondaryId;
+        velocity.vx = velocity.vy = 0;
+
+        if (entry) {
+            entry->seen = true;
+            entry->head = (entry->head + 1) % CONTACT_TRACKER_HISTORY;
+            entry->samples[entry->head] = {now_ns, x, y};
+            if (entry->count < CONTACT_TRACKER_HISTORY)
+                entry->count++;
+
+            // Velocity over the whole history window, oldest to newest sample
+            const Sample& oldest = entry->samples[(entry->head + CONTACT_TRACKER_HISTORY - entry->count + 1) % CONTACT_TRACKER_HISTORY];
+            if (entry->count > 1 && now_ns >= oldest.time_ns) {
+                UInt64 elapsed = now_ns - oldest.time_ns;
+                if (elapsed < CONTACT_TRACKER_MIN_ELAPSED_NS)
+                    elapsed = CONTACT_TRACKER_MIN_ELAPSED_NS;
+                velocity.vx = unitsPerSecond(oldest.x, x, elapsed);
+                velocity.vy = unitsPerSecond(oldest.y, y, elapsed);
+            }
+        }
+
+        xs[count] = x;
+        ys[count] = y;
+        sum_x += x;
+        sum_y += y;
+        stats.min_x = min(stats.min_x, x);
+        stats.min_y = min(stats.min_y, y);
+        stats.max_x = max(stats.max_x, x);
+        stats.max_y = max(stats.max_y, y);
+        count++;
+    }
+
+    // Contacts gone without lifting, the id may come back as a different finger
+    for (History& entry : history) {
+        if (!entry.seen)
+            entry.count = 0;
+        entry.seen = false;
+    }
+
+    stats.timestamp = timestamp;
+    stats.contact_count = count;
+
+    if (count == 0) {
+        stats.centroid_x = stats.centroid_y = 0;
+        stats.min_x = stats.min_y = 0;
+        stats.spread = 0;
+        return;
+    }
+
+    stats.centroid_x = (UInt32)(sum_x / count);
+    stats.centroid_y = (UInt32)(sum_y / count);
+
+    UInt64 spread = 0;
+    for (int i = 0; i < count; i++) {
+        spread += distance(xs[i], stats.centroid_x) + distance(ys[i], stats.centroid_y);
+    }
+    stats.spread = (UInt32)(spread / count);
+}
@@ -0,0 +1,58 @@
+//
+//  VoodooInputContactTracker.hpp
+//  VoodooInput
+//
+//  Copyright © 2024 Kishor Prins. All rights reserved.
+//
+
+#ifndef VOODOO_INPUT_CONTACT_TRACKER_HPP
+#define VOODOO_INPUT_CONTACT_TRACKER_HPP
+
+#include <IOKit/IOService.h>
+
+#include "../VoodooInputMultitouch/VoodooInputEvent.h"
+
+#define CONTACT_TRACKER_IDS 15
+#define CONTACT_TRACKER_HISTORY 4
+// Velocities are taken over at least this long, like CONTACT_FILTER_MIN_DT_US
+#define CONTACT_TRACKER_MIN_ELAPSED_NS 1000000ULL
+
+/*
+ * Per frame contact statistics maintained incrementally from the event stream.
+ * Work is O(contacts) per frame and all state is fixed size.
+ *
+ * Histories are kept per secondaryId, a contact that misses a frame without lifting
+ * starts over. A duplicate id within a frame still counts towards the geometry but
+ * gets no velocity, as does a contact when every history is taken.
+ */
+class VoodooInputContactTracker {
+public:
+    void reset();
+    void update(const VoodooInputEvent& event, AbsoluteTime timestamp);
+
+    const VoodooInputContactStats& getStats() const { return stats; }
+
+private:
+    struct Sample {
+        UInt64 time_ns;
+        UInt32 x;
+        UInt32 y;
+    };
+
+    // Ring of the last positions of one contact, free while count is 0
+    struct History {
+        Sample samples[CONTACT_TRACKER_HISTORY];
+        UInt32 id;
+        UInt8 head;
+        UInt8 count;
+        bool seen;
+    };
+
+    History history[CONTACT_TRACKER_IDS] {};
+
+    // The history of a contact or a free one, nullptr for a duplicate or when all are taken
+    History* findHistory(UInt32 id);
+    VoodooInputContactStats stats {};
+};
+
+#endif // VOODOO_INPUT_CONTACT_TRACKER_HPP
@@ -0,0 +1,198 @@
+//
+//  VoodooInputDigitizerDevice.cpp
+//  VoodooInput
+//
+//  Copyright © 2024 Kishor Prins. All rights reserved.
+//
+
+#include "VoodooInputDigitizerDevice.hpp"
+#include "../VoodooInputMultitouch/MultitouchHelpers.h"
+#include "../VoodooInputIDs.hpp"
+
+#include <IOKit/IOLib.h>
+#include <IOKit/IOWorkLoop.h>
+#include <IOKit/IOCommandGate.h>
+#include <IOKit/hid/IOHIDUsageTables.h>
+
+#define super IOHIDDevice
+OSDefineMetaClassAndStructors(VoodooInputDigitizerDevice, IOHIDDevice);
+
+void VoodooInputDigitizerDevice::constructReport(const VoodooInputEvent& multitouch_event) {
+    if (!ready_for_reports)
+        return;
+
+    command_gate->runAction(OSMemberFunctionCast(IOCommandGate::Action, this, &VoodooInputDigitizerDevice::constructReportGated), (void*)&multitouch_event);
+}
+
+void VoodooInputDigitizerDevice::constructReportGated(const VoodooInputEvent& multitouch_event) {
+    AbsoluteTime relative_timestamp = multitouch_event.timestamp;
+    SUB_ABSOLUTETIME(&relative_timestamp, &start_timestamp);
+
+    UInt64 scan_time;
+    absolutetime_to_nanoseconds(relative_timestamp, &scan_time);
+
+    encoder.setSurface(engine->getLogicalMaxX(), engine->getLogicalMaxY(), engine->getTransformKey());
+    UInt32 send = encoder.encode(multitouch_event, scan_time, *touch_report, *pen_report);
+
+    // handleReport copies the report, so the release can reuse the touch report
+    if (send & kDigitizerSendTouch)
+        handleReport(touch_report_range, kIOHIDReportTypeInput);
+    if (send & kDigitizerSendRelease) {
+        VoodooInputDigitizerEncoder::encodeRelease(*touch_report);
+        handleReport(touch_report_range, kIOHIDReportTypeInput);
+    }
+    if (send & kDigitizerSendPen)
+        handleReport(pen_report_range, kIOHIDReportTypeInput);
+}
+
+bool VoodooInputDigitizerDevice::start(IOService* provider) {
+    // The HID family asks for the report descriptor from within super::start
+    engine = OSDynamicCast(VoodooInput, provider);
+    if (!engine)
+        return false;
+
+    if (!super::start(provider))
+        return false;
+    ready_for_reports = false;
+
+    const VoodooInputArena& arena = engine->getArena();
+    UInt8* report_bytes = arena.getBytes(kVoodooInputArenaDigitizerReports);
+    touch_report_range = arena.newSubRange(kVoodooInputArenaDigitizerReports, 0, sizeof(DIGITIZER_TOUCH_REPORT));
+    pen_report_range = arena.newSubRange(kVoodooInputArenaDigitizerReports, sizeof(DIGITIZER_TOUCH_REPORT), sizeof(DIGITIZER_PEN_REPORT));
+    if (!report_bytes || !touch_report_range || !pen_report_range) {
+        IOLog("%s Could not allocate IOSubMemoryDescriptor\n", getName());
+        releaseResources();
+        return false;
+    }
+    memset(report_bytes, 0, arena.getLength(kVoodooInputArenaDigitizerReports));
+    touch_report = (DIGITIZER_TOUCH_REPORT*)report_bytes;
+    pen_report = (DIGITIZER_PEN_REPORT*)(report_bytes + sizeof(DIGITIZER_TOUCH_REPORT));
+    encoder.reset();
+
+    clock_get_uptime(&start_timestamp);
+
+    work_loop = this->getWorkLoop();
+    if (!work_loop) {
+        IOLog("%s Could not get a IOWorkLoop instance\n", getName());
+        releaseResources();
+        return false;
+    }
+
+    work_loop->retain();
+
+    command_gate = IOCommandGate::commandGate(this);
+    if (!command_gate || (work_loop->addEventSource(command_gate) != kIOReturnSuccess)) {
+        IOLog("%s Could not open command gate\n", getName());
+        releaseResources();
+        return false;
+    }
+
+    ready_for_reports = true;
+
+    return true;
+}
+
+void VoodooInputDigitizerDevice::stop(IOService* provider) {
+    ready_for_reports = false;
+    releaseResources();
+
+    super::stop(provider);
+}
+
+void VoodooInputDigitizerDevice::releaseResources() {
+    if (command_gate) {
+        work_loop->removeEventSource(command_gate);
+        OSSafeReleaseNULL(command_gate);
+    }
+
+    OSSafeReleaseNULL(work_loop);
+    touch_report = nullptr;
+    pen_report = nullptr;
+    OSSafeReleaseNULL(touch_report_range);
+    OSSafeReleaseNULL(pen_report_range);
+}
+
+IOReturn VoodooInputDigitizerDevice::getReport(IOMemoryDescriptor* report, IOHIDReportType reportType, IOOptionBits options) {
+    UInt32 report_id = options & 0xFF;
+
+    if (reportType != kIOHIDReportTypeFeature || report_id != DIGITIZER_CONTACT_MAX_REPORT_ID)
+        return kIOReturnUnsupported;
+
+    unsigned char buffer[] = {DIGITIZER_CONTACT_MAX_REPORT_ID, VOODOO_INPUT_MAX_TRANSDUCERS};
+    report->writeBytes(0, buffer, sizeof(buffer));
+
+    return kIOReturnSuccess;
+}
+
+IOReturn VoodooInputDigitizerDevice::newReportDescriptor(IOMemoryDescriptor** descriptor) const {
+    DigitizerDescriptor* report_descriptor = IONew(DigitizerDescriptor, 1);
+
+    if (!report_descriptor) {
+        IOLog("%s Could not allocate report descriptor\n", getName());
+        return kIOReturnNoResources;
+    }
+
+    *report_descriptor = DigitizerDescriptor {};
+    VoodooInputDigitizerWriteDescriptor(*report_descriptor, engine->getPhysicalMaxX(), engine->getPhysicalMaxY());
+
+    const VoodooInputArena& arena = engine->getArena();
+    UInt8* report_descriptor_bytes = arena.getBytes(kVoodooInputArenaDigitizerDescriptor);
+    IOSubMemoryDescriptor* report_descriptor_range = arena.newSubRange(kVoodooInputArenaDigitizerDescriptor, 0, report_descriptor->length);
+
+    if (report_descriptor_bytes && report_descriptor_range) {
+        memcpy(report_descriptor_bytes, report_descriptor->bytes, report_descriptor->length);
+    } else {
+        IOLog("%s Could not allocate buffer for report descriptor\n", getName());
+        OSSafeReleaseNULL(report_descriptor_range);
+    }
+
+    IODelete(report_descriptor, DigitizerDescriptor, 1);
+
+    if (!report_descriptor_range) {
+        return kIOReturnNoResources;
+    }
+
+    *descriptor = report_descriptor_range;
+
+    return kIOReturnSuccess;
+}
+
+OSString* VoodooInputDigitizerDevice::newManufacturerString() const {
+    return OSString::withCString("VoodooInput");
+}
+
+OSNumber* VoodooInputDigitizerDevice::newPrimaryUsageNumber() const {
+    return OSNumber::withNumber(kHIDUsage_Dig_TouchScreen, 32);
+}
+
+OSNumber* VoodooInputDigitizerDevice::newPrimaryUsagePageNumber() const {
+    return OSNumber::withNumber(kHIDPage_Digitizer, 32);
+}
+
+OSString* VoodooInputDigitizerDevice::newProductString() const {
+    return OSString::withCString("Digitizer");
+}
+
+OSString* VoodooInputDigitizerDevice::newSerialNumberString() const {
+    return OSString::withCString("Voodoo Digitizer");
+}
+
+OSString* VoodooInputDigitizerDevice::newTransportString() const {
+    return OSString::withCString("I2C");
+}
+
+OSNumber* VoodooInputDigitizerDevice::newVersionNumber() const {
+    return OSNumber::withNumber(0x100, 32);
+}
+
+OSNumber* VoodooInputDigitizerDevice::newLocationIDNumber() const {
+    return OSNumber::withNumber(0x14500000, 32);
+}
+
+OSNumber* VoodooInputDigitizerDevice::newVendorIDNumber() const {
+    return OSNumber::withNumber(kVoodooInputVendorDigitizer, 16);
+}
+
+OSNumber* VoodooInputDigitizerDevice::newProductIDNumber() const {
+    return OSNumber::withNumber(kVoodooInputProductDigitizer, 16);
+}
@@ -0,0 +1,71 @@
+//
+//  VoodooInputDigitizerDevice.hpp
+//  VoodooInput
+//
+//  Copyright © 2024 Kishor Prins. All rights reserved.
+//
+
+#ifndef VOODOO_DIGITIZER_DEVICE_HPP
+#define VOODOO_DIGITIZER_DEVICE_HPP
+
+#include <IOKit/IOService.h>
+#include <IOKit/hid/IOHIDDevice.h>
+#include <IOKit/IOSubMemoryDescriptor.h>
+
+#include <kern/clock.h>
+
+#include "../VoodooInput.hpp"
+#include "../VoodooInputMultitouch/VoodooInputTransducer.h"
+#include "../VoodooInputMultitouch/VoodooInputEvent.h"
+#include "VoodooInputDigitizerReport.hpp"
+
+#ifndef EXPORT
+#define EXPORT __attribute__((visibility("default")))
+#endif
+
+/*
+ * Standard multi-contact digitizer (touch screen + pen) for providers that asked for
+ * kVoodooInputBackendDigitizer. Contacts are reported as direct touches, without the
+ * trackpad gesture handling of the Magic Trackpad 2 emulation.
+ */
+class EXPORT VoodooInputDigitizerDevice : public IOHIDDevice {
+    OSDeclareDefaultStructors(VoodooInputDigitizerDevice);
+
+public:
+    void constructReport(const VoodooInputEvent& multitouch_event);
+
+    IOReturn getReport(IOMemoryDescriptor* report, IOHIDReportType reportType, IOOptionBits options) override;
+    IOReturn newReportDescriptor(IOMemoryDescriptor** descriptor) const override;
+
+    OSNumber* newVersionNumber() const override;
+    OSString* newTransportString() const override;
+    OSString* newManufacturerString() const override;
+    OSNumber* newPrimaryUsageNumber() const override;
+    OSNumber* newPrimaryUsagePageNumber() const override;
+    OSString* newProductString() const override;
+    OSString* newSerialNumberString() const override;
+    OSNumber* newLocationIDNumber() const override;
+    OSNumber* newVendorIDNumber() const override;
+    OSNumber* newProductIDNumber() const override;
+
+    bool start(IOService* provider) override;
+    void stop(IOService* provider) override;
+    void releaseResources();
+
+private:
+    bool ready_for_reports {false};
+    VoodooInput* engine {nullptr};
+    AbsoluteTime start_timestamp {};
+    IOWorkLoop* work_loop {nullptr};
+    IOCommandGate* command_gate {nullptr};
+    // Both reports live in the engine arena
+    DIGITIZER_TOUCH_REPORT* touch_report {nullptr};
+    DIGITIZER_PEN_REPORT* pen_report {nullptr};
+    IOSubMemoryDescriptor* touch_report_range {nullptr};
+    IOSubMemoryDescriptor* pen_report_range {nullptr};
+    VoodooInputDigitizerEncoder encoder;
+
+    void constructReportGated(const VoodooInputEvent& multitouch_event);
+};
+
+#endif
@@ -0,0 +1,218 @@
+//
+//  VoodooInputDigitizerReport.cpp
+//  VoodooInput
+//
+//  Copyright © 2024 Kishor Prins. All rights reserved.
+//
+
+#include "VoodooInputDigitizerReport.hpp"
+#include "../VoodooInputMultitouch/MultitouchHelpers.h"
+
+#include <IOKit/hid/IOHIDUsageTables.h>
+
+// Physical extents are in 0.01mm, centimeters with an exponent of -3
+static void writeAxes(DigitizerDescriptor& descriptor, UInt32 physical_max_x, UInt32 physical_max_y) {
+    descriptor.usagePage(kHIDPage_GenericDesktop).logicalMax(DIGITIZER_LOGICAL_MAX).reportSize(16).reportCount(1)
+        .unsignedItem(HID_UNIT_EXPONENT, 0x0D).unsignedItem(HID_UNIT, 0x11)
+        .usage(0x30).item(HID_PHYSICAL_MAX, physical_max_x, 4).input(HID_DATA_VAR_ABS)
+        .usage(0x31).item(HID_PHYSICAL_MAX, physical_max_y, 4).input(HID_DATA_VAR_ABS)
+        .unsignedItem(HID_UNIT_EXPONENT, 0).unsignedItem(HID_UNIT, 0).unsignedItem(HID_PHYSICAL_MAX, 0)
+        .usagePage(kHIDPage_Digitizer);
+}
+
+void VoodooInputDigitizerWriteDescriptor(DigitizerDescriptor& descriptor, UInt32 physical_max_x, UInt32 physical_max_y) {
+    // Touch screen, one logical collection per contact
+    descriptor.usagePage(kHIDPage_Digitizer).usage(kHIDUsage_Dig_TouchScreen).collection(0x01)
+        .reportId(DIGITIZER_TOUCH_REPORT_ID);
+
+    for (int i = 0; i < VOODOO_INPUT_MAX_TRANSDUCERS; i++) {
+        descriptor.usage(0x22).collection(0x02) // Finger
+            .usage(0x42).usage(0x32).usage(0x47) // Tip Switch, In Range, Confidence
+            .logicalMin(0).logicalMax(1).reportSize(1).reportCount(3).input(HID_DATA_VAR_ABS)
+            .reportCount(5).input(HID_CONST)
+            .usage(0x51).logicalMax(VOODOO_INPUT_MAX_TRANSDUCERS - 1).reportSize(8).reportCount(1).input(HID_DATA_VAR_ABS); // Contact Identifier
+        writeAxes(descriptor, physical_max_x, physical_max_y);
+        descriptor.endCollection();
+    }
+
+    descriptor.usage(0x54).logicalMax(VOODOO_INPUT_MAX_TRANSDUCERS).reportSize(8).reportCount(1).input(HID_DATA_VAR_ABS) // Contact Count
+        .usage(0x56).logicalMax(0xFFFF).unsignedItem(HID_UNIT_EXPONENT, 0x0C).unsignedItem(HID_UNIT, 0x1001) // Scan Time, 100us
+        .reportSize(16).input(HID_DATA_VAR_ABS)
+        .unsignedItem(HID_UNIT_EXPONENT, 0).unsignedItem(HID_UNIT, 0)
+        .reportId(DIGITIZER_CONTACT_MAX_REPORT_ID)
+        .usage(0x55).logicalMax(VOODOO_INPUT_MAX_TRANSDUCERS).reportSize(8).feature(HID_DATA_VAR_ABS) // Contact Count Maximum
+    .endCollection();
+
+    // Pen
+    descriptor.usage(0x02).collection(0x01)
+        .reportId(DIGITIZER_PEN_REPORT_ID)
+        .usage(0x20).collection(0x00) // Stylus
+            .usage(0x42).usage(0x44).usage(0x3C).usage(0x45).usage(0x32) // Tip, Barrel, Invert, Eraser, In Range
+            .logicalMax(1).reportSize(1).reportCount(5).input(HID_DATA_VAR_ABS)
+            .reportCount(3).input(HID_CONST);
+    writeAxes(descriptor, physical_max_x, physical_max_y);
+    descriptor.usage(0x30).logicalMax(DIGITIZER_PRESSURE_MAX).reportSize(16).reportCount(1).input(HID_DATA_VAR_ABS) // Tip Pressure
+        .endCollection()
+    .endCollection();
+}
+
+void VoodooInputDigitizerEncoder::reset() {
+    memset(slots, 0, sizeof(slots));
+    pen_in_range = false;
+}
+
+void VoodooInputDigitizerEncoder::setSurface(UInt32 logical_max_x, UInt32 logical_max_y, UInt8 transform) {
+    this->logical_max_x = logical_max_x ? logical_max_x : 1;
+    this->logical_max_y = logical_max_y ? logical_max_y : 1;
+    this->transform = transform;
+}
+
+VoodooInputDigitizerEncoder::Slot* VoodooInputDigitizerEncoder::findSlot(UInt32 secondary_id) {
+    Slot* free_slot = nullptr;
+
+    for (Slot& slot : slots) {
+        if (slot.used && slot.secondary_id == secondary_id)
+            return &slot;
+        if (!slot.used && !free_slot)
+            free_slot = &slot;
+    }
+
+    if (free_slot) {
+        free_slot->used = true;
+        free_slot->secondary_id = secondary_id;
+        free_slot->seen = false;
+    }
+    return free_slot;
+}
+
+void VoodooInputDigitizerEncoder::scaleCoordinates(const VoodooInputTransducer& transducer, UInt16& x, UInt16& y) const {
+    UInt32 scaled_x = (UInt32)((UInt64)min(transducer.currentCoordinates.x, logical_max_x) * DIGITIZER_LOGICAL_MAX / logical_max_x);
+    UInt32 scaled_y = (UInt32)((UInt64)min(transducer.currentCoordinates.y, logical_max_y) * DIGITIZER_LOGICAL_MAX / logical_max_y);
+
+    if (transform & kIOFBSwapAxes) {
+        UInt32 swap = scaled_x;
+        scaled_x = scaled_y;
+        scaled_y = swap;
+    }
+
+    if (transform & kIOFBInvertX)
+        scaled_x = DIGITIZER_LOGICAL_MAX - scaled_x;
+    if (transform & kIOFBInvertY)
+        scaled_y = DIGITIZER_LOGICAL_MAX - scaled_y;
+
+    x = (UInt16)scaled_x;
+    y = (UInt16)scaled_y;
+}
+
+UInt32 VoodooInputDigitizerEncoder::encode(const VoodooInputEvent& event, UInt64 scan_time_ns, DIGITIZER_TOUCH_REPORT& touch, DIGITIZER_PEN_REPORT& pen) {
+    const VoodooInputTransducer* stylus = nullptr;
+    UInt8 contact_count = 0;
+    bool touching = false;
+
+    for (Slot& slot : slots)
+        slot.seen = false;
+
+    for (int i = 0; i < event.contact_count && i < VOODOO_INPUT_MAX_TRANSDUCERS; i++) {
+        const VoodooInputTransducer& transducer = event.transducers[i];
+
+        if (!transducer.isValid)
+            continue;
+
+        if (transducer.type == VoodooInputTransducerType::STYLUS) {
+            if (!stylus)
+                stylus = &transducer;
+            continue;
+        }
+
+        // No free slot means more contacts than the descriptor declares, duplicate ids are reported once
+        Slot* slot = findSlot(transducer.secondaryId);
+        if (!slot || slot->seen)
+            continue;
+
+        bool down = transducer.isTransducerActive || transducer.isPhysicalButtonDown;
+        slot->seen = true;
+        slot->confident = transducer.fingerType != kMT2FingerTypePalm;
+        scaleCoordinates(transducer, slot->x, slot->y);
+
+        // A lifted contact is reported once with tip switch cleared
+        DIGITIZER_TOUCH_REPORT_CONTACT& contact = touch.contacts[contact_count++];
+        contact.flags = down ? DIGITIZER_TIP_SWITCH | DIGITIZER_IN_RANGE : 0;
+        if (slot->confident)
+            contact.flags |= DIGITIZER_CONFIDENCE;
+        contact.contact_id = (UInt8)(slot - slots);
+        contact.x = slot->x;
+        contact.y = slot->y;
+        touching |= down;
+        slot->down = down;
+    }
+
+    // Contacts that went missing without lifting are lifted where they were last seen
+    for (Slot& slot : slots) {
+        if (!slot.used || slot.seen)
+            continue;
+
+        DIGITIZER_TOUCH_REPORT_CONTACT& contact = touch.contacts[contact_count++];
+        contact.flags = slot.confident ? DIGITIZER_CONFIDENCE : 0;
+        contact.contact_id = (UInt8)(&slot - slots);
+        contact.x = slot.x;
+        contact.y = slot.y;
+        slot.used = false;
+    }
+
+    // Held until now so no contact in this report can take over the slot of one lifting
+    for (Slot& slot : slots) {
+        if (slot.seen && !slot.down)
+            slot.used = false;
+    }
+
+    UInt32 send = 0;
+    if (contact_count) {
+        // Unused contacts are never read past contact_count but keep them deterministic
+        memset(&touch.contacts[contact_count], 0, sizeof(DIGITIZER_TOUCH_REPORT_CONTACT) * (VOODOO_INPUT_MAX_TRANSDUCERS - contact_count));
+        touch.report_id = DIGITIZER_TOUCH_REPORT_ID;
+        touch.contact_count = contact_count;
+        touch.scan_time = (UInt16)(scan_time_ns / 100000);
+        send = touching ? kDigitizerSendTouch : kDigitizerSendTouch | kDigitizerSendRelease;
+    }
+
+    if (encodePen(stylus, pen))
+        send |= kDigitizerSendPen;
+
+    return send;
+}
+
+void VoodooInputDigitizerEncoder::encodeRelease(DIGITIZER_TOUCH_REPORT& touch) {
+    // Same scan time, nothing left on the surface
+    memset(touch.contacts, 0, sizeof(touch.contacts));
+    touch.report_id = DIGITIZER_TOUCH_REPORT_ID;
+    touch.contact_count = 0;
+}
+
+bool VoodooInputDigitizerEncoder::encodePen(const VoodooInputTransducer* stylus, DIGITIZER_PEN_REPORT& pen) {
+    if (!stylus && !pen_in_range)
+        return false;
+
+    pen.report_id = DIGITIZER_PEN_REPORT_ID;
+    pen.flags = 0;
+    pen.tip_pressure = 0;
+
+    if (stylus) {
+        pen.flags = DIGITIZER_PEN_IN_RANGE;
+        if (stylus->isTransducerActive)
+            pen.flags |= DIGITIZER_TIP_SWITCH;
+        if (stylus->isPhysicalButtonDown)
+            pen.flags |= DIGITIZER_BARREL_SWITCH;
+        if (stylus->isTransducerActive && stylus->supportsPressure && stylus->maxPressure)
+            pen.tip_pressure = (UInt16)(min((UInt32)stylus->currentCoordinates.pressure, stylus->maxPressure) * DIGITIZER_PRESSURE_MAX / stylus->maxPressure);
+        else if (stylus->isTransducerActive)
+            pen.tip_pressure = DIGITIZER_PRESSURE_MAX;
+        UInt16 x, y;
+        scaleCoordinates(*stylus, x, y);
+        pen.x = x;
+        pen.y = y;
+    }
+
+    // Leaving range is reported once with the last position
+    pen_in_range = stylus != nullptr;
+    return true;
+}
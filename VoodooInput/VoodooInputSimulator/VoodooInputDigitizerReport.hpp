@@ -0,0 +1,107 @@
+//
+//  VoodooInputDigitizerReport.hpp
+//  VoodooInput
+//
+//  Copyright © 2024 Kishor Prins. All rights reserved.
+//
+
+#ifndef VOODOO_INPUT_DIGITIZER_REPORT_HPP
+#define VOODOO_INPUT_DIGITIZER_REPORT_HPP
+
+#include <IOKit/IOService.h>
+
+#include "../VoodooInputMultitouch/VoodooInputEvent.h"
+#include "VoodooInputHIDProfile.hpp"
+
+#define DIGITIZER_LOGICAL_MAX 0x7FFF
+#define DIGITIZER_PRESSURE_MAX 0x3FF
+#define DIGITIZER_DESCRIPTOR_MAX_SIZE 1024
+
+#define DIGITIZER_TOUCH_REPORT_ID 0x01
+#define DIGITIZER_PEN_REPORT_ID 0x02
+#define DIGITIZER_CONTACT_MAX_REPORT_ID 0x03
+
+#define DIGITIZER_TIP_SWITCH (1 << 0)
+#define DIGITIZER_IN_RANGE (1 << 1)
+#define DIGITIZER_CONFIDENCE (1 << 2)
+#define DIGITIZER_BARREL_SWITCH (1 << 1)
+#define DIGITIZER_PEN_IN_RANGE (1 << 4)
+
+struct __attribute__((__packed__)) DIGITIZER_TOUCH_REPORT_CONTACT {
+    UInt8 flags;
+    UInt8 contact_id;
+    UInt16 x;
+    UInt16 y;
+};
+
+struct __attribute__((__packed__)) DIGITIZER_TOUCH_REPORT {
+    UInt8 report_id;
+    DIGITIZER_TOUCH_REPORT_CONTACT contacts[VOODOO_INPUT_MAX_TRANSDUCERS];
+    UInt8 contact_count;
+    // 100us units
+    UInt16 scan_time;
+};
+
+struct __attribute__((__packed__)) DIGITIZER_PEN_REPORT {
+    UInt8 report_id;
+    UInt8 flags;
+    UInt16 x;
+    UInt16 y;
+    UInt16 tip_pressure;
+};
+
+static_assert(sizeof(DIGITIZER_TOUCH_REPORT) == 64, "Unexpected DIGITIZER_TOUCH_REPORT size");
+static_assert(sizeof(DIGITIZER_PEN_REPORT) == 8, "Unexpected DIGITIZER_PEN_REPORT size");
+
+typedef VoodooInputHIDBytes<DIGITIZER_DESCRIPTOR_MAX_SIZE> DigitizerDescriptor;
+
+// Touch screen and pen collections, physical extents in 0.01mm
+void VoodooInputDigitizerWriteDescriptor(DigitizerDescriptor& descriptor, UInt32 physical_max_x, UInt32 physical_max_y);
+
+// Reports encode() filled in, in the order they have to be sent
+enum {
+    kDigitizerSendTouch = 1 << 0,
+    // The touch report again, emptied by encodeRelease
+    kDigitizerSendRelease = 1 << 1,
+    kDigitizerSendPen = 1 << 2,
+};
+
+/*
+ * Turns events into digitizer touch and pen reports. Provider ids can be anything,
+ * the HID contact identifier is a slot 0..9 held from touch down until the contact
+ * has been reported lifted. A contact that disappears from the events without lifting
+ * is reported lifted at its last position, and the report after the last contact
+ * lifted is followed by one with a contact count of 0.
+ */
+class VoodooInputDigitizerEncoder {
+public:
+    void reset();
+    void setSurface(UInt32 logical_max_x, UInt32 logical_max_y, UInt8 transform);
+
+    // Returns kDigitizerSend* flags for the reports to send
+    UInt32 encode(const VoodooInputEvent& event, UInt64 scan_time_ns, DIGITIZER_TOUCH_REPORT& touch, DIGITIZER_PEN_REPORT& pen);
+    static void encodeRelease(DIGITIZER_TOUCH_REPORT& touch);
+
+private:
+    struct Slot {
+        UInt32 secondary_id;
+        UInt16 x;
+        UInt16 y;
+        bool confident;
+        bool down;
+        bool used;
+        bool seen;
+    };
+
+    UInt32 logical_max_x {1};
+    UInt32 logical_max_y {1};
+    UInt8 transform {0};
+    Slot slots[VOODOO_INPUT_MAX_TRANSDUCERS];
+    bool pen_in_range {false};
+
+    Slot* findSlot(UInt32 secondary_id);
+    void scaleCoordinates(const VoodooInputTransducer& transducer, UInt16& x, UInt16& y) const;
+    bool encodePen(const VoodooInputTransducer* stylus, DIGITIZER_PEN_REPORT& pen);
+};
+
+#endif // VOODOO_INPUT_DIGITIZER_REPORT_HPP
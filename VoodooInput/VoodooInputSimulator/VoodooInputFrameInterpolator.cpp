@@ -0,0 +1,112 @@
+//
+//  VoodooInputFrameInterpolator.cpp
+//  VoodooInput
+//
+//  Copyright © 2024 Kishor Prins. All rights reserved.
+//
+
+#include "VoodooInputFrameInterpolator.hpp"
+
+static inline UInt32 lerp(UInt32 from, UInt32 to, UInt64 numerator, UInt64 denominator) {
+    return (UInt32)((SInt64)from + ((SInt64)to - (SInt64)from) * (SInt64)numerator / (SInt64)denominator);
+}
+
+// Only frames where every contact is a finger that stays down can be moved between
+static bool isSteady(const VoodooInputEvent& event) {
+    if (event.contact_count == 0 || event.contact_count > VOODOO_INPUT_MAX_TRANSDUCERS)
+        return false;
+
+    for (int i = 0; i < event.contact_count; i++) {
+        const VoodooInputTransducer& transducer = event.transducers[i];
+
+        if (!transducer.isValid)
+            continue;
+        if (transducer.type == VoodooInputTransducerType::STYLUS || !transducer.isTransducerActive)
+            return false;
+    }
+
+    return true;
+}
+
+void VoodooInputFrameInterpolator::configure(UInt64 new_period, UInt64 new_lag) {
+    period = new_period;
+    lag = new_lag;
+}
+
+void VoodooInputFrameInterpolator::reset() {
+    primed = false;
+    active = false;
+}
+
+bool VoodooInputFrameInterpolator::isTransition(const VoodooInputEvent& event) const {
+    if (!primed || !isSteady(event) || event.contact_count != to.contact_count)
+        return true;
+
+    for (int i = 0; i < event.contact_count; i++) {
+        const VoodooInputTransducer& current = event.transducers[i];
+        const VoodooInputTransducer& previous = to.transducers[i];
+
+        if (current.isValid != previous.isValid || current.secondaryId != previous.secondaryId ||
+            current.fingerType != previous.fingerType || current.isPhysicalButtonDown != previous.isPhysicalButtonDown)
+            return true;
+    }
+
+    return false;
+}
+
+bool VoodooInputFrameInterpolator::push(const VoodooInputEvent& event, UInt64 now) {
+    if (isTransition(event) || now - to_time > lag * FRAME_INTERPOLATOR_GAP_LAGS) {
+        // Sent by the caller right away, a frame with every contact down starts the next segment
+        active = false;
+        primed = isSteady(event);
+        if (primed) {
+            to = last = event;
+            to_time = last_render = now;
+        }
+        return false;
+    }
+
+    from = last;
+    from_time = last_render;
+    to = event;
+    to_time = now;
+    active = true;
+    return true;
+}
+
+bool VoodooInputFrameInterpolator::render(UInt64 now, VoodooInputEvent& event) {
+    if (!active)
+        return false;
+
+    // Nothing newer than the last frame sent yet, the caller keeps ticking while active
+    UInt64 time = now > lag ? now - lag : 0;
+    if (time <= last_render)
+        return false;
+
+    if (time >= to_time) {
+        time = to_time;
+        active = false;
+    }
+
+    UInt64 elapsed = time - from_time;
+    UInt64 length = to_time > from_time ? to_time - from_time : 1;
+
+    event = to;
+    event.timestamp = time;
+
+    for (int i = 0; i < event.contact_count; i++) {
+        VoodooInputTransducer& transducer = event.transducers[i];
+        if (!transducer.isValid)
+            continue;
+
+        const TouchCoordinates& start = from.transducers[i].currentCoordinates;
+        transducer.currentCoordinates.x = lerp(start.x, transducer.currentCoordinates.x, elapsed, length);
+        transducer.currentCoordinates.y = lerp(start.y, transducer.currentCoordinates.y, elapsed, length);
+        transducer.previousCoordinates = last.transducers[i].currentCoordinates;
+        transducer.timestamp = time;
+    }
+
+    last = event;
+    last_render = time;
+    return true;
+}
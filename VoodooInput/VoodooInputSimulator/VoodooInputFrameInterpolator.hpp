@@ -0,0 +1,63 @@
+//
+//  VoodooInputFrameInterpolator.hpp
+//  VoodooInput
+//
+//  Copyright © 2024 Kishor Prins. All rights reserved.
+//
+
+#ifndef VOODOO_INPUT_FRAME_INTERPOLATOR_HPP
+#define VOODOO_INPUT_FRAME_INTERPOLATOR_HPP
+
+#include <IOKit/IOService.h>
+
+#include "../VoodooInputMultitouch/VoodooInputEvent.h"
+
+// Output cadence in Hz and lag in ms, the lag should cover about one provider sample period
+#define FRAME_INTERPOLATOR_DEFAULT_RATE 125
+#define FRAME_INTERPOLATOR_MAX_RATE 250
+#define FRAME_INTERPOLATOR_DEFAULT_LAG 20
+// A provider pause longer than this many lags is not bridged, the next frame goes out as is
+#define FRAME_INTERPOLATOR_GAP_LAGS 4
+
+/*
+ * Upsamples touch frames of low rate providers. Frames are rendered lag behind now,
+ * moving each contact from the position last sent towards the latest real sample,
+ * so the output never runs ahead of the provider and reaches every real sample at
+ * most lag plus one output period after it arrived. A sample followed sooner than that
+ * is passed by, output heads for the newer one from wherever it is. Anything that
+ * changes the contacts (touch down, lift off, buttons, count) is a transition: it goes
+ * out as is and nothing is interpolated across it.
+ *
+ * Times are in whatever monotonic unit the caller uses, nothing here calls into the kernel.
+ */
+class VoodooInputFrameInterpolator {
+public:
+    void configure(UInt64 period, UInt64 lag);
+    void reset();
+
+    // Takes a real frame, false when it is a transition the caller has to send itself
+    bool push(const VoodooInputEvent& event, UInt64 now);
+    // Frame for now - lag, false when there is nothing left to send until the next push
+    bool render(UInt64 now, VoodooInputEvent& event);
+
+    bool isActive() const { return active; }
+    UInt64 getPeriod() const { return period; }
+
+private:
+    UInt64 period {0};
+    UInt64 lag {0};
+
+    bool primed {false};
+    bool active {false};
+    // Segment from the last frame sent to the latest real sample
+    VoodooInputEvent from {};
+    VoodooInputEvent to {};
+    VoodooInputEvent last {};
+    UInt64 from_time {0};
+    UInt64 to_time {0};
+    UInt64 last_render {0};
+
+    bool isTransition(const VoodooInputEvent& event) const;
+};
+
+#endif // VOODOO_INPUT_FRAME_INTERPOLATOR_HPP
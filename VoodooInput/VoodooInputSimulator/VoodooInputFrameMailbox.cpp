@@ -0,0 +1,53 @@
+//
+//  VoodooInputFrameMailbox.cpp
+//  VoodooInput
+//
+//  Copyright © 2024 Kishor Prins. All rights reserved.
+//
+
+#include "VoodooInputFrameMailbox.hpp"
+
+bool VoodooInputFrameMailbox::init() {
+    if (!lock)
+        lock = IOSimpleLockAlloc();
+    if (!lock)
+        return false;
+
+    full = false;
+    superseded = 0;
+    return true;
+}
+
+void VoodooInputFrameMailbox::release() {
+    if (lock) {
+        IOSimpleLockFree(lock);
+        lock = nullptr;
+    }
+    full = false;
+}
+
+bool VoodooInputFrameMailbox::post(const VoodooInputEvent& frame) {
+    IOSimpleLockLock(lock);
+
+    bool empty = !full;
+    if (!empty)
+        superseded++;
+    slot = frame;
+    full = true;
+
+    IOSimpleLockUnlock(lock);
+    return empty;
+}
+
+bool VoodooInputFrameMailbox::take(VoodooInputEvent& frame) {
+    IOSimpleLockLock(lock);
+
+    bool available = full;
+    if (available) {
+        frame = slot;
+        full = false;
+    }
+
+    IOSimpleLockUnlock(lock);
+    return available;
+}
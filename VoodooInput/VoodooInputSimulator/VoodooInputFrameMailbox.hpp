@@ -0,0 +1,39 @@
+//
+//  VoodooInputFrameMailbox.hpp
+//  VoodooInput
+//
+//  Copyright © 2024 Kishor Prins. All rights reserved.
+//
+
+#ifndef VOODOO_INPUT_FRAME_MAILBOX_HPP
+#define VOODOO_INPUT_FRAME_MAILBOX_HPP
+
+#include <IOKit/IOService.h>
+#include <IOKit/IOLocks.h>
+
+#include "../VoodooInputMultitouch/VoodooInputEvent.h"
+
+/*
+ * One frame slot between providers whose frame gave way to a busy gate and the
+ * gate, which takes it once it is free. A frame posted while another one waits
+ * supersedes it, only the newest motion is worth sending.
+ */
+class VoodooInputFrameMailbox {
+public:
+    bool init();
+    void release();
+
+    // True when the slot was empty, the caller arranges for it to be taken
+    bool post(const VoodooInputEvent& frame);
+    bool take(VoodooInputEvent& frame);
+
+    UInt32 getSuperseded() const { return superseded; }
+
+private:
+    IOSimpleLock* lock {nullptr};
+    VoodooInputEvent slot {};
+    bool full {false};
+    UInt32 superseded {0};
+};
+
+#endif // VOODOO_INPUT_FRAME_MAILBOX_HPP
@@ -0,0 +1,44 @@
+//
+//  VoodooInputFrameWatchdog.cpp
+//  VoodooInput
+//
+//  Copyright © 2024 Kishor Prins. All rights reserved.
+//
+
+#include "VoodooInputFrameWatchdog.hpp"
+
+void VoodooInputFrameWatchdog::reset() {
+    degraded = false;
+    recovered_frames = overruns = mode_switches = 0;
+    worst_stall_ns = 0;
+}
+
+bool VoodooInputFrameWatchdog::update(UInt64 lateness_ns) {
+    if (lateness_ns > worst_stall_ns)
+        worst_stall_ns = lateness_ns;
+
+    if (lateness_ns > deadline_ns) {
+        overruns++;
+        recovered_frames = 0;
+
+        if (degraded)
+            return false;
+
+        degraded = true;
+        mode_switches++;
+        return true;
+    }
+
+    if (!degraded || lateness_ns > deadline_ns / 2) {
+        recovered_frames = 0;
+        return false;
+    }
+
+    if (++recovered_frames < FRAME_WATCHDOG_RECOVERY_FRAMES)
+        return false;
+
+    degraded = false;
+    recovered_frames = 0;
+    mode_switches++;
+    return true;
+}
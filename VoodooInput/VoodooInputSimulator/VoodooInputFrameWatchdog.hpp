@@ -0,0 +1,47 @@
+//
+//  VoodooInputFrameWatchdog.hpp
+//  VoodooInput
+//
+//  Copyright © 2024 Kishor Prins. All rights reserved.
+//
+
+#ifndef VOODOO_INPUT_FRAME_WATCHDOG_HPP
+#define VOODOO_INPUT_FRAME_WATCHDOG_HPP
+
+#include <IOKit/IOService.h>
+
+// Default, the deadline can be changed at runtime
+#define FRAME_WATCHDOG_DEADLINE_NS (20ULL * 1000000ULL)
+// Consecutive frames within half the deadline needed to leave degraded mode
+#define FRAME_WATCHDOG_RECOVERY_FRAMES 16
+
+/*
+ * Tracks how late frames are handed to the HID stack relative to their own timestamp.
+ * A frame past the deadline switches to degraded mode, which lasts until the backlog
+ * has cleared for FRAME_WATCHDOG_RECOVERY_FRAMES frames in a row. The deadline is kept
+ * across reset().
+ */
+class VoodooInputFrameWatchdog {
+public:
+    void reset();
+    void setDeadline(UInt64 new_deadline_ns) { deadline_ns = new_deadline_ns; }
+
+    // Returns true when the mode changed
+    bool update(UInt64 lateness_ns);
+
+    bool isDegraded() const { return degraded; }
+    UInt32 getOverruns() const { return overruns; }
+    UInt32 getModeSwitches() const { return mode_switches; }
+    UInt64 getWorstStall() const { return worst_stall_ns; }
+    UInt64 getDeadline() const { return deadline_ns; }
+
+private:
+    UInt64 deadline_ns {FRAME_WATCHDOG_DEADLINE_NS};
+    bool degraded {false};
+    UInt32 recovered_frames {0};
+    UInt32 overruns {0};
+    UInt32 mode_switches {0};
+    UInt64 worst_stall_ns {0};
+};
+
+#endif // VOODOO_INPUT_FRAME_WATCHDOG_HPP
@@ -0,0 +1,178 @@
+//
+//  VoodooInputGestureGenerator.cpp
+//  VoodooInput
+//
+//  Copyright © 2024 Kishor Prins. All rights reserved.
+//
+
+#include "VoodooInputGestureGenerator.hpp"
+#include "../VoodooInputMultitouch/MultitouchHelpers.h"
+
+#include <string.h>
+
+// Positions below are in permille of the touch surface
+#define PERMILLE 1000
+#define STROKE_MS 500
+#define TAP_FRAMES 3
+
+static inline UInt32 lerp(UInt32 from, UInt32 to, UInt32 step, UInt32 length) {
+    return (UInt32)((SInt32)from + ((SInt32)to - (SInt32)from) * (SInt32)step / (SInt32)length);
+}
+
+// 0 -> PERMILLE -> 0 over length steps
+static inline UInt32 triangle(UInt32 step, UInt32 length) {
+    UInt32 half = length / 2 ? length / 2 : 1;
+    return step < half ? step * PERMILLE / half : (length - step) * PERMILLE / half;
+}
+
+static inline UInt32 clampPermille(SInt32 value) {
+    return value < 0 ? 0 : (value > PERMILLE ? PERMILLE : value);
+}
+
+void VoodooInputGestureGenerator::init(const VoodooInputGestureParams& gesture_params, UInt64 start) {
+    params = gesture_params;
+    if (params.sample_rate == 0)
+        params.sample_rate = 100;
+    if (params.contacts == 0 || params.contacts > VOODOO_INPUT_MAX_TRANSDUCERS)
+        params.contacts = VOODOO_INPUT_MAX_TRANSDUCERS;
+
+    start_ns = last_ns = start;
+    period_ns = 1000000000ULL / params.sample_rate;
+    rng = params.seed ? params.seed : 0x9E3779B9;
+    frame = stroke = 0;
+
+    for (int i = 0; i < VOODOO_INPUT_MAX_TRANSDUCERS; i++) {
+        walk_x[i] = random(100, 900);
+        walk_y[i] = random(100, 900);
+    }
+
+    beginStroke();
+}
+
+// xorshift32
+UInt32 VoodooInputGestureGenerator::random() {
+    rng ^= rng << 13;
+    rng ^= rng >> 17;
+    rng ^= rng << 5;
+    return rng;
+}
+
+UInt32 VoodooInputGestureGenerator::random(UInt32 low, UInt32 high) {
+    return low + random() % (high - low + 1);
+}
+
+void VoodooInputGestureGenerator::beginStroke() {
+    step = 0;
+    length = params.scenario == kVoodooInputGestureTapStorm ? TAP_FRAMES : params.sample_rate * STROKE_MS / 1000;
+    if (length < TAP_FRAMES)
+        length = TAP_FRAMES;
+
+    origin_x = random(150, 350);
+    origin_y = random(150, 350);
+}
+
+void VoodooInputGestureGenerator::setContact(VoodooInputEvent& event, UInt8 slot, UInt32 x, UInt32 y, bool active, MT2FingerType type, AbsoluteTime timestamp) {
+    VoodooInputTransducer& transducer = event.transducers[slot];
+
+    // Map from the intended orientation back to what the provider would report for this transform
+    if (params.transform & kIOFBInvertX)
+        x = PERMILLE - x;
+    if (params.transform & kIOFBInvertY)
+        y = PERMILLE - y;
+    if (params.transform & kIOFBSwapAxes) {
+        UInt32 swap = x;
+        x = y;
+        y = swap;
+    }
+
+    transducer.previousCoordinates = transducer.currentCoordinates;
+    transducer.currentCoordinates.x = (UInt32)((UInt64)x * params.logical_max_x / PERMILLE);
+    transducer.currentCoordinates.y = (UInt32)((UInt64)y * params.logical_max_y / PERMILLE);
+    transducer.currentCoordinates.pressure = type == kMT2FingerTypePalm ? 200 : (UInt8)random(40, 80);
+    transducer.currentCoordinates.width = type == kMT2FingerTypePalm ? 60 : (UInt8)random(8, 14);
+
+    transducer.timestamp = timestamp;
+    transducer.fingerType = type;
+    transducer.secondaryId = slot;
+    transducer.type = VoodooInputTransducerType::FINGER;
+    transducer.isValid = true;
+    transducer.isPhysicalButtonDown = false;
+    transducer.isTransducerActive = active;
+    transducer.supportsPressure = true;
+    transducer.maxPressure = 255;
+
+    if (slot + 1 > event.contact_count)
+        event.contact_count = slot + 1;
+}
+
+UInt64 VoodooInputGestureGenerator::next(VoodooInputEvent& event) {
+    UInt64 nominal = start_ns + (UInt64)frame * period_ns;
+    SInt64 jitter = params.jitter_us ? ((SInt64)random(0, 2 * params.jitter_us) - params.jitter_us) * 1000 : 0;
+    UInt64 timestamp = (SInt64)nominal + jitter > (SInt64)last_ns ? nominal + jitter : last_ns + 1;
+    last_ns = timestamp;
+    frame++;
+
+    event.contact_count = 0;
+    event.timestamp = timestamp;
+
+    bool active = step + 1 < length;
+
+    switch (params.scenario) {
+        case kVoodooInputGestureCursor:
+            setContact(event, 0, lerp(origin_x, origin_x + 500, step, length), origin_y + triangle(step, length) / 2, active, kMT2FingerTypeIndexFinger, timestamp);
+            break;
+
+        case kVoodooInputGestureScroll: {
+            // Accelerating downwards, lifted while still moving so macOS starts momentum
+            UInt32 travel = 600 * step * step / (length * length);
+            setContact(event, 0, 420, 850 - travel, active, kMT2FingerTypeIndexFinger, timestamp);
+            setContact(event, 1, 580, 860 - travel, active, kMT2FingerTypeMiddleFinger, timestamp);
+            break;
+        }
+
+        case kVoodooInputGestureSwipe:
+            for (UInt8 i = 0; i < 3; i++) {
+                setContact(event, i, lerp(150 + i * 80, 650 + i * 80, step, length), 450 + (i == 1 ? 0 : 40), active, (MT2FingerType)(kMT2FingerTypeIndexFinger + i), timestamp);
+            }
+            break;
+
+        case kVoodooInputGesturePinch: {
+            // Alternate pinch in and out
+            UInt32 radius = stroke & 1 ? lerp(80, 350, step, length) : lerp(350, 80, step, length);
+            setContact(event, 0, 500 - radius, 500 - radius, active, kMT2FingerTypeThumb, timestamp);
+            setContact(event, 1, 500 + radius, 500 - radius, active, kMT2FingerTypeIndexFinger, timestamp);
+            setContact(event, 2, 500 + radius, 500 + radius, active, kMT2FingerTypeMiddleFinger, timestamp);
+            setContact(event, 3, 500 - radius, 500 + radius, active, kMT2FingerTypeRingFinger, timestamp);
+            break;
+        }
+
+        case kVoodooInputGesturePalm:
+            setContact(event, 0, 500, 920, true, kMT2FingerTypePalm, timestamp);
+            setContact(event, 1, lerp(origin_x, origin_x + 450, step, length), origin_y + triangle(step, length) / 3, active, kMT2FingerTypeIndexFinger, timestamp);
+            if (!active)
+                event.transducers[0].isTransducerActive = false;
+            break;
+
+        case kVoodooInputGestureTapStorm:
+            setContact(event, 0, origin_x + 200, origin_y + 200, active, kMT2FingerTypeIndexFinger, timestamp);
+            break;
+
+        case kVoodooInputGestureStress:
+            for (UInt8 i = 0; i < params.contacts; i++) {
+                walk_x[i] = clampPermille((SInt32)walk_x[i] + (SInt32)random(0, 40) - 20);
+                walk_y[i] = clampPermille((SInt32)walk_y[i] + (SInt32)random(0, 40) - 20);
+                setContact(event, i, walk_x[i], walk_y[i], active, kMT2FingerTypeIndexFinger, timestamp);
+            }
+            break;
+
+        default:
+            break;
+    }
+
+    if (++step >= length) {
+        stroke++;
+        beginStroke();
+    }
+
+    return timestamp;
+}
@@ -0,0 +1,74 @@
+//
+//  VoodooInputGestureGenerator.hpp
+//  VoodooInput
+//
+//  Copyright © 2024 Kishor Prins. All rights reserved.
+//
+
+#ifndef VOODOO_INPUT_GESTURE_GENERATOR_HPP
+#define VOODOO_INPUT_GESTURE_GENERATOR_HPP
+
+#include <IOKit/IOService.h>
+
+#include "../VoodooInputMultitouch/VoodooInputEvent.h"
+
+/*
+ * Deterministic VoodooInputEvent streams for common gestures. Uses integer math only
+ * and never calls into the kernel, so the same streams can be reproduced outside of it.
+ * Identical parameters and seed always produce identical frames.
+ */
+enum VoodooInputGestureScenario {
+    kVoodooInputGestureCursor,
+    kVoodooInputGestureScroll,
+    kVoodooInputGestureSwipe,
+    kVoodooInputGesturePinch,
+    kVoodooInputGesturePalm,
+    kVoodooInputGestureTapStorm,
+    kVoodooInputGestureStress,
+    kVoodooInputGestureScenarioCount
+};
+
+struct VoodooInputGestureParams {
+    VoodooInputGestureScenario scenario;
+    UInt32 seed;
+    UInt32 sample_rate;
+    UInt32 jitter_us;
+    UInt32 logical_max_x;
+    UInt32 logical_max_y;
+    UInt8 transform;
+    // Only used by the stress scenario
+    UInt8 contacts;
+};
+
+class VoodooInputGestureGenerator {
+public:
+    void init(const VoodooInputGestureParams& params, UInt64 start_ns);
+
+    // Fills the next frame and returns its timestamp in nanoseconds
+    UInt64 next(VoodooInputEvent& event);
+
+    UInt32 getFrameCount() const { return frame; }
+    const VoodooInputGestureParams& getParams() const { return params; }
+
+private:
+    VoodooInputGestureParams params {};
+    UInt64 start_ns {0};
+    UInt64 last_ns {0};
+    UInt64 period_ns {0};
+    UInt32 rng {0};
+    UInt32 frame {0};
+    UInt32 stroke {0};
+    UInt32 step {0};
+    UInt32 length {0};
+    UInt32 origin_x {0};
+    UInt32 origin_y {0};
+    UInt32 walk_x[VOODOO_INPUT_MAX_TRANSDUCERS] {};
+    UInt32 walk_y[VOODOO_INPUT_MAX_TRANSDUCERS] {};
+
+    UInt32 random();
+    UInt32 random(UInt32 low, UInt32 high);
+    void beginStroke();
+    void setContact(VoodooInputEvent& event, UInt8 slot, UInt32 x, UInt32 y, bool active, MT2FingerType type, AbsoluteTime timestamp);
+};
+
+#endif // VOODOO_INPUT_GESTURE_GENERATOR_HPP
@@ -0,0 +1,138 @@
+//
+//  VoodooInputHIDProfile.cpp
+//  VoodooInput
+//
+//  Copyright © 2024 Kishor Prins. All rights reserved.
+//
+
+#include "VoodooInputHIDProfile.hpp"
+#include "VoodooInputIDs.hpp"
+
+#include <libkern/version.h>
+
+// Ordered by min_darwin_major, a higher rate built-in trackpad identity can be appended here
+static constexpr VoodooInputHIDProfile profiles[] = {
+    {"MacBook8,1", kVoodooInputProductMacbook8_1, 0x804, 0, 0x81, 0x16, 0x1E, 0x056B, 0x49},
+    {"MacBookAir10,1", kVoodooInputProductMacbookAir10_1, 0x804, kVoodooInputVersionMonterey, 0x81, 0x16, 0x1E, 0x056B, 0x49},
+};
+
+static constexpr size_t profile_count = sizeof(profiles) / sizeof(profiles[0]);
+
+static constexpr VoodooInputHIDTables tables[] = {
+    buildHIDTables(profiles[0]),
+    buildHIDTables(profiles[1]),
+};
+
+static_assert(sizeof(tables) / sizeof(tables[0]) == profile_count, "Every profile needs its tables");
+
+const VoodooInputHIDTables& VoodooInputGetHIDTables() {
+    size_t selected = 0;
+
+    for (size_t i = 0; i < profile_count; i++) {
+        if (version_major >= profiles[i].min_darwin_major)
+            selected = i;
+    }
+
+    return tables[selected];
+}
+
+// The generated bytes must stay identical to what the emulation shipped with as hand written blobs
+namespace HIDProfileCheck {
+    constexpr UInt8 report_descriptor[] = {0x05, 0x01, 0x09, 0x02, 0xa1, 0x01, 0x09, 0x01, 0xa1, 0x00, 0x05, 0x09, 0x19, 0x01, 0x29, 0x03, 0x15, 0x00, 0x25, 0x01, 0x85, 0x02, 0x95, 0x03, 0x75, 0x01, 0x81, 0x02, 0x95, 0x01, 0x75, 0x05, 0x81, 0x01, 0x05, 0x01, 0x09, 0x30, 0x09, 0x31, 0x15, 0x81, 0x25, 0x7f, 0x75, 0x08, 0x95, 0x02, 0x81, 0x06, 0x95, 0x04, 0x75, 0x08, 0x81, 0x01, 0xc0, 0xc0, 0x05, 0x0d, 0x09, 0x05, 0xa1, 0x01, 0x06, 0x00, 0xff, 0x09, 0x0c, 0x15, 0x00, 0x26, 0xff, 0x00, 0x75, 0x08, 0x95, 0x10, 0x85, 0x3f, 0x81, 0x22, 0xc0, 0x06, 0x00, 0xff, 0x09, 0x0c, 0xa1, 0x01, 0x06, 0x00, 0xff, 0x09, 0x0c, 0x15, 0x00, 0x26, 0xff, 0x00, 0x85, 0x44, 0x75, 0x08, 0x96, 0x6b, 0x05, 0x81, 0x00, 0xc0};
+    constexpr UInt8 actuator_descriptor[] = {0x06, 0x00, 0xff, 0x09, 0x0d, 0xa1, 0x01, 0x06, 0x00, 0xff, 0x09, 0x0d, 0x15, 0x00, 0x26, 0xff, 0x00, 0x75, 0x08, 0x85, 0x3f, 0x96, 0x0f, 0x00, 0x81, 0x02, 0x09, 0x0d, 0x85, 0x53, 0x96, 0x3f, 0x00, 0x91, 0x02, 0xc0};
+    // Surface size zeroed, it is patched in at run time
+    constexpr UInt8 sensor_description[] = {0xDB, 0x01, 0x02, 0x00,
+        0xD1, 0x81,
+        0x0D, 0x00,
+        0xD3, 0x01, 0x16, 0x1E, 0x03, 0x95, 0x00, 0x14, 0x1E, 0x62, 0x05, 0x00, 0x00,
+        0x10, 0x00,
+        0xD0, 0x02, 0x01, 0x00, 0x14, 0x01, 0x00, 0x1E, 0x00, 0x02, 0x14, 0x02, 0x01, 0x0E, 0x02, 0x00,
+        0x07, 0x00,
+        0xA1, 0x00, 0x00, 0x05, 0x00, 0xFC, 0x01,
+        0x11, 0x00,
+        0xD9, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x44, 0xE3, 0x52, 0xFF, 0xBD, 0x1E, 0xE4, 0x26,
+        0x7F, 0x00, 0x00, 0x00, 0x00};
+    // Report id, acknowledged length, reply
+    constexpr UInt8 features[][3] = {{0xD1, 0x01, 0x81}, {0xD3, 0x0C, 0x01}, {0xD0, 0x0F, 0x02}, {0xA1, 0x06, 0x00}, {0x7F, 0x04, 0x00}, {0xC8, 0x01, 0x08}, {0x00, 0x00, 0x01}, {0x02, 0x00, 0x01}};
+
+    template <size_t Capacity, size_t N>
+    constexpr bool equal(const VoodooInputHIDBytes<Capacity>& generated, const UInt8 (&expected)[N]) {
+        if (generated.length != N)
+            return false;
+        for (size_t i = 0; i < N; i++) {
+            if (generated.bytes[i] != expected[i])
+                return false;
+        }
+        return true;
+    }
+
+    constexpr bool features_match(const VoodooInputHIDTables& generated) {
+        for (const auto& expected : features) {
+            const VoodooInputFeatureReport* feature = generated.findFeature(expected[0]);
+            if (!feature || feature->ack_length != expected[1] || feature->response.bytes[1] != expected[2])
+                return false;
+        }
+
+        const VoodooInputFeatureReport* description = generated.findFeature(MT2_SENSOR_DESCRIPTION_REPORT_ID);
+        return description && description->ack_length == 0x49 && description->surface_offset == 50 &&
+            equal(description->response, sensor_description);
+    }
+
+    constexpr bool profile_matches(const VoodooInputHIDTables& generated) {
+        return equal(generated.report_descriptor, report_descriptor) && equal(generated.actuator_descriptor, actuator_descriptor) &&
+            features_match(generated);
+    }
+
+    // Bits the descriptor gives report_id for one main item type, walking the short items
+    template <size_t Capacity>
+    constexpr UInt32 report_bits(const VoodooInputHIDBytes<Capacity>& descriptor, UInt8 report_id, UInt8 main_tag) {
+        UInt32 bits = 0, report_size = 0, report_count = 0;
+        UInt8 current_id = 0;
+        for (size_t i = 0; i < descriptor.length;) {
+            UInt8 prefix = descriptor.bytes[i];
+            size_t size = (prefix & 0x3) == 0x3 ? 4 : (prefix & 0x3);
+            UInt32 value = 0;
+            for (size_t j = 0; j < size; j++)
+                value |= (UInt32)descriptor.bytes[i + 1 + j] << (j * 8);
+
+            if ((prefix & 0xFC) == HID_REPORT_ID)
+                current_id = (UInt8)value;
+            else if ((prefix & 0xFC) == HID_REPORT_SIZE)
+                report_size = value;
+            else if ((prefix & 0xFC) == HID_REPORT_COUNT)
+                report_count = value;
+            else if ((prefix & 0xFC) == main_tag && current_id == report_id)
+                bits += report_size * report_count;
+            i += 1 + size;
+        }
+        return bits;
+    }
+
+    // Every report of both descriptors keeps its layout, 0x3F spans the multitouch and actuator collections
+    constexpr bool composite_valid(const VoodooInputHIDTables& generated) {
+        const VoodooInputHIDBytes<192>& composite = generated.composite_descriptor;
+        if (composite.length != generated.report_descriptor.length + generated.actuator_descriptor.length)
+            return false;
+        for (size_t i = 0; i < generated.report_descriptor.length; i++) {
+            if (composite.bytes[i] != generated.report_descriptor.bytes[i])
+                return false;
+        }
+
+        const UInt8 main_tags[] = {HID_INPUT, HID_OUTPUT, HID_FEATURE};
+        for (UInt32 id = 1; id < 256; id++) {
+            for (UInt8 tag : main_tags) {
+                UInt32 simulator = report_bits(generated.report_descriptor, (UInt8)id, tag);
+                UInt32 actuator = report_bits(generated.actuator_descriptor, (UInt8)id, tag);
+                if (simulator && actuator && (id != 0x3F || tag != HID_INPUT))
+                    return false;
+                if (report_bits(composite, (UInt8)id, tag) != simulator + actuator)
+                    return false;
+            }
+        }
+        return report_bits(composite, 0x3F, HID_INPUT) == (0x10 + 0x0F) * 8;
+    }
+}
+
+static_assert(HIDProfileCheck::profile_matches(tables[0]), "MacBook8,1 tables differ from the reference bytes");
+static_assert(HIDProfileCheck::profile_matches(tables[1]), "MacBookAir10,1 tables differ from the reference bytes");
+static_assert(HIDProfileCheck::composite_valid(tables[0]) && HIDProfileCheck::composite_valid(tables[1]), "Composite descriptor changes a report layout");
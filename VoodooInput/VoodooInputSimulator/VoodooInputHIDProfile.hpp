@@ -0,0 +1,257 @@
+//
+//  VoodooInputHIDProfile.hpp
+//  VoodooInput
+//
+//  Copyright © 2024 Kishor Prins. All rights reserved.
+//
+
+#ifndef VOODOO_INPUT_HID_PROFILE_HPP
+#define VOODOO_INPUT_HID_PROFILE_HPP
+
+#include <IOKit/IOService.h>
+
+// Short item tags without their size bits
+#define HID_USAGE_PAGE 0x04
+#define HID_USAGE 0x08
+#define HID_USAGE_MIN 0x18
+#define HID_USAGE_MAX 0x28
+#define HID_COLLECTION 0xA0
+#define HID_END_COLLECTION 0xC0
+#define HID_INPUT 0x80
+#define HID_OUTPUT 0x90
+#define HID_FEATURE 0xB0
+#define HID_REPORT_ID 0x84
+#define HID_REPORT_SIZE 0x74
+#define HID_REPORT_COUNT 0x94
+#define HID_LOGICAL_MIN 0x14
+#define HID_LOGICAL_MAX 0x24
+#define HID_PHYSICAL_MAX 0x44
+#define HID_UNIT_EXPONENT 0x54
+#define HID_UNIT 0x64
+
+#define HID_DATA_ARRAY_ABS 0x00
+#define HID_CONST_ARRAY 0x01
+#define HID_DATA_VAR_ABS 0x02
+#define HID_CONST 0x03
+#define HID_DATA_VAR_REL 0x06
+#define HID_DATA_VAR_ABS_NO_PREFERRED 0x22
+
+/*
+ * Fixed capacity byte writer for report descriptors and feature replies. Every member
+ * is constexpr, so tables built from it at namespace scope are computed by the compiler,
+ * while the same calls still work at run time for descriptors with run time extents.
+ */
+template <size_t Capacity>
+struct VoodooInputHIDBytes {
+    UInt8 bytes[Capacity] {};
+    size_t length {0};
+
+    constexpr VoodooInputHIDBytes& raw(UInt8 value) {
+        bytes[length++] = value;
+        return *this;
+    }
+
+    constexpr VoodooInputHIDBytes& le16(UInt16 value) {
+        return raw((UInt8)value).raw((UInt8)(value >> 8));
+    }
+
+    template <size_t N>
+    constexpr VoodooInputHIDBytes& append(const VoodooInputHIDBytes<N>& other) {
+        for (size_t i = 0; i < other.length; i++)
+            raw(other.bytes[i]);
+        return *this;
+    }
+
+    // Short item with an explicit data size of 1, 2 or 4 bytes
+    constexpr VoodooInputHIDBytes& item(UInt8 tag, UInt32 value, UInt8 size) {
+        raw(tag | (size == 4 ? 0x3 : size));
+        for (UInt8 i = 0; i < size; i++)
+            raw((UInt8)(value >> (i * 8)));
+        return *this;
+    }
+
+    constexpr VoodooInputHIDBytes& unsignedItem(UInt8 tag, UInt32 value) {
+        return item(tag, value, value <= 0xFF ? 1 : (value <= 0xFFFF ? 2 : 4));
+    }
+
+    constexpr VoodooInputHIDBytes& signedItem(UInt8 tag, SInt32 value) {
+        return item(tag, (UInt32)value, value >= -0x80 && value <= 0x7F ? 1 : (value >= -0x8000 && value <= 0x7FFF ? 2 : 4));
+    }
+
+    constexpr VoodooInputHIDBytes& usagePage(UInt16 page) { return unsignedItem(HID_USAGE_PAGE, page); }
+    constexpr VoodooInputHIDBytes& usage(UInt16 usage) { return unsignedItem(HID_USAGE, usage); }
+    constexpr VoodooInputHIDBytes& usageRange(UInt16 min, UInt16 max) { return unsignedItem(HID_USAGE_MIN, min).unsignedItem(HID_USAGE_MAX, max); }
+    constexpr VoodooInputHIDBytes& collection(UInt8 type) { return item(HID_COLLECTION, type, 1); }
+    constexpr VoodooInputHIDBytes& endCollection() { return raw(HID_END_COLLECTION); }
+    constexpr VoodooInputHIDBytes& reportId(UInt8 id) { return item(HID_REPORT_ID, id, 1); }
+    constexpr VoodooInputHIDBytes& reportSize(UInt8 bits) { return item(HID_REPORT_SIZE, bits, 1); }
+    constexpr VoodooInputHIDBytes& reportCount(UInt16 count) { return unsignedItem(HID_REPORT_COUNT, count); }
+    constexpr VoodooInputHIDBytes& logicalMin(SInt32 value) { return signedItem(HID_LOGICAL_MIN, value); }
+    constexpr VoodooInputHIDBytes& logicalMax(SInt32 value) { return signedItem(HID_LOGICAL_MAX, value); }
+    constexpr VoodooInputHIDBytes& input(UInt8 flags) { return item(HID_INPUT, flags, 1); }
+    constexpr VoodooInputHIDBytes& output(UInt8 flags) { return item(HID_OUTPUT, flags, 1); }
+    constexpr VoodooInputHIDBytes& feature(UInt8 flags) { return item(HID_FEATURE, flags, 1); }
+};
+
+/*
+ * One emulated trackpad identity. Everything the simulator and actuator hand to the
+ * HID family is generated from these values by buildHIDTables.
+ */
+struct VoodooInputHIDProfile {
+    const char* name;
+    UInt16 product_id;
+    UInt16 version;
+    // First Darwin major version this identity is used on
+    UInt8 min_darwin_major;
+    UInt8 family_id;
+    UInt8 sensor_rows;
+    UInt8 sensor_columns;
+    // Bytes in the vendor input report 0x44
+    UInt16 vendor_report_length;
+    // Length acknowledged for the 0xDB sensor description, as reported by real hardware
+    UInt8 sensor_description_ack;
+};
+
+#define MT2_FEATURE_MAX_SIZE 80
+#define MT2_FEATURE_COUNT 10
+
+// Sensor surface size in 0.01mm, filled in from the provider at run time
+#define MT2_SURFACE_REPORT_ID 0xD9
+#define MT2_SENSOR_DESCRIPTION_REPORT_ID 0xDB
+#define MT2_SURFACE_WIDTH_OFFSET 1
+#define MT2_SURFACE_HEIGHT_OFFSET 5
+
+// Actuation output report macOS sends to the actuator collection
+#define MT2_ACTUATOR_REPORT_ID 0x53
+
+struct VoodooInputFeatureReport {
+    UInt8 report_id;
+    // Length acknowledged when the host selects this report through report 0x01, 0 when never selected
+    UInt8 ack_length;
+    VoodooInputHIDBytes<MT2_FEATURE_MAX_SIZE> response;
+    // Whether and where the response embeds the 0xD9 surface description
+    bool has_surface;
+    size_t surface_offset;
+};
+
+struct VoodooInputHIDTables {
+    const VoodooInputHIDProfile* profile;
+    VoodooInputHIDBytes<128> report_descriptor;
+    VoodooInputHIDBytes<64> actuator_descriptor;
+    // Both of the above from one device, see buildCompositeDescriptor
+    VoodooInputHIDBytes<192> composite_descriptor;
+    VoodooInputFeatureReport features[MT2_FEATURE_COUNT];
+
+    constexpr const VoodooInputFeatureReport* findFeature(UInt8 report_id) const {
+        for (size_t i = 0; i < MT2_FEATURE_COUNT; i++) {
+            if (features[i].report_id == report_id)
+                return &features[i];
+        }
+        return nullptr;
+    }
+};
+
+constexpr VoodooInputHIDBytes<128> buildReportDescriptor(const VoodooInputHIDProfile& profile) {
+    VoodooInputHIDBytes<128> descriptor {};
+
+    // Mouse fallback, report 0x02
+    descriptor.usagePage(0x01).usage(0x02).collection(0x01)
+        .usage(0x01).collection(0x00)
+            .usagePage(0x09).usageRange(1, 3).logicalMin(0).logicalMax(1)
+            .reportId(0x02).reportCount(3).reportSize(1).input(HID_DATA_VAR_ABS)
+            .reportCount(1).reportSize(5).input(HID_CONST_ARRAY)
+            .usagePage(0x01).usage(0x30).usage(0x31).logicalMin(-127).logicalMax(127)
+            .reportSize(8).reportCount(2).input(HID_DATA_VAR_REL)
+            .reportCount(4).reportSize(8).input(HID_CONST_ARRAY)
+        .endCollection()
+    .endCollection();
+
+    // Touchpad, multitouch report 0x3F
+    descriptor.usagePage(0x0D).usage(0x05).collection(0x01)
+        .usagePage(0xFF00).usage(0x0C).logicalMin(0).logicalMax(0xFF)
+        .reportSize(8).reportCount(0x10).reportId(0x3F).input(HID_DATA_VAR_ABS_NO_PREFERRED)
+    .endCollection();
+
+    // Vendor report 0x44
+    descriptor.usagePage(0xFF00).usage(0x0C).collection(0x01)
+        .usagePage(0xFF00).usage(0x0C).logicalMin(0).logicalMax(0xFF)
+        .reportId(0x44).reportSize(8).item(HID_REPORT_COUNT, profile.vendor_report_length, 2).input(HID_DATA_ARRAY_ABS)
+    .endCollection();
+
+    return descriptor;
+}
+
+constexpr VoodooInputHIDBytes<64> buildActuatorDescriptor(const VoodooInputHIDProfile& profile) {
+    VoodooInputHIDBytes<64> descriptor {};
+
+    // Input report 0x3F and the 0x53 actuation output report
+    descriptor.usagePage(0xFF00).usage(0x0D).collection(0x01)
+        .usagePage(0xFF00).usage(0x0D).logicalMin(0).logicalMax(0xFF).reportSize(8)
+        .reportId(0x3F).item(HID_REPORT_COUNT, 0x0F, 2).input(HID_DATA_VAR_ABS).usage(0x0D)
+        .reportId(MT2_ACTUATOR_REPORT_ID).item(HID_REPORT_COUNT, 0x3F, 2).output(HID_DATA_VAR_ABS)
+    .endCollection();
+
+    return descriptor;
+}
+
+/*
+ * Multitouch and actuator collections for a simulator that also takes the actuator reports.
+ * Both collections declare input report 0x3F, which makes it one report spanning the two:
+ * the 16 multitouch bytes followed by the 15 actuator bytes. Neither side ever sends it,
+ * so the only effect is the element layout the HID family builds, and each collection
+ * keeps the elements it has as a separate device.
+ */
+constexpr VoodooInputHIDBytes<192> buildCompositeDescriptor(const VoodooInputHIDProfile& profile) {
+    VoodooInputHIDBytes<192> descriptor {};
+    descriptor.append(buildReportDescriptor(profile)).append(buildActuatorDescriptor(profile));
+    return descriptor;
+}
+
+constexpr VoodooInputFeatureReport buildFeature(UInt8 report_id, const UInt8* payload, size_t length, bool acknowledged) {
+    VoodooInputFeatureReport feature {report_id, acknowledged ? (UInt8)length : (UInt8)0, {}, report_id == MT2_SURFACE_REPORT_ID, 0};
+    feature.response.raw(report_id);
+    for (size_t i = 0; i < length; i++)
+        feature.response.raw(payload[i]);
+    return feature;
+}
+
+constexpr VoodooInputHIDTables buildHIDTables(const VoodooInputHIDProfile& profile) {
+    const UInt8 status[] = {0x01};
+    const UInt8 family[] = {profile.family_id};
+    const UInt8 sensor[] = {0x01, profile.sensor_rows, profile.sensor_columns, 0x03, 0x95, 0x00, 0x14, 0x1E, 0x62, 0x05, 0x00, 0x00};
+    const UInt8 region[] = {0x02, 0x01, 0x00, 0x14, 0x01, 0x00, 0x1E, 0x00, 0x02, 0x14, 0x02, 0x01, 0x0E, 0x02, 0x00};
+    const UInt8 region_param[] = {0x00, 0x00, 0x05, 0x00, 0xFC, 0x01};
+    const UInt8 surface[] = {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x44, 0xE3, 0x52, 0xFF, 0xBD, 0x1E, 0xE4, 0x26};
+    const UInt8 unknown_7f[] = {0x00, 0x00, 0x00, 0x00};
+    const UInt8 unknown_c8[] = {0x08};
+
+    VoodooInputHIDTables tables {&profile, buildReportDescriptor(profile), buildActuatorDescriptor(profile), buildCompositeDescriptor(profile), {}};
+    tables.features[0] = buildFeature(0x00, status, sizeof(status), false);
+    tables.features[1] = buildFeature(0x02, status, sizeof(status), false);
+    tables.features[2] = buildFeature(0xD1, family, sizeof(family), true);
+    tables.features[3] = buildFeature(0xD3, sensor, sizeof(sensor), true);
+    tables.features[4] = buildFeature(0xD0, region, sizeof(region), true);
+    tables.features[5] = buildFeature(0xA1, region_param, sizeof(region_param), true);
+    tables.features[6] = buildFeature(MT2_SURFACE_REPORT_ID, surface, sizeof(surface), true);
+    tables.features[7] = buildFeature(0x7F, unknown_7f, sizeof(unknown_7f), true);
+    tables.features[8] = buildFeature(0xC8, unknown_c8, sizeof(unknown_c8), true);
+
+    // 0xDB aggregates the sensor reports, each prefixed with its length, followed by 0x7F
+    VoodooInputFeatureReport& description = tables.features[9];
+    description = {MT2_SENSOR_DESCRIPTION_REPORT_ID, profile.sensor_description_ack, {}, true, 0};
+    description.response.raw(MT2_SENSOR_DESCRIPTION_REPORT_ID).raw(0x01);
+    for (size_t i = 2; i <= 6; i++) {
+        const VoodooInputHIDBytes<MT2_FEATURE_MAX_SIZE>& part = tables.features[i].response;
+        description.response.le16((UInt16)part.length);
+        if (tables.features[i].report_id == MT2_SURFACE_REPORT_ID)
+            description.surface_offset = description.response.length;
+        description.response.append(part);
+    }
+    description.response.append(tables.features[7].response);
+
+    return tables;
+}
+
+const VoodooInputHIDTables& VoodooInputGetHIDTables();
+
+#endif // VOODOO_INPUT_HID_PROFILE_HPP
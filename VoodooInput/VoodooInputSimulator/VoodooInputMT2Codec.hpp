@@ -0,0 +1,205 @@
+//
+//  VoodooInputMT2Codec.hpp
+//  VoodooInput
+//
+//  Copyright © 2024 Kishor Prins. All rights reserved.
+//
+
+#ifndef VOODOO_INPUT_MT2_CODEC_HPP
+#define VOODOO_INPUT_MT2_CODEC_HPP
+
+#include <IOKit/IOService.h>
+
+/* State bits reference: linux/drivers/hid/hid-magicmouse.c#L58-L63 */
+#define MT2_TOUCH_STATE_BIT_TRANSITION (0x1)
+#define MT2_TOUCH_STATE_BIT_NEAR (0x1 << 1)
+#define MT2_TOUCH_STATE_BIT_CONTACT (0x1 << 2)
+
+enum TouchStates {
+    kTouchStateInactive = 0x0,
+    kTouchStateStart = MT2_TOUCH_STATE_BIT_NEAR | MT2_TOUCH_STATE_BIT_TRANSITION,
+    kTouchStateActive = MT2_TOUCH_STATE_BIT_CONTACT,
+    kTouchStateStop = MT2_TOUCH_STATE_BIT_CONTACT | MT2_TOUCH_STATE_BIT_NEAR | MT2_TOUCH_STATE_BIT_TRANSITION
+};
+
+#define MT2_HEADER_SIZE 12
+#define MT2_FINGER_SIZE 9
+#define MT2_TIMESTAMP_BITS 21
+#define MT2_TIMESTAMP_MASK ((1 << MT2_TIMESTAMP_BITS) - 1)
+
+/* Finger Packet
++---+---+---+---+---+---+---+---+---+
+|   | 7 | 6 | 5 | 4 | 3 | 2 | 1 | 0 |
++---+---+---+---+---+---+---+---+---+
+| 0 |           x: SInt13           |
++---+-----------+                   +
+| 1 |           |                   |
++---+           +-------------------+
+| 2 |           y: SInt13           |
++---+-----------+-----------+       +
+| 3 |   state   |   finger  |       |
+|   |   UInt3   |   UInt3   |       |
++---+-----------+-----------+-------+
+| 4 |       touchMajor: UInt8       |
++---+-------------------------------+
+| 5 |       touchMinor: UInt8       |
++---+-------------------------------+
+| 6 |          size: UInt8          |
++---+-------------------------------+
+| 7 |        pressure: UInt8        |
++---+-----------+---+---------------+
+| 8 |   angle   | 0 |    touchID    |
+|   |   UInt3   |   |     UInt4     |
++---+-----------+---+---------------+
+*/
+struct MT2Finger {
+    SInt16 x;
+    SInt16 y;
+    UInt8 finger;
+    UInt8 state;
+    UInt8 touchMajor;
+    UInt8 touchMinor;
+    UInt8 size;
+    UInt8 pressure;
+    UInt8 identifier;
+    UInt8 angle;
+};
+
+/* Header
+ * 0: report id, 1: button, 2-6: unused, 7: touch active, 8: multitouch report id,
+ * 9-11: 0b100 followed by a 21 bit millisecond timestamp
+ */
+struct MT2Header {
+    UInt8 reportId;
+    UInt8 button;
+    UInt8 touchActive;
+    UInt8 multitouchReportId;
+    UInt32 timestamp;
+};
+
+// Arithmetic shift, what the bitfield used to compile to
+static constexpr SInt16 MT2SignExtend13(UInt16 value) {
+    return (SInt16)((SInt16)(value << 3) >> 3);
+}
+
+static constexpr void MT2EncodeTimestamp(UInt32 milliseconds, UInt8* out) {
+    out[0] = (UInt8)((milliseconds << 3) | 0x4);
+    out[1] = (UInt8)(milliseconds >> 5);
+    out[2] = (UInt8)(milliseconds >> 13);
+}
+
+static constexpr UInt32 MT2DecodeTimestamp(const UInt8* in) {
+    return ((UInt32)in[0] >> 3) | ((UInt32)in[1] << 5) | ((UInt32)in[2] << 13);
+}
+
+static constexpr void MT2EncodeHeader(const MT2Header& header, UInt8* out) {
+    out[0] = header.reportId;
+    out[1] = header.button;
+    out[2] = out[3] = out[4] = out[5] = out[6] = 0;
+    out[7] = header.touchActive;
+    out[8] = header.multitouchReportId;
+    MT2EncodeTimestamp(header.timestamp, out + 9);
+}
+
+static constexpr MT2Header MT2DecodeHeader(const UInt8* in) {
+    return MT2Header {in[0], in[1], in[7], in[8], MT2DecodeTimestamp(in + 9)};
+}
+
+static constexpr void MT2EncodeFinger(const MT2Finger& finger, UInt8* out) {
+    // Everything is read before the first store, out may alias finger as far as the compiler knows.
+    // Bytes 0-7 then go out as one little endian word, which compilers merge into a single store.
+    UInt64 word = ((UInt64)((UInt16)finger.x & 0x1FFF)) | ((UInt64)((UInt16)finger.y & 0x1FFF) << 13) |
+        ((UInt64)(finger.finger & 0x7) << 26) | ((UInt64)(finger.state & 0x7) << 29) | ((UInt64)finger.touchMajor << 32) |
+        ((UInt64)finger.touchMinor << 40) | ((UInt64)finger.size << 48) | ((UInt64)finger.pressure << 56);
+    UInt8 last = (UInt8)((finger.identifier & 0xF) | ((finger.angle & 0x7) << 5));
+
+    out[0] = (UInt8)word;
+    out[1] = (UInt8)(word >> 8);
+    out[2] = (UInt8)(word >> 16);
+    out[3] = (UInt8)(word >> 24);
+    out[4] = (UInt8)(word >> 32);
+    out[5] = (UInt8)(word >> 40);
+    out[6] = (UInt8)(word >> 48);
+    out[7] = (UInt8)(word >> 56);
+    out[8] = last;
+}
+
+static constexpr MT2Finger MT2DecodeFinger(const UInt8* in) {
+    return MT2Finger {
+        MT2SignExtend13((UInt16)(in[0] | ((in[1] & 0x1F) << 8))),
+        MT2SignExtend13((UInt16)((in[1] >> 5) | (in[2] << 3) | ((in[3] & 0x3) << 11))),
+        (UInt8)((in[3] >> 2) & 0x7),
+        (UInt8)(in[3] >> 5),
+        in[4],
+        in[5],
+        in[6],
+        in[7],
+        (UInt8)(in[8] & 0xF),
+        (UInt8)(in[8] >> 5)
+    };
+}
+
+// hid-magicmouse treats a contact as down when either of the two high state bits is set (tdata[3] & 0xC0)
+static constexpr bool MT2FingerIsDown(const UInt8* in) {
+    return (in[3] & 0xC0) != 0;
+}
+
+// hid-magicmouse reports the angle as orientation around pi/2
+static constexpr SInt8 MT2FingerOrientation(const UInt8* in) {
+    return (SInt8)(in[8] >> 5) - 4;
+}
+
+namespace MT2CodecCheck {
+    constexpr MT2Finger kFinger {-4067, 2603, 2, kTouchStateStop, 20, 18, 10, 120, 14, 4};
+
+    constexpr bool fingerLayout() {
+        UInt8 bytes[MT2_FINGER_SIZE] {};
+        MT2EncodeFinger(kFinger, bytes);
+        // x = 0x101D, y = 0x0A2B
+        return bytes[0] == 0x1D && bytes[1] == 0x70 && bytes[2] == 0x45 && bytes[3] == 0xE9 &&
+            bytes[4] == 20 && bytes[5] == 18 && bytes[6] == 10 && bytes[7] == 120 && bytes[8] == 0x8E;
+    }
+
+    constexpr bool fingerRoundTrip(SInt16 x, SInt16 y) {
+        UInt8 bytes[MT2_FINGER_SIZE] {};
+        MT2Finger finger = kFinger;
+        finger.x = x;
+        finger.y = y;
+        MT2EncodeFinger(finger, bytes);
+        MT2Finger decoded = MT2DecodeFinger(bytes);
+        return decoded.x == x && decoded.y == y && decoded.finger == finger.finger && decoded.state == finger.state &&
+            decoded.touchMajor == finger.touchMajor && decoded.touchMinor == finger.touchMinor && decoded.size == finger.size &&
+            decoded.pressure == finger.pressure && decoded.identifier == finger.identifier && decoded.angle == finger.angle;
+    }
+
+    constexpr bool headerRoundTrip(UInt32 timestamp) {
+        UInt8 bytes[MT2_HEADER_SIZE] {};
+        MT2EncodeHeader(MT2Header {0x02, 1, 0x3, 0x31, timestamp}, bytes);
+        MT2Header decoded = MT2DecodeHeader(bytes);
+        return (bytes[9] & 0x7) == 0x4 && decoded.reportId == 0x02 && decoded.button == 1 &&
+            decoded.touchActive == 0x3 && decoded.multitouchReportId == 0x31 && decoded.timestamp == (timestamp & MT2_TIMESTAMP_MASK);
+    }
+
+    constexpr bool hidMagicMouseState() {
+        UInt8 bytes[MT2_FINGER_SIZE] {};
+        MT2Finger finger = kFinger;
+        finger.state = kTouchStateInactive;
+        MT2EncodeFinger(finger, bytes);
+        bool inactive = !MT2FingerIsDown(bytes);
+        finger.state = kTouchStateStart;
+        MT2EncodeFinger(finger, bytes);
+        bool start = MT2FingerIsDown(bytes);
+        finger.state = kTouchStateActive;
+        MT2EncodeFinger(finger, bytes);
+        return inactive && start && MT2FingerIsDown(bytes) && MT2FingerOrientation(bytes) == 0;
+    }
+}
+
+static_assert(MT2CodecCheck::fingerLayout(), "Unexpected MT2 finger byte layout");
+static_assert(MT2CodecCheck::fingerRoundTrip(-4096, 4095) && MT2CodecCheck::fingerRoundTrip(0, -1) &&
+              MT2CodecCheck::fingerRoundTrip(4067, -2603), "MT2 finger round trip failed");
+static_assert(MT2CodecCheck::headerRoundTrip(0) && MT2CodecCheck::headerRoundTrip(MT2_TIMESTAMP_MASK) &&
+              MT2CodecCheck::headerRoundTrip(MT2_TIMESTAMP_MASK + 5), "MT2 header round trip failed");
+static_assert(MT2CodecCheck::hidMagicMouseState(), "MT2 state bits do not match hid-magicmouse");
+
+#endif // VOODOO_INPUT_MT2_CODEC_HPP
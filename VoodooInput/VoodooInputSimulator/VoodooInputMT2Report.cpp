@@ -0,0 +1,255 @@
+//
+//  VoodooInputMT2Report.cpp
+//  VoodooInput
+//
+//  Copyright © 2024 Kishor Prins. All rights reserved.
+//  Report construction moved from VoodooInputSimulatorDevice.cpp, Copyright © 2018 Alexandre Daoud and Kishor Prins
+//
+
+#include "VoodooInputMT2Report.hpp"
+
+bool VoodooInputMT2Encoder::init(UInt8* report, VoodooInputTrace* new_trace) {
+    timestamps.init();
+    input_report = (MAGIC_TRACKPAD_INPUT_REPORT*)report;
+    trace = new_trace;
+    reset();
+    return mailbox.init();
+}
+
+bool VoodooInputMT2Encoder::init(UInt8* report, VoodooInputTrace* new_trace, UInt32 numer, UInt32 denom, VoodooInputTimestamp::Clock clock) {
+    timestamps.init(numer, denom, clock);
+    input_report = (MAGIC_TRACKPAD_INPUT_REPORT*)report;
+    trace = new_trace;
+    reset();
+    return mailbox.init();
+}
+
+void VoodooInputMT2Encoder::release() {
+    input_report = nullptr;
+    interpolator.reset();
+    mailbox.release();
+}
+
+void VoodooInputMT2Encoder::reset() {
+    sample_estimator.init();
+    contact_tracker.reset();
+    frame_watchdog.reset();
+    contact_filter.reset();
+    interpolator.reset();
+    interpolation_rate = interpolation_lag = 0;
+    memset(touch_active, false, sizeof(touch_active));
+    last_contact_count = 0;
+    last_button = false;
+    last_frame_time = 0;
+}
+
+bool VoodooInputMT2Encoder::takePending(VoodooInputEvent& multitouch_event) {
+    if (!mailbox.take(multitouch_event))
+        return false;
+
+    // A frame that waited for the gate carries newer state, going back to this one would undo it
+    return multitouch_event.timestamp >= last_frame_time;
+}
+
+bool VoodooInputMT2Encoder::isCoalescable(const VoodooInputEvent& multitouch_event) const {
+    // Contacts appearing or lifting and button changes must always be delivered
+    if (multitouch_event.contact_count != last_contact_count || multitouch_event.transducers[0].isPhysicalButtonDown != last_button)
+        return false;
+
+    for (int i = 0; i < multitouch_event.contact_count; i++) {
+        const VoodooInputTransducer& transducer = multitouch_event.transducers[i];
+
+        if (!transducer.isValid || transducer.type == VoodooInputTransducerType::STYLUS)
+            continue;
+
+        if (!transducer.isTransducerActive && !transducer.isPhysicalButtonDown)
+            return false;
+    }
+
+    return true;
+}
+
+bool VoodooInputMT2Encoder::updateWatchdog(const VoodooInputEvent& multitouch_event) {
+    last_contact_count = multitouch_event.contact_count;
+    last_button = multitouch_event.transducers[0].isPhysicalButtonDown;
+
+    AbsoluteTime now = timestamps.now();
+
+    if (!multitouch_event.timestamp || multitouch_event.timestamp > now)
+        return false;
+
+    UInt64 lateness = timestamps.toNanoseconds(now - multitouch_event.timestamp);
+    return frame_watchdog.update(lateness) && !frame_watchdog.isDegraded();
+}
+
+bool VoodooInputMT2Encoder::pushInterpolatedFrame(const VoodooInputEvent& multitouch_event) {
+    if (settings.interpolation_rate != interpolation_rate || settings.interpolation_lag != interpolation_lag) {
+        interpolation_rate = settings.interpolation_rate;
+        interpolation_lag = settings.interpolation_lag;
+
+        UInt64 period_ticks, lag_ticks;
+        nanoseconds_to_absolutetime(1000000000ULL / interpolation_rate, &period_ticks);
+        nanoseconds_to_absolutetime((UInt64)interpolation_lag * 1000000ULL, &lag_ticks);
+        interpolator.configure(period_ticks, lag_ticks);
+    }
+
+    return interpolator.push(multitouch_event, timestamps.now());
+}
+
+UInt32 VoodooInputMT2Encoder::encodeFingers(const VoodooInputEvent& multitouch_event, AbsoluteTime timestamp, bool& input_active) {
+    // Every byte up to the report length is rewritten below, no need to clear the previous frame
+    input_report->ReportID = 0x02;
+    input_report->Unused[0] = 0;
+    input_report->Unused[1] = 0;
+    input_report->Unused[2] = 0;
+    input_report->Unused[3] = 0;
+    input_report->Unused[4] = 0;
+
+    const VoodooInputTransducer* transducer = &multitouch_event.transducers[0];
+
+    // physical button
+    input_report->Button = transducer->isPhysicalButtonDown;
+
+    // rotation check
+    UInt8 transform = settings.transform;
+
+    // multitouch report id
+    input_report->multitouch_report_id = 0x31; // Magic
+
+    // timestamp
+    MT2EncodeTimestamp(timestamps.mt2Milliseconds(timestamp), input_report->timestamp_buffer);
+
+    // finger data
+    input_active = input_report->Button;
+    bool is_error_input_active = false;
+
+    bool smoothing = settings.contact_smoothing;
+    UInt32 filter_time_us = 0;
+    if (smoothing) {
+        contact_filter.configure(settings.smoothing_min_cutoff, settings.smoothing_beta);
+        filter_time_us = (UInt32)(timestamps.toNanoseconds(timestamp) / 1000);
+    }
+
+    for (int i = 0; i < multitouch_event.contact_count; i++) {
+        const VoodooInputTransducer* transducer = &multitouch_event.transducers[i];
+        MT2Finger finger_data {};
+
+        if (!transducer || !transducer->isValid || transducer->type == VoodooInputTransducerType::STYLUS) {
+            MT2EncodeFinger(finger_data, input_report->FINGERS[i].raw);
+            continue;
+        }
+
+        // in case the obtained id is greater than 14, usually 0~4 for common devices.
+        UInt16 touch_id = transducer->secondaryId % 15;
+        input_active |= transducer->isTransducerActive;
+
+        IOFixed scaled_x = ((transducer->currentCoordinates.x * 1.0f) / settings.logical_max_x) * MT2_MAX_X;
+        IOFixed scaled_y = ((transducer->currentCoordinates.y * 1.0f) / settings.logical_max_y) * MT2_MAX_Y;
+
+        if (scaled_x < 1 && scaled_y >= MT2_MAX_Y) {
+            is_error_input_active = true;
+        }
+
+        if (transform) {
+            if (transform & kIOFBSwapAxes) {
+                scaled_x = ((transducer->currentCoordinates.y * 1.0f) / settings.logical_max_y) * MT2_MAX_X;
+                scaled_y = ((transducer->currentCoordinates.x * 1.0f) / settings.logical_max_x) * MT2_MAX_Y;
+            }
+
+            if (transform & kIOFBInvertX) {
+                scaled_x = MT2_MAX_X - scaled_x;
+            }
+            if (transform & kIOFBInvertY) {
+                scaled_y = MT2_MAX_Y - scaled_y;
+            }
+        }
+
+        finger_data.state = touch_active[touch_id] ? kTouchStateActive : kTouchStateStart;
+        touch_active[touch_id] = transducer->isTransducerActive || transducer->isPhysicalButtonDown;
+
+        if (smoothing) {
+            // Every touch starts from its raw position, the lift off frame still moves smoothly
+            if (finger_data.state == kTouchStateStart)
+                contact_filter.reset(touch_id);
+            contact_filter.update(touch_id, filter_time_us, scaled_x, scaled_y);
+            if (!touch_active[touch_id])
+                contact_filter.reset(touch_id);
+        }
+
+        finger_data.finger = transducer->fingerType;
+
+        if (transducer->supportsPressure) {
+            finger_data.pressure = transducer->currentCoordinates.pressure;
+            finger_data.size = transducer->currentCoordinates.width;
+            finger_data.touchMajor = transducer->currentCoordinates.width;
+            finger_data.touchMinor = transducer->currentCoordinates.width;
+        } else {
+            finger_data.pressure = 5;
+            finger_data.size = 10;
+            finger_data.touchMajor = 20;
+            finger_data.touchMinor = 20;
+        }
+
+        if (input_report->Button) {
+            finger_data.pressure = 120;
+        }
+
+        if (!transducer->isTransducerActive && !transducer->isPhysicalButtonDown) {
+            finger_data.state = kTouchStateStop;
+            finger_data.size = 0x0;
+            finger_data.pressure = 0x0;
+            finger_data.touchMinor = 0;
+            finger_data.touchMajor = 0;
+        }
+
+        finger_data.x = (SInt16)(scaled_x - (MT2_MAX_X / 2));
+        finger_data.y = (SInt16)(scaled_y - (MT2_MAX_Y / 2)) * -1;
+
+        finger_data.angle = 0x4; // pi/2
+        finger_data.identifier = touch_id + 1;
+
+        MT2EncodeFinger(finger_data, input_report->FINGERS[i].raw);
+    }
+
+    if (input_active)
+        input_report->TouchActive = 0x3;
+    else
+        input_report->TouchActive = 0x2;
+
+    if (is_error_input_active)
+        return 0;
+
+    return sizeof(MAGIC_TRACKPAD_INPUT_REPORT) + sizeof(MAGIC_TRACKPAD_INPUT_REPORT_FINGER) * multitouch_event.contact_count;
+}
+
+UInt32 VoodooInputMT2Encoder::encodeLiftOff(UInt8 step, UInt32 length) {
+    MT2Finger lift_finger = MT2DecodeFinger(input_report->FINGERS[0].raw);
+
+    switch (step) {
+        case 0:
+            // The first finger again without pressure or size
+            memset(touch_active, false, sizeof(touch_active));
+            contact_filter.reset();
+
+            lift_finger.size = 0x0;
+            lift_finger.pressure = 0x0;
+            lift_finger.touchMajor = 0x0;
+            lift_finger.touchMinor = 0x0;
+            MT2EncodeFinger(lift_finger, input_report->FINGERS[0].raw);
+
+            MT2EncodeTimestamp(timestamps.mt2Advance(settings.lift_off_spacing_ms), input_report->timestamp_buffer);
+            return length;
+
+        case 1:
+            // Same time, the finger gone
+            lift_finger.finger = kMT2FingerTypeUndefined;
+            lift_finger.state = kTouchStateInactive;
+            MT2EncodeFinger(lift_finger, input_report->FINGERS[0].raw);
+            return length;
+
+        default:
+            // No fingers at all
+            MT2EncodeTimestamp(timestamps.mt2Advance(settings.lift_off_spacing_ms), input_report->timestamp_buffer);
+            return sizeof(MAGIC_TRACKPAD_INPUT_REPORT);
+    }
+}
@@ -0,0 +1,270 @@
+//
+//  VoodooInputMT2Report.hpp
+//  VoodooInput
+//
+//  Copyright © 2024 Kishor Prins. All rights reserved.
+//  Report construction moved from VoodooInputSimulatorDevice.cpp, Copyright © 2018 Alexandre Daoud and Kishor Prins
+//
+
+#ifndef VOODOO_INPUT_MT2_REPORT_HPP
+#define VOODOO_INPUT_MT2_REPORT_HPP
+
+#include <IOKit/IOService.h>
+
+#include "../VoodooInputMultitouch/VoodooInputEvent.h"
+#include "../VoodooInputMultitouch/MultitouchHelpers.h"
+#include "../VoodooInputTrace.hpp"
+#include "../VoodooInputKdebug.hpp"
+#include "VoodooInputMT2Codec.hpp"
+#include "VoodooInputSampleEstimator.hpp"
+#include "VoodooInputContactTracker.hpp"
+#include "VoodooInputFrameWatchdog.hpp"
+#include "VoodooInputTimestamp.hpp"
+#include "VoodooInputContactFilter.hpp"
+#include "VoodooInputFrameInterpolator.hpp"
+#include "VoodooInputFrameMailbox.hpp"
+
+#define MT2_MAX_X 8134
+#define MT2_MAX_Y 5206
+
+// Time in ms between the reports synthesized after a lift off
+#define MT2_LIFT_OFF_SPACING_MS 10
+// Reports sent after the one of a lift off frame
+#define MT2_LIFT_OFF_REPORTS 3
+
+// Encoded with MT2EncodeFinger, see VoodooInputMT2Codec.hpp for the layout
+struct __attribute__((__packed__)) MAGIC_TRACKPAD_INPUT_REPORT_FINGER {
+    UInt8 raw[MT2_FINGER_SIZE];
+};
+
+struct __attribute__((__packed__)) MAGIC_TRACKPAD_INPUT_REPORT {
+    UInt8 ReportID;
+    UInt8 Button;
+    UInt8 Unused[5];
+
+    UInt8 TouchActive;
+
+    UInt8 multitouch_report_id;
+    UInt8 timestamp_buffer[3];
+
+    MAGIC_TRACKPAD_INPUT_REPORT_FINGER FINGERS[]; // May support more fingers
+};
+
+static_assert(sizeof(MAGIC_TRACKPAD_INPUT_REPORT) == MT2_HEADER_SIZE, "Unexpected MAGIC_TRACKPAD_INPUT_REPORT size");
+static_assert(sizeof(MAGIC_TRACKPAD_INPUT_REPORT_FINGER) == MT2_FINGER_SIZE, "Unexpected MAGIC_TRACKPAD_INPUT_REPORT_FINGER size");
+
+#define MT2_REPORT_MAX_SIZE (sizeof(MAGIC_TRACKPAD_INPUT_REPORT) + sizeof(MAGIC_TRACKPAD_INPUT_REPORT_FINGER) * VOODOO_INPUT_MAX_TRANSDUCERS)
+
+// Engine settings the report path reads, taken once per frame
+struct VoodooInputMT2Settings {
+    UInt32 logical_max_x {1};
+    UInt32 logical_max_y {1};
+    UInt8 transform {0};
+    bool timestamp_smoothing {false};
+    bool contact_smoothing {false};
+    UInt32 smoothing_min_cutoff {CONTACT_FILTER_DEFAULT_MIN_CUTOFF};
+    UInt32 smoothing_beta {CONTACT_FILTER_DEFAULT_BETA};
+    bool frame_interpolation {false};
+    UInt32 interpolation_rate {FRAME_INTERPOLATOR_DEFAULT_RATE};
+    UInt32 interpolation_lag {FRAME_INTERPOLATOR_DEFAULT_LAG};
+    UInt32 lift_off_spacing_ms {MT2_LIFT_OFF_SPACING_MS};
+};
+
+/*
+ * Everything VoodooInputSimulatorDevice does with a frame inside its command gate:
+ * sample estimation, contact statistics, the frame watchdog, interpolation, contact
+ * smoothing and the MT2 encoding with the reports synthesized after a lift off. The
+ * device only adds the gate, the timer and the HID family, so a host build runs the
+ * same code against its own sink.
+ *
+ * A sink provides
+ *   void sendReport(const UInt8* report, UInt32 length)   handleReport, the bytes are the encoder buffer
+ *   void publishSampleProperties()                         after a gesture, with at least two samples
+ *   void publishWatchdogProperties()                       after a gesture and on leaving degraded mode
+ *
+ * and a gate, for submit() from outside of it,
+ *   void runGated(const VoodooInputEvent& event)           constructReport within the gate, waits for it
+ *   bool attemptGated(const VoodooInputEvent& event)       the same, false without waiting when it is busy
+ *   void schedulePending()                                 once the gate is free, constructReport within it
+ *                                                          whatever takePending returns
+ */
+class VoodooInputMT2Encoder {
+public:
+    // Kernel timebase, time from clock_get_uptime
+    bool init(UInt8* report, VoodooInputTrace* trace);
+    // Explicit timebase and clock, for host builds
+    bool init(UInt8* report, VoodooInputTrace* trace, UInt32 numer, UInt32 denom, VoodooInputTimestamp::Clock clock);
+    void release();
+
+    void configure(const VoodooInputMT2Settings& new_settings) { settings = new_settings; }
+
+    // Outside the gate, picks how to enter it
+    template <typename Gate>
+    void submit(const VoodooInputEvent& multitouch_event, Gate& gate);
+
+    // Within the gate, the newest frame that gave way to it unless a later one got in since
+    bool takePending(VoodooInputEvent& multitouch_event);
+
+    // Returns true when the interpolator took the frame, the caller sends renders from then on
+    template <typename Sink>
+    bool constructReport(const VoodooInputEvent& multitouch_event, Sink& sink);
+    // Sends the render due now, false once there is nothing left until the next frame
+    template <typename Sink>
+    bool interpolate(Sink& sink);
+
+    // Whether a frame only carries motion and may be superseded by the next one while degraded
+    bool isCoalescable(const VoodooInputEvent& multitouch_event) const;
+
+    AbsoluteTime now() const { return timestamps.now(); }
+    UInt64 getInterpolationPeriod() const { return interpolator.getPeriod(); }
+    bool isInterpolating() const { return interpolator.isActive(); }
+
+    const UInt8* getReport() const { return (const UInt8*)input_report; }
+    const VoodooInputSampleEstimator& getSampleEstimator() const { return sample_estimator; }
+    const VoodooInputContactStats& getContactStats() const { return contact_tracker.getStats(); }
+    const VoodooInputFrameWatchdog& getWatchdog() const { return frame_watchdog; }
+    VoodooInputFrameWatchdog& getWatchdog() { return frame_watchdog; }
+    const VoodooInputFrameMailbox& getMailbox() const { return mailbox; }
+
+private:
+    MAGIC_TRACKPAD_INPUT_REPORT* input_report {nullptr};
+    VoodooInputTrace* trace {nullptr};
+    VoodooInputMT2Settings settings;
+    VoodooInputTimestamp timestamps;
+    VoodooInputSampleEstimator sample_estimator;
+    VoodooInputContactTracker contact_tracker;
+    VoodooInputFrameWatchdog frame_watchdog;
+    VoodooInputContactFilter contact_filter;
+    VoodooInputFrameInterpolator interpolator;
+    VoodooInputFrameMailbox mailbox;
+    AbsoluteTime last_frame_time {0};
+    UInt32 interpolation_rate {0};
+    UInt32 interpolation_lag {0};
+    bool touch_active[15] {false};
+    UInt8 last_contact_count {0};
+    bool last_button {false};
+
+    void reset();
+    bool pushInterpolatedFrame(const VoodooInputEvent& multitouch_event);
+    // Fills the report, returns its length or 0 when the frame is an error input that is not sent
+    UInt32 encodeFingers(const VoodooInputEvent& multitouch_event, AbsoluteTime timestamp, bool& input_active);
+    // Turns the report into the given one of the reports following a lift off, returns its length
+    UInt32 encodeLiftOff(UInt8 step, UInt32 length);
+    // Returns true when the watchdog mode changed to normal
+    bool updateWatchdog(const VoodooInputEvent& multitouch_event);
+
+    template <typename Sink>
+    void sendReport(UInt32 length, bool degraded, Sink& sink);
+    template <typename Sink>
+    void encodeReport(const VoodooInputEvent& multitouch_event, AbsoluteTime timestamp, bool degraded, Sink& sink);
+};
+
+template <typename Gate>
+void VoodooInputMT2Encoder::submit(const VoodooInputEvent& multitouch_event, Gate& gate) {
+    // While behind, frames that only carry motion give way to a busy gate, the next frame supersedes them
+    if (frame_watchdog.isDegraded() && isCoalescable(multitouch_event)) {
+        VoodooInputKdebug(kVoodooInputKdebugGate, DBG_FUNC_START, multitouch_event.contact_count, true);
+        bool entered = gate.attemptGated(multitouch_event);
+        VoodooInputKdebug(kVoodooInputKdebugGate, DBG_FUNC_END, multitouch_event.contact_count, true);
+
+        // Kept until the holder is done, when nobody supersedes it the last motion still gets out
+        if (!entered && mailbox.post(multitouch_event))
+            gate.schedulePending();
+        return;
+    }
+
+    VoodooInputKdebug(kVoodooInputKdebugGate, DBG_FUNC_START, multitouch_event.contact_count, false);
+    gate.runGated(multitouch_event);
+    VoodooInputKdebug(kVoodooInputKdebugGate, DBG_FUNC_END, multitouch_event.contact_count, false);
+}
+
+template <typename Sink>
+bool VoodooInputMT2Encoder::constructReport(const VoodooInputEvent& multitouch_event, Sink& sink) {
+    VoodooInputKdebug(kVoodooInputKdebugFrame, DBG_FUNC_START, multitouch_event.contact_count);
+    last_frame_time = multitouch_event.timestamp;
+
+    AbsoluteTime timestamp = sample_estimator.update(multitouch_event.timestamp);
+
+    // Providers stamp frames at different points, optionally report the reconstructed timeline instead
+    if (!settings.timestamp_smoothing)
+        timestamp = multitouch_event.timestamp;
+
+    // Analytics and tracing are skipped while behind
+    bool degraded = frame_watchdog.isDegraded();
+    if (!degraded) {
+        contact_tracker.update(multitouch_event, timestamp);
+        trace->record(kVoodooInputTraceGateAcquired, multitouch_event.contact_count);
+    }
+
+    // Motion between transitions is sent by the interpolation timer instead, never while behind
+    bool interpolated = false;
+    if (!settings.frame_interpolation || degraded)
+        interpolator.reset();
+    else
+        interpolated = pushInterpolatedFrame(multitouch_event);
+
+    if (!interpolated)
+        encodeReport(multitouch_event, timestamp, degraded, sink);
+
+    // Entering degraded mode is published once the backlog has cleared
+    if (updateWatchdog(multitouch_event))
+        sink.publishWatchdogProperties();
+
+    VoodooInputKdebug(kVoodooInputKdebugFrame, DBG_FUNC_END, multitouch_event.contact_count);
+    return interpolated;
+}
+
+template <typename Sink>
+bool VoodooInputMT2Encoder::interpolate(Sink& sink) {
+    VoodooInputEvent frame;
+    if (interpolator.isActive() && interpolator.render(timestamps.now(), frame)) {
+        VoodooInputKdebug(kVoodooInputKdebugFrame, DBG_FUNC_START, frame.contact_count);
+        encodeReport(frame, frame.timestamp, frame_watchdog.isDegraded(), sink);
+        VoodooInputKdebug(kVoodooInputKdebugFrame, DBG_FUNC_END, frame.contact_count);
+    }
+
+    return interpolator.isActive();
+}
+
+template <typename Sink>
+void VoodooInputMT2Encoder::sendReport(UInt32 length, bool degraded, Sink& sink) {
+    if (!degraded)
+        trace->record(kVoodooInputTraceReportSent, input_report->TouchActive, length);
+    VoodooInputKdebug(kVoodooInputKdebugReport, DBG_FUNC_NONE, length, input_report->TouchActive);
+    sink.sendReport((const UInt8*)input_report, length);
+}
+
+template <typename Sink>
+void VoodooInputMT2Encoder::encodeReport(const VoodooInputEvent& multitouch_event, AbsoluteTime timestamp, bool degraded, Sink& sink) {
+    bool input_active;
+    UInt32 length = encodeFingers(multitouch_event, timestamp, input_active);
+
+    if (length) {
+        sendReport(length, degraded, sink);
+    } else {
+        length = sizeof(MAGIC_TRACKPAD_INPUT_REPORT) + sizeof(MAGIC_TRACKPAD_INPUT_REPORT_FINGER) * multitouch_event.contact_count;
+        if (!degraded)
+            trace->record(kVoodooInputTraceDropped, kVoodooInputTraceDropErrorInput);
+    }
+
+    if (input_active)
+        return;
+
+    if (!degraded) {
+        trace->record(kVoodooInputTraceLiftOff, multitouch_event.contact_count);
+
+        if (sample_estimator.getSampleCount() > 1)
+            sink.publishSampleProperties();
+
+        sink.publishWatchdogProperties();
+    }
+
+    VoodooInputKdebug(kVoodooInputKdebugLiftOff, DBG_FUNC_NONE, multitouch_event.contact_count);
+    for (UInt8 step = 0; step < MT2_LIFT_OFF_REPORTS; step++)
+        sendReport(encodeLiftOff(step, length), degraded, sink);
+
+    // Only between gestures, so a wrap never shows up as time running backwards mid gesture
+    timestamps.mt2Idle();
+}
+
+#endif // VOODOO_INPUT_MT2_REPORT_HPP
@@ -0,0 +1,82 @@
+//
+//  VoodooInputSampleEstimator.cpp
+//  VoodooInput
+//
+//  Copyright © 2024 Kishor Prins. All rights reserved.
+//
+
+#include "VoodooInputSampleEstimator.hpp"
+
+#include <kern/clock.h>
+
+// Anything longer than this between frames is a new touch session, not a late sample
+#define SAMPLE_GAP_MS 100
+// Loop gains as shifts: frequency 1/16, phase 1/4, jitter average 1/16
+#define PERIOD_SHIFT 4
+#define PHASE_SHIFT 2
+#define JITTER_SHIFT 4
+
+void VoodooInputSampleEstimator::init() {
+    nanoseconds_to_absolutetime(SAMPLE_GAP_MS * NSEC_PER_MSEC, &gap);
+    period = 0;
+    jitter = 0;
+    reset();
+}
+
+void VoodooInputSampleEstimator::reset() {
+    last_timestamp = 0;
+    smoothed = 0;
+    samples = 0;
+}
+
+UInt64 VoodooInputSampleEstimator::update(UInt64 timestamp) {
+    if (samples == 0 || timestamp <= last_timestamp || timestamp - last_timestamp > gap) {
+        // Resynchronise phase, keep the learned period across sessions
+        last_timestamp = smoothed = timestamp;
+        samples = 1;
+        return timestamp;
+    }
+
+    SInt64 delta = timestamp - last_timestamp;
+    last_timestamp = timestamp;
+
+    if (period == 0)
+        period = delta;
+
+    // Judged against the period learned so far, the sample being judged must not widen its own window
+    UInt64 predicted = smoothed + period;
+    SInt64 error = (SInt64)(timestamp - predicted);
+    UInt64 magnitude = error < 0 ? -error : error;
+    bool locked = magnitude <= 4 * period;
+
+    period += (delta - (SInt64)period) / (1 << PERIOD_SHIFT);
+
+    if (locked) {
+        jitter += ((SInt64)magnitude - (SInt64)jitter) / (1 << JITTER_SHIFT);
+        smoothed = predicted + error / (1 << PHASE_SHIFT);
+    } else {
+        // Lost lock, e.g. the provider skipped several samples, that is no jitter
+        smoothed = timestamp;
+    }
+
+    samples++;
+    return smoothed;
+}
+
+UInt32 VoodooInputSampleEstimator::getRate() const {
+    if (period == 0)
+        return 0;
+
+    UInt64 period_ns;
+    absolutetime_to_nanoseconds(period, &period_ns);
+    if (period_ns == 0)
+        return 0;
+
+    return (UInt32)((NSEC_PER_SEC + period_ns / 2) / period_ns);
+}
+
+UInt32 VoodooInputSampleEstimator::getJitter() const {
+    UInt64 jitter_ns;
+    absolutetime_to_nanoseconds(jitter, &jitter_ns);
+    return (UInt32)(jitter_ns / NSEC_PER_USEC);
+}
@@ -0,0 +1,41 @@
+//
+//  VoodooInputSampleEstimator.hpp
+//  VoodooInput
+//
+//  Copyright © 2024 Kishor Prins. All rights reserved.
+//
+
+#ifndef VOODOO_INPUT_SAMPLE_ESTIMATOR_HPP
+#define VOODOO_INPUT_SAMPLE_ESTIMATOR_HPP
+
+#include <IOKit/IOService.h>
+
+/*
+ * Tracks the nominal sample period and arrival jitter of a provider with a
+ * second order loop (phase + frequency) and reconstructs a smoothed timeline
+ * from the stamped frame times. All values are in AbsoluteTime units.
+ */
+class VoodooInputSampleEstimator {
+public:
+    void init();
+    void reset();
+
+    // Feeds one frame timestamp and returns it placed on the smoothed timeline
+    UInt64 update(UInt64 timestamp);
+
+    // Measured sample rate in Hz, 0 when unknown
+    UInt32 getRate() const;
+    // Mean absolute arrival jitter in microseconds
+    UInt32 getJitter() const;
+    UInt32 getSampleCount() const { return samples; }
+
+private:
+    UInt64 gap {0};
+    UInt64 last_timestamp {0};
+    UInt64 smoothed {0};
+    UInt64 period {0};
+    UInt64 jitter {0};
+    UInt32 samples {0};
+};
+
+#endif // VOODOO_INPUT_SAMPLE_ESTIMATOR_HPP
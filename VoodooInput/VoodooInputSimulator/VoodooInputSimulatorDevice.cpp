@@ -8,219 +8,158 @@
 #include "VoodooInput.hpp"
 #include "VoodooInputSimulatorDevice.hpp"
 #include "../VoodooInputMultitouch/MultitouchHelpers.h"
+#include "../VoodooInputMultitouch/VoodooInputMessages.h"
 #include "VoodooInputIDs.hpp"
+#include "VoodooInputHIDProfile.hpp"
 
 #include <IOKit/IOWorkLoop.h>
+#include <IOKit/IOTimerEventSource.h>
+#include <IOKit/IOInterruptEventSource.h>
 #include <IOKit/IOCommandGate.h>
 
 #define super IOHIDDevice
 OSDefineMetaClassAndStructors(VoodooInputSimulatorDevice, IOHIDDevice);
 
 
-const unsigned char report_descriptor[] = {0x05, 0x01, 0x09, 0x02, 0xa1, 0x01, 0x09, 0x01, 0xa1, 0x00, 0x05, 0x09, 0x19, 0x01, 0x29, 0x03, 0x15, 0x00, 0x25, 0x01, 0x85, 0x02, 0x95, 0x03, 0x75, 0x01, 0x81, 0x02, 0x95, 0x01, 0x75, 0x05, 0x81, 0x01, 0x05, 0x01, 0x09, 0x30, 0x09, 0x31, 0x15, 0x81, 0x25, 0x7f, 0x75, 0x08, 0x95, 0x02, 0x81, 0x06, 0x95, 0x04, 0x75, 0x08, 0x81, 0x01, 0xc0, 0xc0, 0x05, 0x0d, 0x09, 0x05, 0xa1, 0x01, 0x06, 0x00, 0xff, 0x09, 0x0c, 0x15, 0x00, 0x26, 0xff, 0x00, 0x75, 0x08, 0x95, 0x10, 0x85, 0x3f, 0x81, 0x22, 0xc0, 0x06, 0x00, 0xff, 0x09, 0x0c, 0xa1, 0x01, 0x06, 0x00, 0xff, 0x09, 0x0c, 0x15, 0x00, 0x26, 0xff, 0x00, 0x85, 0x44, 0x75, 0x08, 0x96, 0x6b, 0x05, 0x81, 0x00, 0xc0};
 
 void VoodooInputSimulatorDevice::constructReport(const VoodooInputEvent& multitouch_event) {
-    if (!ready_for_reports)
+    if (!ready_for_reports) {
+        if (engine)
+            engine->getTrace().record(kVoodooInputTraceDropped, kVoodooInputTraceDropNotReady);
         return;
+    }
 
-    command_gate->runAction(OSMemberFunctionCast(IOCommandGate::Action, this, &VoodooInputSimulatorDevice::constructReportGated), (void*)&multitouch_event);
+    encoder.submit(multitouch_event, *this);
 }
 
-void VoodooInputSimulatorDevice::sendReport() {
-#if DEBUG
-    size_t fingerCount = (input_report_buffer->getLength() - sizeof(MAGIC_TRACKPAD_INPUT_REPORT)) / sizeof(MAGIC_TRACKPAD_INPUT_REPORT_FINGER);
-    IOLog("Sending report with touch active %d, button %d, finger count %zu\n", input_report->TouchActive, input_report->Button, fingerCount);
-    for (size_t i = 0; i < fingerCount; i++) {
-        MAGIC_TRACKPAD_INPUT_REPORT_FINGER &f = input_report->FINGERS[i];
-        IOLog("[%zu] (%d, %d) F%d St%d Maj%d Min%d Sz%d P%d ID%d A%d\n", i, f.X, f.Y, f.Finger, f.State, f.Touch_Major, f.Touch_Minor, f.Size, f.Pressure, f.Identifier, f.Angle);
-    }
-#endif
-    handleReport(input_report_buffer, kIOHIDReportTypeInput);
+void VoodooInputSimulatorDevice::runGated(const VoodooInputEvent& multitouch_event) {
+    command_gate->runAction(OSMemberFunctionCast(IOCommandGate::Action, this, &VoodooInputSimulatorDevice::constructReportGated), (void*)&multitouch_event);
 }
 
-void VoodooInputSimulatorDevice::constructReportGated(const VoodooInputEvent& multitouch_event) {
-    AbsoluteTime timestamp = multitouch_event.timestamp;
-
-    input_report->ReportID = 0x02;
-    input_report->Unused[0] = 0;
-    input_report->Unused[1] = 0;
-    input_report->Unused[2] = 0;
-    input_report->Unused[3] = 0;
-    input_report->Unused[4] = 0;
-
-    const VoodooInputTransducer* transducer = &multitouch_event.transducers[0];
-
-    // physical button
-    input_report->Button = transducer->isPhysicalButtonDown;
-    
-    // touch active
+bool VoodooInputSimulatorDevice::attemptGated(const VoodooInputEvent& multitouch_event) {
+    return command_gate->attemptAction(OSMemberFunctionCast(IOCommandGate::Action, this, &VoodooInputSimulatorDevice::constructReportGated), (void*)&multitouch_event) == kIOReturnSuccess;
+}
 
-    // rotation check
-    
-    UInt8 transform = engine->getTransformKey();
+void VoodooInputSimulatorDevice::schedulePending() {
+    pending_source->interruptOccurred(nullptr, this, 0);
+}
 
-    // multitouch report id
-    input_report->multitouch_report_id = 0x31; // Magic
-    
-    // timestamp
-    AbsoluteTime relative_timestamp = timestamp;
-    
-    SUB_ABSOLUTETIME(&relative_timestamp, &start_timestamp);
-    
-    UInt64 milli_timestamp;
-    
-    absolutetime_to_nanoseconds(relative_timestamp, &milli_timestamp);
-    
-    milli_timestamp /= 1000000;
-    
-    input_report->timestamp_buffer[0] = (milli_timestamp << 0x3) | 0x4;
-    input_report->timestamp_buffer[1] = (milli_timestamp >> 0x5) & 0xFF;
-    input_report->timestamp_buffer[2] = (milli_timestamp >> 0xd) & 0xFF;
-    
-    // finger data
-    bool input_active = input_report->Button;
-    bool is_error_input_active = false;
-    
-    for (int i = 0; i < multitouch_event.contact_count; i++) {
-        const VoodooInputTransducer* transducer = &multitouch_event.transducers[i];
+void VoodooInputSimulatorDevice::copyContactStats(VoodooInputContactStats& contact_stats) {
+    if (!ready_for_reports) {
+        memset(&contact_stats, 0, sizeof(contact_stats));
+        return;
+    }
 
-        if (!transducer || !transducer->isValid)
-            continue;
+    command_gate->runAction(OSMemberFunctionCast(IOCommandGate::Action, this, &VoodooInputSimulatorDevice::copyContactStatsGated), (void*)&contact_stats);
+}
 
-        if (transducer->type == VoodooInputTransducerType::STYLUS) {
-            continue;
-        }
+void VoodooInputSimulatorDevice::copyContactStatsGated(VoodooInputContactStats& contact_stats) {
+    contact_stats = encoder.getContactStats();
+}
 
-        // in case the obtained id is greater than 14, usually 0~4 for common devices.
-        UInt16 touch_id = transducer->secondaryId % 15;
-        input_active |= transducer->isTransducerActive;
+void VoodooInputSimulatorDevice::sendReport(const UInt8* report, UInt32 length) {
+    // The encoder writes straight into the arena, only the range handed to the HID family changes
+    if (!engine->getArena().retarget(input_report_range, kVoodooInputArenaSimulatorReports, 0, length))
+        return;
+    handleReport(input_report_range, kIOHIDReportTypeInput);
+}
 
-        MAGIC_TRACKPAD_INPUT_REPORT_FINGER& finger_data = input_report->FINGERS[i];
+void VoodooInputSimulatorDevice::publishSampleProperties() {
+    const VoodooInputSampleEstimator& sample_estimator = encoder.getSampleEstimator();
+    setProperty(VOODOO_INPUT_SAMPLE_RATE_KEY, sample_estimator.getRate(), 32);
+    setProperty(VOODOO_INPUT_SAMPLE_JITTER_KEY, sample_estimator.getJitter(), 32);
+}
 
-        IOFixed scaled_x = ((transducer->currentCoordinates.x * 1.0f) / engine->getLogicalMaxX()) * MT2_MAX_X;
-        IOFixed scaled_y = ((transducer->currentCoordinates.y * 1.0f) / engine->getLogicalMaxY()) * MT2_MAX_Y;
+void VoodooInputSimulatorDevice::publishWatchdogProperties() {
+    const VoodooInputFrameWatchdog& frame_watchdog = encoder.getWatchdog();
+    setProperty(VOODOO_INPUT_FRAME_OVERRUNS_KEY, frame_watchdog.getOverruns(), 32);
+    setProperty(VOODOO_INPUT_WORST_FRAME_STALL_KEY, frame_watchdog.getWorstStall() / 1000, 32);
+    setProperty(VOODOO_INPUT_DEGRADED_MODE_SWITCHES_KEY, frame_watchdog.getModeSwitches(), 32);
+}
 
-        if (scaled_x < 1 && scaled_y >= MT2_MAX_Y) {
-            is_error_input_active = true;
-        }
-        
-        if (transform) {
-            if (transform & kIOFBSwapAxes) {
-                scaled_x = ((transducer->currentCoordinates.y * 1.0f) / engine->getLogicalMaxY()) * MT2_MAX_X;
-                scaled_y = ((transducer->currentCoordinates.x * 1.0f) / engine->getLogicalMaxX()) * MT2_MAX_Y;
-            }
-            
-            if (transform & kIOFBInvertX) {
-                scaled_x = MT2_MAX_X - scaled_x;
-            }
-            if (transform & kIOFBInvertY) {
-                scaled_y = MT2_MAX_Y - scaled_y;
-            }
-        }
+void VoodooInputSimulatorDevice::loadSettings() {
+    VoodooInputMT2Settings settings;
+    settings.logical_max_x = engine->getLogicalMaxX();
+    settings.logical_max_y = engine->getLogicalMaxY();
+    settings.transform = engine->getTransformKey();
+    settings.timestamp_smoothing = engine->getTimestampSmoothing();
+    settings.contact_smoothing = engine->getContactSmoothing();
+    settings.smoothing_min_cutoff = engine->getSmoothingMinCutoff();
+    settings.smoothing_beta = engine->getSmoothingBeta();
+    settings.frame_interpolation = engine->getFrameInterpolation();
+    settings.interpolation_rate = engine->getInterpolationRate();
+    settings.interpolation_lag = engine->getInterpolationLag();
+    encoder.configure(settings);
+}
 
-        finger_data.State = touch_active[touch_id] ? kTouchStateActive : kTouchStateStart;
-        touch_active[touch_id] = transducer->isTransducerActive || transducer->isPhysicalButtonDown;
-
-        finger_data.Finger = transducer->fingerType;
-
-        if (transducer->supportsPressure) {
-            finger_data.Pressure = transducer->currentCoordinates.pressure;
-            finger_data.Size = transducer->currentCoordinates.width;
-            finger_data.Touch_Major = transducer->currentCoordinates.width;
-            finger_data.Touch_Minor = transducer->currentCoordinates.width;
-        } else {
-            finger_data.Pressure = 5;
-            finger_data.Size = 10;
-            finger_data.Touch_Major = 20;
-            finger_data.Touch_Minor = 20;
-        }
-        
-        if (input_report->Button) {
-            finger_data.Pressure = 120;
-        }
-        
-        if (!transducer->isTransducerActive && !transducer->isPhysicalButtonDown) {
-            finger_data.State = kTouchStateStop;
-            finger_data.Size = 0x0;
-            finger_data.Pressure = 0x0;
-            finger_data.Touch_Minor = 0;
-            finger_data.Touch_Major = 0;
-        }
+void VoodooInputSimulatorDevice::constructReportGated(const VoodooInputEvent& multitouch_event) {
+    loadSettings();
 
-        finger_data.X = (SInt16)(scaled_x - (MT2_MAX_X / 2));
-        finger_data.Y = (SInt16)(scaled_y - (MT2_MAX_Y / 2)) * -1;
-        
-        finger_data.Angle = 0x4; // pi/2
-        finger_data.Identifier = touch_id + 1;
+    // Motion the interpolator took is sent from the timer
+    if (encoder.constructReport(multitouch_event, *this) && !interpolation_armed) {
+        interpolation_armed = true;
+        interpolation_timer->wakeAtTime(encoder.now() + encoder.getInterpolationPeriod());
     }
+}
 
-    if (input_active)
-        input_report->TouchActive = 0x3;
-    else
-        input_report->TouchActive = 0x2;
-
-    vm_size_t total_report_len = sizeof(MAGIC_TRACKPAD_INPUT_REPORT) +
-        sizeof(MAGIC_TRACKPAD_INPUT_REPORT_FINGER) * multitouch_event.contact_count;
+void VoodooInputSimulatorDevice::constructPendingGated(IOInterruptEventSource* sender, int count) {
+    VoodooInputEvent multitouch_event;
+    if (ready_for_reports && encoder.takePending(multitouch_event))
+        constructReportGated(multitouch_event);
+}
 
-    if (!is_error_input_active) {
-        input_report_buffer->setLength(total_report_len);
-        sendReport();
-    }
+void VoodooInputSimulatorDevice::interpolateGated(IOTimerEventSource* sender) {
+    interpolation_armed = false;
+    
+    // Interpolation stopped or got turned off since the timer was armed
+    if (!encoder.isInterpolating() || !ready_for_reports)
+        return;
     
-    if (!input_active) {
-        memset(touch_active, false, sizeof(touch_active));
-
-        input_report->FINGERS[0].Size = 0x0;
-        input_report->FINGERS[0].Pressure = 0x0;
-        input_report->FINGERS[0].Touch_Major = 0x0;
-        input_report->FINGERS[0].Touch_Minor = 0x0;
-
-        milli_timestamp += 10;
-
-        input_report->timestamp_buffer[0] = (milli_timestamp << 0x3) | 0x4;
-        input_report->timestamp_buffer[1] = (milli_timestamp >> 0x5) & 0xFF;
-        input_report->timestamp_buffer[2] = (milli_timestamp >> 0xd) & 0xFF;
-        input_report_buffer->setLength(total_report_len);
-        sendReport();
-
-        input_report->FINGERS[0].Finger = kMT2FingerTypeUndefined;
-        input_report->FINGERS[0].State = kTouchStateInactive;
-        input_report_buffer->setLength(total_report_len);
-        sendReport();
-
-        milli_timestamp += 10;
-
-        input_report->timestamp_buffer[0] = (milli_timestamp << 0x3) | 0x4;
-        input_report->timestamp_buffer[1] = (milli_timestamp >> 0x5) & 0xFF;
-        input_report->timestamp_buffer[2] = (milli_timestamp >> 0xd) & 0xFF;
-        input_report_buffer->setLength(sizeof(MAGIC_TRACKPAD_INPUT_REPORT));
-        sendReport();
+    AbsoluteTime now = encoder.now();
+    if (encoder.interpolate(*this)) {
+        interpolation_armed = true;
+        sender->wakeAtTime(now + encoder.getInterpolationPeriod());
     }
-
-    memset(input_report, 0, total_report_len);
 }
 
 bool VoodooInputSimulatorDevice::start(IOService* provider) {
+    // The HID family asks for the report descriptor from within super::start
+    engine = OSDynamicCast(VoodooInput, provider);
+    if (!engine)
+        return false;
+    composite = engine->getCompositeActuator();
+
     if (!super::start(provider))
         return false;
     ready_for_reports = false;
 
-    input_report_buffer = IOBufferMemoryDescriptor::inTaskWithOptions(kernel_task, 0,
-        sizeof(MAGIC_TRACKPAD_INPUT_REPORT) + sizeof(MAGIC_TRACKPAD_INPUT_REPORT_FINGER) * VOODOO_INPUT_MAX_TRANSDUCERS);
-    if (!input_report_buffer) {
-        IOLog("%s Could not allocate IOBufferMemoryDescriptor\n", getName());
+    const VoodooInputArena& arena = engine->getArena();
+    UInt8* report_bytes = arena.getBytes(kVoodooInputArenaSimulatorReports);
+    if (!report_bytes) {
+        releaseResources();
         return false;
     }
-    input_report = (MAGIC_TRACKPAD_INPUT_REPORT *) input_report_buffer->getBytesNoCopy();
 
-    clock_get_uptime(&start_timestamp);
-    
-    engine = OSDynamicCast(VoodooInput, provider);
-    
-    if (!engine) {
+    // Reserved bits are never written afterwards, start from a clean buffer
+    memset(report_bytes, 0, arena.getLength(kVoodooInputArenaSimulatorReports));
+
+    input_report_range = arena.newSubRange(kVoodooInputArenaSimulatorReports, 0, MT2_REPORT_MAX_SIZE);
+    if (!input_report_range) {
+        IOLog("%s Could not allocate IOSubMemoryDescriptor\n", getName());
+        releaseResources();
+        return false;
+    }
+
+    feature_response = arena.getBytes(kVoodooInputArenaSimulatorFeature);
+    feature_response_length = 0;
+    feature_response_selected = false;
+
+    if (!encoder.init(report_bytes, &engine->getTrace())) {
+        IOLog("%s Could not allocate the frame mailbox\n", getName());
         releaseResources();
         return false;
     }
+    interpolation_armed = false;
 
     work_loop = this->getWorkLoop();
     if (!work_loop) {
@@ -238,11 +177,23 @@ bool VoodooInputSimulatorDevice::start(IOService* provider) {
         return false;
     }
 
+    interpolation_timer = IOTimerEventSource::timerEventSource(this, OSMemberFunctionCast(IOTimerEventSource::Action, this, &VoodooInputSimulatorDevice::interpolateGated));
+    if (!interpolation_timer || (work_loop->addEventSource(interpolation_timer) != kIOReturnSuccess)) {
+        IOLog("%s Could not add interpolation timer\n", getName());
+        releaseResources();
+        return false;
+    }
+
+    pending_source = IOInterruptEventSource::interruptEventSource(this, OSMemberFunctionCast(IOInterruptEventSource::Action, this, &VoodooInputSimulatorDevice::constructPendingGated));
+    if (!pending_source || (work_loop->addEventSource(pending_source) != kIOReturnSuccess)) {
+        IOLog("%s Could not add pending frame source\n", getName());
+        releaseResources();
+        return false;
+    }
+
     PMinit();
     provider->joinPMtree(this);
     registerPowerDriver(this, PMPowerStates, kIOPMNumberPowerStates);
-        
-    new_get_report_buffer = nullptr;
     
     ready_for_reports = true;
     
@@ -269,222 +220,123 @@ IOReturn VoodooInputSimulatorDevice::setPowerState(unsigned long whichState, IOS
 }
 
 void VoodooInputSimulatorDevice::releaseResources() {
+    if (interpolation_timer) {
+        interpolation_timer->cancelTimeout();
+        work_loop->removeEventSource(interpolation_timer);
+        OSSafeReleaseNULL(interpolation_timer);
+    }
+    interpolation_armed = false;
+    if (pending_source) {
+        pending_source->disable();
+        work_loop->removeEventSource(pending_source);
+        OSSafeReleaseNULL(pending_source);
+    }
     if (command_gate) {
         work_loop->removeEventSource(command_gate);
         OSSafeReleaseNULL(command_gate);
     }
-    input_report = nullptr;
+    encoder.release();
+    OSSafeReleaseNULL(input_report_range);
+    feature_response = nullptr;
+    feature_response_selected = false;
 
     OSSafeReleaseNULL(work_loop);
-
-    OSSafeReleaseNULL(new_get_report_buffer);
-
-    OSSafeReleaseNULL(input_report_buffer);
 }
 
 IOReturn VoodooInputSimulatorDevice::setReport(IOMemoryDescriptor* report, IOHIDReportType reportType, IOOptionBits options) {
     UInt32 report_id = options & 0xFF;
     
+    if (composite && reportType == kIOHIDReportTypeOutput && report_id == MT2_ACTUATOR_REPORT_ID) {
+        return engine->handleActuatorReport(report);
+    }
+    
     if (report_id == 0x1) {
-        char* raw_buffer = (char*)IOMalloc(report->getLength());
+        UInt8 value = 0;
         
         report->prepare();
         
-        report->readBytes(0, raw_buffer, report->getLength());
+        report->readBytes(1, &value, sizeof(value));
         
         report->complete();
         
-        if (new_get_report_buffer) {
-            new_get_report_buffer->release();
-        }
-        
-        new_get_report_buffer = OSData::withCapacity(1);
-        
-        if (!new_get_report_buffer) {
+        if (!feature_response) {
             return kIOReturnNoResources;
         }
         
-        UInt8 value = raw_buffer[1];
-        
-        if (value == 0xDB) {
-            unsigned char buffer[] = {0x1, 0xDB, 0x00, 0x49, 0x00};
-            new_get_report_buffer->appendBytes(buffer, sizeof(buffer));
-        }
-        
-        if (value == 0xD1) {
-            unsigned char buffer[] = {0x1, 0xD1, 0x00, 0x01, 0x00};
-            new_get_report_buffer->appendBytes(buffer, sizeof(buffer));
-        }
+        const VoodooInputFeatureReport* feature = VoodooInputGetHIDTables().findFeature(value);
         
-        if (value == 0xD3) {
-            unsigned char buffer[] = {0x1, 0xD3, 0x00, 0x0C, 0x00};
-            new_get_report_buffer->appendBytes(buffer, sizeof(buffer));
+        feature_response_length = 0;
+        if (value == MT2_SURFACE_REPORT_ID) {
+            feature_response_length = copyFeatureResponse(value, feature_response);
+        } else if (feature && feature->ack_length) {
+            unsigned char buffer[] = {0x1, value, 0x00, feature->ack_length, 0x00};
+            memcpy(feature_response, buffer, sizeof(buffer));
+            feature_response_length = sizeof(buffer);
         }
-        
-        if (value == 0xD0) {
-            unsigned char buffer[] = {0x1, 0xD0, 0x00, 0x0F, 0x00};
-            new_get_report_buffer->appendBytes(buffer, sizeof(buffer));
-        }
-        
-        if (value == 0xA1) {
-            unsigned char buffer[] = {0x1, 0xA1, 0x00, 0x06, 0x00};
-            new_get_report_buffer->appendBytes(buffer, sizeof(buffer));
-        }
-        
-        if (value == 0xD9) {
-            //Sensor Surface Width = 0x3cf0 (0xf0, 0x3c) = 15.600 cm
-            //Sensor Surface Height = 0x2b20 (0x20, 0x2b) = 11.040 cm
-
-            // It's already in 0.01 mm units
-            uint32_t rawWidth = engine->getPhysicalMaxX();
-            uint32_t rawHeight = engine->getPhysicalMaxY();
-
-            uint8_t rawWidthLower = rawWidth & 0xff;
-            uint8_t rawWidthHigher = (rawWidth >> 8) & 0xff;
-
-            uint8_t rawHeightLower = rawHeight & 0xff;
-            uint8_t rawHeightHigher = (rawHeight >> 8) & 0xff;
-
-            unsigned char buffer[] = {0xD9, rawWidthLower, rawWidthHigher, 0x00, 0x00, rawHeightLower, rawHeightHigher, 0x00, 0x00, 0x44, 0xE3, 0x52, 0xFF, 0xBD, 0x1E, 0xE4, 0x26}; //Sensor Surface Description
-            new_get_report_buffer->appendBytes(buffer, sizeof(buffer));
-        }
-        
-        if (value == 0x7F) {
-            unsigned char buffer[] = {0x1, 0x7F, 0x00, 0x04, 0x00};
-            new_get_report_buffer->appendBytes(buffer, sizeof(buffer));
-        }
-        
-        if (value == 0xC8) {
-            unsigned char buffer[] = {0x1, 0xC8, 0x00, 0x01, 0x00};
-            new_get_report_buffer->appendBytes(buffer, sizeof(buffer));
-        }
-        
-        IOFree(raw_buffer, report->getLength());
+        feature_response_selected = true;
     }
     
     return kIOReturnSuccess;
 }
 
-IOReturn VoodooInputSimulatorDevice::getReport(IOMemoryDescriptor* report, IOHIDReportType reportType, IOOptionBits options) {
-    UInt32 report_id = options & 0xFF;
-    Boolean getReportedAllocated = true;
+size_t VoodooInputSimulatorDevice::copyFeatureResponse(UInt8 report_id, UInt8* buffer) const {
+    const VoodooInputFeatureReport* feature = VoodooInputGetHIDTables().findFeature(report_id);
     
-    OSData* get_buffer = OSData::withCapacity(1);
-
-    if (!get_buffer || (report_id == 0x1 && !new_get_report_buffer)) {
-       OSSafeReleaseNULL(get_buffer);
-       return kIOReturnNoResources;
-    }
-    
-    if (report_id == 0x0) {
-        unsigned char buffer[] = {0x0, 0x01};
-        get_buffer->appendBytes(buffer, sizeof(buffer));
-    }
-    
-    if (report_id == 0x1) {
-        get_buffer->release();
-        get_buffer = new_get_report_buffer;
-        getReportedAllocated = false;
-    }
-    
-    if (report_id == 0xD1) {
-        unsigned char buffer[] = {0xD1, 0x81};
-        // Family ID = 0x81
-        get_buffer->appendBytes(buffer, sizeof(buffer));
+    if (!feature) {
+        return 0;
     }
     
-    if (report_id == 0xD3) {
-        unsigned char buffer[] = {0xD3, 0x01, 0x16, 0x1E, 0x03, 0x95, 0x00, 0x14, 0x1E, 0x62, 0x05, 0x00, 0x00};
-        // Sensor Rows = 0x16
-        // Sensor Columns = 0x1e
-        get_buffer->appendBytes(buffer, sizeof(buffer));
-    }
-    
-    if (report_id == 0xD0) {
-        unsigned char buffer[] = {0xD0, 0x02, 0x01, 0x00, 0x14, 0x01, 0x00, 0x1E, 0x00, 0x02, 0x14, 0x02, 0x01, 0x0E, 0x02, 0x00}; // Sensor Region Description
-        get_buffer->appendBytes(buffer, sizeof(buffer));
-    }
-    
-    if (report_id == 0xA1) {
-        unsigned char buffer[] = {0xA1, 0x00, 0x00, 0x05, 0x00, 0xFC, 0x01}; // Sensor Region Param
-        get_buffer->appendBytes(buffer, sizeof(buffer));
-    }
+    memcpy(buffer, feature->response.bytes, feature->response.length);
     
-    if (report_id == 0xD9) {
-        // Sensor Surface Width = 0x3cf0 (0xf0, 0x3c) = 15.600 cm
-        // Sensor Surface Height = 0x2b20 (0x20, 0x2b) = 11.040 cm
-        
-        uint32_t rawWidth = engine->getPhysicalMaxX();
-        uint32_t rawHeight = engine->getPhysicalMaxY();
-        
-        uint8_t rawWidthLower = rawWidth & 0xff;
-        uint8_t rawWidthHigher = (rawWidth >> 8) & 0xff;
-        
-        uint8_t rawHeightLower = rawHeight & 0xff;
-        uint8_t rawHeightHigher = (rawHeight >> 8) & 0xff;
+    if (feature->has_surface) {
+        // Sensor surface size, already in 0.01 mm units
+        UInt8* surface = buffer + feature->surface_offset;
+        UInt32 rawWidth = engine->getPhysicalMaxX();
+        UInt32 rawHeight = engine->getPhysicalMaxY();
         
-        unsigned char buffer[] = {0xD9, rawWidthLower, rawWidthHigher, 0x00, 0x00, rawHeightLower, rawHeightHigher, 0x00, 0x00, 0x44, 0xE3, 0x52, 0xFF, 0xBD, 0x1E, 0xE4, 0x26}; // Sensor Surface Description
-        get_buffer->appendBytes(buffer, sizeof(buffer));
+        surface[MT2_SURFACE_WIDTH_OFFSET] = rawWidth & 0xff;
+        surface[MT2_SURFACE_WIDTH_OFFSET + 1] = (rawWidth >> 8) & 0xff;
+        surface[MT2_SURFACE_HEIGHT_OFFSET] = rawHeight & 0xff;
+        surface[MT2_SURFACE_HEIGHT_OFFSET + 1] = (rawHeight >> 8) & 0xff;
     }
     
-    if (report_id == 0x7F) {
-        unsigned char buffer[] = {0x7F, 0x00, 0x00, 0x00, 0x00};
-        get_buffer->appendBytes(buffer, sizeof(buffer));
-    }
-    
-    if (report_id == 0xC8) {
-        unsigned char buffer[] = {0xC8, 0x08};
-        get_buffer->appendBytes(buffer, sizeof(buffer));
-    }
-    
-    if (report_id == 0x2) {
-        unsigned char buffer[] = {0x02, 0x01};
-        get_buffer->appendBytes(buffer, sizeof(buffer));
-    }
+    return feature->response.length;
+}
+
+IOReturn VoodooInputSimulatorDevice::getReport(IOMemoryDescriptor* report, IOHIDReportType reportType, IOOptionBits options) {
+    UInt32 report_id = options & 0xFF;
     
-    if (report_id == 0xDB) {
-        uint32_t rawWidth = engine->getPhysicalMaxX();
-        uint32_t rawHeight = engine->getPhysicalMaxY();
-        
-        uint8_t rawWidthLower = rawWidth & 0xff;
-        uint8_t rawWidthHigher = (rawWidth >> 8) & 0xff;
-        
-        uint8_t rawHeightLower = rawHeight & 0xff;
-        uint8_t rawHeightHigher = (rawHeight >> 8) & 0xff;
+    if (report_id == 0x1) {
+        if (!feature_response_selected) {
+            return kIOReturnNoResources;
+        }
         
-        unsigned char buffer[] = {0xDB, 0x01, 0x02, 0x00,
-            /* Start 0xD1 */ 0xD1, 0x81, /* End 0xD1 */
-            0x0D, 0x00,
-            /* Start 0xD3 */ 0xD3, 0x01, 0x16, 0x1E, 0x03, 0x95, 0x00, 0x14, 0x1E, 0x62, 0x05, 0x00, 0x00, /* End 0xD3 */
-            0x10, 0x00,
-            /* Start 0xD0 */ 0xD0, 0x02, 0x01, 0x00, 0x14, 0x01, 0x00, 0x1E, 0x00, 0x02, 0x14, 0x02, 0x01, 0x0E, 0x02, 0x00, /* End 0xD0 */
-            0x07, 0x00,
-            /* Start 0xA1 */ 0xA1, 0x00, 0x00, 0x05, 0x00, 0xFC, 0x01, /* End 0xA1 */
-            0x11, 0x00,
-            /* Start 0xD9 */ 0xD9, rawWidthLower, rawWidthHigher, 0x00, 0x00, rawHeightLower, rawHeightHigher, 0x00, 0x00, 0x44, 0xE3, 0x52, 0xFF, 0xBD, 0x1E, 0xE4, 0x26,
-            /* Start 0x7F */ 0x7F, 0x00, 0x00, 0x00, 0x00 /*End 0x7F */};
-        get_buffer->appendBytes(buffer, sizeof(buffer));
+        report->writeBytes(0, feature_response, feature_response_length);
+        return kIOReturnSuccess;
     }
     
-    report->writeBytes(0, get_buffer->getBytesNoCopy(), get_buffer->getLength());
-    
-   if (getReportedAllocated) {
-        get_buffer->release();
-   }
+    UInt8 buffer[MT2_FEATURE_MAX_SIZE];
+    report->writeBytes(0, buffer, copyFeatureResponse(report_id, buffer));
     
     return kIOReturnSuccess;
 }
 
 IOReturn VoodooInputSimulatorDevice::newReportDescriptor(IOMemoryDescriptor** descriptor) const {
-    IOBufferMemoryDescriptor* report_descriptor_buffer = IOBufferMemoryDescriptor::inTaskWithOptions(kernel_task, 0, sizeof(report_descriptor));
-    
-    if (!report_descriptor_buffer) {
+    const VoodooInputHIDTables& tables = VoodooInputGetHIDTables();
+    const UInt8* report_descriptor = composite ? tables.composite_descriptor.bytes : tables.report_descriptor.bytes;
+    size_t report_descriptor_length = composite ? tables.composite_descriptor.length : tables.report_descriptor.length;
+    const VoodooInputArena& arena = engine->getArena();
+    UInt8* report_descriptor_bytes = arena.getBytes(kVoodooInputArenaSimulatorDescriptor);
+    IOSubMemoryDescriptor* report_descriptor_range = arena.newSubRange(kVoodooInputArenaSimulatorDescriptor, 0, report_descriptor_length);
+    
+    if (!report_descriptor_bytes || !report_descriptor_range) {
         IOLog("%s Could not allocate buffer for report descriptor\n", getName());
+        OSSafeReleaseNULL(report_descriptor_range);
         return kIOReturnNoResources;
     }
     
-    report_descriptor_buffer->writeBytes(0, report_descriptor, sizeof(report_descriptor));
-    *descriptor = report_descriptor_buffer;
+    memcpy(report_descriptor_bytes, report_descriptor, report_descriptor_length);
+    *descriptor = report_descriptor_range;
     
     return kIOReturnSuccess;
 }
@@ -526,5 +378,5 @@ OSNumber* VoodooInputSimulatorDevice::newLocationIDNumber() const {
 }
 
 OSNumber* VoodooInputSimulatorDevice::newVersionNumber() const {
-    return OSNumber::withNumber(0x804, 32);
+    return OSNumber::withNumber(VoodooInputGetHIDTables().profile->version, 32);
 }
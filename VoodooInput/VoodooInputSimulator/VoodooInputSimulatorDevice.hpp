@@ -10,6 +10,9 @@
 
 #include <IOKit/IOService.h>
 #include <IOKit/hid/IOHIDDevice.h>
+#include <IOKit/IOSubMemoryDescriptor.h>
+#include <IOKit/IOTimerEventSource.h>
+#include <IOKit/IOInterruptEventSource.h>
 
 #include <kern/clock.h>
 
@@ -17,86 +20,22 @@
 #include "../VoodooInputMultitouch/VoodooInputTransducer.h"
 #include "../VoodooInputMultitouch/VoodooInputEvent.h"
 #include "../VoodooInputMultitouch/MultitouchHelpers.h"
+#include "VoodooInputMT2Report.hpp"
 
 #ifndef EXPORT
 #define EXPORT __attribute__((visibility("default")))
 #endif
 
-#define MT2_MAX_X 8134
-#define MT2_MAX_Y 5206
-
-/* State bits reference: linux/drivers/hid/hid-magicmouse.c#L58-L63 */
-#define MT2_TOUCH_STATE_BIT_TRANSITION (0x1)
-#define MT2_TOUCH_STATE_BIT_NEAR (0x1 << 1)
-#define MT2_TOUCH_STATE_BIT_CONTACT (0x1 << 2)
-
-enum TouchStates {
-    kTouchStateInactive = 0x0,
-    kTouchStateStart = MT2_TOUCH_STATE_BIT_NEAR | MT2_TOUCH_STATE_BIT_TRANSITION,
-    kTouchStateActive = MT2_TOUCH_STATE_BIT_CONTACT,
-    kTouchStateStop = MT2_TOUCH_STATE_BIT_CONTACT | MT2_TOUCH_STATE_BIT_NEAR | MT2_TOUCH_STATE_BIT_TRANSITION
-};
-
-/* Finger Packet
-+---+---+---+---+---+---+---+---+---+
-|   | 7 | 6 | 5 | 4 | 3 | 2 | 1 | 0 |
-+---+---+---+---+---+---+---+---+---+
-| 0 |           x: SInt13           |
-+---+-----------+                   +
-| 1 |           |                   |
-+---+           +-------------------+
-| 2 |           y: SInt13           |
-+---+-----------+-----------+       +
-| 3 |   state   |   finger  |       |
-|   |   UInt3   |   UInt3   |       |
-+---+-----------+-----------+-------+
-| 4 |       touchMajor: UInt8       |
-+---+-------------------------------+
-| 5 |       touchMinor: UInt8       |
-+---+-------------------------------+
-| 6 |          size: UInt8          |
-+---+-------------------------------+
-| 7 |        pressure: UInt8        |
-+---+-----------+---+---------------+
-| 8 |   angle   | 0 |    touchID    |
-|   |   UInt3   |   |     UInt4     |
-+---+-----------+---+---------------+
-*/
-struct __attribute__((__packed__)) MAGIC_TRACKPAD_INPUT_REPORT_FINGER {
-    SInt16 X: 13;
-    SInt16 Y: 13;
-    UInt8 Finger: 3;
-    UInt8 State: 3;
-    UInt8 Touch_Major;
-    UInt8 Touch_Minor;
-    UInt8 Size;
-    UInt8 Pressure;
-    UInt8 Identifier: 4;
-    UInt8 : 1;
-    UInt8 Angle: 3;
-};
-
-struct __attribute__((__packed__)) MAGIC_TRACKPAD_INPUT_REPORT {
-    UInt8 ReportID;
-    UInt8 Button;
-    UInt8 Unused[5];
-    
-    UInt8 TouchActive;
-    
-    UInt8 multitouch_report_id;
-    UInt8 timestamp_buffer[3];
-    
-    MAGIC_TRACKPAD_INPUT_REPORT_FINGER FINGERS[]; // May support more fingers
-};
-
-static_assert(sizeof(MAGIC_TRACKPAD_INPUT_REPORT) == 12, "Unexpected MAGIC_TRACKPAD_INPUT_REPORT size");
-static_assert(sizeof(MAGIC_TRACKPAD_INPUT_REPORT_FINGER) == 9, "Unexpected MAGIC_TRACKPAD_INPUT_REPORT_FINGER size");
-
 class EXPORT VoodooInputSimulatorDevice : public IOHIDDevice {
     OSDeclareDefaultStructors(VoodooInputSimulatorDevice);
     
 public:
     void constructReport(const VoodooInputEvent& multitouch_event);
+    void copyContactStats(VoodooInputContactStats& contact_stats);
+    // Only valid from within the command gate
+    const VoodooInputContactStats& getContactStats() const { return encoder.getContactStats(); }
+    bool isDegraded() const { return encoder.getWatchdog().isDegraded(); }
+    bool isComposite() const { return composite; }
 
     IOReturn setReport(IOMemoryDescriptor* report, IOHIDReportType reportType, IOOptionBits options) override;
 
@@ -122,17 +61,40 @@ public:
 
 private:
     bool ready_for_reports {false};
+    // Also carries the actuator collection, fixed for the lifetime of the device
+    bool composite {false};
     VoodooInput* engine {nullptr};
-    AbsoluteTime start_timestamp {};
-    OSData* new_get_report_buffer {nullptr};
-    bool touch_active[15] {false};
+    // Reply selected through report 0x01, kept in the arena
+    UInt8* feature_response {nullptr};
+    IOByteCount feature_response_length {0};
+    bool feature_response_selected {false};
     IOWorkLoop* work_loop {nullptr};
     IOCommandGate* command_gate {nullptr};
-    IOBufferMemoryDescriptor* input_report_buffer {nullptr};
-    MAGIC_TRACKPAD_INPUT_REPORT* input_report {nullptr};
-
-    void sendReport();
+    // The report lives in the engine arena, handed out through a sub-range retargeted to each length.
+    // handleReport copies it before returning, so one buffer is all the gate can ever use.
+    IOSubMemoryDescriptor* input_report_range {nullptr};
+    // Everything between the gate and handleReport, this device is its sink
+    VoodooInputMT2Encoder encoder;
+    // Runs on the gate of work_loop, only armed while the encoder has interpolated frames to send
+    IOTimerEventSource* interpolation_timer {nullptr};
+    bool interpolation_armed {false};
+    // Runs on the gate of work_loop once it is free, for the frame a busy gate made wait in the encoder
+    IOInterruptEventSource* pending_source {nullptr};
+
+    friend class VoodooInputMT2Encoder;
+    void runGated(const VoodooInputEvent& multitouch_event);
+    bool attemptGated(const VoodooInputEvent& multitouch_event);
+    void schedulePending();
+    void sendReport(const UInt8* report, UInt32 length);
+    void publishSampleProperties();
+    void publishWatchdogProperties();
+
+    size_t copyFeatureResponse(UInt8 report_id, UInt8* buffer) const;
+    void loadSettings();
     void constructReportGated(const VoodooInputEvent& multitouch_event);
+    void constructPendingGated(IOInterruptEventSource* sender, int count);
+    void interpolateGated(IOTimerEventSource* sender);
+    void copyContactStatsGated(VoodooInputContactStats& contact_stats);
 };
 
 
@@ -0,0 +1,93 @@
+//
+//  VoodooInputSoakSource.cpp
+//  VoodooInput
+//
+//  Copyright © 2024 Kishor Prins. All rights reserved.
+//
+
+#include "VoodooInputSoakSource.hpp"
+
+#include <string.h>
+
+// Trackpoint packets walk a square, one side per this many frames
+#define TRACKPOINT_SIDE_FRAMES 32
+#define TRACKPOINT_STEP 3
+
+void VoodooInputSoakSource::start(const VoodooInputSoakParams& params, UInt64 now_ns) {
+    VoodooInputGestureParams gesture {};
+    gesture.scenario = params.scenario < kVoodooInputGestureScenarioCount ? params.scenario : kVoodooInputGestureStress;
+    gesture.seed = 0;
+    gesture.sample_rate = params.rate == 0 ? SOAK_DEFAULT_RATE : (params.rate > SOAK_MAX_RATE ? SOAK_MAX_RATE : params.rate);
+    // Timestamps are taken when a frame is sent, the grid already provides the timing
+    gesture.jitter_us = 0;
+    gesture.logical_max_x = params.logical_max_x;
+    gesture.logical_max_y = params.logical_max_y;
+    gesture.transform = params.transform;
+    gesture.contacts = params.contacts;
+
+    generator.init(gesture, now_ns);
+    trackpoint = params.trackpoint;
+
+    start_ns = now_ns;
+    period_ns = 1000000000ULL / gesture.sample_rate;
+    slot = 0;
+    taken = 0;
+    missed = 0;
+    refused = 0;
+    total_wait_ns = 0;
+    worst_wait_ns = 0;
+}
+
+bool VoodooInputSoakSource::nextFrame(UInt64 now_ns, VoodooInputEvent& event) {
+    if (now_ns < getNextDeadline())
+        return false;
+
+    // Every deadline between the one we were waiting for and now was missed
+    UInt32 latest = (UInt32)((now_ns - start_ns) / period_ns);
+    missed += latest - slot;
+    slot = latest + 1;
+    taken++;
+
+    memset(&event, 0, sizeof(event));
+    generator.next(event);
+    return true;
+}
+
+bool VoodooInputSoakSource::nextTrackpoint(TrackpointReport& report) {
+    if (!trackpoint || taken == 0)
+        return false;
+
+    static const SInt8 directions[4][2] = {{1, 0}, {0, 1}, {-1, 0}, {0, -1}};
+    UInt32 side = ((taken - 1) / TRACKPOINT_SIDE_FRAMES) % 4;
+
+    report.timestamp = 0;
+    report.dx = directions[side][0] * TRACKPOINT_STEP;
+    report.dy = directions[side][1] * TRACKPOINT_STEP;
+    report.buttons = 0;
+    return true;
+}
+
+void VoodooInputSoakSource::recordDelivery(UInt64 wait_ns, bool accepted) {
+    if (!accepted)
+        refused++;
+
+    total_wait_ns += wait_ns;
+    if (wait_ns > worst_wait_ns)
+        worst_wait_ns = wait_ns;
+}
+
+VoodooInputSoakStats VoodooInputSoakSource::getStats(UInt64 now_ns) const {
+    VoodooInputSoakStats stats {};
+    stats.frames = taken - refused;
+    stats.dropped = missed + refused;
+
+    UInt64 elapsed = now_ns > start_ns ? now_ns - start_ns : 0;
+    if (elapsed)
+        stats.achieved_rate = (UInt32)((UInt64)stats.frames * 1000000000ULL / elapsed);
+
+    if (taken) {
+        stats.average_wait_ns = total_wait_ns / taken;
+        stats.worst_wait_ns = worst_wait_ns;
+    }
+    return stats;
+}
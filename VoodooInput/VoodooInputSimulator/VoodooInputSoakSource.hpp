@@ -0,0 +1,71 @@
+//
+//  VoodooInputSoakSource.hpp
+//  VoodooInput
+//
+//  Copyright © 2024 Kishor Prins. All rights reserved.
+//
+
+#ifndef VOODOO_INPUT_SOAK_SOURCE_HPP
+#define VOODOO_INPUT_SOAK_SOURCE_HPP
+
+#include "VoodooInputGestureGenerator.hpp"
+
+#define SOAK_DEFAULT_RATE 125
+#define SOAK_MAX_RATE 1000
+
+struct VoodooInputSoakParams {
+    VoodooInputGestureScenario scenario;
+    UInt32 rate;
+    UInt8 contacts;
+    bool trackpoint;
+    UInt32 logical_max_x;
+    UInt32 logical_max_y;
+    UInt8 transform;
+};
+
+struct VoodooInputSoakStats {
+    UInt32 frames;
+    UInt32 dropped;
+    // Frames per second actually delivered
+    UInt32 achieved_rate;
+    UInt64 average_wait_ns;
+    UInt64 worst_wait_ns;
+};
+
+/*
+ * Schedule and statistics of the built-in soak source. Frames are due on a fixed
+ * grid from start, a deadline that already passed when the next one is taken is
+ * counted as dropped instead of being sent late in a burst. Time is passed in by
+ * the caller, nothing here calls into the kernel.
+ */
+class VoodooInputSoakSource {
+public:
+    void start(const VoodooInputSoakParams& params, UInt64 now_ns);
+
+    // Fills the frame for the latest deadline not after now, false when none is due yet
+    bool nextFrame(UInt64 now_ns, VoodooInputEvent& event);
+    // Trackpoint packet that goes with the frame just taken, false when disabled
+    bool nextTrackpoint(TrackpointReport& report);
+
+    UInt64 getNextDeadline() const { return start_ns + (UInt64)slot * period_ns; }
+
+    // Time the entry point took for one frame, false when it refused the frame
+    void recordDelivery(UInt64 wait_ns, bool accepted);
+
+    VoodooInputSoakStats getStats(UInt64 now_ns) const;
+
+private:
+    VoodooInputGestureGenerator generator;
+    bool trackpoint {false};
+    UInt64 start_ns {0};
+    UInt64 period_ns {0};
+    // Index of the next deadline on the grid
+    UInt32 slot {0};
+    UInt32 taken {0};
+    UInt32 missed {0};
+    UInt32 refused {0};
+    UInt64 total_wait_ns {0};
+    UInt64 worst_wait_ns {0};
+};
+
+#endif // VOODOO_INPUT_SOAK_SOURCE_HPP
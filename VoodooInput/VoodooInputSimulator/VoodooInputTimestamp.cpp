@@ -0,0 +1,63 @@
+//
+//  VoodooInputTimestamp.cpp
+//  VoodooInput
+//
+//  Copyright © 2024 Kishor Prins. All rights reserved.
+//
+
+#include "VoodooInputTimestamp.hpp"
+
+#include <kern/clock.h>
+
+static AbsoluteTime uptime() {
+    AbsoluteTime now;
+    clock_get_uptime(&now);
+    return now;
+}
+
+void VoodooInputTimestamp::init() {
+    UInt64 ns_per_2_32;
+    UInt64 ns_per_2_52;
+    absolutetime_to_nanoseconds(1ULL << 32, &ns_per_2_32);
+    absolutetime_to_nanoseconds(1ULL << 52, &ns_per_2_52);
+
+    clock = uptime;
+    ns_mult = ns_per_2_32;
+    // Rounded up so whole milliseconds never come out one short
+    ms_mult = (UInt64)((((unsigned __int128)ns_per_2_52 << 12) + 999999) / 1000000);
+    epoch = now();
+    last_ms = 0;
+    idle = false;
+}
+
+void VoodooInputTimestamp::init(UInt32 numer, UInt32 denom, Clock replay_clock) {
+    clock = replay_clock ? replay_clock : uptime;
+    ns_mult = (UInt64)((((unsigned __int128)numer << 32) + denom - 1) / denom);
+    ms_mult = (UInt64)((((unsigned __int128)numer << 64) + (unsigned __int128)denom * 1000000 - 1) / ((unsigned __int128)denom * 1000000));
+    epoch = now();
+    last_ms = 0;
+    idle = false;
+}
+
+UInt32 VoodooInputTimestamp::mt2Milliseconds(AbsoluteTime timestamp) {
+    // Frames stamped before the epoch or out of order keep the counter where it is
+    UInt32 ms = timestamp > epoch ? (UInt32)toMilliseconds(timestamp - epoch) : 0;
+
+    // Decided with the time the gesture starts at, an idle period can take the counter close to wrapping too
+    if (idle) {
+        idle = false;
+        if ((ms & MT2_TIMESTAMP_MASK) >= MT2_TIMESTAMP_MASK - MT2_TIMESTAMP_REBASE_MARGIN_MS) {
+            epoch = timestamp;
+            last_ms = ms = 0;
+        }
+    }
+
+    if (ms > last_ms)
+        last_ms = ms;
+    return last_ms;
+}
+
+UInt32 VoodooInputTimestamp::mt2Advance(UInt32 ms) {
+    last_ms += ms;
+    return last_ms;
+}
@@ -0,0 +1,57 @@
+//
+//  VoodooInputTimestamp.hpp
+//  VoodooInput
+//
+//  Copyright © 2024 Kishor Prins. All rights reserved.
+//
+
+#ifndef VOODOO_INPUT_TIMESTAMP_HPP
+#define VOODOO_INPUT_TIMESTAMP_HPP
+
+#include <IOKit/IOService.h>
+
+#include "VoodooInputMT2Codec.hpp"
+
+// The 21 bit millisecond counter wraps every ~35 minutes, restart it between gestures this close to wrapping
+#define MT2_TIMESTAMP_REBASE_MARGIN_MS (5 * 60 * 1000)
+
+/*
+ * Time conversions for the report path. The timebase is turned into multiply-shift
+ * factors once, so a conversion is a single widening multiply instead of the divisions
+ * done by absolutetime_to_nanoseconds. The clock and the factors can be supplied
+ * explicitly to replay long uptimes and counter wraps deterministically.
+ */
+class VoodooInputTimestamp {
+public:
+    typedef AbsoluteTime (*Clock)();
+
+    // Factors of the running kernel, time from clock_get_uptime
+    void init();
+    // Factors for a mach timebase numer/denom pair and an explicit clock
+    void init(UInt32 numer, UInt32 denom, Clock clock);
+
+    AbsoluteTime now() const { return clock(); }
+    UInt64 toNanoseconds(AbsoluteTime duration) const { return scale(duration, ns_mult, 32); }
+    UInt64 toMilliseconds(AbsoluteTime duration) const { return scale(duration, ms_mult, 64); }
+
+    // MT2 header time for a frame, never decreasing until the next rebase
+    UInt32 mt2Milliseconds(AbsoluteTime timestamp);
+    // MT2 header time for a frame synthesized ms after the previous one
+    UInt32 mt2Advance(UInt32 ms);
+    // Called once no contact is down, the first frame after it restarts the epoch if its time is about to wrap
+    void mt2Idle() { idle = true; }
+
+private:
+    Clock clock {nullptr};
+    UInt64 ns_mult {0};
+    UInt64 ms_mult {0};
+    AbsoluteTime epoch {0};
+    UInt32 last_ms {0};
+    bool idle {false};
+
+    static UInt64 scale(UInt64 value, UInt64 mult, UInt8 shift) {
+        return (UInt64)(((unsigned __int128)value * mult) >> shift);
+    }
+};
+
+#endif // VOODOO_INPUT_TIMESTAMP_HPP
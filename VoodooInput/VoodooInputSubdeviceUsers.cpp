@@ -0,0 +1,25 @@
+//
+//  VoodooInputSubdeviceUsers.cpp
+//  VoodooInput
+//
+//  Copyright © 2024 Kishor Prins. All rights reserved.
+//
+
+#include "VoodooInputSubdeviceUsers.hpp"
+
+void VoodooInputSubdeviceUsers::drain(IOLock* lock) {
+    drainers++;
+    OSMemoryBarrier();
+
+    // The lock is dropped while asleep, a caller leaving takes it to wake us
+    while (users)
+        IOLockSleep(lock, (void*)&users, THREAD_UNINT);
+
+    drainers--;
+}
+
+void VoodooInputSubdeviceUsers::wake(IOLock* lock) {
+    IOLockLock(lock);
+    IOLockWakeup(lock, (void*)&users, false);
+    IOLockUnlock(lock);
+}
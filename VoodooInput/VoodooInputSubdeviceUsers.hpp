@@ -0,0 +1,53 @@
+//
+//  VoodooInputSubdeviceUsers.hpp
+//  VoodooInput
+//
+//  Copyright © 2024 Kishor Prins. All rights reserved.
+//
+
+#ifndef VOODOO_INPUT_SUBDEVICE_USERS_HPP
+#define VOODOO_INPUT_SUBDEVICE_USERS_HPP
+
+#include <IOKit/IOService.h>
+#include <IOKit/IOLocks.h>
+#include <libkern/OSAtomic.h>
+
+/*
+ * Lets callers use a subdevice loaded from a published pointer without a lock or a
+ * reference. A caller enters before it loads the pointer and leaves once it is done
+ * with the subdevice. A stopper clears the pointer, then drains: callers that entered
+ * before are waited for, later ones load the cleared pointer.
+ *
+ * Each side puts a full barrier between its store and its load, so either the caller
+ * sees the pointer cleared or the stopper sees the caller counted. Leaving only takes
+ * the lock while a stopper is waiting.
+ */
+class VoodooInputSubdeviceUsers {
+public:
+    inline void enter() {
+        OSIncrementAtomic(&users);
+        OSMemoryBarrier();
+    }
+
+    inline void leave(IOLock* lock) {
+        OSMemoryBarrier();
+        OSDecrementAtomic(&users);
+        OSMemoryBarrier();
+        if (__builtin_expect(drainers != 0, false))
+            wake(lock);
+    }
+
+    // Called with lock held once the subdevice is unpublished, sleeps until every caller that may still use it left
+    void drain(IOLock* lock);
+
+    UInt32 getUsers() const { return (UInt32)users; }
+
+private:
+    volatile SInt32 users {0};
+    // Stoppers in drain(), changed with the lock held
+    volatile SInt32 drainers {0};
+
+    void wake(IOLock* lock);
+};
+
+#endif // VOODOO_INPUT_SUBDEVICE_USERS_HPP
@@ -0,0 +1,69 @@
+//
+//  VoodooInputTrace.cpp
+//  VoodooInput
+//
+//  Copyright © 2024 Kishor Prins. All rights reserved.
+//
+
+#include "VoodooInputTrace.hpp"
+
+bool VoodooInputTrace::enable() {
+    if (enabled)
+        return true;
+
+    if (!records) {
+        records = (VoodooInputTraceRecord*)IOMalloc(sizeof(VoodooInputTraceRecord) * VOODOO_INPUT_TRACE_RECORDS);
+        if (!records)
+            return false;
+    }
+
+    memset(records, 0, sizeof(VoodooInputTraceRecord) * VOODOO_INPUT_TRACE_RECORDS);
+    head = 0;
+    OSMemoryBarrier();
+    enabled = true;
+    return true;
+}
+
+void VoodooInputTrace::disable() {
+    enabled = false;
+    OSMemoryBarrier();
+
+    // Writers never block, this is at most one record per CPU
+    while (writers)
+        IODelay(1);
+}
+
+// Must not race with enable()
+void VoodooInputTrace::release() {
+    disable();
+    if (records) {
+        IOFree(records, sizeof(VoodooInputTraceRecord) * VOODOO_INPUT_TRACE_RECORDS);
+        records = nullptr;
+    }
+}
+
+OSData* VoodooInputTrace::dump() const {
+    if (!records || enabled)
+        return nullptr;
+
+    UInt32 total = static_cast<UInt32>(head);
+    UInt32 count = min(total, (UInt32)VOODOO_INPUT_TRACE_RECORDS);
+    UInt32 first = total - count;
+
+    OSData* data = OSData::withCapacity(sizeof(VoodooInputTraceHeader) + sizeof(VoodooInputTraceRecord) * count);
+    if (!data)
+        return nullptr;
+
+    VoodooInputTraceHeader header {VOODOO_INPUT_TRACE_MAGIC, VOODOO_INPUT_TRACE_VERSION, sizeof(VoodooInputTraceRecord), count, total};
+    data->appendBytes(&header, sizeof(header));
+
+    for (UInt32 i = 0; i < count; i++) {
+        VoodooInputTraceRecord entry = records[(first + i) & (VOODOO_INPUT_TRACE_RECORDS - 1)];
+        UInt64 nanoseconds;
+        absolutetime_to_nanoseconds(entry.timestamp, &nanoseconds);
+        entry.timestamp = nanoseconds;
+        data->appendBytes(&entry, sizeof(entry));
+    }
+
+    return data;
+}
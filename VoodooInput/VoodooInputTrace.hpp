@@ -0,0 +1,93 @@
+//
+//  VoodooInputTrace.hpp
+//  VoodooInput
+//
+//  Copyright © 2024 Kishor Prins. All rights reserved.
+//
+
+#ifndef VOODOO_INPUT_TRACE_HPP
+#define VOODOO_INPUT_TRACE_HPP
+
+#include <IOKit/IOService.h>
+#include <libkern/OSAtomic.h>
+#include <kern/clock.h>
+
+/* Trace record types, keep in sync with Scripts/trace_decode.py */
+enum VoodooInputTraceType : UInt8 {
+    kVoodooInputTraceFrameIn = 1,
+    kVoodooInputTraceGateAcquired,
+    kVoodooInputTraceReportSent,
+    kVoodooInputTraceLiftOff,
+    kVoodooInputTraceDropped,
+    kVoodooInputTraceTrackpointPacket,
+};
+
+enum VoodooInputTraceDropReason : UInt8 {
+    kVoodooInputTraceDropNotReady = 1,
+    kVoodooInputTraceDropErrorInput,
+};
+
+struct __attribute__((__packed__)) VoodooInputTraceRecord {
+    UInt64 timestamp;
+    UInt8 type;
+    UInt8 arg0;
+    UInt16 arg1;
+    UInt32 arg2;
+};
+
+/* Dump layout: header followed by count records, oldest first, timestamps in ns */
+struct __attribute__((__packed__)) VoodooInputTraceHeader {
+    UInt32 magic;
+    UInt16 version;
+    UInt16 record_size;
+    UInt32 count;
+    UInt32 total;
+};
+
+static_assert(sizeof(VoodooInputTraceRecord) == 16, "Unexpected VoodooInputTraceRecord size");
+static_assert(sizeof(VoodooInputTraceHeader) == 16, "Unexpected VoodooInputTraceHeader size");
+
+#define VOODOO_INPUT_TRACE_MAGIC 0x52544956 // 'VITR'
+#define VOODOO_INPUT_TRACE_VERSION 1
+#define VOODOO_INPUT_TRACE_RECORDS 1024
+
+static_assert((VOODOO_INPUT_TRACE_RECORDS & (VOODOO_INPUT_TRACE_RECORDS - 1)) == 0, "Trace ring size must be a power of two");
+
+class VoodooInputTrace {
+public:
+    // Keeps what was recorded so far when already enabled
+    bool enable();
+    // Returns once no writer is left in record()
+    void disable();
+    void release();
+    // Only while disabled, the ring may be half written otherwise
+    OSData* dump() const;
+
+    inline void record(UInt8 type, UInt8 arg0 = 0, UInt16 arg1 = 0, UInt32 arg2 = 0) {
+        if (!enabled)
+            return;
+
+        // Checked again once counted, disable() waits for every writer that got in
+        OSIncrementAtomic(&writers);
+        if (enabled) {
+            UInt32 slot = static_cast<UInt32>(OSIncrementAtomic(&head)) & (VOODOO_INPUT_TRACE_RECORDS - 1);
+            VoodooInputTraceRecord& entry = records[slot];
+            UInt64 now;
+            clock_get_uptime(&now);
+            entry.timestamp = now;
+            entry.type = type;
+            entry.arg0 = arg0;
+            entry.arg1 = arg1;
+            entry.arg2 = arg2;
+        }
+        OSDecrementAtomic(&writers);
+    }
+
+private:
+    volatile bool enabled {false};
+    volatile SInt32 head {0};
+    volatile SInt32 writers {0};
+    VoodooInputTraceRecord* records {nullptr};
+};
+
+#endif // VOODOO_INPUT_TRACE_HPP